@@ -42,6 +42,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 // *****************************************************************************
 // Private types and definitions
@@ -57,6 +58,10 @@ typedef enum { COMS_MGR_STATES(EXPAND_STATE_ENUMS) } coms_mgr_state_t;
 typedef struct {
     mu_task_t task;           // the coms_mgr task object
     mu_task_t *on_completion; // called on completion or error
+    char *buf;                // caller's buffer for the received msg
+    size_t capacity;          // size of buf
+    size_t bytes_received;    // bytes of the msg read into buf so far
+    SERCOM_USART_EVENT event; // set by coms_rx_cb()
     bool had_error;
 } coms_mgr_t;
 
@@ -99,6 +104,13 @@ static inline mu_task_t *coms_mgr_task(void) { return &s_coms_mgr.task; }
  */
 static void coms_mgr_fn(mu_task_t *task, void *arg);
 
+/**
+ * @brief Read what the USART has received straight into the caller's buffer,
+ * as far as it has room.  Return true if the msg is null terminated or the
+ * buffer is full.
+ */
+static bool read_msg(void);
+
 /**
  * @brief Set terminal state and invoke on_completion task.
  */
@@ -157,19 +169,9 @@ static void coms_mgr_fn(mu_task_t *task, void *arg) {
         case SERCOM_USART_EVENT_READ_THRESHOLD_REACHED:
         case SERCOM_USART_EVENT_READ_BUFFER_FULL: {
             /* bytes are available in the receive ring buffer */
-            char ch;
-
-            while ((self->bytes_received < self->capacity) &&
-                   ((SERCOM3_USART_Read(&ch, 1) == 1))) {
-                // quit on null terminator or full buffer
-                self->buf[self->bytes_received++] = ch;
-                if (ch == '\0') {
-                    break;
-                }
-            }
             // If null terminator or buffer full, call continuation.  Else
             // wait for more characters.
-            if ((ch == '\0') || (self->bytes_received == self->capacity)) {
+            if (read_msg()) {
                 endgame(false);
             } else {
                 mu_task_wait(task, COMS_MGR_STATE_AWAIT_RQST);
@@ -203,6 +205,27 @@ static void coms_mgr_fn(mu_task_t *task, void *arg) {
     } // switch
 }
 
+static bool read_msg(void) {
+    coms_mgr_t *self = coms_mgr();
+    char *start = &self->buf[self->bytes_received];
+    size_t n = SERCOM3_USART_Read(start, self->capacity - self->bytes_received);
+
+    self->bytes_received += n;
+    // quit on null terminator or full buffer
+    char *nul = memchr(start, '\0', n);
+    if (nul != NULL) {
+        // Each request gets a single reply, so nothing should follow it.
+        size_t extra = self->bytes_received - (nul - self->buf + 1);
+        if (extra > 0) {
+            MU_LOG_WARN("coms_mgr: dropped %u bytes after msg",
+                        (unsigned int)extra);
+        }
+        self->bytes_received -= extra;
+        return true;
+    }
+    return self->bytes_received == self->capacity;
+}
+
 static void endgame(bool had_error) {
     coms_mgr_t *self = coms_mgr();
     mu_task_t *task = coms_mgr_task();
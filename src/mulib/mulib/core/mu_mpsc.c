@@ -0,0 +1,113 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// *****************************************************************************
+// includes
+
+#include "mu_mpsc.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+// *****************************************************************************
+// private types and definitions
+
+// *****************************************************************************
+// private declarations
+
+// *****************************************************************************
+// local storage
+
+// *****************************************************************************
+// public code
+
+void mu_mpsc_init(mu_mpsc_t *q) {
+  atomic_store_explicit(&q->stub.next, NULL, memory_order_relaxed);
+  atomic_store_explicit(&q->tail, &q->stub, memory_order_relaxed);
+  q->head = &q->stub;
+}
+
+void mu_mpsc_push(mu_mpsc_t *q, mu_mpsc_node_t *node) {
+  atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+  // Claim the tail, then link the previous tail to the node.  The release
+  // publishes the node (and the item around it) to the consumer.
+  mu_mpsc_node_t *prev =
+      atomic_exchange_explicit(&q->tail, node, memory_order_acq_rel);
+  atomic_store_explicit(&prev->next, node, memory_order_release);
+}
+
+mu_mpsc_node_t *mu_mpsc_pop(mu_mpsc_t *q) {
+  mu_mpsc_node_t *head = q->head;
+  mu_mpsc_node_t *next =
+      atomic_load_explicit(&head->next, memory_order_acquire);
+
+  if (head == &q->stub) {
+    if (next == NULL) {
+      return NULL; // empty
+    }
+    // Step past the stub.
+    q->head = next;
+    head = next;
+    next = atomic_load_explicit(&head->next, memory_order_acquire);
+  }
+  if (next != NULL) {
+    q->head = next;
+    return head;
+  }
+  // head is the last linked node.  If it is not the tail, a push is under way
+  // and its node will be linked shortly.
+  if (head != atomic_load_explicit(&q->tail, memory_order_acquire)) {
+    return NULL;
+  }
+  // head is the only node: queue the stub behind it so head can be removed.
+  mu_mpsc_push(q, &q->stub);
+  next = atomic_load_explicit(&head->next, memory_order_acquire);
+  if (next != NULL) {
+    q->head = next;
+    return head;
+  }
+  return NULL; // a producer got in ahead of the stub; try again later
+}
+
+bool mu_mpsc_is_empty(mu_mpsc_t *q) {
+  return mu_mpsc_peek(q) == NULL;
+}
+
+mu_mpsc_node_t *mu_mpsc_peek(mu_mpsc_t *q) {
+  mu_mpsc_node_t *node = q->head;
+  if (node == &q->stub) {
+    node = atomic_load_explicit(&node->next, memory_order_acquire);
+  }
+  return node;
+}
+
+mu_mpsc_node_t *mu_mpsc_next(mu_mpsc_t *q, mu_mpsc_node_t *node) {
+  node = atomic_load_explicit(&node->next, memory_order_acquire);
+  if (node == &q->stub) {
+    node = atomic_load_explicit(&node->next, memory_order_acquire);
+  }
+  return node;
+}
+
+// *****************************************************************************
+// private code
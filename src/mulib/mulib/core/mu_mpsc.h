@@ -0,0 +1,125 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @brief An intrusive, lock-free Multiple Producer / Single Consumer queue.
+ *
+ * Items embed a mu_mpsc_node_t and are linked through it, so the queue never
+ * fills and needs no storage of its own.  Any number of threads may push: a
+ * push is one atomic exchange plus one store, and never blocks or retries.
+ * One thread pops.  This is Dmitry Vyukov's non-intrusive MPSC queue made
+ * intrusive with a stub node.
+ *
+ * A push that has exchanged the tail but not yet linked its node hides that
+ * node, and any pushed after it, from the consumer for that instant:
+ * mu_mpsc_pop() returns NULL as if the queue were empty, and the items appear
+ * on a later call.  Producers should therefore wake the consumer after pushing
+ * rather than rely on it having seen the queue non-empty.
+ */
+
+#ifndef _MU_MPSC_H_
+#define _MU_MPSC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// includes
+
+#include "mu_spsc.h" // for MU_SPSC_ALIGNED
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// *****************************************************************************
+// types and definitions
+
+// Embed one of these in each item to be queued.  An item may be in at most one
+// queue at a time, once.
+typedef struct _mu_mpsc_node {
+  struct _mu_mpsc_node *_Atomic next;
+} mu_mpsc_node_t;
+
+typedef struct {
+  // Exchanged by producers.
+  MU_SPSC_ALIGNED mu_mpsc_node_t *_Atomic tail;
+  // Used by the consumer.
+  MU_SPSC_ALIGNED mu_mpsc_node_t *head;
+  mu_mpsc_node_t stub; // keeps the list non-empty
+} mu_mpsc_t;
+
+// Recover a pointer to an item from a pointer to its embedded node.
+#define MU_MPSC_CONTAINER_OF(node, type, member)                               \
+  ((type *)((char *)(node) - offsetof(type, member)))
+
+// *****************************************************************************
+// declarations
+
+/**
+ * @brief Initialize the queue to empty.  Not thread safe!
+ *
+ * The queue holds pointers to its own stub node, so it must not be moved or
+ * copied once initialized.
+ */
+void mu_mpsc_init(mu_mpsc_t *q);
+
+/**
+ * @brief Append a node to the queue.  May be called from any thread.
+ */
+void mu_mpsc_push(mu_mpsc_t *q, mu_mpsc_node_t *node);
+
+/**
+ * @brief Remove the node at the head of the queue.  May only be called by the
+ * consumer.
+ *
+ * @return The node, or NULL if the queue is empty or its head is still being
+ * pushed.  Once returned, the node may be pushed again.
+ */
+mu_mpsc_node_t *mu_mpsc_pop(mu_mpsc_t *q);
+
+/**
+ * @brief Return true if the consumer can see no nodes in the queue.  May only
+ * be called by the consumer.
+ */
+bool mu_mpsc_is_empty(mu_mpsc_t *q);
+
+/**
+ * @brief Return the node at the head of the queue without removing it, or
+ * NULL.  May only be called by the consumer.
+ */
+mu_mpsc_node_t *mu_mpsc_peek(mu_mpsc_t *q);
+
+/**
+ * @brief Return the node after node, or NULL.  Together with mu_mpsc_peek(),
+ * this walks the nodes the consumer can see, in order.  May only be called by
+ * the consumer, and not across a call to mu_mpsc_pop().
+ */
+mu_mpsc_node_t *mu_mpsc_next(mu_mpsc_t *q, mu_mpsc_node_t *node);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // #ifndef _MU_MPSC_H_
@@ -0,0 +1,209 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// *****************************************************************************
+// includes
+
+#include "mu_ringbuf.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// *****************************************************************************
+// private types and definitions
+
+// *****************************************************************************
+// private declarations
+
+#define IS_POWER_OF_TWO(n) (((n) & ((n)-1)) == 0)
+
+/**
+ * @brief Describe the n bytes starting at index as up to two spans.
+ */
+static void make_spans(mu_ringbuf_t *rb, uint32_t index, uint32_t n,
+                       mu_ringbuf_span_t spans[2]);
+
+/**
+ * @brief Copy up to n bytes between buf and the spans, in the direction given.
+ * Return the number of bytes copied.
+ */
+static uint32_t copy_spans(mu_ringbuf_span_t spans[2], uint8_t *buf,
+                           uint32_t n, bool to_spans);
+
+// *****************************************************************************
+// local storage
+
+// *****************************************************************************
+// public code
+
+mu_ringbuf_err_t mu_ringbuf_init(mu_ringbuf_t *rb,
+                                 uint8_t *store,
+                                 uint32_t capacity) {
+  if ((capacity < 2) || (capacity > MU_RINGBUF_MAX_CAPACITY) ||
+      !IS_POWER_OF_TWO(capacity)) {
+    return MU_RINGBUF_ERR_SIZE;
+  }
+  rb->mask = capacity - 1;
+  rb->mirrored = false;
+  rb->store = store;
+  return mu_ringbuf_reset(rb);
+}
+
+mu_ringbuf_err_t mu_ringbuf_init_mirrored(mu_ringbuf_t *rb,
+                                          uint8_t *store,
+                                          uint32_t capacity) {
+  mu_ringbuf_err_t err = mu_ringbuf_init(rb, store, capacity);
+
+  if (err == MU_RINGBUF_ERR_NONE) {
+    rb->mirrored = true;
+  }
+  return err;
+}
+
+mu_ringbuf_err_t mu_ringbuf_reset(mu_ringbuf_t *rb) {
+  atomic_store_explicit(&rb->head, 0, memory_order_relaxed);
+  atomic_store_explicit(&rb->tail, 0, memory_order_relaxed);
+  rb->tail_cache = 0;
+  rb->head_cache = 0;
+  return MU_RINGBUF_ERR_NONE;
+}
+
+uint32_t mu_ringbuf_capacity(mu_ringbuf_t *rb) { return rb->mask + 1; }
+
+uint32_t mu_ringbuf_count(mu_ringbuf_t *rb) {
+  uint32_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+  uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+  return tail - head;
+}
+
+bool mu_ringbuf_is_empty(mu_ringbuf_t *rb) { return mu_ringbuf_count(rb) == 0; }
+
+uint32_t mu_ringbuf_reserve_write(mu_ringbuf_t *rb,
+                                  mu_ringbuf_span_t spans[2]) {
+  uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+  uint32_t room;
+
+  // The acquire pairs with the consumer's release of head, so it is done with
+  // the bytes being handed back out.
+  rb->head_cache = atomic_load_explicit(&rb->head, memory_order_acquire);
+  room = rb->mask + 1 - (tail - rb->head_cache);
+  make_spans(rb, tail, room, spans);
+  return room;
+}
+
+uint32_t mu_ringbuf_commit_write(mu_ringbuf_t *rb, uint32_t n) {
+  uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+  uint32_t room = rb->mask + 1 - (tail - rb->head_cache);
+
+  if (n > room) {
+    n = room;
+  }
+  if (n > 0) {
+    atomic_store_explicit(&rb->tail, tail + n, memory_order_release);
+  }
+  return n;
+}
+
+uint32_t mu_ringbuf_peek_read(mu_ringbuf_t *rb, mu_ringbuf_span_t spans[2]) {
+  uint32_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+  uint32_t avail;
+
+  // The acquire pairs with the producer's release of tail, so the bytes are
+  // visible.
+  rb->tail_cache = atomic_load_explicit(&rb->tail, memory_order_acquire);
+  avail = rb->tail_cache - head;
+  make_spans(rb, head, avail, spans);
+  return avail;
+}
+
+uint32_t mu_ringbuf_consume(mu_ringbuf_t *rb, uint32_t n) {
+  uint32_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+  uint32_t avail = rb->tail_cache - head;
+
+  if (n > avail) {
+    n = avail;
+  }
+  if (n > 0) {
+    atomic_store_explicit(&rb->head, head + n, memory_order_release);
+  }
+  return n;
+}
+
+uint32_t mu_ringbuf_write(mu_ringbuf_t *rb, const void *src, uint32_t n) {
+  mu_ringbuf_span_t spans[2];
+
+  mu_ringbuf_reserve_write(rb, spans);
+  n = copy_spans(spans, (uint8_t *)src, n, true);
+  return mu_ringbuf_commit_write(rb, n);
+}
+
+uint32_t mu_ringbuf_read(mu_ringbuf_t *rb, void *dst, uint32_t n) {
+  mu_ringbuf_span_t spans[2];
+
+  mu_ringbuf_peek_read(rb, spans);
+  n = copy_spans(spans, (uint8_t *)dst, n, false);
+  return mu_ringbuf_consume(rb, n);
+}
+
+// *****************************************************************************
+// private code
+
+static void make_spans(mu_ringbuf_t *rb, uint32_t index, uint32_t n,
+                       mu_ringbuf_span_t spans[2]) {
+  uint32_t offset = index & rb->mask;
+  uint32_t first = rb->mask + 1 - offset; // bytes before the end of the store
+
+  spans[0].data = &rb->store[offset];
+  if (rb->mirrored || (n <= first)) {
+    spans[0].len = n;
+    spans[1].data = rb->store;
+    spans[1].len = 0;
+  } else {
+    spans[0].len = first;
+    spans[1].data = rb->store;
+    spans[1].len = n - first;
+  }
+}
+
+static uint32_t copy_spans(mu_ringbuf_span_t spans[2], uint8_t *buf,
+                           uint32_t n, bool to_spans) {
+  uint32_t copied = 0;
+
+  for (int i = 0; (i < 2) && (copied < n); i++) {
+    uint32_t len = spans[i].len;
+
+    if (len > n - copied) {
+      len = n - copied;
+    }
+    if (to_spans) {
+      memcpy(spans[i].data, &buf[copied], len);
+    } else {
+      memcpy(&buf[copied], spans[i].data, len);
+    }
+    copied += len;
+  }
+  return copied;
+}
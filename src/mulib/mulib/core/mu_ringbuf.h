@@ -0,0 +1,195 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @brief A lock-free Single Producer / Single Consumer ring of bytes.
+ *
+ * mu_ringbuf moves bytes between a producer (e.g. a receive interrupt or a
+ * reader thread) and a consumer without copying them through an intermediate
+ * buffer.  Rather than put and get, each side asks for a span of the store:
+ *
+ *    mu_ringbuf_span_t spans[2];
+ *    uint32_t n = mu_ringbuf_reserve_write(&rb, spans);
+ *    n = read_from_device(spans[0].data, spans[0].len); // fill in place...
+ *    mu_ringbuf_commit_write(&rb, n);                    // ...then publish
+ *
+ *    n = mu_ringbuf_peek_read(&rb, spans);
+ *    n = parse(spans[0].data, spans[0].len);             // use in place...
+ *    mu_ringbuf_consume(&rb, n);                         // ...then free
+ *
+ * Free space or data that wraps past the end of the store is handed out as two
+ * spans; spans[1] is empty when it doesn't wrap.  A store that is mapped twice
+ * in a row in virtual memory (see extras/mu_ringbuf_host.h) never wraps, so
+ * a mirrored ring always hands out a single span.
+ *
+ * head and tail follow the same rules as mu_spsc: the producer publishes bytes
+ * with a release store of tail and the consumer frees them with a release
+ * store of head, so the two sides may run on different cores.
+ */
+
+#ifndef _MU_RINGBUF_H_
+#define _MU_RINGBUF_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// includes
+
+#include "mu_spsc.h" // for MU_SPSC_ALIGNED
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// *****************************************************************************
+// types and definitions
+
+typedef enum {
+  MU_RINGBUF_ERR_NONE,
+  MU_RINGBUF_ERR_SIZE,
+} mu_ringbuf_err_t;
+
+// The largest capacity that can be passed to mu_ringbuf_init().
+#define MU_RINGBUF_MAX_CAPACITY ((uint32_t)1 << 31)
+
+// A contiguous run of bytes within the store.
+typedef struct {
+  uint8_t *data;
+  uint32_t len;
+} mu_ringbuf_span_t;
+
+// head and tail count bytes ever consumed and committed, wrapping at 2^32: byte
+// i lives at store[i & mask] and the ring holds tail - head bytes.  Unlike
+// mu_spsc, every byte of the store can be filled.
+typedef struct {
+  // Written by the consumer.
+  MU_SPSC_ALIGNED _Atomic uint32_t head;
+  uint32_t tail_cache; // the consumer's last reading of tail
+  // Written by the producer.
+  MU_SPSC_ALIGNED _Atomic uint32_t tail;
+  uint32_t head_cache; // the producer's last reading of head
+  // Set by mu_ringbuf_init() and read only thereafter.
+  MU_SPSC_ALIGNED uint32_t mask;
+  bool mirrored; // store[i + capacity] aliases store[i]
+  uint8_t *store;
+} mu_ringbuf_t;
+
+// *****************************************************************************
+// declarations
+
+/**
+ * @brief Initialize a ring with a backing store of capacity bytes.  capacity
+ * must be a power of two, from 2 to MU_RINGBUF_MAX_CAPACITY.
+ */
+mu_ringbuf_err_t mu_ringbuf_init(mu_ringbuf_t *rb,
+                                 uint8_t *store,
+                                 uint32_t capacity);
+
+/**
+ * @brief Initialize a ring whose store is followed in memory by a mirror of
+ * itself, so that store[i + capacity] is the same byte as store[i].  Spans
+ * handed out by the ring then never wrap.
+ */
+mu_ringbuf_err_t mu_ringbuf_init_mirrored(mu_ringbuf_t *rb,
+                                          uint8_t *store,
+                                          uint32_t capacity);
+
+/**
+ * @brief Reset the ring to empty.  Not interrupt safe!
+ */
+mu_ringbuf_err_t mu_ringbuf_reset(mu_ringbuf_t *rb);
+
+/**
+ * @brief Return the number of bytes the ring can hold.
+ */
+uint32_t mu_ringbuf_capacity(mu_ringbuf_t *rb);
+
+/**
+ * @brief Return the number of bytes in the ring.  Like mu_spsc_count(), this is
+ * a snapshot unless the other side is idle.
+ */
+uint32_t mu_ringbuf_count(mu_ringbuf_t *rb);
+
+/**
+ * @brief Return true if the ring holds no bytes.
+ */
+bool mu_ringbuf_is_empty(mu_ringbuf_t *rb);
+
+/**
+ * @brief Return the free space in the ring as up to two spans, in order.  The
+ * producer may fill any prefix of them and then publish it with
+ * mu_ringbuf_commit_write().  May only be called by the producer.
+ *
+ * @return The total number of free bytes, spans[0].len + spans[1].len.
+ */
+uint32_t mu_ringbuf_reserve_write(mu_ringbuf_t *rb, mu_ringbuf_span_t spans[2]);
+
+/**
+ * @brief Publish the first n bytes of the space returned by the last call to
+ * mu_ringbuf_reserve_write().  n is clipped to the free space.  May only be
+ * called by the producer.
+ *
+ * @return The number of bytes published.
+ */
+uint32_t mu_ringbuf_commit_write(mu_ringbuf_t *rb, uint32_t n);
+
+/**
+ * @brief Return the bytes in the ring as up to two spans, oldest first.  They
+ * remain in the ring until released by mu_ringbuf_consume().  May only be
+ * called by the consumer.
+ *
+ * @return The total number of bytes, spans[0].len + spans[1].len.
+ */
+uint32_t mu_ringbuf_peek_read(mu_ringbuf_t *rb, mu_ringbuf_span_t spans[2]);
+
+/**
+ * @brief Release the oldest n bytes.  n is clipped to the bytes in the ring.
+ * May only be called by the consumer.
+ *
+ * @return The number of bytes released.
+ */
+uint32_t mu_ringbuf_consume(mu_ringbuf_t *rb, uint32_t n);
+
+/**
+ * @brief Copy up to n bytes from src into the ring.  May only be called by the
+ * producer.
+ *
+ * @return The number of bytes copied, which is less than n if the ring fills.
+ */
+uint32_t mu_ringbuf_write(mu_ringbuf_t *rb, const void *src, uint32_t n);
+
+/**
+ * @brief Copy up to n bytes from the ring into dst and release them.  May only
+ * be called by the consumer.
+ *
+ * @return The number of bytes copied, which is less than n if the ring empties.
+ */
+uint32_t mu_ringbuf_read(mu_ringbuf_t *rb, void *dst, uint32_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // #ifndef _MU_RINGBUF_H_
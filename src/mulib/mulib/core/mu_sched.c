@@ -25,250 +25,2443 @@
  *
  */
 
+
 // *****************************************************************************
 // Includes
 
-#include "mu_sched.h"
+#include "mu_sched.h"
+
+#include "mu_config.h"
+#include "mu_mqueue.h"
+#include "mu_spsc.h"
+#include "mu_task.h"
+#include "mu_time.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef MU_CONFIG_SCHED_EXEC
+#include "mu_exec.h"
+#endif
+
+// #include <stdio.h> // debugging
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+_Static_assert(MU_CONFIG_SCHED_ASAP_PRIORITIES >= 1 &&
+                   MU_CONFIG_SCHED_ASAP_PRIORITIES <= 32,
+               "MU_CONFIG_SCHED_ASAP_PRIORITIES must be between 1 and 32");
+
+// A deferred_task associates a task and a time.
+typedef mu_sched_deferred_t deferred_task_t;
+
+#ifdef MU_CONFIG_SCHED_FAIR
+// The classes of task that take turns in mu_sched_step().
+typedef enum {
+    FAIR_CLASS_IRQ,
+    FAIR_CLASS_DEFERRED,
+    FAIR_CLASS_ASAP,
+    FAIR_CLASS_COUNT,
+} fair_class_t;
+#endif
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+/**
+ * @brief Return the scheduler that calls on behalf of the running task (or of
+ * code outside any task) should go to.
+ */
+static mu_sched_t *current(void);
+
+/**
+ * @brief Return the next deferred task in the queue, or NULL if there is none.
+ */
+static deferred_task_t *peek_next_deferred_task(mu_sched_t *sched);
+
+/**
+ * @brief Fetch the next task, if any, from the deferred task queue that is
+ * runnable as of now.
+ */
+static mu_task_t *fetch_runnable_deferred_task(mu_sched_t *sched,
+                                               mu_time_abs_t now);
+
+/**
+ * @brief Run one batch of tasks (see mu_sched_drain()).
+ *
+ * If has_now is false, the clock is read only if there are deferred tasks.
+ * An earlier reading can't stand in for it: it shows only that the time is no
+ * earlier than it was, never that the head of the queue isn't due yet.
+ */
+static int run_batch(mu_sched_t *sched, bool has_now, mu_time_abs_t now);
+
+/**
+ * @brief Run a task as the current task.
+ */
+static void run_task(mu_sched_t *sched, mu_task_t *task);
+
+/**
+ * @brief Fetch the next task, if any, from the irq queue (or, once that is
+ * empty, from the thread queue).
+ */
+static mu_task_t *fetch_irq_task(mu_sched_t *sched);
+
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
+/**
+ * @brief Fetch the next task, if any, from the thread queue.
+ */
+static mu_task_t *fetch_thread_task(mu_sched_t *sched);
+#endif
+
+/**
+ * @brief Fetch the next task, if any, from the highest priority asap queue.
+ */
+static mu_task_t *fetch_asap_task(mu_sched_t *sched);
+
+/**
+ * @brief Set *slot to the value that stands for task in the irq and asap
+ * queues.  Return false if the task can't be registered.
+ */
+static bool slot_for(mu_task_t *task, mu_sched_slot_t *slot);
+
+/**
+ * @brief Return the task that a queue slot value stands for.
+ */
+static mu_task_t *slot_task(mu_sched_slot_t slot);
+
+/**
+ * @brief Return the number of tasks the irq queue can hold.
+ */
+static size_t irq_capacity(mu_sched_t *sched);
+
+/**
+ * @brief Add a slot to the irq queue.  Return false if it is full.  Producer
+ * only.
+ */
+static bool irq_put(mu_sched_t *sched, mu_sched_slot_t slot);
+
+/**
+ * @brief Take a slot from the irq queue.  Return false if it is empty.
+ * Consumer only.
+ */
+static bool irq_get(mu_sched_t *sched, mu_sched_slot_t *slot);
+
+/**
+ * @brief Return the number of slots in the irq queue.
+ */
+static size_t irq_count(mu_sched_t *sched);
+
+/**
+ * @brief Read the nth slot (counting from the next to run) of the irq queue.
+ * Return false if there are not that many.
+ */
+static bool irq_at(mu_sched_t *sched, size_t n, mu_sched_slot_t *slot);
+
+/**
+ * @brief Add a slot to an asap queue.  Return false if it is full.
+ */
+static bool asap_put(mu_sched_asap_queue_t *q, mu_sched_slot_t slot);
+
+/**
+ * @brief Take a slot from an asap queue.  Return false if it is empty.
+ */
+static bool asap_get(mu_sched_asap_queue_t *q, mu_sched_slot_t *slot);
+
+/**
+ * @brief Read the first slot of an asap queue.  Return false if it is empty.
+ */
+static bool asap_peek(mu_sched_asap_queue_t *q, mu_sched_slot_t *slot);
+
+/**
+ * @brief Return the number of slots in an asap queue.
+ */
+static size_t asap_count(mu_sched_asap_queue_t *q);
+
+/**
+ * @brief Read the nth slot (counting from the next to run) of an asap queue.
+ * Return false if there are not that many.
+ */
+static bool asap_at(mu_sched_asap_queue_t *q, size_t n, mu_sched_slot_t *slot);
+
+/**
+ * @brief Make an asap queue empty, with the given storage.
+ */
+static void asap_init(mu_sched_asap_queue_t *q, mu_sched_slot_t *store,
+                      size_t capacity);
+
+/**
+ * @brief Add a task's slot to the asap queue of the given priority, growing
+ * the asap queues if need be.  Return false if it is full.
+ */
+static bool asap_push(mu_sched_t *sched, mu_sched_prio_t prio,
+                      mu_sched_slot_t slot);
+
+/**
+ * @brief Return true if the deferred queue has room for one more task, growing
+ * it if need be.
+ */
+static bool deferred_has_room(mu_sched_t *sched);
+
+/**
+ * @brief Return the task of a deferred task.
+ */
+static mu_task_t *deferred_get_task(deferred_task_t *deferred_task);
+
+/**
+ * @brief Set the task of a deferred task.  The task must be registered.
+ */
+static void deferred_set_task(deferred_task_t *deferred_task,
+                              mu_task_t *task);
+
+/**
+ * @brief Return the time of a deferred task, as held in the deferred queue.
+ */
+static mu_sched_at_t deferred_get_at(deferred_task_t *deferred_task);
+
+/**
+ * @brief Set the time of a deferred task.
+ */
+static void deferred_set_at(deferred_task_t *deferred_task, mu_sched_at_t at);
+
+/**
+ * @brief Return true if at can be held in the deferred queue.
+ */
+static bool at_fits(mu_sched_t *sched, mu_time_abs_t at);
+
+/**
+ * @brief Convert a time to the form held in the deferred queue.
+ */
+static mu_sched_at_t at_pack(mu_sched_t *sched, mu_time_abs_t at);
+
+/**
+ * @brief Convert a time held in the deferred queue back to a full time.
+ */
+static mu_time_abs_t at_unpack(mu_sched_t *sched, mu_sched_at_t at);
+
+/**
+ * @brief Return true if deferred time a is before deferred time b.
+ */
+static bool at_precedes(mu_sched_at_t a, mu_sched_at_t b);
+
+/**
+ * @brief Return the time from at to at + slack at which to run a task so that
+ * it can share a wakeup with other tasks.  sched is the scheduler that will
+ * hold the task, or NULL if it is held elsewhere (in mu_exec).
+ */
+static mu_time_abs_t coalesce(mu_sched_t *sched, mu_time_abs_t at,
+                              mu_time_rel_t slack);
+
+/**
+ * @brief Schedule the given task at the given time.
+ */
+static mu_task_err_t sched_aux(mu_sched_t *sched, mu_task_t *task,
+                               mu_time_abs_t at);
+
+#ifdef MU_CONFIG_SCHED_GROWABLE
+
+/**
+ * @brief Return the capacity a queue grows to from the given capacity, or 0 if
+ * it may not grow.  max_capacity of 0 means no limit.
+ */
+static size_t grown_capacity(size_t capacity, size_t max_capacity);
+
+/**
+ * @brief Move the asap queues to new storage, releasing the old storage if it
+ * was allocated.
+ */
+static void asap_move(mu_sched_t *sched, mu_sched_slot_t *store,
+                      size_t capacity);
+
+/**
+ * @brief Move the deferred queue to new storage, releasing the old storage if
+ * it was allocated.
+ */
+static void deferred_move(mu_sched_t *sched, mu_sched_deferred_t *store,
+                          size_t capacity);
+
+#ifdef MU_CONFIG_SCHED_STATS
+
+/**
+ * @brief Rotate the first n times of a table left by k places.
+ */
+static void rotate_times(mu_time_abs_t *times, size_t n, size_t k);
+
+#endif
+
+#endif
+
+#ifdef MU_CONFIG_SCHED_FAIR
+
+/**
+ * @brief Fetch the next runnable task, if any, from the class whose turn it
+ * is, moving on to the next class when a turn is spent or the class has
+ * nothing runnable.
+ */
+static mu_task_t *fetch_fair_task(mu_sched_t *sched);
+
+#endif
+
+#ifdef MU_CONFIG_SCHED_STATS
+
+/**
+ * @brief Record how long a task waited in a queue.
+ */
+static void stats_record_wait(mu_sched_t *sched, mu_sched_queue_t queue,
+                              mu_time_abs_t queued_at, mu_time_abs_t now);
+
+/**
+ * @brief Update a queue's high-water mark.
+ */
+static void stats_record_depth(mu_sched_t *sched, mu_sched_queue_t queue,
+                               size_t depth);
+
+/**
+ * @brief Record the wait time and lateness of a deferred task being run.
+ */
+static void stats_record_deferred(mu_sched_t *sched,
+                                  deferred_task_t *deferred_task,
+                                  mu_time_abs_t now);
+
+#endif
+
+#ifdef MU_CONFIG_SCHED_LOAD
+
+/**
+ * @brief Count the time since the last accounted time as idle, and return the
+ * current time, at which a task is about to start.
+ */
+static mu_time_abs_t load_begin(mu_sched_t *sched);
+
+/**
+ * @brief Count the time since started as busy, now that a task has finished.
+ */
+static void load_end(mu_sched_t *sched, mu_time_abs_t started);
+
+/**
+ * @brief Close the utilization windows whose length has passed as of now.
+ */
+static void load_roll(mu_sched_t *sched, mu_time_abs_t now);
+
+#endif
+
+#ifdef MU_CONFIG_SCHED_DEDUP
+
+/**
+ * @brief Mark a task as waiting in sched's irq or asap queues.  Return false if
+ * deduplication is enabled for the task and it was already marked.
+ */
+static bool dedup_mark(mu_sched_t *sched, mu_task_t *task);
+
+/**
+ * @brief Clear a task's mark.
+ */
+static void dedup_clear(mu_task_t *task);
+
+#endif
+
+#ifdef MU_CONFIG_SCHED_EDF
+
+/**
+ * @brief Fetch the task with the earliest deadline, if any, counting a miss if
+ * now follows its deadline.
+ */
+static mu_task_t *fetch_edf_task(mu_sched_t *sched, mu_time_abs_t now);
+
+/**
+ * @brief Return true if edf task a must run before edf task b.
+ */
+static bool edf_precedes(mu_sched_edf_t *a, mu_sched_edf_t *b);
+
+/**
+ * @brief Move the edf task at index i towards the root of the heap.
+ */
+static void edf_sift_up(mu_sched_t *sched, size_t i);
+
+/**
+ * @brief Move the edf task at index i towards the leaves of the heap.
+ */
+static void edf_sift_down(mu_sched_t *sched, size_t i);
+
+#endif
+
+#ifdef MU_CONFIG_SCHED_DEFERRED_HEAP
+
+/**
+ * @brief Return true if deferred task a must run before deferred task b.
+ */
+static bool heap_precedes(deferred_task_t *a, deferred_task_t *b);
+
+/**
+ * @brief Move the deferred task at index i towards the root of the heap.
+ */
+static void heap_sift_up(mu_sched_t *sched, size_t i);
+
+/**
+ * @brief Move the deferred task at index i towards the leaves of the heap.
+ */
+static void heap_sift_down(mu_sched_t *sched, size_t i);
+
+/**
+ * @brief Remove the deferred task at index i, preserving the heap property.
+ */
+static void heap_remove_at(mu_sched_t *sched, size_t i);
+
+/**
+ * @brief Store a deferred task in slot i and update the task's back-index.
+ */
+static void heap_place(mu_sched_t *sched, size_t i, deferred_task_t *item);
+
+/**
+ * @brief If the task is in the deferred heap, set *i to its slot and return
+ * true.  O(1).
+ */
+static bool heap_find(mu_sched_t *sched, mu_task_t *task, size_t *i);
+
+#endif
+
+// *****************************************************************************
+// Local (private, static) storage
+
+// Storage for the default scheduler, used by the mu_sched_xxx() functions.
+static mu_sched_slot_t s_irq_store[MU_CONFIG_SCHED_MAX_IRQ_TASKS];
+static mu_sched_slot_t s_now_store[MU_CONFIG_SCHED_ASAP_PRIORITIES *
+                                   MU_CONFIG_SCHED_MAX_ASAP_TASKS];
+static deferred_task_t s_deferred_tasks[MU_CONFIG_SCHED_MAX_DEFERRED_TASKS];
+static mu_sched_t s_sched;
+
+// The scheduler whose task is running in this thread, or NULL.
+static MU_CONFIG_SCHED_THREAD_LOCAL mu_sched_t *s_running;
+
+#ifdef MU_CONFIG_SCHED_DEDUP
+// The epoch most recently given to a scheduler.  Marks left on tasks by a
+// scheduler that has since been re-initialized don't match its new epoch.
+static uint32_t s_epoch;
+#endif
+
+// *****************************************************************************
+// Public code
+
+mu_sched_t *mu_sched_inst_init(mu_sched_t *sched, mu_sched_slot_t *irq_store,
+                               size_t irq_capacity,
+                               mu_sched_slot_t *asap_store,
+                               size_t asap_capacity,
+                               mu_sched_deferred_t *deferred_store,
+                               size_t deferred_capacity) {
+#ifdef MU_CONFIG_TASK_IDS
+    // Same rules as mu_spsc_init(): a power of two, at least two.
+    if (irq_capacity > MU_SPSC_MAX_CAPACITY || irq_capacity < 2 ||
+        (irq_capacity & (irq_capacity - 1)) != 0 ||
+        asap_capacity > UINT16_MAX) {
+        return NULL;
+    }
+    sched->irq_tasks.mask = (uint32_t)(irq_capacity - 1);
+    atomic_store_explicit(&sched->irq_tasks.head, 0, memory_order_relaxed);
+    atomic_store_explicit(&sched->irq_tasks.tail, 0, memory_order_relaxed);
+    sched->irq_tasks.store = irq_store;
+#else
+    if (irq_capacity > MU_SPSC_MAX_CAPACITY ||
+        mu_spsc_init(&sched->irq_tasks, irq_store, (uint32_t)irq_capacity) !=
+            MU_SPSC_ERR_NONE) {
+        return NULL;
+    }
+#endif
+#ifdef MU_CONFIG_SCHED_STATS
+    // Queueing times are kept in fixed size tables in the mu_sched_t.
+    if (irq_capacity > MU_CONFIG_SCHED_MAX_IRQ_TASKS ||
+        asap_capacity > MU_CONFIG_SCHED_MAX_ASAP_TASKS) {
+        return NULL;
+    }
+#endif
+    for (int prio = 0; prio < MU_CONFIG_SCHED_ASAP_PRIORITIES; prio++) {
+        asap_init(&sched->asap_tasks[prio], &asap_store[prio * asap_capacity],
+                  asap_capacity);
+    }
+    sched->asap_ready = 0;
+    sched->asap_capacity = asap_capacity;
+    sched->deferred_tasks = deferred_store;
+    sched->deferred_capacity = deferred_capacity;
+    sched->deferred_task_count = 0;
+#ifdef MU_CONFIG_TASK_IDS
+    sched->deferred_ref = 0;
+#endif
+#ifdef MU_CONFIG_SCHED_GROWABLE
+    sched->allocator.alloc = NULL;
+    sched->allocator.free = NULL;
+    sched->allocator.arg = NULL;
+    sched->asap_store = asap_store;
+    sched->asap_base = asap_store;
+    sched->asap_base_capacity = asap_capacity;
+    sched->asap_max_capacity = asap_capacity;
+    sched->deferred_base = deferred_store;
+    sched->deferred_base_capacity = deferred_capacity;
+    sched->deferred_max_capacity = deferred_capacity;
+#endif
+#ifdef MU_CONFIG_SCHED_DEFERRED_HEAP
+    sched->deferred_seq = 0;
+#endif
+    sched->curr_task = NULL;
+    sched->clock_fn = mu_time_now;
+#ifdef MU_CONFIG_SCHED_CACHED_NOW
+    sched->in_batch = false;
+    sched->now_valid = false;
+    sched->now = 0;
+#endif
+    sched->idle_task = NULL;
+    sched->wakeup_fn = NULL;
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
+    mu_mpsc_init(&sched->thread_tasks);
+#endif
+#ifdef MU_CONFIG_SCHED_LOAD
+    for (int n = 0; n < MU_CONFIG_SCHED_LOAD_WINDOWS; n++) {
+        sched->load.windows[n].length = 0;
+    }
+    mu_sched_inst_reset_load(sched);
+#endif
+#ifdef MU_CONFIG_SCHED_DEDUP
+    if (++s_epoch == 0) {
+        s_epoch = 1; // zero means "not queued"
+    }
+    sched->epoch = s_epoch;
+#endif
+#ifdef MU_CONFIG_SCHED_EDF
+    sched->edf_task_count = 0;
+    sched->edf_seq = 0;
+    sched->deadline_misses = 0;
+#endif
+#ifdef MU_CONFIG_SCHED_FAIR
+    mu_sched_inst_set_fair_weights(sched, MU_CONFIG_SCHED_FAIR_IRQ_WEIGHT,
+                                   MU_CONFIG_SCHED_FAIR_DEFERRED_WEIGHT,
+                                   MU_CONFIG_SCHED_FAIR_ASAP_WEIGHT);
+#endif
+#ifdef MU_CONFIG_SCHED_STATS
+    for (int prio = 0; prio < MU_CONFIG_SCHED_ASAP_PRIORITIES; prio++) {
+        sched->asap_queued_at_head[prio] = 0;
+    }
+    // the irq queue holds one less than its number of slots
+    sched->stats.queues[MU_SCHED_QUEUE_IRQ].capacity = irq_capacity - 1;
+    sched->stats.queues[MU_SCHED_QUEUE_DEFERRED].capacity = deferred_capacity;
+    sched->stats.queues[MU_SCHED_QUEUE_ASAP].capacity = asap_capacity;
+    mu_sched_inst_reset_stats(sched);
+#endif
+    return sched;
+}
+
+#ifdef MU_CONFIG_SCHED_GROWABLE
+
+void mu_sched_inst_set_allocator(mu_sched_t *sched,
+                                 const mu_sched_allocator_t *allocator,
+                                 size_t asap_max_capacity,
+                                 size_t deferred_max_capacity) {
+    size_t asap_limit = SIZE_MAX;
+#ifdef MU_CONFIG_TASK_IDS
+    asap_limit = UINT16_MAX;
+#endif
+#ifdef MU_CONFIG_SCHED_STATS
+    // Queueing times are kept in fixed size tables in the mu_sched_t.
+    asap_limit = MU_CONFIG_SCHED_MAX_ASAP_TASKS;
+#endif
+    if (asap_max_capacity == 0 || asap_max_capacity > asap_limit) {
+        asap_max_capacity = asap_limit;
+    }
+    sched->allocator = *allocator;
+    sched->asap_max_capacity = asap_max_capacity;
+    sched->deferred_max_capacity = deferred_max_capacity;
+}
+
+void mu_sched_inst_shrink(mu_sched_t *sched) {
+    size_t count = 0;
+    size_t capacity;
+
+    for (int prio = 0; prio < MU_CONFIG_SCHED_ASAP_PRIORITIES; prio++) {
+        size_t n = asap_count(&sched->asap_tasks[prio]);
+        count = n > count ? n : count;
+    }
+    capacity = sched->asap_base_capacity;
+    while (capacity < count) {
+        capacity = grown_capacity(capacity, 0);
+    }
+    if (capacity < sched->asap_capacity) {
+        mu_sched_slot_t *store = sched->asap_base;
+        if (capacity != sched->asap_base_capacity) {
+            store = sched->allocator.alloc(MU_CONFIG_SCHED_ASAP_PRIORITIES *
+                                               capacity * sizeof(*store),
+                                           sched->allocator.arg);
+        }
+        if (store != NULL) {
+            asap_move(sched, store, capacity);
+        }
+    }
+
+    count = sched->deferred_task_count;
+    capacity = sched->deferred_base_capacity;
+    while (capacity < count) {
+        capacity = grown_capacity(capacity, 0);
+    }
+    if (capacity < sched->deferred_capacity) {
+        mu_sched_deferred_t *store = sched->deferred_base;
+        if (capacity != sched->deferred_base_capacity) {
+            store = sched->allocator.alloc(capacity * sizeof(*store),
+                                           sched->allocator.arg);
+        }
+        if (store != NULL) {
+            deferred_move(sched, store, capacity);
+        }
+    }
+}
+
+#endif
+
+size_t mu_sched_inst_get_capacity(mu_sched_t *sched, mu_sched_queue_t queue) {
+    switch (queue) {
+    case MU_SCHED_QUEUE_IRQ:
+        return irq_capacity(sched);
+    case MU_SCHED_QUEUE_DEFERRED:
+        return sched->deferred_capacity;
+    case MU_SCHED_QUEUE_ASAP:
+        return sched->asap_capacity;
+    default:
+        return 0;
+    }
+}
+
+void mu_sched_inst_reset(mu_sched_t *sched) {
+    sched->deferred_task_count = 0;
+}
+
+void mu_sched_inst_step(mu_sched_t *sched) {
+    mu_sched_t *prev_running = s_running;
+    s_running = sched;
+
+#ifdef MU_CONFIG_SCHED_FAIR
+    if ((sched->curr_task = fetch_fair_task(sched)) == NULL) {
+        // no runnable tasks available -- use the idle task (may be NULL)
+        sched->curr_task = sched->idle_task;
+    }
+#else
+    if ((sched->curr_task = fetch_irq_task(sched)) != NULL) {
+        // pulled one task from the irq task queue
+        asm("nop");
+
+    } else if (peek_next_deferred_task(sched) != NULL &&
+               (sched->curr_task = fetch_runnable_deferred_task(
+                    sched, mu_sched_inst_get_current_time(sched))) != NULL) {
+        // pulled one runnable task from the deferred task queue
+        asm("nop");
+
+#ifdef MU_CONFIG_SCHED_EDF
+    } else if (sched->edf_task_count > 0 &&
+               (sched->curr_task = fetch_edf_task(
+                    sched, mu_sched_inst_get_current_time(sched))) != NULL) {
+        // pulled the earliest deadline task from the edf task queue
+        asm("nop");
+
+#endif
+    } else if ((sched->curr_task = fetch_asap_task(sched)) != NULL) {
+        // pulled one task from the "now" task queue
+        asm("nop");
+
+    } else {
+        // no runnable tasks available -- use the idle task (may be NULL)
+        sched->curr_task = sched->idle_task;
+    }
+#endif
+
+    // invoke the task.
+#ifdef MU_CONFIG_SCHED_LOAD
+    if (sched->curr_task == sched->idle_task) {
+        // time in the idle task counts as idle
+        sched->load.idle_steps += 1;
+        mu_task_call(sched->curr_task, NULL);
+    } else {
+        mu_time_abs_t started = load_begin(sched);
+        mu_task_call(sched->curr_task, NULL);
+        load_end(sched, started);
+    }
+#else
+    mu_task_call(sched->curr_task, NULL);
+#endif
+    sched->curr_task = NULL;
+    s_running = prev_running;
+}
+
+int mu_sched_inst_drain(mu_sched_t *sched) {
+    return run_batch(sched, false, 0);
+}
+
+int mu_sched_inst_run_for(mu_sched_t *sched, mu_time_rel_t budget) {
+    int count = 0;
+    mu_time_abs_t now = mu_sched_inst_get_current_time(sched);
+    mu_time_abs_t until = mu_time_offset(now, budget);
+
+    while (true) {
+        int n = run_batch(sched, true, now);
+        count += n;
+        if (n == 0) {
+            break;
+        }
+        // The budget check needs the clock anyway, so this reading is also the
+        // next batch's snapshot of "now".
+        now = mu_sched_inst_get_current_time(sched);
+        if (!mu_time_precedes(now, until)) {
+            break;
+        }
+    }
+    return count;
+}
+
+mu_clock_fn mu_sched_inst_get_clock_source(mu_sched_t *sched) {
+    return sched->clock_fn;
+}
+
+void mu_sched_inst_set_clock_source(mu_sched_t *sched, mu_clock_fn clock_fn) {
+    sched->clock_fn = clock_fn;
+#ifdef MU_CONFIG_SCHED_LOAD
+    // times from the old clock can't be compared with the new one
+    mu_sched_inst_reset_load(sched);
+#endif
+}
+
+mu_time_abs_t mu_sched_inst_get_current_time(mu_sched_t *sched) {
+#ifdef MU_CONFIG_SCHED_CACHED_NOW
+    if (sched->in_batch) {
+        if (!sched->now_valid) {
+            sched->now = sched->clock_fn();
+            sched->now_valid = true;
+        }
+        return sched->now;
+    }
+#endif
+    return sched->clock_fn();
+}
+
+mu_task_t *mu_sched_inst_get_idle_task(mu_sched_t *sched) {
+    return sched->idle_task;
+}
+
+void mu_sched_inst_set_idle_task(mu_sched_t *sched, mu_task_t *task) {
+    sched->idle_task = task;
+}
+
+void mu_sched_inst_set_wakeup_fn(mu_sched_t *sched, mu_sched_wakeup_fn fn) {
+    sched->wakeup_fn = fn;
+}
+
+#ifdef MU_CONFIG_SCHED_FAIR
+
+void mu_sched_inst_set_fair_weights(mu_sched_t *sched, unsigned int irq,
+                                    unsigned int deferred, unsigned int asap) {
+    sched->fair_weights[FAIR_CLASS_IRQ] = irq > 0 ? irq : 1;
+    sched->fair_weights[FAIR_CLASS_DEFERRED] = deferred > 0 ? deferred : 1;
+    sched->fair_weights[FAIR_CLASS_ASAP] = asap > 0 ? asap : 1;
+    // start afresh with a full turn for the irq class
+    sched->fair_class = FAIR_CLASS_IRQ;
+    sched->fair_credit = sched->fair_weights[FAIR_CLASS_IRQ];
+}
+
+#endif
+
+bool mu_sched_inst_next_deadline(mu_sched_t *sched, mu_time_abs_t *at) {
+    deferred_task_t *deferred_task = peek_next_deferred_task(sched);
+    if (deferred_task == NULL) {
+        return false;
+    }
+    *at = at_unpack(sched, deferred_get_at(deferred_task));
+    return true;
+}
+
+mu_task_t *mu_sched_inst_current_task(mu_sched_t *sched) {
+    return sched->curr_task;
+}
+
+mu_task_t *mu_sched_inst_peek_next_task(mu_sched_t *sched) {
+    mu_sched_slot_t slot;
+
+    deferred_task_t *deferred_task = peek_next_deferred_task(sched);
+    if (deferred_task) {
+        return deferred_get_task(deferred_task);
+    }
+
+#ifdef MU_CONFIG_SCHED_EDF
+    if (sched->edf_task_count > 0) {
+        return sched->edf_tasks[0].task;
+    }
+#endif
+
+    if (sched->asap_ready == 0) {
+        return NULL;
+    }
+    asap_peek(&sched->asap_tasks[__builtin_ctz(sched->asap_ready)], &slot);
+    return slot_task(slot);
+}
+
+bool mu_sched_inst_visit(mu_sched_t *sched, mu_sched_visit_fn fn, void *arg) {
+    mu_sched_entry_t entry;
+    mu_sched_slot_t slot;
+
+    entry.queue = MU_SCHED_QUEUE_IRQ;
+    entry.prio = 0;
+    entry.has_deadline = false;
+    entry.at = 0;
+    for (size_t n = 0; irq_at(sched, n, &slot); n++) {
+        entry.task = slot_task(slot);
+        entry.order = (uint32_t)n;
+        if (!fn(&entry, arg)) {
+            return false;
+        }
+    }
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
+    // Tasks from other threads run once the irq queue is empty.
+    entry.order = (uint32_t)irq_count(sched);
+    for (mu_mpsc_node_t *node = mu_mpsc_peek(&sched->thread_tasks);
+         node != NULL; node = mu_mpsc_next(&sched->thread_tasks, node)) {
+        entry.task = MU_MPSC_CONTAINER_OF(node, mu_task_t, thread_node);
+        if (!fn(&entry, arg)) {
+            return false;
+        }
+        entry.order += 1;
+    }
+#endif
+
+    entry.queue = MU_SCHED_QUEUE_DEFERRED;
+    for (size_t i = 0; i < sched->deferred_task_count; i++) {
+        deferred_task_t *deferred_task = &sched->deferred_tasks[i];
+        entry.task = deferred_get_task(deferred_task);
+        entry.at = at_unpack(sched, deferred_get_at(deferred_task));
+#ifdef MU_CONFIG_SCHED_DEFERRED_HEAP
+        entry.order = deferred_task->seq;
+#else
+        // The array is sorted with the next task to run last.
+        entry.order = (uint32_t)(sched->deferred_task_count - i);
+#endif
+        if (!fn(&entry, arg)) {
+            return false;
+        }
+    }
+
+    entry.queue = MU_SCHED_QUEUE_ASAP;
+#ifdef MU_CONFIG_SCHED_EDF
+    entry.has_deadline = true;
+    for (size_t i = 0; i < sched->edf_task_count; i++) {
+        entry.task = sched->edf_tasks[i].task;
+        entry.at = sched->edf_tasks[i].deadline;
+        entry.order = sched->edf_tasks[i].seq;
+        if (!fn(&entry, arg)) {
+            return false;
+        }
+    }
+    entry.has_deadline = false;
+#endif
+    entry.at = 0;
+    for (int prio = 0; prio < MU_CONFIG_SCHED_ASAP_PRIORITIES; prio++) {
+        entry.prio = prio;
+        for (size_t n = 0; asap_at(&sched->asap_tasks[prio], n, &slot); n++) {
+            entry.task = slot_task(slot);
+            entry.order = (uint32_t)n;
+            if (!fn(&entry, arg)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+mu_task_err_t mu_sched_inst_asap(mu_sched_t *sched, mu_task_t *task) {
+    return mu_sched_inst_asap_prio(sched, task, MU_SCHED_PRIO_DEFAULT);
+}
+
+mu_task_err_t mu_sched_inst_asap_prio(mu_sched_t *sched, mu_task_t *task,
+                                      mu_sched_prio_t prio) {
+    mu_sched_slot_t slot;
+
+    if (prio > MU_SCHED_PRIO_LOWEST) {
+        prio = MU_SCHED_PRIO_LOWEST;
+    }
+    if (!slot_for(task, &slot)) {
+#ifdef MU_CONFIG_SCHED_STATS
+        sched->stats.queues[MU_SCHED_QUEUE_ASAP].sched_full += 1;
+#endif
+        return MU_TASK_ERR_SCHED_FULL;
+    }
+#ifdef MU_CONFIG_SCHED_DEDUP
+    if (!dedup_mark(sched, task)) {
+        return MU_TASK_ERR_NONE; // already queued
+    }
+#endif
+    // push task onto the "now" queue for its priority
+    if (asap_push(sched, prio, slot) == false) {
+#ifdef MU_CONFIG_SCHED_DEDUP
+        dedup_clear(task);
+#endif
+#ifdef MU_CONFIG_SCHED_STATS
+        sched->stats.queues[MU_SCHED_QUEUE_ASAP].sched_full += 1;
+#endif
+        return MU_TASK_ERR_SCHED_FULL;
+    } else {
+        sched->asap_ready |= (uint32_t)1 << prio;
+#ifdef MU_CONFIG_SCHED_STATS
+        size_t depth = asap_count(&sched->asap_tasks[prio]);
+        size_t qi = (sched->asap_queued_at_head[prio] + depth - 1) %
+                    sched->asap_capacity;
+        sched->asap_queued_at[prio][qi] =
+            mu_sched_inst_get_current_time(sched);
+        stats_record_depth(sched, MU_SCHED_QUEUE_ASAP, depth);
+#endif
+        return MU_TASK_ERR_NONE;
+    }
+}
+
+#ifdef MU_CONFIG_SCHED_EDF
+
+mu_task_err_t mu_sched_inst_asap_deadline(mu_sched_t *sched, mu_task_t *task,
+                                          mu_time_abs_t deadline) {
+#ifdef MU_CONFIG_SCHED_DEDUP
+    if (!dedup_mark(sched, task)) {
+        return MU_TASK_ERR_NONE; // already queued
+    }
+#endif
+    if (sched->edf_task_count == MU_CONFIG_SCHED_MAX_EDF_TASKS) {
+#ifdef MU_CONFIG_SCHED_DEDUP
+        dedup_clear(task);
+#endif
+#ifdef MU_CONFIG_SCHED_STATS
+        sched->stats.queues[MU_SCHED_QUEUE_ASAP].sched_full += 1;
+#endif
+        return MU_TASK_ERR_SCHED_FULL;
+    }
+    // Append to the end of the heap and let it rise to its proper place.
+    size_t i = sched->edf_task_count++;
+    sched->edf_tasks[i].deadline = deadline;
+    sched->edf_tasks[i].task = task;
+    sched->edf_tasks[i].seq = sched->edf_seq++;
+    edf_sift_up(sched, i);
+#ifdef MU_CONFIG_SCHED_STATS
+    stats_record_depth(sched, MU_SCHED_QUEUE_ASAP, sched->edf_task_count);
+#endif
+    return MU_TASK_ERR_NONE;
+}
+
+uint32_t mu_sched_inst_get_deadline_misses(mu_sched_t *sched) {
+    return sched->deadline_misses;
+}
+
+#endif
+
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
+
+mu_task_err_t mu_sched_inst_from_thread(mu_sched_t *sched, mu_task_t *task) {
+    // Whoever sets the flag owns the task's node until the scheduler takes it
+    // from the queue and clears the flag.
+    if (atomic_exchange_explicit(&task->thread_queued, true,
+                                 memory_order_acquire)) {
+        return MU_TASK_ERR_NONE; // already queued
+    }
+    mu_mpsc_push(&sched->thread_tasks, &task->thread_node);
+    if (sched->wakeup_fn != NULL) {
+        sched->wakeup_fn();
+    }
+    return MU_TASK_ERR_NONE;
+}
+
+#endif
+
+mu_task_err_t mu_sched_inst_from_isr(mu_sched_t *sched, mu_task_t *task) {
+    mu_sched_slot_t slot;
+
+    if (!slot_for(task, &slot)) {
+#ifdef MU_CONFIG_SCHED_STATS
+        sched->stats.queues[MU_SCHED_QUEUE_IRQ].sched_full += 1;
+#endif
+        return MU_TASK_ERR_SCHED_FULL;
+    }
+#ifdef MU_CONFIG_SCHED_DEDUP
+    if (!dedup_mark(sched, task)) {
+        return MU_TASK_ERR_NONE; // already queued
+    }
+#endif
+#ifdef MU_CONFIG_SCHED_STATS
+    // Stamp the slot before the task becomes visible to the consumer.  Only
+    // the producer moves tail, so the slot can't change under us.
+    sched->irq_queued_at[atomic_load_explicit(&sched->irq_tasks.tail,
+                                              memory_order_relaxed) &
+                         sched->irq_tasks.mask] =
+        mu_sched_inst_get_current_time(sched);
+#endif
+    if (irq_put(sched, slot) == false) {
+#ifdef MU_CONFIG_SCHED_DEDUP
+        dedup_clear(task);
+#endif
+#ifdef MU_CONFIG_SCHED_STATS
+        sched->stats.queues[MU_SCHED_QUEUE_IRQ].sched_full += 1;
+#endif
+        return MU_TASK_ERR_SCHED_FULL;
+    } else {
+#ifdef MU_CONFIG_SCHED_STATS
+        stats_record_depth(sched, MU_SCHED_QUEUE_IRQ, irq_count(sched));
+#endif
+        if (sched->wakeup_fn != NULL) {
+            sched->wakeup_fn();
+        }
+        return MU_TASK_ERR_NONE;
+    }
+}
+
+mu_task_err_t mu_sched_inst_defer_until(mu_sched_t *sched, mu_task_t *task,
+                                        mu_time_abs_t at) {
+    return sched_aux(sched, task, at);
+}
+
+mu_task_err_t mu_sched_inst_defer_for(mu_sched_t *sched, mu_task_t *task,
+                                      mu_time_rel_t in) {
+    mu_time_abs_t at =
+        mu_time_offset(mu_sched_inst_get_current_time(sched), in);
+    return mu_sched_inst_defer_until(sched, task, at);
+}
+
+mu_task_err_t mu_sched_inst_defer_until_slack(mu_sched_t *sched,
+                                              mu_task_t *task,
+                                              mu_time_abs_t at,
+                                              mu_time_rel_t slack) {
+    return mu_sched_inst_defer_until(sched, task, coalesce(sched, at, slack));
+}
+
+mu_task_err_t mu_sched_inst_defer_for_slack(mu_sched_t *sched,
+                                            mu_task_t *task, mu_time_rel_t in,
+                                            mu_time_rel_t slack) {
+    mu_time_abs_t at =
+        mu_time_offset(mu_sched_inst_get_current_time(sched), in);
+    return mu_sched_inst_defer_until_slack(sched, task, at, slack);
+}
+
+#ifdef MU_CONFIG_SCHED_DEFERRED_HEAP
+
+mu_task_err_t mu_sched_inst_remove_deferred_task(mu_sched_t *sched,
+                                                 mu_task_t *task) {
+    mu_task_err_t err = MU_TASK_ERR_NOT_FOUND;
+
+    // Each task records its own slot in the heap, so a task that is deferred
+    // once is removed without a search.
+    size_t i;
+    if (heap_find(sched, task, &i)) {
+        heap_remove_at(sched, i);
+        err = MU_TASK_ERR_NONE;
+    }
+    if (task->deferred_count == 0) {
+        return err;
+    }
+
+    // The task is deferred more than once, or its count is stale: scan all of
+    // the heap.  Note that heap_remove_at() moves another entry into slot i, so
+    // re-examine slot i after a removal.
+    i = 0;
+    while (i < sched->deferred_task_count) {
+        if (deferred_get_task(&sched->deferred_tasks[i]) == task) {
+            heap_remove_at(sched, i);
+            err = MU_TASK_ERR_NONE;
+        } else {
+            i += 1;
+        }
+    }
+    // Whatever is left was counted before a reset.
+    task->deferred_count = 0;
+    return err;
+}
+
+bool mu_sched_inst_is_deferred(mu_sched_t *sched, mu_task_t *task) {
+    size_t i;
+    if (heap_find(sched, task, &i)) {
+        return true;
+    }
+    if (task->deferred_count == 0) {
+        return false;
+    }
+    for (i = 0; i < sched->deferred_task_count; i++) {
+        if (deferred_get_task(&sched->deferred_tasks[i]) == task) {
+            return true;
+        }
+    }
+    task->deferred_count = 0;
+    return false;
+}
+
+#else
+
+bool mu_sched_inst_is_deferred(mu_sched_t *sched, mu_task_t *task) {
+    for (size_t i = 0; i < sched->deferred_task_count; i++) {
+        if (deferred_get_task(&sched->deferred_tasks[i]) == task) {
+            return true;
+        }
+    }
+    return false;
+}
+
+mu_task_err_t mu_sched_inst_remove_deferred_task(mu_sched_t *sched,
+                                                 mu_task_t *task) {
+    mu_task_err_t err = MU_TASK_ERR_NOT_FOUND;
+    deferred_task_t *deferred_tasks = sched->deferred_tasks;
+
+    size_t i = sched->deferred_task_count;
+    while (i > 0) {
+        deferred_task_t *deferred_task = &deferred_tasks[i - 1];
+        if (deferred_get_task(deferred_task) == task) {
+            // use memmove to close slot at i-1
+            size_t to_move = sched->deferred_task_count - i;
+            if (to_move > 0) {
+                deferred_task_t *src = &deferred_tasks[i];
+                memmove(deferred_task, src, to_move * sizeof(deferred_task_t));
+            }
+            sched->deferred_task_count -= 1;
+            err = MU_TASK_ERR_NONE;
+        }
+        i -= 1;
+    }
+    return err;
+}
+
+#endif
+
+#ifdef MU_CONFIG_SCHED_STATS
+
+const mu_sched_stats_t *mu_sched_inst_get_stats(mu_sched_t *sched) {
+    return &sched->stats;
+}
+
+void mu_sched_inst_reset_stats(mu_sched_t *sched) {
+    for (int queue = 0; queue < MU_SCHED_QUEUE_COUNT; queue++) {
+        mu_sched_queue_stats_t *queue_stats = &sched->stats.queues[queue];
+        mu_sched_hist_reset(&queue_stats->wait);
+        queue_stats->high_water = 0;
+        queue_stats->sched_full = 0;
+    }
+    mu_sched_hist_reset(&sched->stats.lateness);
+}
+
+#endif
+
+#ifdef MU_CONFIG_SCHED_LOAD
+
+const mu_sched_load_t *mu_sched_inst_get_load(mu_sched_t *sched) {
+    load_roll(sched, load_begin(sched));
+    return &sched->load;
+}
+
+void mu_sched_inst_reset_load(mu_sched_t *sched) {
+    mu_sched_load_t *load = &sched->load;
+    mu_time_abs_t now = sched->clock_fn();
+
+    load->busy = 0;
+    load->idle = 0;
+    load->tasks_run = 0;
+    load->idle_steps = 0;
+    load->mark = now;
+    for (int n = 0; n < MU_CONFIG_SCHED_LOAD_WINDOWS; n++) {
+        mu_sched_load_window_t *window = &load->windows[n];
+        window->start = now;
+        window->busy = 0;
+        window->utilization = 0;
+    }
+}
+
+void mu_sched_inst_set_load_window(mu_sched_t *sched, unsigned int n,
+                                   mu_time_rel_t length) {
+    if (n < MU_CONFIG_SCHED_LOAD_WINDOWS) {
+        mu_sched_load_window_t *window = &sched->load.windows[n];
+        window->length = length;
+        window->start = mu_sched_inst_get_current_time(sched);
+        window->busy = 0;
+        window->utilization = 0;
+    }
+}
+
+#endif
+
+mu_sched_t *mu_sched_default_instance(void) { return &s_sched; }
+
+mu_sched_t *mu_sched_current_instance(void) { return current(); }
+
+// The mu_sched_xxx() functions: init, reset, step, drain, run_for and from_isr
+// work on the default scheduler.  The rest work on the scheduler whose task is
+// running (see current()), so task code works unchanged in any scheduler.
+
+void mu_sched_init(void) {
+    mu_sched_inst_init(&s_sched, s_irq_store, MU_CONFIG_SCHED_MAX_IRQ_TASKS,
+                       s_now_store, MU_CONFIG_SCHED_MAX_ASAP_TASKS,
+                       s_deferred_tasks, MU_CONFIG_SCHED_MAX_DEFERRED_TASKS);
+}
+
+void mu_sched_reset(void) { mu_sched_inst_reset(&s_sched); }
+
+void mu_sched_step(void) { mu_sched_inst_step(&s_sched); }
+
+int mu_sched_drain(void) { return mu_sched_inst_drain(&s_sched); }
+
+int mu_sched_run_for(mu_time_rel_t budget) {
+    return mu_sched_inst_run_for(&s_sched, budget);
+}
+
+mu_clock_fn mu_sched_get_clock_source(void) {
+    return mu_sched_inst_get_clock_source(current());
+}
+
+void mu_sched_set_clock_source(mu_clock_fn clock_fn) {
+    mu_sched_inst_set_clock_source(current(), clock_fn);
+}
+
+mu_time_abs_t mu_sched_get_current_time(void) {
+    return mu_sched_inst_get_current_time(current());
+}
+
+mu_task_t *mu_sched_get_idle_task(void) {
+    return mu_sched_inst_get_idle_task(current());
+}
+
+void mu_sched_set_idle_task(mu_task_t *task) {
+    mu_sched_inst_set_idle_task(current(), task);
+}
+
+void mu_sched_set_wakeup_fn(mu_sched_wakeup_fn fn) {
+    mu_sched_inst_set_wakeup_fn(current(), fn);
+}
+
+#ifdef MU_CONFIG_SCHED_FAIR
+
+void mu_sched_set_fair_weights(unsigned int irq, unsigned int deferred,
+                               unsigned int asap) {
+    mu_sched_inst_set_fair_weights(current(), irq, deferred, asap);
+}
+
+#endif
+
+bool mu_sched_next_deadline(mu_time_abs_t *at) {
+    return mu_sched_inst_next_deadline(current(), at);
+}
+
+mu_task_t *mu_sched_current_task(void) {
+#ifdef MU_CONFIG_SCHED_EXEC
+    if (mu_exec_active()) {
+        return mu_exec_current_task();
+    }
+#endif
+    return mu_sched_inst_current_task(current());
+}
+
+mu_task_t *mu_sched_peek_next_task(void) {
+    return mu_sched_inst_peek_next_task(current());
+}
+
+mu_task_err_t mu_sched_asap(mu_task_t *task) {
+    return mu_sched_asap_prio(task, MU_SCHED_PRIO_DEFAULT);
+}
+
+mu_task_err_t mu_sched_asap_prio(mu_task_t *task, mu_sched_prio_t prio) {
+#ifdef MU_CONFIG_SCHED_EXEC
+    if (mu_exec_active()) {
+        // mu_exec workers don't have priority levels.
+        return mu_exec_asap(task);
+    }
+#endif
+    return mu_sched_inst_asap_prio(current(), task, prio);
+}
+
+#ifdef MU_CONFIG_SCHED_EDF
+
+mu_task_err_t mu_sched_asap_deadline(mu_task_t *task, mu_time_abs_t deadline) {
+#ifdef MU_CONFIG_SCHED_EXEC
+    if (mu_exec_active()) {
+        // mu_exec workers don't order tasks by deadline.
+        return mu_exec_asap(task);
+    }
+#endif
+    return mu_sched_inst_asap_deadline(current(), task, deadline);
+}
+
+uint32_t mu_sched_get_task_deadline_misses(mu_task_t *task) {
+    return task->deadline_misses;
+}
+
+uint32_t mu_sched_get_deadline_misses(void) {
+    return mu_sched_inst_get_deadline_misses(current());
+}
+
+#endif
+
+mu_task_err_t mu_sched_from_isr(mu_task_t *task) {
+#ifdef MU_CONFIG_SCHED_EXEC
+    if (mu_exec_active()) {
+        return mu_exec_asap(task);
+    }
+#endif
+    // Interrupts (and other threads) aren't part of any running task.
+    return mu_sched_inst_from_isr(&s_sched, task);
+}
+
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
+
+mu_task_err_t mu_sched_from_thread(mu_task_t *task) {
+#ifdef MU_CONFIG_SCHED_EXEC
+    if (mu_exec_active()) {
+        return mu_exec_asap(task);
+    }
+#endif
+    return mu_sched_inst_from_thread(&s_sched, task);
+}
+
+#endif
+
+mu_task_err_t mu_sched_defer_until(mu_task_t *task, mu_time_abs_t at) {
+#ifdef MU_CONFIG_SCHED_EXEC
+    if (mu_exec_active()) {
+        return mu_exec_defer_until(task, at);
+    }
+#endif
+    return mu_sched_inst_defer_until(current(), task, at);
+}
+
+mu_task_err_t mu_sched_defer_for(mu_task_t *task, mu_time_rel_t in) {
+    mu_time_abs_t at = mu_time_offset(mu_sched_get_current_time(), in);
+    return mu_sched_defer_until(task, at);
+}
+
+mu_task_err_t mu_sched_defer_until_slack(mu_task_t *task, mu_time_abs_t at,
+                                         mu_time_rel_t slack) {
+#ifdef MU_CONFIG_SCHED_EXEC
+    if (mu_exec_active()) {
+        // The task goes to an mu_exec worker, so no mu_sched queue applies.
+        return mu_exec_defer_until(task, coalesce(NULL, at, slack));
+    }
+#endif
+    return mu_sched_inst_defer_until_slack(current(), task, at, slack);
+}
+
+mu_task_err_t mu_sched_defer_for_slack(mu_task_t *task, mu_time_rel_t in,
+                                       mu_time_rel_t slack) {
+    mu_time_abs_t at = mu_time_offset(mu_sched_get_current_time(), in);
+    return mu_sched_defer_until_slack(task, at, slack);
+}
+
+mu_task_err_t mu_sched_remove_deferred_task(mu_task_t *task) {
+#ifdef MU_CONFIG_SCHED_EXEC
+    if (mu_exec_active()) {
+        return mu_exec_remove_deferred_task(task);
+    }
+#endif
+    return mu_sched_inst_remove_deferred_task(current(), task);
+}
+
+bool mu_sched_is_deferred(mu_task_t *task) {
+    return mu_sched_inst_is_deferred(current(), task);
+}
+
+#ifdef MU_CONFIG_SCHED_DEDUP
+
+void mu_sched_set_dedup(mu_task_t *task, bool enable) {
+    task->dedup = enable;
+    __atomic_store_n(&task->queued, 0, __ATOMIC_RELEASE);
+}
+
+#endif
+
+#ifdef MU_CONFIG_SCHED_STATS
+
+const mu_sched_stats_t *mu_sched_get_stats(void) {
+    return mu_sched_inst_get_stats(current());
+}
+
+void mu_sched_reset_stats(void) { mu_sched_inst_reset_stats(current()); }
+
+void mu_sched_set_lateness_hist(mu_task_t *task, mu_sched_hist_t *hist) {
+    task->lateness = hist;
+}
+
+void mu_sched_hist_reset(mu_sched_hist_t *hist) {
+    memset(hist, 0, sizeof(mu_sched_hist_t));
+}
+
+void mu_sched_hist_record(mu_sched_hist_t *hist, mu_time_rel_t value) {
+    int bucket = 0;
+    if (value > 0) {
+        // 1 -> 1, 2..3 -> 2, 4..7 -> 3, ...
+        bucket = 64 - __builtin_clzll((unsigned long long)value);
+        if (bucket >= MU_CONFIG_SCHED_STATS_BUCKETS) {
+            bucket = MU_CONFIG_SCHED_STATS_BUCKETS - 1;
+        }
+    }
+    hist->buckets[bucket] += 1;
+    if (hist->count == 0 || value > hist->max) {
+        hist->max = value;
+    }
+    hist->count += 1;
+}
+
+const char *mu_sched_queue_name(mu_sched_queue_t queue) {
+    switch (queue) {
+    case MU_SCHED_QUEUE_IRQ:
+        return "irq";
+    case MU_SCHED_QUEUE_DEFERRED:
+        return "deferred";
+    case MU_SCHED_QUEUE_ASAP:
+        return "asap";
+    default:
+        return "unknown";
+    }
+}
+
+#endif
+
+#ifdef MU_CONFIG_SCHED_LOAD
+
+const mu_sched_load_t *mu_sched_get_load(void) {
+    return mu_sched_inst_get_load(current());
+}
+
+void mu_sched_reset_load(void) { mu_sched_inst_reset_load(current()); }
+
+void mu_sched_set_load_window(unsigned int n, mu_time_rel_t length) {
+    mu_sched_inst_set_load_window(current(), n, length);
+}
+
+#endif
+
+#if 0
+// ChatGPT's rewrite:
+mu_task_err_t mu_sched_remove_deferred_task(mu_task_t *task) {
+  mu_task_err_t err = MU_TASK_ERR_NOT_FOUND;
+  deferred_task_t *candidate;
+
+  deferred_task_t *last = s_deferred_tasks + s_sched.deferred_task_count;
+  for (candidate = s_deferred_tasks; candidate < last; candidate++) {
+    if (candidate->task == task) {
+      // use memmove to close slot at i-1
+      size_t to_move = last - candidate - 1;
+      if (to_move > 0) {
+        deferred_task_t *src = candidate + 1;
+        memmove(candidate, src, to_move * sizeof(deferred_task_t));
+      }
+      s_sched.deferred_task_count--;
+      err = MU_TASK_ERR_NONE;
+      break;  // inappropriate if task appears more than once.
+    }
+  }
+  return err;
+}
+#endif
+
+// *****************************************************************************
+// Local (private, static) code
+
+static mu_sched_t *current(void) {
+    mu_sched_t *running = s_running;
+    return running != NULL ? running : &s_sched;
+}
+
+#ifdef MU_CONFIG_TASK_IDS
+
+// The queues hold task IDs.  The irq queue follows mu_spsc's rules: only the
+// producer moves tail and only the consumer moves head, each with a release
+// store that the other side reads with an acquire load.
+
+static bool slot_for(mu_task_t *task, mu_sched_slot_t *slot) {
+    *slot = mu_task_get_id(task);
+    return *slot != MU_TASK_ID_NONE;
+}
+
+static mu_task_t *slot_task(mu_sched_slot_t slot) {
+    return mu_task_from_id(slot);
+}
+
+static size_t irq_capacity(mu_sched_t *sched) {
+    return sched->irq_tasks.mask;
+}
+
+static bool irq_put(mu_sched_t *sched, mu_sched_slot_t slot) {
+    mu_sched_irq_queue_t *q = &sched->irq_tasks;
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+    if (tail - atomic_load_explicit(&q->head, memory_order_acquire) ==
+        q->mask) {
+        return false;
+    }
+    q->store[tail & q->mask] = slot;
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+static bool irq_get(mu_sched_t *sched, mu_sched_slot_t *slot) {
+    mu_sched_irq_queue_t *q = &sched->irq_tasks;
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+    if (head == atomic_load_explicit(&q->tail, memory_order_acquire)) {
+        return false;
+    }
+    *slot = q->store[head & q->mask];
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return true;
+}
+
+static bool asap_put(mu_sched_asap_queue_t *q, mu_sched_slot_t slot) {
+    if (q->count == q->capacity) {
+        return false;
+    }
+    q->store[(q->head + q->count) % q->capacity] = slot;
+    q->count += 1;
+    return true;
+}
+
+static bool asap_get(mu_sched_asap_queue_t *q, mu_sched_slot_t *slot) {
+    if (!asap_peek(q, slot)) {
+        return false;
+    }
+    q->head = (q->head + 1) % q->capacity;
+    q->count -= 1;
+    return true;
+}
+
+static bool asap_peek(mu_sched_asap_queue_t *q, mu_sched_slot_t *slot) {
+    if (q->count == 0) {
+        return false;
+    }
+    *slot = q->store[q->head];
+    return true;
+}
+
+static size_t asap_count(mu_sched_asap_queue_t *q) { return q->count; }
+
+static bool asap_at(mu_sched_asap_queue_t *q, size_t n, mu_sched_slot_t *slot) {
+    if (n >= q->count) {
+        return false;
+    }
+    *slot = q->store[(q->head + n) % q->capacity];
+    return true;
+}
+
+static void asap_init(mu_sched_asap_queue_t *q, mu_sched_slot_t *store,
+                      size_t capacity) {
+    q->store = store;
+    q->capacity = (uint16_t)capacity;
+    q->head = 0;
+    q->count = 0;
+}
+
+static mu_task_t *deferred_get_task(deferred_task_t *deferred_task) {
+    return mu_task_from_id(deferred_task->task_id);
+}
+
+static void deferred_set_task(deferred_task_t *deferred_task,
+                              mu_task_t *task) {
+    deferred_task->task_id = task->id;
+}
+
+// Deferred times keep only their low MU_SCHED_AT_BITS bits and are compared
+// like mu_time_precedes() compares full times, which is correct while they lie
+// within 2^(MU_SCHED_AT_BITS - 1) ticks of each other.  at_fits() keeps each
+// one within MU_SCHED_AT_RANGE, a quarter of that, of the time it is deferred.
+// A full time is recovered from the most recently deferred time.
+
+#define AT_SHIFT (64 - MU_SCHED_AT_BITS)
+
+static mu_sched_at_t deferred_get_at(deferred_task_t *deferred_task) {
+    return ((mu_sched_at_t)deferred_task->at_hi << 32) | deferred_task->at;
+}
+
+static void deferred_set_at(deferred_task_t *deferred_task, mu_sched_at_t at) {
+    deferred_task->at = (uint32_t)at;
+    deferred_task->at_hi = (uint16_t)(at >> 32);
+}
+
+static bool at_fits(mu_sched_t *sched, mu_time_abs_t at) {
+    mu_time_rel_t dt =
+        mu_time_difference(at, mu_sched_inst_get_current_time(sched));
+    return dt > -MU_SCHED_AT_RANGE && dt < MU_SCHED_AT_RANGE;
+}
+
+static mu_sched_at_t at_pack(mu_sched_t *sched, mu_time_abs_t at) {
+    sched->deferred_ref = at;
+    return (mu_sched_at_t)at & (UINT64_MAX >> AT_SHIFT);
+}
+
+static mu_time_abs_t at_unpack(mu_sched_t *sched, mu_sched_at_t at) {
+    // Shift the difference up to sign-extend it from MU_SCHED_AT_BITS bits.
+    int64_t offset =
+        (int64_t)((at - (mu_sched_at_t)sched->deferred_ref) << AT_SHIFT) >>
+        AT_SHIFT;
+    return mu_time_offset(sched->deferred_ref, offset);
+}
+
+static bool at_precedes(mu_sched_at_t a, mu_sched_at_t b) {
+    return (int64_t)((a - b) << AT_SHIFT) < 0;
+}
+
+#else
+
+static bool slot_for(mu_task_t *task, mu_sched_slot_t *slot) {
+    *slot = task;
+    return true;
+}
+
+static mu_task_t *slot_task(mu_sched_slot_t slot) { return slot; }
+
+static size_t irq_capacity(mu_sched_t *sched) {
+    return mu_spsc_capacity(&sched->irq_tasks);
+}
+
+static bool irq_put(mu_sched_t *sched, mu_sched_slot_t slot) {
+    return mu_spsc_put(&sched->irq_tasks, slot) == MU_SPSC_ERR_NONE;
+}
+
+static bool irq_get(mu_sched_t *sched, mu_sched_slot_t *slot) {
+    return mu_spsc_get(&sched->irq_tasks, slot) == MU_SPSC_ERR_NONE;
+}
+
+static bool asap_put(mu_sched_asap_queue_t *q, mu_sched_slot_t slot) {
+    return mu_mqueue_put(q, slot);
+}
+
+static bool asap_get(mu_sched_asap_queue_t *q, mu_sched_slot_t *slot) {
+    return mu_mqueue_get(q, slot);
+}
+
+static bool asap_peek(mu_sched_asap_queue_t *q, mu_sched_slot_t *slot) {
+    return mu_mqueue_peek(q, slot);
+}
+
+static size_t asap_count(mu_sched_asap_queue_t *q) {
+    return mu_mqueue_count(q);
+}
+
+static bool asap_at(mu_sched_asap_queue_t *q, size_t n, mu_sched_slot_t *slot) {
+    if (n >= q->count) {
+        return false;
+    }
+    // Same arithmetic as mu_mqueue_peek(), n items further on.
+    *slot = q->storage[(q->capacity + q->index - q->count + n) % q->capacity];
+    return true;
+}
+
+static void asap_init(mu_sched_asap_queue_t *q, mu_sched_slot_t *store,
+                      size_t capacity) {
+    mu_mqueue_init(q, store, capacity, NULL, NULL);
+}
+
+static mu_task_t *deferred_get_task(deferred_task_t *deferred_task) {
+    return deferred_task->task;
+}
+
+static void deferred_set_task(deferred_task_t *deferred_task,
+                              mu_task_t *task) {
+    deferred_task->task = task;
+}
+
+static mu_sched_at_t deferred_get_at(deferred_task_t *deferred_task) {
+    return deferred_task->at;
+}
+
+static void deferred_set_at(deferred_task_t *deferred_task, mu_sched_at_t at) {
+    deferred_task->at = at;
+}
+
+static bool at_fits(mu_sched_t *sched, mu_time_abs_t at) {
+    (void)sched;
+    (void)at;
+    return true;
+}
+
+static mu_sched_at_t at_pack(mu_sched_t *sched, mu_time_abs_t at) {
+    (void)sched;
+    return at;
+}
+
+static mu_time_abs_t at_unpack(mu_sched_t *sched, mu_sched_at_t at) {
+    (void)sched;
+    return at;
+}
+
+static bool at_precedes(mu_sched_at_t a, mu_sched_at_t b) {
+    return mu_time_precedes(a, b);
+}
+
+#endif
+
+static bool asap_push(mu_sched_t *sched, mu_sched_prio_t prio,
+                      mu_sched_slot_t slot) {
+    if (asap_put(&sched->asap_tasks[prio], slot)) {
+        return true;
+    }
+#ifdef MU_CONFIG_SCHED_GROWABLE
+    size_t capacity =
+        grown_capacity(sched->asap_capacity, sched->asap_max_capacity);
+    if (sched->allocator.alloc == NULL || capacity == 0 ||
+        capacity > SIZE_MAX / (MU_CONFIG_SCHED_ASAP_PRIORITIES *
+                               sizeof(mu_sched_slot_t))) {
+        return false;
+    }
+    mu_sched_slot_t *store = sched->allocator.alloc(
+        MU_CONFIG_SCHED_ASAP_PRIORITIES * capacity * sizeof(*store),
+        sched->allocator.arg);
+    if (store == NULL) {
+        return false;
+    }
+    asap_move(sched, store, capacity);
+    return asap_put(&sched->asap_tasks[prio], slot);
+#else
+    (void)sched;
+    return false;
+#endif
+}
+
+static bool deferred_has_room(mu_sched_t *sched) {
+    if (sched->deferred_task_count < sched->deferred_capacity) {
+        return true;
+    }
+#ifdef MU_CONFIG_SCHED_GROWABLE
+    size_t capacity =
+        grown_capacity(sched->deferred_capacity, sched->deferred_max_capacity);
+    if (sched->allocator.alloc == NULL || capacity == 0 ||
+        capacity > SIZE_MAX / sizeof(mu_sched_deferred_t)) {
+        return false;
+    }
+    mu_sched_deferred_t *store = sched->allocator.alloc(
+        capacity * sizeof(*store), sched->allocator.arg);
+    if (store == NULL) {
+        return false;
+    }
+    deferred_move(sched, store, capacity);
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef MU_CONFIG_SCHED_LOAD
+
+static mu_time_abs_t load_begin(mu_sched_t *sched) {
+    // Read clock_fn directly: a cached batch time would hide the time spent
+    // in tasks.
+    mu_time_abs_t now = sched->clock_fn();
+    mu_time_rel_t idle = mu_time_difference(now, sched->load.mark);
+
+    if (idle > 0) {
+        sched->load.idle += (uint64_t)idle;
+    }
+    sched->load.mark = now;
+    return now;
+}
+
+static void load_end(mu_sched_t *sched, mu_time_abs_t started) {
+    mu_sched_load_t *load = &sched->load;
+    mu_time_abs_t now = sched->clock_fn();
+    mu_time_rel_t busy = mu_time_difference(now, started);
+
+    if (busy > 0) {
+        load->busy += (uint64_t)busy;
+        for (int n = 0; n < MU_CONFIG_SCHED_LOAD_WINDOWS; n++) {
+            load->windows[n].busy += (uint64_t)busy;
+        }
+    }
+    load->tasks_run += 1;
+    load->mark = now;
+    load_roll(sched, now);
+}
+
+static void load_roll(mu_sched_t *sched, mu_time_abs_t now) {
+    for (int n = 0; n < MU_CONFIG_SCHED_LOAD_WINDOWS; n++) {
+        mu_sched_load_window_t *window = &sched->load.windows[n];
+        mu_time_rel_t elapsed = mu_time_difference(now, window->start);
+        if (window->length <= 0 || elapsed < window->length) {
+            continue;
+        }
+        uint64_t busy = window->busy;
+        uint64_t span = (uint64_t)elapsed;
+        while (busy > UINT64_MAX / MU_SCHED_LOAD_FULL) {
+            busy >>= 1; // keep busy * MU_SCHED_LOAD_FULL in range
+            span >>= 1;
+        }
+        window->utilization = busy >= span ? MU_SCHED_LOAD_FULL
+                                           : busy * MU_SCHED_LOAD_FULL / span;
+        window->start = now;
+        window->busy = 0;
+    }
+}
 
-#include "mu_config.h"
-#include "mu_mqueue.h"
-#include "mu_spsc.h"
-#include "mu_task.h"
-#include "mu_time.h"
-#include <stdbool.h>
-#include <stdint.h>
-#include <string.h>
+#endif
 
-// #include <stdio.h> // debugging
+#ifdef MU_CONFIG_SCHED_GROWABLE
 
-// *****************************************************************************
-// Local (private) types and definitions
+static size_t grown_capacity(size_t capacity, size_t max_capacity) {
+    size_t grown = capacity == 0 ? 1 : 2 * capacity;
+    if (grown < capacity) {
+        grown = SIZE_MAX; // overflow
+    }
+    if (max_capacity != 0 && grown > max_capacity) {
+        grown = max_capacity;
+    }
+    return grown > capacity ? grown : 0;
+}
 
-// A deferred_task associates a task and a time.
-typedef struct {
-    mu_time_abs_t at;
-    mu_task_t *task;
-} deferred_task_t;
+static void asap_move(mu_sched_t *sched, mu_sched_slot_t *store,
+                      size_t capacity) {
+    for (int prio = 0; prio < MU_CONFIG_SCHED_ASAP_PRIORITIES; prio++) {
+        mu_sched_asap_queue_t *q = &sched->asap_tasks[prio];
+        mu_sched_slot_t *dst = &store[prio * capacity];
+        size_t count = asap_count(q);
+        for (size_t i = 0; i < count; i++) {
+            asap_at(q, i, &dst[i]);
+        }
+        // Re-queue the copied slots in place, oldest first.
+        asap_init(q, dst, capacity);
+        for (size_t i = 0; i < count; i++) {
+            asap_put(q, dst[i]);
+        }
+#ifdef MU_CONFIG_SCHED_STATS
+        // Likewise start the queueing times of the queue at the table's head.
+        rotate_times(sched->asap_queued_at[prio], sched->asap_capacity,
+                     sched->asap_queued_at_head[prio]);
+        sched->asap_queued_at_head[prio] = 0;
+#endif
+    }
+    if (sched->asap_store != sched->asap_base) {
+        sched->allocator.free(sched->asap_store, sched->allocator.arg);
+    }
+    sched->asap_store = store;
+    sched->asap_capacity = capacity;
+#ifdef MU_CONFIG_SCHED_STATS
+    sched->stats.queues[MU_SCHED_QUEUE_ASAP].capacity = capacity;
+#endif
+}
 
-typedef struct {
-    mu_spsc_t irq_tasks;        // tasks queued from interrupt level.
-    mu_mqueue_t asap_tasks;     // tasks to be run "as soon as possible"
-    size_t deferred_task_count; // number of deferred tasks in queue
-    mu_task_t *curr_task;       // task currently being processed.
-    mu_clock_fn clock_fn;       // function to call to get the current time.
-    mu_task_t *idle_task;       // task to run when nothing else is runnable.
-} mu_sched_t;
+static void deferred_move(mu_sched_t *sched, mu_sched_deferred_t *store,
+                          size_t capacity) {
+    // Tasks keep their positions, so heap back-indices stay valid.
+    memcpy(store, sched->deferred_tasks,
+           sched->deferred_task_count * sizeof(*store));
+    if (sched->deferred_tasks != sched->deferred_base) {
+        sched->allocator.free(sched->deferred_tasks, sched->allocator.arg);
+    }
+    sched->deferred_tasks = store;
+    sched->deferred_capacity = capacity;
+#ifdef MU_CONFIG_SCHED_STATS
+    sched->stats.queues[MU_SCHED_QUEUE_DEFERRED].capacity = capacity;
+#endif
+}
 
-// *****************************************************************************
-// Local (private, static) forward declarations
+#ifdef MU_CONFIG_SCHED_STATS
 
-/**
- * @brief Return the next deferred task in the queue, or NULL if there is none.
- */
-static deferred_task_t *peek_next_deferred_task(void);
+static void rotate_times(mu_time_abs_t *times, size_t n, size_t k) {
+    // Three reversals rotate in place.
+    size_t spans[3][2] = {{0, k}, {k, n}, {0, n}};
+    for (int s = 0; s < 3; s++) {
+        size_t lo = spans[s][0];
+        size_t hi = spans[s][1];
+        while (lo + 1 < hi) {
+            mu_time_abs_t t = times[lo];
+            times[lo++] = times[--hi];
+            times[hi] = t;
+        }
+    }
+}
 
-/**
- * @brief Fetch the next runnable task, if any, from the deferred task queue.
- */
-static mu_task_t *fetch_runnable_deferred_task(void);
+#endif
 
-/**
- * @brief Schedule the given task at the given time.
- */
-static mu_task_err_t sched_aux(mu_task_t *task, mu_time_abs_t at);
+#endif // MU_CONFIG_SCHED_GROWABLE
 
-// *****************************************************************************
-// Local (private, static) storage
+// mu_spsc_t and the irq ring of task IDs share field names and index rules.
+static size_t irq_count(mu_sched_t *sched) {
+    mu_sched_irq_queue_t *q = &sched->irq_tasks;
+    return atomic_load_explicit(&q->tail, memory_order_acquire) -
+           atomic_load_explicit(&q->head, memory_order_acquire);
+}
 
-static void *s_irq_store[MU_CONFIG_SCHED_MAX_IRQ_TASKS];
-static void *s_now_store[MU_CONFIG_SCHED_MAX_ASAP_TASKS];
-static deferred_task_t s_deferred_tasks[MU_CONFIG_SCHED_MAX_DEFERRED_TASKS];
-static mu_sched_t s_sched;
+static bool irq_at(mu_sched_t *sched, size_t n, mu_sched_slot_t *slot) {
+    mu_sched_irq_queue_t *q = &sched->irq_tasks;
+    if (n >= irq_count(sched)) {
+        return false;
+    }
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    *slot = q->store[(head + n) & q->mask];
+    return true;
+}
 
-// *****************************************************************************
-// Public code
+#ifdef MU_CONFIG_SCHED_STATS
 
-void mu_sched_init(void) {
-    mu_spsc_init(&s_sched.irq_tasks, s_irq_store, MU_CONFIG_SCHED_MAX_IRQ_TASKS);
-    mu_mqueue_init(&s_sched.asap_tasks, s_now_store, MU_CONFIG_SCHED_MAX_ASAP_TASKS,
-                   NULL, NULL);
-    s_sched.deferred_task_count = 0;
-    s_sched.curr_task = NULL;
-    s_sched.clock_fn = mu_time_now;
-    s_sched.idle_task = NULL;
+static void stats_record_wait(mu_sched_t *sched, mu_sched_queue_t queue,
+                              mu_time_abs_t queued_at, mu_time_abs_t now) {
+    mu_sched_hist_record(&sched->stats.queues[queue].wait,
+                         mu_time_difference(now, queued_at));
 }
 
-void mu_sched_reset(void) { s_sched.deferred_task_count = 0; }
+static void stats_record_depth(mu_sched_t *sched, mu_sched_queue_t queue,
+                               size_t depth) {
+    if (depth > sched->stats.queues[queue].high_water) {
+        sched->stats.queues[queue].high_water = depth;
+    }
+}
 
-void mu_sched_step(void) {
-    mu_spsc_item_t item = (mu_spsc_item_t)(&s_sched.curr_task);
+static void stats_record_deferred(mu_sched_t *sched,
+                                  deferred_task_t *deferred_task,
+                                  mu_time_abs_t now) {
+    mu_task_t *task = deferred_get_task(deferred_task);
+    mu_time_abs_t at = at_unpack(sched, deferred_get_at(deferred_task));
+    mu_time_rel_t lateness = mu_time_difference(now, at);
+    stats_record_wait(sched, MU_SCHED_QUEUE_DEFERRED, deferred_task->queued_at,
+                      now);
+    mu_sched_hist_record(&sched->stats.lateness, lateness);
+    if (task->lateness != NULL) {
+        mu_sched_hist_record(task->lateness, lateness);
+    }
+}
 
-    if (mu_spsc_get(&s_sched.irq_tasks, item) == MU_SPSC_ERR_NONE) {
-        // pulled one task from the irq task queue
-        asm("nop");
+#endif
 
-    } else if ((s_sched.curr_task = fetch_runnable_deferred_task()) != NULL) {
-        // pulled one runnable task from the deferred task queue
-        asm("nop");
+static int run_batch(mu_sched_t *sched, bool has_now, mu_time_abs_t now) {
+    int count = 0;
+    mu_task_t *task;
+    mu_sched_t *prev_running = s_running;
+#ifdef MU_CONFIG_SCHED_CACHED_NOW
+    bool prev_in_batch = sched->in_batch;
 
-    } else if (mu_mqueue_get(&s_sched.asap_tasks,
-                             (void **)&s_sched.curr_task) == true) {
-        // pulled one task from the "now" task queue
-        asm("nop");
+    // The batch's time is read on first use, or is the caller's snapshot.
+    sched->in_batch = true;
+    sched->now_valid = has_now;
+    sched->now = now;
+#endif
 
-    } else {
-        // no runnable tasks available -- use the idle task (may be NULL)
-        s_sched.curr_task = s_sched.idle_task;
+    s_running = sched;
+
+    // Each phase runs at most as many tasks as were queued when it started.
+    for (size_t n = irq_capacity(sched); n > 0; n--) {
+        if ((task = fetch_irq_task(sched)) == NULL) {
+            break;
+        }
+        run_task(sched, task);
+        count += 1;
     }
 
-    // invoke the task.
-    mu_task_call(s_sched.curr_task, NULL);
-    s_sched.curr_task = NULL;
+    if (peek_next_deferred_task(sched) != NULL) {
+        if (!has_now) {
+            now = mu_sched_inst_get_current_time(sched);
+        }
+        for (size_t n = sched->deferred_task_count; n > 0; n--) {
+            if ((task = fetch_runnable_deferred_task(sched, now)) == NULL) {
+                break;
+            }
+            run_task(sched, task);
+            count += 1;
+        }
+    }
+
+#ifdef MU_CONFIG_SCHED_EDF
+    if (sched->edf_task_count > 0) {
+        // Read the clock afresh: the tasks above may have taken a while, and
+        // a stale reading would hide deadline misses.
+#ifdef MU_CONFIG_SCHED_CACHED_NOW
+        now = sched->clock_fn();
+#else
+        now = mu_sched_inst_get_current_time(sched);
+#endif
+        for (size_t n = sched->edf_task_count; n > 0; n--) {
+            if ((task = fetch_edf_task(sched, now)) == NULL) {
+                break;
+            }
+            run_task(sched, task);
+            count += 1;
+        }
+    }
+#endif
+
+    size_t n = 0;
+    for (int prio = 0; prio < MU_CONFIG_SCHED_ASAP_PRIORITIES; prio++) {
+        n += asap_count(&sched->asap_tasks[prio]);
+    }
+    for (; n > 0; n--) {
+        if ((task = fetch_asap_task(sched)) == NULL) {
+            break;
+        }
+        run_task(sched, task);
+        count += 1;
+    }
+
+#ifdef MU_CONFIG_SCHED_CACHED_NOW
+    sched->in_batch = prev_in_batch;
+    sched->now_valid = false;
+#endif
+    s_running = prev_running;
+    return count;
 }
 
-mu_clock_fn mu_sched_get_clock_source(void) { return s_sched.clock_fn; }
+#ifdef MU_CONFIG_SCHED_FAIR
 
-void mu_sched_set_clock_source(mu_clock_fn clock_fn) {
-    s_sched.clock_fn = clock_fn;
+static mu_task_t *fetch_fair_task(mu_sched_t *sched) {
+    bool has_now = false;
+    mu_time_abs_t now = 0;
+
+    // Visiting every class once more than there are classes gives each class
+    // (including the one whose turn was under way) a look with fresh credit.
+    for (int visits = 0; visits <= FAIR_CLASS_COUNT; visits++) {
+        mu_task_t *task = NULL;
+        if (sched->fair_credit > 0) {
+            switch (sched->fair_class) {
+            case FAIR_CLASS_IRQ:
+                task = fetch_irq_task(sched);
+                break;
+            case FAIR_CLASS_DEFERRED:
+                if (peek_next_deferred_task(sched) != NULL) {
+                    if (!has_now) {
+                        now = mu_sched_inst_get_current_time(sched);
+                        has_now = true;
+                    }
+                    task = fetch_runnable_deferred_task(sched, now);
+                }
+                break;
+            default:
+#ifdef MU_CONFIG_SCHED_EDF
+                if (sched->edf_task_count > 0) {
+                    if (!has_now) {
+                        now = mu_sched_inst_get_current_time(sched);
+                        has_now = true;
+                    }
+                    task = fetch_edf_task(sched, now);
+                    break;
+                }
+#endif
+                task = fetch_asap_task(sched);
+                break;
+            }
+            if (task != NULL) {
+                sched->fair_credit -= 1;
+                return task;
+            }
+        }
+        // Turn spent, or nothing runnable: the next class takes its turn.
+        sched->fair_class = (sched->fair_class + 1) % FAIR_CLASS_COUNT;
+        sched->fair_credit = sched->fair_weights[sched->fair_class];
+    }
+    return NULL;
 }
 
-mu_time_abs_t mu_sched_get_current_time(void) { return s_sched.clock_fn(); }
+#endif
+
+static void run_task(mu_sched_t *sched, mu_task_t *task) {
+#ifdef MU_CONFIG_SCHED_LOAD
+    mu_time_abs_t started = load_begin(sched);
+#endif
+    sched->curr_task = task;
+    mu_task_call(task, NULL);
+    sched->curr_task = NULL;
+#ifdef MU_CONFIG_SCHED_LOAD
+    load_end(sched, started);
+#endif
+}
 
-mu_task_t *mu_sched_get_idle_task(void) { return s_sched.idle_task; }
+static mu_task_t *fetch_irq_task(mu_sched_t *sched) {
+    mu_sched_slot_t slot;
+#ifdef MU_CONFIG_SCHED_STATS
+    uint32_t head =
+        atomic_load_explicit(&sched->irq_tasks.head, memory_order_relaxed) &
+        sched->irq_tasks.mask;
+#endif
 
-void mu_sched_set_idle_task(mu_task_t *task) { s_sched.idle_task = task; }
+    if (!irq_get(sched, &slot)) {
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
+        return fetch_thread_task(sched);
+#else
+        return NULL;
+#endif
+    }
+    mu_task_t *task = slot_task(slot);
+#ifdef MU_CONFIG_SCHED_DEDUP
+    dedup_clear(task);
+#endif
+#ifdef MU_CONFIG_SCHED_STATS
+    stats_record_wait(sched, MU_SCHED_QUEUE_IRQ, sched->irq_queued_at[head],
+                      mu_sched_inst_get_current_time(sched));
+#endif
+    return task;
+}
 
-mu_task_t *mu_sched_current_task(void) { return s_sched.curr_task; }
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
 
-mu_task_t *mu_sched_peek_next_task(void) {
+static mu_task_t *fetch_thread_task(mu_sched_t *sched) {
+    mu_mpsc_node_t *node = mu_mpsc_pop(&sched->thread_tasks);
+
+    if (node == NULL) {
+        return NULL;
+    }
+    mu_task_t *task = MU_MPSC_CONTAINER_OF(node, mu_task_t, thread_node);
+    // Cleared before the task runs, so that it can be queued again meanwhile.
+    atomic_store_explicit(&task->thread_queued, false, memory_order_release);
+    return task;
+}
+
+#endif
+
+static mu_task_t *fetch_asap_task(mu_sched_t *sched) {
     mu_task_t *task = NULL;
 
-    deferred_task_t *deferred_task = peek_next_deferred_task();
-    if (deferred_task) {
-        return deferred_task->task;
+    if (sched->asap_ready != 0) {
+        // The lowest set bit is the highest priority non-empty queue.
+        int prio = __builtin_ctz(sched->asap_ready);
+        mu_sched_slot_t slot;
+        asap_get(&sched->asap_tasks[prio], &slot);
+        task = slot_task(slot);
+#ifdef MU_CONFIG_SCHED_DEDUP
+        dedup_clear(task);
+#endif
+#ifdef MU_CONFIG_SCHED_STATS
+        size_t *head = &sched->asap_queued_at_head[prio];
+        stats_record_wait(sched, MU_SCHED_QUEUE_ASAP,
+                          sched->asap_queued_at[prio][*head],
+                          mu_sched_inst_get_current_time(sched));
+        *head = (*head + 1) % sched->asap_capacity;
+#endif
+        if (asap_count(&sched->asap_tasks[prio]) == 0) {
+            sched->asap_ready &= ~((uint32_t)1 << prio);
+        }
     }
+    return task;
+}
 
-    if (!mu_mqueue_peek(&s_sched.asap_tasks, (void **)&task)) {
-        // peek failed
+#ifdef MU_CONFIG_SCHED_EDF
+
+// The edf tasks form a binary min-heap ordered by deadline, laid out like the
+// deferred heap: edf_tasks[0] is the next task to run.
+
+static mu_task_t *fetch_edf_task(mu_sched_t *sched, mu_time_abs_t now) {
+    if (sched->edf_task_count == 0) {
         return NULL;
-    } else {
-        return task;
     }
+    mu_sched_edf_t *edf_task = &sched->edf_tasks[0];
+    mu_task_t *task = edf_task->task;
+    if (mu_time_follows(now, edf_task->deadline)) {
+        task->deadline_misses += 1;
+        sched->deadline_misses += 1;
+    }
+#ifdef MU_CONFIG_SCHED_DEDUP
+    dedup_clear(task);
+#endif
+    sched->edf_task_count -= 1;
+    if (sched->edf_task_count > 0) {
+        sched->edf_tasks[0] = sched->edf_tasks[sched->edf_task_count];
+        edf_sift_down(sched, 0);
+    }
+    return task;
 }
 
-mu_task_err_t mu_sched_asap(mu_task_t *task) {
-    // push task onto the "now" queue
-    if (mu_mqueue_put(&s_sched.asap_tasks, task) == false) {
-        return MU_TASK_ERR_SCHED_FULL;
+static bool edf_precedes(mu_sched_edf_t *a, mu_sched_edf_t *b) {
+    if (mu_time_precedes(a->deadline, b->deadline)) {
+        return true;
+    } else if (mu_time_equals(a->deadline, b->deadline)) {
+        // signed difference tolerates wrapping of the sequence number
+        return (int32_t)(a->seq - b->seq) < 0;
     } else {
-        return MU_TASK_ERR_NONE;
+        return false;
     }
 }
 
-mu_task_err_t mu_sched_from_isr(mu_task_t *task) {
-    if (mu_spsc_put(&s_sched.irq_tasks, task) == MU_SPSC_ERR_FULL) {
-        return MU_TASK_ERR_SCHED_FULL;
+static void edf_sift_up(mu_sched_t *sched, size_t i) {
+    mu_sched_edf_t *edf_tasks = sched->edf_tasks;
+    mu_sched_edf_t item = edf_tasks[i];
+
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!edf_precedes(&item, &edf_tasks[parent])) {
+            break;
+        }
+        edf_tasks[i] = edf_tasks[parent];
+        i = parent;
+    }
+    edf_tasks[i] = item;
+}
+
+static void edf_sift_down(mu_sched_t *sched, size_t i) {
+    mu_sched_edf_t *edf_tasks = sched->edf_tasks;
+    size_t count = sched->edf_task_count;
+    mu_sched_edf_t item = edf_tasks[i];
+
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= count) {
+            break;
+        }
+        if ((child + 1 < count) &&
+            edf_precedes(&edf_tasks[child + 1], &edf_tasks[child])) {
+            child += 1;
+        }
+        if (!edf_precedes(&edf_tasks[child], &item)) {
+            break;
+        }
+        edf_tasks[i] = edf_tasks[child];
+        i = child;
+    }
+    edf_tasks[i] = item;
+}
+
+#endif
+
+#ifdef MU_CONFIG_SCHED_DEDUP
+
+static bool dedup_mark(mu_sched_t *sched, mu_task_t *task) {
+    if (!task->dedup) {
+        return true;
+    }
+    // The exchange makes marking atomic with respect to interrupts and other
+    // threads: exactly one of several racing callers sees the old mark.
+    return __atomic_exchange_n(&task->queued, sched->epoch, __ATOMIC_ACQ_REL) !=
+           sched->epoch;
+}
+
+static void dedup_clear(mu_task_t *task) {
+    if (task->dedup) {
+        __atomic_store_n(&task->queued, 0, __ATOMIC_RELEASE);
+    }
+}
+
+#endif
+
+static mu_time_abs_t coalesce(mu_sched_t *sched, mu_time_abs_t at,
+                              mu_time_rel_t slack) {
+    if (slack <= 0) {
+        return at;
+    }
+    mu_time_abs_t latest = mu_time_offset(at, slack);
+
+    // Share the next wakeup if it falls in the window.  Only the head of the
+    // queue is checked: later wakeups in the window aren't searched for.
+    deferred_task_t *next =
+        sched != NULL ? peek_next_deferred_task(sched) : NULL;
+    if (next != NULL) {
+        mu_time_abs_t next_at = at_unpack(sched, deferred_get_at(next));
+        if (!mu_time_precedes(next_at, at) &&
+            !mu_time_follows(next_at, latest)) {
+            return next_at;
+        }
+    }
+    // Otherwise take the one time in the window with the most trailing zero
+    // bits: clear the bits of latest below the highest bit in which it
+    // differs from at - 1.
+    unsigned long long differ = (unsigned long long)((at - 1) ^ latest);
+    int bit = 63 - __builtin_clzll(differ);
+    return latest & ~(((mu_time_abs_t)1 << bit) - 1);
+}
+
+#ifdef MU_CONFIG_SCHED_DEFERRED_HEAP
+
+// The deferred tasks form a binary min-heap: deferred_tasks[0] is the next
+// task to run and the children of slot i live in slots 2i+1 and 2i+2.
+
+static deferred_task_t *peek_next_deferred_task(mu_sched_t *sched) {
+    deferred_task_t *deferred_task = NULL;
+    if (sched->deferred_task_count > 0) {
+        deferred_task = &sched->deferred_tasks[0];
+    }
+    return deferred_task;
+}
+
+static mu_task_t *fetch_runnable_deferred_task(mu_sched_t *sched,
+                                               mu_time_abs_t now) {
+    deferred_task_t *deferred_task;
+
+    deferred_task = peek_next_deferred_task(sched);
+    if (deferred_task &&
+        !at_precedes((mu_sched_at_t)now, deferred_get_at(deferred_task))) {
+        // A deferred_task's time has arrived.  Remove it from the heap.
+        mu_task_t *task = deferred_get_task(deferred_task);
+#ifdef MU_CONFIG_SCHED_STATS
+        stats_record_deferred(sched, deferred_task, now);
+#endif
+        heap_remove_at(sched, 0);
+        return task;
     } else {
-        return MU_TASK_ERR_NONE;
+        return NULL;
     }
 }
 
-mu_task_err_t mu_sched_defer_until(mu_task_t *task, mu_time_abs_t at) {
-    return sched_aux(task, at);
+static mu_task_err_t sched_aux(mu_sched_t *sched, mu_task_t *task,
+                               mu_time_abs_t at) {
+    deferred_task_t *deferred_task;
+    mu_sched_slot_t slot;
+    size_t i;
+
+    if (!slot_for(task, &slot)) {
+#ifdef MU_CONFIG_SCHED_STATS
+        sched->stats.queues[MU_SCHED_QUEUE_DEFERRED].sched_full += 1;
+#endif
+        return MU_TASK_ERR_SCHED_FULL;
+    }
+    if (!at_fits(sched, at)) {
+        return MU_TASK_ERR_SCHED_RANGE;
+    }
+    if (!deferred_has_room(sched)) {
+#ifdef MU_CONFIG_SCHED_STATS
+        sched->stats.queues[MU_SCHED_QUEUE_DEFERRED].sched_full += 1;
+#endif
+        return MU_TASK_ERR_SCHED_FULL;
+    }
+
+    // Append the new deferred_task to the end of the heap and let it rise to
+    // its proper place.  The sequence number guarantees that a task scheduled
+    // for the same 'at' as an existing task will follow it.
+    i = sched->deferred_task_count;
+    deferred_task = &sched->deferred_tasks[i];
+    deferred_set_at(deferred_task, at_pack(sched, at));
+    deferred_set_task(deferred_task, task);
+    deferred_task->seq = sched->deferred_seq++;
+#ifdef MU_CONFIG_SCHED_STATS
+    deferred_task->queued_at = mu_sched_inst_get_current_time(sched);
+#endif
+    sched->deferred_task_count += 1;
+    task->deferred_count += 1;
+    heap_sift_up(sched, i);
+#ifdef MU_CONFIG_SCHED_STATS
+    stats_record_depth(sched, MU_SCHED_QUEUE_DEFERRED,
+                       sched->deferred_task_count);
+#endif
+    return MU_TASK_ERR_NONE;
 }
 
-mu_task_err_t mu_sched_defer_for(mu_task_t *task, mu_time_rel_t in) {
-    mu_time_abs_t at = mu_time_offset(mu_sched_get_current_time(), in);
-    return sched_aux(task, at);
+static bool heap_precedes(deferred_task_t *a, deferred_task_t *b) {
+    mu_sched_at_t a_at = deferred_get_at(a);
+    mu_sched_at_t b_at = deferred_get_at(b);
+    if (at_precedes(a_at, b_at)) {
+        return true;
+    } else if (a_at == b_at) {
+        // signed difference tolerates wrapping of the sequence number
+        return (int32_t)(a->seq - b->seq) < 0;
+    } else {
+        return false;
+    }
 }
 
-mu_task_err_t mu_sched_remove_deferred_task(mu_task_t *task) {
-    mu_task_err_t err = MU_TASK_ERR_NOT_FOUND;
+static void heap_sift_up(mu_sched_t *sched, size_t i) {
+    deferred_task_t *deferred_tasks = sched->deferred_tasks;
+    deferred_task_t item = deferred_tasks[i];
 
-    size_t i = s_sched.deferred_task_count;
     while (i > 0) {
-        deferred_task_t *deferred_task = &s_deferred_tasks[i - 1];
-        if (deferred_task->task == task) {
-            // use memmove to close slot at i-1
-            size_t to_move = s_sched.deferred_task_count - i;
-            if (to_move > 0) {
-                deferred_task_t *src = &s_deferred_tasks[i];
-                memmove(deferred_task, src, to_move * sizeof(deferred_task_t));
-            }
-            s_sched.deferred_task_count -= 1;
-            err = MU_TASK_ERR_NONE;
+        size_t parent = (i - 1) / 2;
+        if (!heap_precedes(&item, &deferred_tasks[parent])) {
+            break;
         }
-        i -= 1;
+        heap_place(sched, i, &deferred_tasks[parent]);
+        i = parent;
     }
-    return err;
+    heap_place(sched, i, &item);
 }
 
-#if 0
-// ChatGPT's rewrite:
-mu_task_err_t mu_sched_remove_deferred_task(mu_task_t *task) {
-  mu_task_err_t err = MU_TASK_ERR_NOT_FOUND;
-  deferred_task_t *candidate;
+static void heap_sift_down(mu_sched_t *sched, size_t i) {
+    deferred_task_t *deferred_tasks = sched->deferred_tasks;
+    size_t count = sched->deferred_task_count;
+    deferred_task_t item = deferred_tasks[i];
 
-  deferred_task_t *last = s_deferred_tasks + s_sched.deferred_task_count;
-  for (candidate = s_deferred_tasks; candidate < last; candidate++) {
-    if (candidate->task == task) {
-      // use memmove to close slot at i-1
-      size_t to_move = last - candidate - 1;
-      if (to_move > 0) {
-        deferred_task_t *src = candidate + 1;
-        memmove(candidate, src, to_move * sizeof(deferred_task_t));
-      }
-      s_sched.deferred_task_count--;
-      err = MU_TASK_ERR_NONE;
-      break;  // inappropriate if task appears more than once.
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= count) {
+            break;
+        }
+        if ((child + 1 < count) && heap_precedes(&deferred_tasks[child + 1],
+                                                 &deferred_tasks[child])) {
+            child += 1;
+        }
+        if (!heap_precedes(&deferred_tasks[child], &item)) {
+            break;
+        }
+        heap_place(sched, i, &deferred_tasks[child]);
+        i = child;
     }
-  }
-  return err;
+    heap_place(sched, i, &item);
 }
-#endif
 
-// *****************************************************************************
-// Local (private, static) code
+static void heap_remove_at(mu_sched_t *sched, size_t i) {
+    size_t last = sched->deferred_task_count - 1;
+    mu_task_t *task = deferred_get_task(&sched->deferred_tasks[i]);
+
+    // If the task has other entries, its slot isn't known until one of them
+    // moves.  Until then, mu_sched_inst_remove_deferred_task() searches.
+    task->deferred_slot = 0;
+    if (task->deferred_count > 0) {
+        task->deferred_count -= 1;
+    }
+    sched->deferred_task_count = last;
+    if (i != last) {
+        // Fill the hole with the last item, which may need to move either way.
+        heap_place(sched, i, &sched->deferred_tasks[last]);
+        heap_sift_down(sched, i);
+        heap_sift_up(sched, i);
+    }
+}
+
+static void heap_place(mu_sched_t *sched, size_t i, deferred_task_t *item) {
+    sched->deferred_tasks[i] = *item;
+    deferred_get_task(&sched->deferred_tasks[i])->deferred_slot = i + 1;
+}
+
+static bool heap_find(mu_sched_t *sched, mu_task_t *task, size_t *i) {
+    // deferred_slot is stale if the scheduler was reset while the task was
+    // deferred (or if the task is deferred in another scheduler), so confirm
+    // that the slot really holds the task.
+    size_t slot = task->deferred_slot;
+    if (slot == 0 || slot > sched->deferred_task_count ||
+        deferred_get_task(&sched->deferred_tasks[slot - 1]) != task) {
+        return false;
+    }
+    *i = slot - 1;
+    return true;
+}
 
-static deferred_task_t *peek_next_deferred_task(void) {
+#else
+
+static deferred_task_t *peek_next_deferred_task(mu_sched_t *sched) {
     deferred_task_t *deferred_task = NULL;
-    if (s_sched.deferred_task_count > 0) {
-        deferred_task = &s_deferred_tasks[s_sched.deferred_task_count - 1];
+    if (sched->deferred_task_count > 0) {
+        deferred_task = &sched->deferred_tasks[sched->deferred_task_count - 1];
     }
     return deferred_task;
 }
 
-static mu_task_t *fetch_runnable_deferred_task(void) {
+static mu_task_t *fetch_runnable_deferred_task(mu_sched_t *sched,
+                                               mu_time_abs_t now) {
     deferred_task_t *deferred_task;
-    mu_time_abs_t now = mu_sched_get_current_time();
 
-    deferred_task = peek_next_deferred_task();
-    if (deferred_task && !mu_time_precedes(now, deferred_task->at)) {
+    deferred_task = peek_next_deferred_task(sched);
+    if (deferred_task &&
+        !at_precedes((mu_sched_at_t)now, deferred_get_at(deferred_task))) {
         // A deferred_task's time has arrived.
         // NOTE: normally it would be an error to decrement the
         // deferred_task_count before the task is consumed, but this is
         // operating in a single-threaded environment, so this is safe.
-        s_sched.deferred_task_count -= 1;
-        return deferred_task->task;
+#ifdef MU_CONFIG_SCHED_STATS
+        stats_record_deferred(sched, deferred_task, now);
+#endif
+        sched->deferred_task_count -= 1;
+        return deferred_get_task(deferred_task);
     } else {
         return NULL;
     }
 }
 
-static mu_task_err_t sched_aux(mu_task_t *task, mu_time_abs_t at) {
+static mu_task_err_t sched_aux(mu_sched_t *sched, mu_task_t *task,
+                               mu_time_abs_t at) {
+    deferred_task_t *deferred_tasks;
     deferred_task_t *deferred_task;
+    mu_sched_slot_t slot;
 
-    if (s_sched.deferred_task_count == MU_CONFIG_SCHED_MAX_DEFERRED_TASKS) {
+    if (!at_fits(sched, at)) {
+        return MU_TASK_ERR_SCHED_RANGE;
+    }
+    if (!deferred_has_room(sched) || !slot_for(task, &slot)) {
+#ifdef MU_CONFIG_SCHED_STATS
+        sched->stats.queues[MU_SCHED_QUEUE_DEFERRED].sched_full += 1;
+#endif
         return MU_TASK_ERR_SCHED_FULL;
     }
 
     // perform a linear search to find the insertion point
-    size_t i = s_sched.deferred_task_count;
+    deferred_tasks = sched->deferred_tasks;
+    mu_sched_at_t packed = at_pack(sched, at);
+    size_t i = sched->deferred_task_count;
     while (i > 0) {
-        deferred_task = &s_deferred_tasks[i - 1];
+        deferred_task = &deferred_tasks[i - 1];
         // Strict ordering: if a task already is scheduled for 'at', schedule
         // this new deferred_task to follow it.
-        if (mu_time_follows(deferred_task->at, at)) {
+        if (at_precedes(packed, deferred_get_at(deferred_task))) {
             break;
         }
         i -= 1;
@@ -276,18 +2469,27 @@ static mu_task_err_t sched_aux(mu_task_t *task, mu_time_abs_t at) {
 
     // Here, i is the index for the new deferred_task.  If needed, open a slot
     // at i.
-    int to_move = s_sched.deferred_task_count - i;
+    int to_move = sched->deferred_task_count - i;
     if (to_move > 0) {
-        deferred_task_t *src = &s_deferred_tasks[i];
-        deferred_task_t *dst = &s_deferred_tasks[i + 1];
+        deferred_task_t *src = &deferred_tasks[i];
+        deferred_task_t *dst = &deferred_tasks[i + 1];
         memmove(dst, src, to_move * sizeof(deferred_task_t));
     }
 
     // Write the time and task into the deferred_task, bump the deferred_task
     // count.
-    deferred_task = &s_deferred_tasks[i];
-    deferred_task->at = at;
-    deferred_task->task = task;
-    s_sched.deferred_task_count += 1;
+    deferred_task = &deferred_tasks[i];
+    deferred_set_at(deferred_task, packed);
+    deferred_set_task(deferred_task, task);
+#ifdef MU_CONFIG_SCHED_STATS
+    deferred_task->queued_at = mu_sched_inst_get_current_time(sched);
+#endif
+    sched->deferred_task_count += 1;
+#ifdef MU_CONFIG_SCHED_STATS
+    stats_record_depth(sched, MU_SCHED_QUEUE_DEFERRED,
+                       sched->deferred_task_count);
+#endif
     return MU_TASK_ERR_NONE;
 }
+
+#endif
@@ -44,6 +44,11 @@ Any task scheduled from interrupt level is saved in an interrupt safe
 the next time mu_sched_step() is called, any tasks on the queue are added
 to the regular schedule as if mu_sched_asap() was called.
 
+With MU_CONFIG_SCHED_FROM_THREAD, any number of host threads may also schedule
+tasks, through a lock-free "multiple producer, single consumer" queue:
+
+   mu_task_err_t mu_sched_from_thread(mu_task_t *task);
+
 The function
 
    mu_task_err_t mu_sched_step(void);
@@ -65,6 +70,11 @@ extern "C" {
 // Includes
 
 #include "mu_config.h"
+#include "mu_mqueue.h"
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
+#include "mu_mpsc.h"
+#endif
+#include "mu_spsc.h"
 #include "mu_task.h"
 #include "mu_time.h"
 #include <stdbool.h>
@@ -93,9 +103,278 @@ extern "C" {
 #define MU_CONFIG_SCHED_MAX_ASAP_TASKS 20
 #endif
 
+#ifndef MU_CONFIG_SCHED_ASAP_PRIORITIES
+#define MU_CONFIG_SCHED_ASAP_PRIORITIES 1
+#endif
+
+#ifndef MU_CONFIG_SCHED_ASAP_DEFAULT_PRIORITY
+#define MU_CONFIG_SCHED_ASAP_DEFAULT_PRIORITY                                  \
+    ((MU_CONFIG_SCHED_ASAP_PRIORITIES - 1) / 2)
+#endif
+
+#ifdef MU_CONFIG_SCHED_EDF
+#ifndef MU_CONFIG_SCHED_MAX_EDF_TASKS
+#define MU_CONFIG_SCHED_MAX_EDF_TASKS 16
+#endif
+#endif
+
+#ifdef MU_CONFIG_SCHED_FAIR
+// Default number of consecutive mu_sched_step() dispatches each class of task
+// gets in its turn.  See mu_sched_set_fair_weights().
+#ifndef MU_CONFIG_SCHED_FAIR_IRQ_WEIGHT
+#define MU_CONFIG_SCHED_FAIR_IRQ_WEIGHT 4
+#endif
+#ifndef MU_CONFIG_SCHED_FAIR_DEFERRED_WEIGHT
+#define MU_CONFIG_SCHED_FAIR_DEFERRED_WEIGHT 2
+#endif
+#ifndef MU_CONFIG_SCHED_FAIR_ASAP_WEIGHT
+#define MU_CONFIG_SCHED_FAIR_ASAP_WEIGHT 1
+#endif
+#endif
+
+// Storage class of the record of which scheduler is running a task.  Define
+// as _Thread_local when schedulers run on more than one thread.
+#ifndef MU_CONFIG_SCHED_THREAD_LOCAL
+#define MU_CONFIG_SCHED_THREAD_LOCAL
+#endif
+
+// Priority levels for asap tasks.  Lower numbers run first.
+#define MU_SCHED_PRIO_HIGHEST 0
+#define MU_SCHED_PRIO_LOWEST (MU_CONFIG_SCHED_ASAP_PRIORITIES - 1)
+#define MU_SCHED_PRIO_DEFAULT MU_CONFIG_SCHED_ASAP_DEFAULT_PRIORITY
+
+typedef unsigned int mu_sched_prio_t;
+
 // Signature for clock source function.  Returns the current time.
 typedef mu_time_abs_t (*mu_clock_fn)(void);
 
+// Signature for a function that wakes up a sleeping scheduler loop.
+typedef void (*mu_sched_wakeup_fn)(void);
+
+// The queues in which a task waits to run.
+typedef enum {
+    MU_SCHED_QUEUE_IRQ,
+    MU_SCHED_QUEUE_DEFERRED,
+    MU_SCHED_QUEUE_ASAP,
+    MU_SCHED_QUEUE_COUNT,
+} mu_sched_queue_t;
+
+// A task waiting in a scheduler, as reported by mu_sched_inst_visit().
+typedef struct {
+    mu_task_t *task;
+    mu_sched_queue_t queue;
+    mu_sched_prio_t prio; // asap tasks: the priority level
+    bool has_deadline;    // asap tasks: queued by mu_sched_asap_deadline()
+    mu_time_abs_t at;     // deferred tasks: when due.  Deadline tasks: deadline
+    uint32_t order;       // breaks ties between equal 'at' values: lower first
+} mu_sched_entry_t;
+
+// Signature for a mu_sched_inst_visit() function.  Return false to stop.
+typedef bool (*mu_sched_visit_fn)(const mu_sched_entry_t *entry, void *arg);
+
+#ifdef MU_CONFIG_SCHED_GROWABLE
+
+// Allocates the storage for grown queues.  See mu_sched_inst_set_allocator().
+typedef struct {
+    void *(*alloc)(size_t size, void *arg); // return NULL on failure
+    void (*free)(void *ptr, void *arg);
+    void *arg;
+} mu_sched_allocator_t;
+
+#endif
+
+#ifdef MU_CONFIG_SCHED_STATS
+
+#ifndef MU_CONFIG_SCHED_STATS_BUCKETS
+#define MU_CONFIG_SCHED_STATS_BUCKETS 24
+#endif
+
+// A log2 histogram of durations in mu_time units.  buckets[0] counts values of
+// zero or less, buckets[b] counts values in [2^(b-1), 2^b), and the last bucket
+// also counts anything larger.
+typedef struct _mu_sched_hist {
+    uint32_t buckets[MU_CONFIG_SCHED_STATS_BUCKETS];
+    uint32_t count;    // number of values recorded
+    mu_time_rel_t max; // largest value recorded
+} mu_sched_hist_t;
+
+typedef struct {
+    mu_sched_hist_t wait; // time from being queued to being run
+    size_t capacity;      // queue capacity (for asap, per priority level)
+    size_t high_water;    // greatest number of tasks seen in the queue (for
+                          // asap, in one priority level or the deadline queue)
+    uint32_t sched_full;  // number of MU_TASK_ERR_SCHED_FULL errors
+} mu_sched_queue_stats_t;
+
+typedef struct {
+    mu_sched_queue_stats_t queues[MU_SCHED_QUEUE_COUNT];
+    mu_sched_hist_t lateness; // deferred tasks: time run minus time requested
+} mu_sched_stats_t;
+
+#endif // MU_CONFIG_SCHED_STATS
+
+#ifdef MU_CONFIG_SCHED_LOAD
+
+#ifndef MU_CONFIG_SCHED_LOAD_WINDOWS
+#define MU_CONFIG_SCHED_LOAD_WINDOWS 3
+#endif
+
+// The utilization of a window with no idle time.
+#define MU_SCHED_LOAD_FULL 10000
+
+// A utilization window.  See mu_sched_set_load_window().
+typedef struct {
+    mu_time_rel_t length; // how long the window is, or 0 if unused
+    mu_time_abs_t start;  // when the current window began
+    uint64_t busy;        // time spent running tasks in the current window
+    uint32_t utilization; // busy share of the last window, of LOAD_FULL
+} mu_sched_load_window_t;
+
+// How busy a scheduler has been.  Times are in mu_time units.
+typedef struct {
+    uint64_t busy;       // time spent running tasks, other than the idle task
+    uint64_t idle;       // all other time
+    uint32_t tasks_run;  // number of tasks run, other than the idle task
+    uint32_t idle_steps; // mu_sched_step() calls that found nothing to run
+    mu_time_abs_t mark;  // time up to which busy and idle are counted
+    mu_sched_load_window_t windows[MU_CONFIG_SCHED_LOAD_WINDOWS];
+} mu_sched_load_t;
+
+#endif // MU_CONFIG_SCHED_LOAD
+
+#ifdef MU_CONFIG_TASK_IDS
+
+// With MU_CONFIG_TASK_IDS the scheduler's queues hold 16-bit task IDs rather
+// than task pointers, and deferred times are held in 48 bits, split so that a
+// deferred task packs into 8 bytes.  A deferred time must lie within
+// MU_SCHED_AT_RANGE ticks of the current time.
+typedef mu_task_id_t mu_sched_slot_t;
+typedef uint64_t mu_sched_at_t;
+#define MU_SCHED_AT_BITS 48
+#define MU_SCHED_AT_RANGE ((mu_time_rel_t)1 << (MU_SCHED_AT_BITS - 2))
+
+// The irq queue: a single producer, single consumer queue of task IDs that
+// works like mu_spsc_t, without its cached indices and padding.
+typedef struct {
+    uint32_t mask;
+    _Atomic uint32_t head;
+    _Atomic uint32_t tail;
+    mu_task_id_t *store;
+} mu_sched_irq_queue_t;
+
+// An asap queue: a FIFO of task IDs.
+typedef struct {
+    mu_task_id_t *store;
+    uint16_t capacity;
+    uint16_t head;
+    uint16_t count;
+} mu_sched_asap_queue_t;
+
+#else
+
+typedef void *mu_sched_slot_t;
+typedef mu_time_abs_t mu_sched_at_t;
+typedef mu_spsc_t mu_sched_irq_queue_t;
+typedef mu_mqueue_t mu_sched_asap_queue_t;
+
+#endif
+
+// A deferred task, as held in a scheduler's deferred queue.
+typedef struct {
+#ifdef MU_CONFIG_TASK_IDS
+    uint32_t at;          // low 32 bits of the deferred time
+    mu_task_id_t task_id;
+    uint16_t at_hi;       // next 16 bits of the deferred time
+#else
+    mu_sched_at_t at;
+    mu_task_t *task;
+#endif
+#ifdef MU_CONFIG_SCHED_DEFERRED_HEAP
+    uint32_t seq; // insertion order: breaks ties between equal 'at' values
+#endif
+#ifdef MU_CONFIG_SCHED_STATS
+    mu_time_abs_t queued_at;
+#endif
+} mu_sched_deferred_t;
+
+#ifdef MU_CONFIG_SCHED_EDF
+
+// A task waiting in a scheduler's earliest-deadline-first queue.
+typedef struct {
+    mu_time_abs_t deadline;
+    mu_task_t *task;
+    uint32_t seq; // insertion order: breaks ties between equal deadlines
+} mu_sched_edf_t;
+
+#endif
+
+// A scheduler instance.  Treat as opaque: use the mu_sched_inst_xxx()
+// functions.
+typedef struct _mu_sched {
+    mu_sched_irq_queue_t irq_tasks; // tasks queued from interrupt level.
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
+    mu_mpsc_t thread_tasks;     // tasks queued from other threads.
+#endif
+    // one asap queue per priority level
+    mu_sched_asap_queue_t asap_tasks[MU_CONFIG_SCHED_ASAP_PRIORITIES];
+    uint32_t asap_ready;        // bit n set if asap_tasks[n] is non-empty
+    size_t asap_capacity;       // capacity of each asap queue
+    mu_sched_deferred_t *deferred_tasks; // the deferred queue
+    size_t deferred_capacity;   // number of slots in deferred_tasks
+    size_t deferred_task_count; // number of deferred tasks in queue
+#ifdef MU_CONFIG_TASK_IDS
+    mu_time_abs_t deferred_ref; // recent deferred time, to widen 'at' values
+#endif
+#ifdef MU_CONFIG_SCHED_DEFERRED_HEAP
+    uint32_t deferred_seq;      // sequence number for next deferred task
+#endif
+    mu_task_t *curr_task;       // task currently being processed.
+    mu_clock_fn clock_fn;       // function to call to get the current time.
+#ifdef MU_CONFIG_SCHED_CACHED_NOW
+    bool in_batch;              // true while run_batch() is running
+    bool now_valid;             // true once 'now' is read in this batch
+    mu_time_abs_t now;          // the batch's reading of clock_fn
+#endif
+    mu_task_t *idle_task;       // task to run when nothing else is runnable.
+    mu_sched_wakeup_fn wakeup_fn; // called after scheduling from isr.
+#ifdef MU_CONFIG_SCHED_DEDUP
+    uint32_t epoch;             // marks tasks queued by this initialization
+#endif
+#ifdef MU_CONFIG_SCHED_EDF
+    mu_sched_edf_t edf_tasks[MU_CONFIG_SCHED_MAX_EDF_TASKS]; // a min-heap
+    size_t edf_task_count;      // number of tasks in edf_tasks
+    uint32_t edf_seq;           // sequence number for next edf task
+    uint32_t deadline_misses;   // edf tasks run after their deadline
+#endif
+#ifdef MU_CONFIG_SCHED_FAIR
+    unsigned int fair_weights[3]; // irq, deferred, asap
+    unsigned int fair_class;    // class whose turn it is
+    unsigned int fair_credit;   // dispatches left in fair_class's turn
+#endif
+#ifdef MU_CONFIG_SCHED_GROWABLE
+    mu_sched_allocator_t allocator; // alloc is NULL if the queues can't grow
+    mu_sched_slot_t *asap_store;    // current storage for the asap queues
+    mu_sched_slot_t *asap_base;     // storage given to mu_sched_inst_init()
+    size_t asap_base_capacity;
+    size_t asap_max_capacity;
+    mu_sched_deferred_t *deferred_base; // storage given to mu_sched_inst_init()
+    size_t deferred_base_capacity;
+    size_t deferred_max_capacity;
+#endif
+#ifdef MU_CONFIG_SCHED_LOAD
+    mu_sched_load_t load;
+#endif
+#ifdef MU_CONFIG_SCHED_STATS
+    mu_sched_stats_t stats;
+    // Times at which the tasks in each slot of the irq and asap queues were
+    // queued.
+    mu_time_abs_t irq_queued_at[MU_CONFIG_SCHED_MAX_IRQ_TASKS];
+    mu_time_abs_t asap_queued_at[MU_CONFIG_SCHED_ASAP_PRIORITIES]
+                                [MU_CONFIG_SCHED_MAX_ASAP_TASKS];
+    size_t asap_queued_at_head[MU_CONFIG_SCHED_ASAP_PRIORITIES];
+#endif
+} mu_sched_t;
+
 // *****************************************************************************
 // Public declarations
 
@@ -112,9 +391,38 @@ void mu_sched_reset(void);
 /**
  * @brief Process the next runnable task or -- if none are runnable -- the idle
  * task.
+ *
+ * Runnable tasks are taken from the irq queue first, then from the deferred
+ * queue, then from the asap queues.  With MU_CONFIG_SCHED_FAIR the three
+ * classes take turns instead: see mu_sched_set_fair_weights().
  */
 void mu_sched_step(void);
 
+/**
+ * @brief Run one batch of runnable tasks and return the number of tasks run.
+ *
+ * A batch runs, in order:
+ * - the tasks queued from interrupt level,
+ * - every deferred task that is due as of a single reading of the clock,
+ * - with MU_CONFIG_SCHED_EDF, the deadline tasks queued when that phase began,
+ * - as many asap tasks as were queued when the asap phase began.
+ *
+ * Tasks scheduled by tasks in the batch run in the next batch, so a task that
+ * keeps re-scheduling itself cannot stall the caller.  The clock is not read
+ * at all if there are no deferred (or deadline) tasks.  The idle task is not
+ * run.
+ */
+int mu_sched_drain(void);
+
+/**
+ * @brief Run batches of tasks until there is nothing left to run or the
+ * budget has been spent.  Return the number of tasks run.
+ *
+ * The clock is read once per batch.  A batch is never cut short, so the call
+ * may overrun the budget by up to one batch.  The idle task is not run.
+ */
+int mu_sched_run_for(mu_time_rel_t budget);
+
 /**
  * @brief Return the current clock source.
  */
@@ -131,6 +439,10 @@ void mu_sched_set_clock_source(mu_clock_fn clock_fn);
 
 /**
  * @brief Return the scheduler's idea of time according to the clock source.
+ *
+ * With MU_CONFIG_SCHED_CACHED_NOW, the clock is read once per batch run by
+ * mu_sched_drain() or mu_sched_run_for(), and tasks in that batch all see the
+ * time at which it was read.
  */
 mu_time_abs_t mu_sched_get_current_time(void);
 
@@ -146,6 +458,47 @@ mu_task_t *mu_sched_get_idle_task(void);
  */
 void mu_sched_set_idle_task(mu_task_t *task);
 
+/**
+ * @brief Set a function to be called whenever a task is scheduled from
+ * interrupt level (or from another thread) via mu_sched_from_isr() or
+ * mu_sched_from_thread().
+ *
+ * An idle task that puts the processor or the thread to sleep uses this to
+ * get woken up.  The function is called from the context of the caller of
+ * mu_sched_from_isr(), so it must be interrupt (or thread) safe.  Setting this
+ * to NULL disables it.  Note: mu_sched_init() clears the wakeup function.
+ */
+void mu_sched_set_wakeup_fn(mu_sched_wakeup_fn fn);
+
+#ifdef MU_CONFIG_SCHED_FAIR
+
+/**
+ * @brief Set how many tasks of each class mu_sched_step() may run in a row.
+ *
+ * mu_sched_step() visits the irq, deferred and asap classes (the latter
+ * including any deadline tasks) in round robin order.  In its turn a class
+ * runs up to its weight in tasks, one per step; a class with nothing runnable
+ * forfeits the rest of its turn.  So while all three are busy, an asap task
+ * waits at most irq + deferred dispatches, however fast interrupts arrive.
+ *
+ * A weight of zero is taken as one, so no class can be starved.  Defaults are
+ * MU_CONFIG_SCHED_FAIR_xxx_WEIGHT.  mu_sched_drain() and mu_sched_run_for()
+ * are not affected: each batch already runs every class.  With
+ * MU_CONFIG_SCHED_STATS, the wait.max of each queue is the worst wait seen.
+ */
+void mu_sched_set_fair_weights(unsigned int irq, unsigned int deferred,
+                               unsigned int asap);
+
+#endif // MU_CONFIG_SCHED_FAIR
+
+/**
+ * @brief Get the time at which the next deferred task is due.
+ *
+ * @param at Receives the time if there is a deferred task.
+ * @return false if there are no deferred tasks, true otherwise.
+ */
+bool mu_sched_next_deadline(mu_time_abs_t *at);
+
 /**
  * @brief Return the task currently being run or NULL if none are active.
  */
@@ -154,22 +507,95 @@ mu_task_t *mu_sched_current_task(void);
 /**
  * @brief Return the next task to be processed, or NULL if none.
  *
- * Note: this consults the asap and deferreds queues but not the irq queue.
+ * Note: this consults the asap and deferreds queues (and with
+ * MU_CONFIG_SCHED_EDF, the deadline queue) but not the irq queue.
  */
 mu_task_t *mu_sched_peek_next_task(void);
 
 /**
  * @brief Schedule a task to run as soon as possible.
+ *
+ * Equivalent to mu_sched_asap_prio(task, MU_SCHED_PRIO_DEFAULT).
  */
 mu_task_err_t mu_sched_asap(mu_task_t *task);
 
+/**
+ * @brief Schedule a task to run as soon as possible at the given priority.
+ *
+ * An asap task runs only when no asap task of a higher priority (a lower
+ * number) is waiting.  Tasks of equal priority run in FIFO order.  Priorities
+ * beyond MU_SCHED_PRIO_LOWEST are treated as MU_SCHED_PRIO_LOWEST.
+ */
+mu_task_err_t mu_sched_asap_prio(mu_task_t *task, mu_sched_prio_t prio);
+
+#ifdef MU_CONFIG_SCHED_EDF
+
+/**
+ * @brief Schedule a task to run as soon as possible, and no later than the
+ * given deadline.
+ *
+ * Deadline tasks wait in their own queue and run earliest deadline first,
+ * after the irq and due deferred tasks but ahead of every asap priority level.
+ * Tasks with equal deadlines run in FIFO order.  Queueing and dispatch are
+ * O(log n).
+ *
+ * A task that is dispatched after its deadline still runs, and the miss is
+ * counted both for the task and for the scheduler.  Within a batch (see
+ * mu_sched_drain()) the clock is read once, as the deadline phase begins.
+ */
+mu_task_err_t mu_sched_asap_deadline(mu_task_t *task, mu_time_abs_t deadline);
+
+/**
+ * @brief Return the number of times the task ran after its deadline.
+ */
+uint32_t mu_sched_get_task_deadline_misses(mu_task_t *task);
+
+/**
+ * @brief Return the number of deadline tasks that ran after their deadline
+ * since mu_sched_init().
+ */
+uint32_t mu_sched_get_deadline_misses(void);
+
+#endif // MU_CONFIG_SCHED_EDF
+
 /**
  * @brief Schedule a task to run as soon as possible from interrupt level.
+ *
+ * With MU_CONFIG_SCHED_DEDUP, see also mu_sched_set_dedup().
  */
 mu_task_err_t mu_sched_from_isr(mu_task_t *task);
 
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
+
+/**
+ * @brief Schedule a task to run as soon as possible from any thread.
+ *
+ * Unlike mu_sched_from_isr(), any number of threads may call this at once,
+ * and it never fails or blocks: the task is linked into the scheduler's thread
+ * queue through the task itself.  A task is in the thread queue at most once,
+ * so calling this again before the task is taken from the queue is a no-op.
+ * Thread queue tasks run along with (after) the irq queue's, and the wakeup
+ * function is called as for mu_sched_from_isr().  While the queue is empty,
+ * checking it costs the scheduler a load or two.
+ *
+ * Re-initializing the scheduler abandons the tasks in its thread queue: call
+ * mu_task_init() on them before scheduling them from a thread again.
+ *
+ * @return MU_TASK_ERR_NONE
+ */
+mu_task_err_t mu_sched_from_thread(mu_task_t *task);
+
+#endif // MU_CONFIG_SCHED_FROM_THREAD
+
 /**
  * @brief Schedule a task to run at the specified time in the future.
+ *
+ * Each call adds an entry to the deferred queue, even if the task is already
+ * deferred, so the task runs once for each call.  To reschedule a deferred
+ * task, call mu_sched_remove_deferred_task() first.
+ *
+ * With MU_CONFIG_TASK_IDS, a time MU_SCHED_AT_RANGE or more ticks from the
+ * current time can't be held, and MU_TASK_ERR_SCHED_RANGE is returned.
  */
 mu_task_err_t mu_sched_defer_until(mu_task_t *task, mu_time_abs_t at);
 
@@ -179,10 +605,370 @@ mu_task_err_t mu_sched_defer_until(mu_task_t *task, mu_time_abs_t at);
 mu_task_err_t mu_sched_defer_for(mu_task_t *task, mu_time_rel_t in);
 
 /**
- * @brief Remove a deferred task from the schedule.
+ * @brief Schedule a task to run at any time from at to at + slack, so that it
+ * can share a wakeup with other tasks.
+ *
+ * If the next deferred task is due within the window, the task is deferred
+ * to the same time.  Only the next task is considered: a later task due within
+ * the window isn't looked for.  Otherwise the task is deferred to the time in
+ * the window with the most trailing zero bits, so tasks whose windows overlap
+ * tend to land on the same time.  A slack of zero or less defers the task
+ * until at.
+ *
+ * The next task is taken from the scheduler that will hold the task: the one
+ * whose task is running, else the default.  Under mu_exec, whose workers keep
+ * their own queues, only the trailing zero rule applies.
+ */
+mu_task_err_t mu_sched_defer_until_slack(mu_task_t *task, mu_time_abs_t at,
+                                         mu_time_rel_t slack);
+
+/**
+ * @brief Schedule a task to run after a delay of from in to in + slack.  See
+ * mu_sched_defer_until_slack().
+ */
+mu_task_err_t mu_sched_defer_for_slack(mu_task_t *task, mu_time_rel_t in,
+                                       mu_time_rel_t slack);
+
+/**
+ * @brief Remove every entry for a deferred task from the schedule.
+ *
+ * With MU_CONFIG_SCHED_DEFERRED_HEAP this is O(log n) for a task that is
+ * deferred once, since each task records its position in the heap.  A task
+ * with several entries costs O(n).  Without the heap it is always O(n).
  */
 mu_task_err_t mu_sched_remove_deferred_task(mu_task_t *task);
 
+/**
+ * @brief Return true if the task is in the deferred queue.
+ *
+ * With MU_CONFIG_SCHED_DEFERRED_HEAP this is O(1) for a task that is deferred
+ * once.  Otherwise it is O(n).
+ */
+bool mu_sched_is_deferred(mu_task_t *task);
+
+#ifdef MU_CONFIG_SCHED_STATS
+
+/**
+ * @brief Return the scheduler statistics gathered since mu_sched_init() or
+ * mu_sched_reset_stats().
+ *
+ * Note: while statistics are enabled, queueing and dispatching a task each
+ * read the clock, including mu_sched_from_isr().
+ */
+const mu_sched_stats_t *mu_sched_get_stats(void);
+
+/**
+ * @brief Clear the scheduler statistics.  Capacities are kept.
+ */
+void mu_sched_reset_stats(void);
+
+/**
+ * @brief Record the lateness of each deferred run of task in hist, in
+ * addition to the scheduler-wide lateness histogram.  hist may be NULL.
+ */
+void mu_sched_set_lateness_hist(mu_task_t *task, mu_sched_hist_t *hist);
+
+/**
+ * @brief Clear a histogram.
+ */
+void mu_sched_hist_reset(mu_sched_hist_t *hist);
+
+/**
+ * @brief Add a value to a histogram.
+ */
+void mu_sched_hist_record(mu_sched_hist_t *hist, mu_time_rel_t value);
+
+/**
+ * @brief Return the name of a queue, e.g. "irq".
+ */
+const char *mu_sched_queue_name(mu_sched_queue_t queue);
+
+#endif // MU_CONFIG_SCHED_STATS
+
+#ifdef MU_CONFIG_SCHED_LOAD
+
+/**
+ * @brief Return how busy the scheduler has been since mu_sched_init(),
+ * mu_sched_reset_load() or mu_sched_set_clock_source().
+ *
+ * Time spent running tasks other than the idle task is busy; all other time,
+ * including time spent in the idle task and outside the scheduler, is idle.
+ * The counts are brought up to date, which reads the clock once.
+ *
+ * Note: while load accounting is enabled, running a task reads the clock
+ * before and after the call.  Times follow the scheduler's clock source.
+ */
+const mu_sched_load_t *mu_sched_get_load(void);
+
+/**
+ * @brief Clear the load counts and restart the utilization windows.  Window
+ * lengths are kept.
+ */
+void mu_sched_reset_load(void);
+
+/**
+ * @brief Set the length of utilization window n, from 0 to
+ * MU_CONFIG_SCHED_LOAD_WINDOWS - 1, and restart it.  A length of 0 disables it.
+ *
+ * Each window records the busy share of the last complete window, in units of
+ * MU_SCHED_LOAD_FULL.  A window closes when a task finishes, or the load is
+ * read, once the window's length has passed, so it may run a little longer
+ * than its length.  Tasks are counted in the window in which they finish.
+ */
+void mu_sched_set_load_window(unsigned int n, mu_time_rel_t length);
+
+#endif // MU_CONFIG_SCHED_LOAD
+
+#ifdef MU_CONFIG_SCHED_DEDUP
+
+/**
+ * @brief Enable or disable deduplication of a task's asap and irq scheduling.
+ *
+ * While enabled, scheduling the task with mu_sched_asap(), mu_sched_asap_prio()
+ * (or mu_sched_asap_deadline()) or mu_sched_from_isr() is a no-op (returning
+ * MU_TASK_ERR_NONE) if the task is already waiting in the scheduler's irq,
+ * asap or deadline queues.  The mark is cleared
+ * just before the task is run, so an event that arrives while the task runs
+ * schedules it again.  This keeps a chatty interrupt source from filling the
+ * queues with copies of one task.
+ *
+ * Notes:
+ * - Marking is an atomic exchange, so it is safe between an interrupt (or
+ *   another thread) and the scheduler loop.  On cores without atomic exchange
+ *   instructions the compiler may need libatomic.
+ * - Re-scheduling an already queued task at a higher priority does not move
+ *   it.
+ * - The deferred queue is not affected.
+ */
+void mu_sched_set_dedup(mu_task_t *task, bool enable);
+
+#endif // MU_CONFIG_SCHED_DEDUP
+
+// *****************************************************************************
+// Scheduler instances
+//
+// The mu_sched_xxx() functions above work on a default scheduler whose storage
+// is sized by the MU_CONFIG_SCHED_xxx settings.  Any number of additional
+// schedulers can be created with caller-supplied storage, e.g. one per
+// emulated device in a host program.
+//
+// mu_sched_init(), mu_sched_reset(), mu_sched_step(), mu_sched_drain(),
+// mu_sched_run_for(), mu_sched_from_isr() and mu_sched_from_thread() always
+// refer to the default scheduler.  The other
+// mu_sched_xxx() functions (and so mu_task_yield() and friends) refer to the
+// scheduler that is running the calling task, or to the default scheduler
+// when called from outside any task.  Existing task code therefore runs
+// unchanged in any scheduler.
+//
+// Notes:
+// - A task may be queued in only one scheduler at a time.
+// - Use mu_sched_inst_from_isr() to schedule from interrupt level (or from
+//   another thread) into a scheduler other than the default.
+// - When several threads each run their own schedulers, define
+//   MU_CONFIG_SCHED_THREAD_LOCAL as _Thread_local.
+// - mu_timer's MU_CONFIG_TIMER_WHEEL engine serves only one scheduler.
+//
+// With MU_CONFIG_TASK_IDS, the irq and asap stores hold mu_task_id_t rather
+// than pointers, and deferred slots shrink to 8 bytes (12 with
+// MU_CONFIG_SCHED_DEFERRED_HEAP) from 16 (24): declare storage with
+// mu_sched_slot_t to suit either setting.  Scheduling a task registers it
+// (see mu_task_get_id()), and fails with MU_TASK_ERR_SCHED_FULL if the
+// registry is full.  Deferred times are packed into 48 bits, so a task can be
+// deferred at most MU_SCHED_AT_RANGE ticks (2^46, about 19 hours at 1 ns per
+// tick) from the current time.
+
+/**
+ * @brief Initialize a scheduler with caller-supplied storage.
+ *
+ * @param sched The scheduler to initialize.
+ * @param irq_store Storage for the irq queue.
+ * @param irq_capacity Number of slots in irq_store.  Must be a power of two,
+ * at most MU_SPSC_MAX_CAPACITY (2^31).  The queue holds irq_capacity - 1
+ * tasks.
+ * @param asap_store Storage for the asap queues: asap_capacity slots for each
+ * of the MU_CONFIG_SCHED_ASAP_PRIORITIES levels.
+ * @param asap_capacity Number of tasks each asap queue can hold.
+ * @param deferred_store Storage for the deferred queue.
+ * @param deferred_capacity Number of slots in deferred_store.
+ * @return sched, or NULL if irq_capacity is not valid (or, with
+ * MU_CONFIG_TASK_IDS, if asap_capacity exceeds 65535).  With
+ * MU_CONFIG_SCHED_STATS, irq_capacity and asap_capacity may not exceed
+ * MU_CONFIG_SCHED_MAX_IRQ_TASKS and MU_CONFIG_SCHED_MAX_ASAP_TASKS.
+ */
+mu_sched_t *mu_sched_inst_init(mu_sched_t *sched, mu_sched_slot_t *irq_store,
+                               size_t irq_capacity,
+                               mu_sched_slot_t *asap_store,
+                               size_t asap_capacity,
+                               mu_sched_deferred_t *deferred_store,
+                               size_t deferred_capacity);
+
+/**
+ * @brief Return the default scheduler used by the mu_sched_xxx() functions.
+ */
+mu_sched_t *mu_sched_default_instance(void);
+
+/**
+ * @brief Return the scheduler running the calling task, or the default
+ * scheduler if called from outside a task.
+ */
+mu_sched_t *mu_sched_current_instance(void);
+
+// Each of the following works like the mu_sched_xxx() function of the same
+// name, on the given scheduler.
+
+void mu_sched_inst_reset(mu_sched_t *sched);
+
+void mu_sched_inst_step(mu_sched_t *sched);
+
+int mu_sched_inst_drain(mu_sched_t *sched);
+
+int mu_sched_inst_run_for(mu_sched_t *sched, mu_time_rel_t budget);
+
+mu_clock_fn mu_sched_inst_get_clock_source(mu_sched_t *sched);
+
+void mu_sched_inst_set_clock_source(mu_sched_t *sched, mu_clock_fn clock_fn);
+
+mu_time_abs_t mu_sched_inst_get_current_time(mu_sched_t *sched);
+
+mu_task_t *mu_sched_inst_get_idle_task(mu_sched_t *sched);
+
+void mu_sched_inst_set_idle_task(mu_sched_t *sched, mu_task_t *task);
+
+void mu_sched_inst_set_wakeup_fn(mu_sched_t *sched, mu_sched_wakeup_fn fn);
+
+#ifdef MU_CONFIG_SCHED_FAIR
+
+void mu_sched_inst_set_fair_weights(mu_sched_t *sched, unsigned int irq,
+                                    unsigned int deferred, unsigned int asap);
+
+#endif // MU_CONFIG_SCHED_FAIR
+
+bool mu_sched_inst_next_deadline(mu_sched_t *sched, mu_time_abs_t *at);
+
+mu_task_t *mu_sched_inst_current_task(mu_sched_t *sched);
+
+mu_task_t *mu_sched_inst_peek_next_task(mu_sched_t *sched);
+
+/**
+ * @brief Call fn for each task waiting in the scheduler, e.g. to save them.
+ *
+ * irq tasks are visited first, then each asap priority level, in the order
+ * they will run.  Deferred and deadline tasks are visited in no particular
+ * order: sort them by (at, order) to get the order they will run in.  fn must
+ * not schedule or remove tasks.  Not interrupt safe.
+ *
+ * @return false if fn stopped the visit, else true.
+ */
+bool mu_sched_inst_visit(mu_sched_t *sched, mu_sched_visit_fn fn, void *arg);
+
+mu_task_err_t mu_sched_inst_asap(mu_sched_t *sched, mu_task_t *task);
+
+mu_task_err_t mu_sched_inst_asap_prio(mu_sched_t *sched, mu_task_t *task,
+                                      mu_sched_prio_t prio);
+
+mu_task_err_t mu_sched_inst_from_isr(mu_sched_t *sched, mu_task_t *task);
+
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
+
+mu_task_err_t mu_sched_inst_from_thread(mu_sched_t *sched, mu_task_t *task);
+
+#endif
+
+#ifdef MU_CONFIG_SCHED_EDF
+
+mu_task_err_t mu_sched_inst_asap_deadline(mu_sched_t *sched, mu_task_t *task,
+                                          mu_time_abs_t deadline);
+
+uint32_t mu_sched_inst_get_deadline_misses(mu_sched_t *sched);
+
+#endif // MU_CONFIG_SCHED_EDF
+
+mu_task_err_t mu_sched_inst_defer_until(mu_sched_t *sched, mu_task_t *task,
+                                        mu_time_abs_t at);
+
+mu_task_err_t mu_sched_inst_defer_for(mu_sched_t *sched, mu_task_t *task,
+                                      mu_time_rel_t in);
+
+mu_task_err_t mu_sched_inst_defer_until_slack(mu_sched_t *sched,
+                                              mu_task_t *task,
+                                              mu_time_abs_t at,
+                                              mu_time_rel_t slack);
+
+mu_task_err_t mu_sched_inst_defer_for_slack(mu_sched_t *sched,
+                                            mu_task_t *task, mu_time_rel_t in,
+                                            mu_time_rel_t slack);
+
+mu_task_err_t mu_sched_inst_remove_deferred_task(mu_sched_t *sched,
+                                                 mu_task_t *task);
+
+bool mu_sched_inst_is_deferred(mu_sched_t *sched, mu_task_t *task);
+
+#ifdef MU_CONFIG_SCHED_STATS
+
+const mu_sched_stats_t *mu_sched_inst_get_stats(mu_sched_t *sched);
+
+void mu_sched_inst_reset_stats(mu_sched_t *sched);
+
+#endif // MU_CONFIG_SCHED_STATS
+
+#ifdef MU_CONFIG_SCHED_LOAD
+
+const mu_sched_load_t *mu_sched_inst_get_load(mu_sched_t *sched);
+
+void mu_sched_inst_reset_load(mu_sched_t *sched);
+
+void mu_sched_inst_set_load_window(mu_sched_t *sched, unsigned int n,
+                                   mu_time_rel_t length);
+
+#endif // MU_CONFIG_SCHED_LOAD
+
+#ifdef MU_CONFIG_SCHED_GROWABLE
+
+// With MU_CONFIG_SCHED_GROWABLE (host builds), a scheduler's asap and deferred
+// queues can outgrow the storage given to mu_sched_inst_init().  When a queue
+// is full, its storage is replaced by one twice the size (or up to the
+// maximum capacity) from the caller's allocator and the queued tasks are
+// copied across, so growth costs amortized O(1) per task.  The irq queue
+// doesn't grow: interrupt handlers and other threads add to it without a
+// lock, so its storage can't be replaced under them.
+
+/**
+ * @brief Let the scheduler's asap and deferred queues grow when full.
+ *
+ * @param sched The scheduler.
+ * @param allocator Supplies the storage for grown queues.  It is copied.
+ * @param asap_max_capacity The most tasks each asap queue may grow to hold, or
+ * 0 for no limit.  With MU_CONFIG_TASK_IDS the limit is at most 65535, and
+ * with MU_CONFIG_SCHED_STATS at most MU_CONFIG_SCHED_MAX_ASAP_TASKS.
+ * @param deferred_max_capacity The most tasks the deferred queue may grow to
+ * hold, or 0 for no limit.
+ *
+ * Grown storage belongs to the scheduler until mu_sched_inst_shrink() gives
+ * it back: shrink an empty scheduler before discarding or re-initializing it.
+ */
+void mu_sched_inst_set_allocator(mu_sched_t *sched,
+                                 const mu_sched_allocator_t *allocator,
+                                 size_t asap_max_capacity,
+                                 size_t deferred_max_capacity);
+
+/**
+ * @brief Shrink the scheduler's grown queues to fit the tasks they hold.
+ *
+ * Each grown queue is moved to the smallest storage, counting by doubling from
+ * the capacity given to mu_sched_inst_init(), that holds its tasks.  A queue
+ * that fits in its original storage is moved back into it.  Call it when load
+ * has subsided, e.g. from the idle task.  Not interrupt safe.
+ */
+void mu_sched_inst_shrink(mu_sched_t *sched);
+
+#endif // MU_CONFIG_SCHED_GROWABLE
+
+/**
+ * @brief Return the number of tasks a queue of the scheduler can hold: for
+ * MU_SCHED_QUEUE_ASAP, the number for each priority level.
+ */
+size_t mu_sched_inst_get_capacity(mu_sched_t *sched, mu_sched_queue_t queue);
+
 // *****************************************************************************
 // End of file
 
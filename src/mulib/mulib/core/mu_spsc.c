@@ -26,8 +26,10 @@
 // includes
 
 #include "mu_spsc.h"
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 // *****************************************************************************
 // private types and definitions
@@ -37,6 +39,18 @@
 
 #define IS_POWER_OF_TWO(n) (((n) & ((n)-1)) == 0)
 
+/**
+ * @brief Copy n items into the store, starting at index, wrapping as needed.
+ */
+static void copy_in(mu_spsc_t *q, uint32_t index, const mu_spsc_item_t *items,
+                    uint32_t n);
+
+/**
+ * @brief Copy n items out of the store, starting at index, wrapping as needed.
+ */
+static void copy_out(mu_spsc_t *q, uint32_t index, mu_spsc_item_t *items,
+                     uint32_t n);
+
 // *****************************************************************************
 // local storage
 
@@ -45,8 +59,9 @@
 
 mu_spsc_err_t mu_spsc_init(mu_spsc_t *q,
                            mu_spsc_item_t *store,
-                           uint16_t capacity) {
-  if ((capacity < 2) || !IS_POWER_OF_TWO(capacity)) {
+                           uint32_t capacity) {
+  if ((capacity < 2) || (capacity > MU_SPSC_MAX_CAPACITY) ||
+      !IS_POWER_OF_TWO(capacity)) {
     return MU_SPSC_ERR_SIZE;
   }
   q->mask = capacity - 1;
@@ -55,46 +70,121 @@ mu_spsc_err_t mu_spsc_init(mu_spsc_t *q,
 }
 
 mu_spsc_err_t mu_spsc_reset(mu_spsc_t *q) {
-  q->head = 0;
-  q->tail = 0;
+  atomic_store_explicit(&q->head, 0, memory_order_relaxed);
+  atomic_store_explicit(&q->tail, 0, memory_order_relaxed);
+  q->tail_cache = 0;
+  q->head_cache = 0;
   return MU_SPSC_ERR_NONE;
 }
 
-uint16_t mu_spsc_capacity(mu_spsc_t *q) { return q->mask; }
+uint32_t mu_spsc_capacity(mu_spsc_t *q) { return q->mask; }
+
+uint32_t mu_spsc_count(mu_spsc_t *q) {
+  uint32_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+  uint32_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+  return tail - head;
+}
 
 /**
  * @brief To be called by Producer only: update tail only after setting item.
  */
 mu_spsc_err_t mu_spsc_put(mu_spsc_t *q, mu_spsc_item_t item) {
-  mu_spsc_err_t err = MU_SPSC_ERR_NONE;
-  uint16_t next_tail = (q->tail + 1) & q->mask;
-
-  if (next_tail == q->head) {
-    err = MU_SPSC_ERR_FULL;
-  } else {
-    q->store[q->tail] = item;
-    q->tail = next_tail;
+  uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+  if (tail - q->head_cache == q->mask) {
+    // Full as far as we knew: see how far the consumer has got.  The acquire
+    // pairs with the consumer's release of head, so it is done with the slot.
+    q->head_cache = atomic_load_explicit(&q->head, memory_order_acquire);
+    if (tail - q->head_cache == q->mask) {
+      return MU_SPSC_ERR_FULL;
+    }
   }
-
-  return err;
+  q->store[tail & q->mask] = item;
+  atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+  return MU_SPSC_ERR_NONE;
 }
 
 /**
  * @brief To be called by Consumer only: update head only after fetching item.
  */
 mu_spsc_err_t mu_spsc_get(mu_spsc_t *q, mu_spsc_item_t *item) {
-  mu_spsc_err_t err = MU_SPSC_ERR_NONE;
+  uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+  if (head == q->tail_cache) {
+    // Empty as far as we knew: see how far the producer has got.  The acquire
+    // pairs with the producer's release of tail, so the items are visible.
+    q->tail_cache = atomic_load_explicit(&q->tail, memory_order_acquire);
+    if (head == q->tail_cache) {
+      *item = NULL;
+      return MU_SPSC_ERR_EMPTY;
+    }
+  }
+  *item = q->store[head & q->mask];
+  atomic_store_explicit(&q->head, head + 1, memory_order_release);
+  return MU_SPSC_ERR_NONE;
+}
 
-  if (q->head == q->tail) {
-    err = MU_SPSC_ERR_EMPTY;
-    *item = NULL;
-  } else {
-    *item = q->store[q->head];
-    q->head = (q->head + 1) & q->mask;
+uint32_t mu_spsc_put_n(mu_spsc_t *q, const mu_spsc_item_t *items, uint32_t n) {
+  uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+  uint32_t room = q->mask - (tail - q->head_cache);
+
+  if (room < n) {
+    q->head_cache = atomic_load_explicit(&q->head, memory_order_acquire);
+    room = q->mask - (tail - q->head_cache);
+    if (room < n) {
+      n = room;
+    }
+  }
+  if (n > 0) {
+    copy_in(q, tail, items, n);
+    atomic_store_explicit(&q->tail, tail + n, memory_order_release);
   }
+  return n;
+}
+
+uint32_t mu_spsc_get_n(mu_spsc_t *q, mu_spsc_item_t *items, uint32_t n) {
+  uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+  uint32_t avail = q->tail_cache - head;
 
-  return err;
+  if (avail < n) {
+    q->tail_cache = atomic_load_explicit(&q->tail, memory_order_acquire);
+    avail = q->tail_cache - head;
+    if (avail < n) {
+      n = avail;
+    }
+  }
+  if (n > 0) {
+    copy_out(q, head, items, n);
+    atomic_store_explicit(&q->head, head + n, memory_order_release);
+  }
+  return n;
 }
 
 // *****************************************************************************
 // private code
+
+static void copy_in(mu_spsc_t *q, uint32_t index, const mu_spsc_item_t *items,
+                    uint32_t n) {
+  uint32_t slot = index & q->mask;
+  uint32_t first = q->mask + 1 - slot; // slots before the end of the store
+
+  if (n <= first) {
+    memcpy(&q->store[slot], items, n * sizeof(mu_spsc_item_t));
+  } else {
+    memcpy(&q->store[slot], items, first * sizeof(mu_spsc_item_t));
+    memcpy(q->store, &items[first], (n - first) * sizeof(mu_spsc_item_t));
+  }
+}
+
+static void copy_out(mu_spsc_t *q, uint32_t index, mu_spsc_item_t *items,
+                     uint32_t n) {
+  uint32_t slot = index & q->mask;
+  uint32_t first = q->mask + 1 - slot;
+
+  if (n <= first) {
+    memcpy(items, &q->store[slot], n * sizeof(mu_spsc_item_t));
+  } else {
+    memcpy(items, &q->store[slot], first * sizeof(mu_spsc_item_t));
+    memcpy(&items[first], q->store, (n - first) * sizeof(mu_spsc_item_t));
+  }
+}
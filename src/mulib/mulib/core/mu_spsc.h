@@ -27,6 +27,13 @@
  *
  * spsc stores pointer sized objects in a queue.  In mulib, the scheduler uses
  * an instance of spsc to mediate between interrupt and foreground levels.
+ *
+ * The producer and consumer may also be threads on different cores.  head and
+ * tail are C11 atomics: the producer publishes an item with a release store of
+ * tail, and the consumer frees its slot with a release store of head.  Each
+ * side keeps a private copy of the other side's index and only reloads it when
+ * the copy says the queue is full (or empty), so in the common case neither
+ * side touches the other's cache line.
  */
 
 #ifndef _MU_SPSC_H_
@@ -39,6 +46,7 @@ extern "C" {
 // *****************************************************************************
 // includes
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -52,13 +60,36 @@ typedef enum {
   MU_SPSC_ERR_SIZE,
 } mu_spsc_err_t;
 
+// The size of a cache line.  The consumer's and the producer's fields of a
+// mu_spsc_t are aligned to it so that the two sides don't share a line.
+// Define as 0 to pack the fields instead, e.g. on a single core MCU.
+#ifndef MU_CONFIG_SPSC_CACHE_LINE
+#define MU_CONFIG_SPSC_CACHE_LINE 64
+#endif
+
+#if MU_CONFIG_SPSC_CACHE_LINE > 0
+#define MU_SPSC_ALIGNED _Alignas(MU_CONFIG_SPSC_CACHE_LINE)
+#else
+#define MU_SPSC_ALIGNED
+#endif
+
+// The largest capacity that can be passed to mu_spsc_init().
+#define MU_SPSC_MAX_CAPACITY ((uint32_t)1 << 31)
+
 // mu_spsc manages pointer-sized objects
 typedef void *mu_spsc_item_t;
 
+// head and tail count items ever taken and put, wrapping at 2^32: the slot of
+// index i is store[i & mask] and the queue holds tail - head items.
 typedef struct {
-  uint16_t mask;
-  volatile uint16_t head;
-  volatile uint16_t tail;
+  // Written by the consumer.
+  MU_SPSC_ALIGNED _Atomic uint32_t head;
+  uint32_t tail_cache; // the consumer's last reading of tail
+  // Written by the producer.
+  MU_SPSC_ALIGNED _Atomic uint32_t tail;
+  uint32_t head_cache; // the producer's last reading of head
+  // Set by mu_spsc_init() and read only thereafter.
+  MU_SPSC_ALIGNED uint32_t mask;
   mu_spsc_item_t *store;
 } mu_spsc_t;
 
@@ -67,11 +98,11 @@ typedef struct {
 
 /**
  * @brief initialize a cqueue with a backing store.  capacity must be a power
- * of two.
+ * of two, from 2 to MU_SPSC_MAX_CAPACITY.
  */
 mu_spsc_err_t mu_spsc_init(mu_spsc_t *q,
                            mu_spsc_item_t *store,
-                           uint16_t capacity);
+                           uint32_t capacity);
 
 /**
  * @brief reset the cqueue to empty.  Not interrupt safe!
@@ -79,10 +110,18 @@ mu_spsc_err_t mu_spsc_init(mu_spsc_t *q,
 mu_spsc_err_t mu_spsc_reset(mu_spsc_t *q);
 
 /**
- * @brief return the maximum number of items that can be stored in the cqueue.
- * May be called at any time.
+ * @brief return the maximum number of items that can be stored in the cqueue,
+ * which is one less than the capacity given to mu_spsc_init().  May be called
+ * at any time.
+ */
+uint32_t mu_spsc_capacity(mu_spsc_t *q);
+
+/**
+ * @brief return the number of items in the queue.  The count is exact when
+ * called by the producer or by the consumer while the other side is idle;
+ * otherwise it is a snapshot that may already be out of date.
  */
-uint16_t mu_spsc_capacity(mu_spsc_t *q);
+uint32_t mu_spsc_count(mu_spsc_t *q);
 
 // TDOO: bool mu_spsc_is_empty() / mu_spsc_is_full() ?
 
@@ -98,6 +137,24 @@ mu_spsc_err_t mu_spsc_put(mu_spsc_t *q, mu_spsc_item_t item);
  */
 mu_spsc_err_t mu_spsc_get(mu_spsc_t *q, mu_spsc_item_t *item);
 
+/**
+ * @brief Insert up to n items at the tail of the queue, publishing them all at
+ * once.  May only be called by the producer.
+ *
+ * @return The number of items inserted, which is less than n if the queue
+ * fills.
+ */
+uint32_t mu_spsc_put_n(mu_spsc_t *q, const mu_spsc_item_t *items, uint32_t n);
+
+/**
+ * @brief Remove up to n items from the head of the queue, freeing their slots
+ * all at once.  May only be called by the consumer.
+ *
+ * @return The number of items removed, which is less than n if the queue
+ * empties.
+ */
+uint32_t mu_spsc_get_n(mu_spsc_t *q, mu_spsc_item_t *items, uint32_t n);
+
 #ifdef __cplusplus
 }
 #endif
@@ -29,7 +29,10 @@
 
 #include "mu_config.h"
 #include "mu_sched.h"
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
 
 // *****************************************************************************
 // Private types and definitions
@@ -37,6 +40,19 @@
 // *****************************************************************************
 // Private declarations
 
+#ifdef MU_CONFIG_TASK_WATCHDOG
+/**
+ * @brief Add one call's run time to timing.
+ */
+static void record_timing(mu_task_timing_t *timing, mu_time_rel_t elapsed,
+                          bool overrun);
+
+/**
+ * @brief Call the task and return how long the call took.
+ */
+static mu_time_rel_t timed_call(mu_task_t *task, void *arg);
+#endif
+
 // *****************************************************************************
 // Local storage
 
@@ -44,6 +60,26 @@ static mu_task_call_hook s_call_hook = NULL;
 
 static mu_task_set_state_hook s_set_state_hook = NULL;
 
+#ifdef MU_CONFIG_TASK_IDS
+_Static_assert(MU_CONFIG_TASK_MAX_IDS >= 1 &&
+                   MU_CONFIG_TASK_MAX_IDS <= UINT16_MAX,
+               "MU_CONFIG_TASK_MAX_IDS must be between 1 and 65535");
+
+// The task registry: s_registry[id - 1] is the task with that id, or NULL.
+// Free slots are claimed with a compare-and-swap, so tasks can be registered
+// from several threads at once.
+static mu_task_t *s_registry[MU_CONFIG_TASK_MAX_IDS];
+#endif
+
+#ifdef MU_CONFIG_TASK_WATCHDOG
+static mu_time_rel_t s_watchdog_budget = 0;
+
+static mu_task_overrun_hook s_overrun_hook = NULL;
+
+// NULL to time calls with the cycle counter.
+static mu_task_clock_fn s_watchdog_clock = NULL;
+#endif
+
 // *****************************************************************************
 // Public code
 
@@ -53,6 +89,34 @@ mu_task_t *mu_task_init(mu_task_t *task, mu_task_fn fn,
     task->fn = fn;
     task->state = initial_state;
     task->user_info = user_info;
+#ifdef MU_CONFIG_TASK_IDS
+    task->id = MU_TASK_ID_NONE;
+#endif
+#ifdef MU_CONFIG_SCHED_EXEC
+    task->exec_lock = 0;
+#endif
+#ifdef MU_CONFIG_SCHED_DEFERRED_HEAP
+    task->deferred_slot = 0;
+    task->deferred_count = 0;
+#endif
+#ifdef MU_CONFIG_SCHED_DEDUP
+    task->dedup = false;
+    task->queued = 0;
+#endif
+#ifdef MU_CONFIG_SCHED_EDF
+    task->deadline_misses = 0;
+#endif
+#ifdef MU_CONFIG_SCHED_STATS
+    task->lateness = NULL;
+#endif
+#ifdef MU_CONFIG_TASK_WATCHDOG
+    task->state_timing = NULL;
+    task->n_state_timing = 0;
+    mu_task_reset_timing(task);
+#endif
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
+    atomic_store_explicit(&task->thread_queued, false, memory_order_relaxed);
+#endif
     return task;
 }
 
@@ -73,10 +137,106 @@ void mu_task_call(mu_task_t *task, void *arg) {
     if (s_call_hook != NULL) {
         s_call_hook(task);
     }
+#ifdef MU_CONFIG_TASK_WATCHDOG
+    // Invoke the task, timing the call
+    mu_task_state_t state = task->state;
+    mu_time_rel_t elapsed = timed_call(task, arg);
+    bool overrun = s_watchdog_budget > 0 && elapsed > s_watchdog_budget;
+    record_timing(&task->timing, elapsed, overrun);
+    if (state < task->n_state_timing) {
+        record_timing(&task->state_timing[state], elapsed, overrun);
+    }
+    if (overrun && s_overrun_hook != NULL) {
+        s_overrun_hook(task, state, elapsed);
+    }
+#else
     // Invoke the task
     task->fn(task, arg);
+#endif
 }
 
+#ifdef MU_CONFIG_TASK_WATCHDOG
+
+void mu_task_set_watchdog(mu_time_rel_t budget, mu_task_overrun_hook fn) {
+    s_watchdog_budget = budget;
+    s_overrun_hook = fn;
+}
+
+void mu_task_set_watchdog_clock(mu_task_clock_fn clock_fn) {
+    s_watchdog_clock = clock_fn;
+}
+
+const mu_task_timing_t *mu_task_get_timing(mu_task_t *task) {
+    return &task->timing;
+}
+
+void mu_task_set_state_timing(mu_task_t *task, mu_task_timing_t *timing,
+                              size_t n_states) {
+    task->state_timing = timing;
+    task->n_state_timing = timing != NULL ? n_states : 0;
+    mu_task_reset_timing(task);
+}
+
+void mu_task_reset_timing(mu_task_t *task) {
+    memset(&task->timing, 0, sizeof(mu_task_timing_t));
+    if (task->n_state_timing > 0) {
+        memset(task->state_timing, 0,
+               task->n_state_timing * sizeof(mu_task_timing_t));
+    }
+}
+
+#endif
+
+#ifdef MU_CONFIG_TASK_IDS
+
+mu_task_id_t mu_task_get_id(mu_task_t *task) {
+    mu_task_id_t id = task->id;
+    if (id != MU_TASK_ID_NONE &&
+        __atomic_load_n(&s_registry[id - 1], __ATOMIC_ACQUIRE) == task) {
+        return id;
+    }
+    // Not registered since mu_task_init().  The task may still hold an ID
+    // from before it was re-initialized, so look for it before claiming a
+    // free ID.
+    id = MU_TASK_ID_NONE;
+    for (size_t i = 0; i < MU_CONFIG_TASK_MAX_IDS; i++) {
+        if (__atomic_load_n(&s_registry[i], __ATOMIC_ACQUIRE) == task) {
+            id = (mu_task_id_t)(i + 1);
+            break;
+        }
+    }
+    // Another thread may claim a free slot between the load and the swap, in
+    // which case move on to the next one.
+    for (size_t i = 0; i < MU_CONFIG_TASK_MAX_IDS && id == MU_TASK_ID_NONE;
+         i++) {
+        mu_task_t *expected = NULL;
+        if (__atomic_compare_exchange_n(&s_registry[i], &expected, task, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            id = (mu_task_id_t)(i + 1);
+        }
+    }
+    task->id = id;
+    return id;
+}
+
+mu_task_t *mu_task_from_id(mu_task_id_t id) {
+    if (id == MU_TASK_ID_NONE || id > MU_CONFIG_TASK_MAX_IDS) {
+        return NULL;
+    }
+    return __atomic_load_n(&s_registry[id - 1], __ATOMIC_ACQUIRE);
+}
+
+void mu_task_unregister(mu_task_t *task) {
+    for (size_t i = 0; i < MU_CONFIG_TASK_MAX_IDS; i++) {
+        mu_task_t *expected = task;
+        __atomic_compare_exchange_n(&s_registry[i], &expected, NULL, false,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
+    task->id = MU_TASK_ID_NONE;
+}
+
+#endif
+
 mu_task_fn mu_task_get_fn(mu_task_t *task) { return task->fn; }
 
 unsigned int mu_task_get_state(mu_task_t *task) { return task->state; }
@@ -113,10 +273,31 @@ mu_task_err_t mu_task_yield(mu_task_t *task, mu_task_state_t next_state) {
     return mu_sched_asap(task);
 }
 
+mu_task_err_t mu_task_yield_prio(mu_task_t *task, mu_task_state_t next_state,
+                                 unsigned int prio) {
+    mu_task_set_state(task, next_state);
+    return mu_sched_asap_prio(task, prio);
+}
+
+#ifdef MU_CONFIG_SCHED_EDF
+mu_task_err_t mu_task_yield_deadline(mu_task_t *task,
+                                     mu_task_state_t next_state,
+                                     mu_time_abs_t deadline) {
+    mu_task_set_state(task, next_state);
+    return mu_sched_asap_deadline(task, deadline);
+}
+#endif
+
 mu_task_err_t mu_task_sched_from_isr(mu_task_t *task) {
     return mu_sched_from_isr(task);
 }
 
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
+mu_task_err_t mu_task_sched_from_thread(mu_task_t *task) {
+    return mu_sched_from_thread(task);
+}
+#endif
+
 mu_task_err_t mu_task_defer_for(mu_task_t *task, mu_task_state_t next_state,
                                 mu_time_rel_t in) {
     mu_task_set_state(task, next_state);
@@ -129,6 +310,20 @@ mu_task_err_t mu_task_defer_until(mu_task_t *task, mu_task_state_t next_state,
     return mu_sched_defer_until(task, at);
 }
 
+mu_task_err_t mu_task_defer_for_slack(mu_task_t *task,
+                                      mu_task_state_t next_state,
+                                      mu_time_rel_t in, mu_time_rel_t slack) {
+    mu_task_set_state(task, next_state);
+    return mu_sched_defer_for_slack(task, in, slack);
+}
+
+mu_task_err_t mu_task_defer_until_slack(mu_task_t *task,
+                                        mu_task_state_t next_state,
+                                        mu_time_abs_t at, mu_time_rel_t slack) {
+    mu_task_set_state(task, next_state);
+    return mu_sched_defer_until_slack(task, at, slack);
+}
+
 mu_task_err_t mu_task_remove_deferred_task(mu_task_t *task) {
     return mu_sched_remove_deferred_task(task);
 }
@@ -142,3 +337,30 @@ mu_task_err_t mu_task_transfer(mu_task_t *from_task,
 
 // *****************************************************************************
 // Private functions
+
+#ifdef MU_CONFIG_TASK_WATCHDOG
+
+static mu_time_rel_t timed_call(mu_task_t *task, void *arg) {
+    if (s_watchdog_clock != NULL) {
+        mu_time_abs_t start = s_watchdog_clock();
+        task->fn(task, arg);
+        return mu_time_difference(s_watchdog_clock(), start);
+    }
+    mu_time_cycles_t start = mu_time_cycles();
+    task->fn(task, arg);
+    return mu_time_cycles_to_rel(mu_time_cycles_ordered() - start);
+}
+
+static void record_timing(mu_task_timing_t *timing, mu_time_rel_t elapsed,
+                          bool overrun) {
+    timing->calls += 1;
+    timing->total += elapsed;
+    if (elapsed > timing->max) {
+        timing->max = elapsed;
+    }
+    if (overrun) {
+        timing->overruns += 1;
+    }
+}
+
+#endif
@@ -30,7 +30,12 @@
 
 #include "mu_config.h"
 #include "mu_time.h"
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
+#include "mu_mpsc.h"
+#endif
+#include <stdbool.h>
 #include <stddef.h> // offsetof
+#include <stdint.h>
 
 // *****************************************************************************
 // C++ compatibility
@@ -44,10 +49,24 @@ extern "C" {
 
 typedef unsigned int mu_task_state_t;
 
+#ifdef MU_CONFIG_TASK_IDS
+
+#ifndef MU_CONFIG_TASK_MAX_IDS
+#define MU_CONFIG_TASK_MAX_IDS 32
+#endif
+
+// A compact name for a task, assigned by the task registry.
+typedef uint16_t mu_task_id_t;
+
+#define MU_TASK_ID_NONE 0 // not a task
+
+#endif
+
 typedef enum {
   MU_TASK_ERR_NONE,
   MU_TASK_ERR_SCHED_FULL,
   MU_TASK_ERR_NOT_FOUND,
+  MU_TASK_ERR_SCHED_RANGE, // deferred time too far off (MU_CONFIG_TASK_IDS)
 } mu_task_err_t;
 
 /**
@@ -70,13 +89,53 @@ typedef enum {
 
 struct _mu_task; // forward declaration
 
+#ifdef MU_CONFIG_TASK_WATCHDOG
+// How long calls to a task (or to a task in one state) took.  See
+// mu_task_set_watchdog().
+typedef struct {
+  uint32_t calls;      // number of calls timed
+  uint32_t overruns;   // number of calls that exceeded the budget
+  mu_time_rel_t max;   // longest call
+  mu_time_rel_t total; // time spent in all calls
+} mu_task_timing_t;
+#endif
+
 // The signature of a mu_task function.
 typedef void (*mu_task_fn)(struct _mu_task *task, void *arg);
 
 typedef struct _mu_task {
   mu_task_fn fn;         // the function to call
   mu_task_state_t state; // the current task state
+#ifdef MU_CONFIG_TASK_IDS
+  mu_task_id_t id;       // see mu_task_get_id()
+#endif
   void *user_info;       // user-supplied info
+#ifdef MU_CONFIG_SCHED_EXEC
+  volatile unsigned int exec_lock; // non-zero while a mu_exec worker runs it
+#endif
+#ifdef MU_CONFIG_SCHED_DEFERRED_HEAP
+  size_t deferred_slot;   // 1 + index in mu_sched's deferred heap, 0 if none
+  size_t deferred_count;  // number of entries for the task in deferred heaps
+#endif
+#ifdef MU_CONFIG_SCHED_DEDUP
+  bool dedup;               // see mu_sched_set_dedup()
+  volatile uint32_t queued; // non-zero while queued for a scheduler
+#endif
+#ifdef MU_CONFIG_SCHED_EDF
+  uint32_t deadline_misses; // times run after its mu_sched_asap_deadline()
+#endif
+#ifdef MU_CONFIG_SCHED_STATS
+  struct _mu_sched_hist *lateness; // optional, see mu_sched_set_lateness_hist()
+#endif
+#ifdef MU_CONFIG_TASK_WATCHDOG
+  mu_task_timing_t timing;        // all calls to the task
+  mu_task_timing_t *state_timing; // optional, see mu_task_set_state_timing()
+  size_t n_state_timing;          // number of states in state_timing
+#endif
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
+  mu_mpsc_node_t thread_node;  // links the task into a scheduler's thread queue
+  _Atomic bool thread_queued;  // true while in a thread queue
+#endif
 } mu_task_t;
 
 // The signature of a mu_task_call_hook() function
@@ -87,6 +146,16 @@ typedef void (*mu_task_set_state_hook)(mu_task_t *task,
                                        mu_task_state_t prev_state,
                                        mu_task_state_t state);
 
+#ifdef MU_CONFIG_TASK_WATCHDOG
+// The signature of a mu_task_set_watchdog() overrun function.  state is the
+// state the task was in when it was called.
+typedef void (*mu_task_overrun_hook)(mu_task_t *task, mu_task_state_t state,
+                                     mu_time_rel_t elapsed);
+
+// The signature of a mu_task_set_watchdog_clock() function.
+typedef mu_time_abs_t (*mu_task_clock_fn)(void);
+#endif
+
 // *****************************************************************************
 // Public declarations
 
@@ -115,6 +184,83 @@ void mu_task_install_set_state_hook(mu_task_set_state_hook fn);
  */
 void mu_task_call(mu_task_t *task, void *arg);
 
+#ifdef MU_CONFIG_TASK_WATCHDOG
+
+/**
+ * @brief Set the run time budget for a single call to a task and the function
+ * called when a call exceeds it.
+ *
+ * Every mu_task_call() is timed, whatever the budget, and recorded in the
+ * task's timing (and in its state timing, if any).  A call that takes longer
+ * than budget is counted as an overrun and, after the task returns, reported
+ * to fn.  A budget of zero disables overrun checks; fn may be NULL.
+ */
+void mu_task_set_watchdog(mu_time_rel_t budget, mu_task_overrun_hook fn);
+
+/**
+ * @brief Set the clock used to time task calls.  NULL (the default) selects
+ * the cycle counter, mu_time_cycles().
+ *
+ * The watchdog measures real time, so it does not follow the scheduler's clock
+ * source.  This function is provided primarily for unit testing.
+ */
+void mu_task_set_watchdog_clock(mu_task_clock_fn clock_fn);
+
+/**
+ * @brief Return the timing of all calls to the task.
+ */
+const mu_task_timing_t *mu_task_get_timing(mu_task_t *task);
+
+/**
+ * @brief Also record the timing of the task's calls by state.
+ *
+ * timing[s] records the calls made while the task was in state s.  Calls made
+ * in states of n_states or more are recorded only in the task's timing.  The
+ * array is cleared.  Pass NULL to stop recording by state.
+ */
+void mu_task_set_state_timing(mu_task_t *task, mu_task_timing_t *timing,
+                              size_t n_states);
+
+/**
+ * @brief Clear the task's timing and state timing.
+ */
+void mu_task_reset_timing(mu_task_t *task);
+
+#endif // MU_CONFIG_TASK_WATCHDOG
+
+#ifdef MU_CONFIG_TASK_IDS
+
+/**
+ * @brief Return the task's ID, registering the task on first use.
+ *
+ * IDs run from 1 to MU_CONFIG_TASK_MAX_IDS.  The scheduler calls this itself,
+ * so registration is normally implicit.  The first call after mu_task_init()
+ * searches the registry, so it is O(MU_CONFIG_TASK_MAX_IDS); later calls are
+ * O(1).  A task that is scheduled from interrupt level should be registered
+ * beforehand.
+ *
+ * Free IDs are claimed atomically, so different tasks may be registered from
+ * different threads (mu_exec workers, mu_pdes LPs) at the same time.  The
+ * same task must not be registered from two threads at once.
+ *
+ * @return The ID, or MU_TASK_ID_NONE if the registry is full.
+ */
+mu_task_id_t mu_task_get_id(mu_task_t *task);
+
+/**
+ * @brief Return the task with the given ID, or NULL if none.
+ */
+mu_task_t *mu_task_from_id(mu_task_id_t id);
+
+/**
+ * @brief Release the task's ID, e.g. before the task goes out of scope.
+ *
+ * The task must not be waiting in a scheduler.
+ */
+void mu_task_unregister(mu_task_t *task);
+
+#endif // MU_CONFIG_TASK_IDS
+
 /**
  * @brief Return the function of this task.
  */
@@ -159,11 +305,35 @@ mu_task_err_t mu_task_wait(mu_task_t *task, mu_task_state_t next_state);
  */
 mu_task_err_t mu_task_yield(mu_task_t *task, mu_task_state_t next_state);
 
+/**
+ * @brief Set the state of the given task before rescheduling it ASAP at the
+ * given priority.  See mu_sched_asap_prio().
+ */
+mu_task_err_t mu_task_yield_prio(mu_task_t *task, mu_task_state_t next_state,
+                                 unsigned int prio);
+
+#ifdef MU_CONFIG_SCHED_EDF
+/**
+ * @brief Set the state of the given task before rescheduling it to run by the
+ * given deadline.  See mu_sched_asap_deadline().
+ */
+mu_task_err_t mu_task_yield_deadline(mu_task_t *task,
+                                     mu_task_state_t next_state,
+                                     mu_time_abs_t deadline);
+#endif
+
 /**
  * @brief Schedule a task from interrupt level in the "asap" queue.
  */
 mu_task_err_t mu_task_sched_from_isr(mu_task_t *task);
 
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
+/**
+ * @brief Schedule a task from another thread.  See mu_sched_from_thread().
+ */
+mu_task_err_t mu_task_sched_from_thread(mu_task_t *task);
+#endif
+
 /**
  * @brief Schedule a task to be run after a given interval.
  */
@@ -176,6 +346,22 @@ mu_task_err_t mu_task_defer_for(mu_task_t *task, mu_task_state_t next_state,
 mu_task_err_t mu_task_defer_until(mu_task_t *task, mu_task_state_t next_state,
                                   mu_time_abs_t at);
 
+/**
+ * @brief Schedule a task to be run after an interval of from in to in + slack.
+ * See mu_sched_defer_until_slack().
+ */
+mu_task_err_t mu_task_defer_for_slack(mu_task_t *task,
+                                      mu_task_state_t next_state,
+                                      mu_time_rel_t in, mu_time_rel_t slack);
+
+/**
+ * @brief Schedule a task to be run at a time from at to at + slack.  See
+ * mu_sched_defer_until_slack().
+ */
+mu_task_err_t mu_task_defer_until_slack(mu_task_t *task,
+                                        mu_task_state_t next_state,
+                                        mu_time_abs_t at, mu_time_rel_t slack);
+
 /**
  * @brief Remove a deferred task from the scheduler.
  *
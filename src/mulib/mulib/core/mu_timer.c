@@ -32,6 +32,9 @@
 #include "mu_sched.h"
 #include "mu_task.h"
 #include "mu_time.h"
+#ifdef MU_CONFIG_TIMER_WHEEL
+#include "mu_twheel.h"
+#endif
 
 #include <stdbool.h>
 #include <stddef.h>
@@ -43,6 +46,16 @@
 // *****************************************************************************
 // Private (static) storage
 
+#ifdef MU_CONFIG_TIMER_WHEEL
+
+static mu_twheel_t s_wheel;               // holds all running timers
+static mu_task_t s_wheel_task;            // services s_wheel when it is due
+static mu_time_abs_t s_wheel_origin;      // the time of wheel tick 0
+static bool s_wheel_armed;                // true if s_wheel_task was deferred
+static mu_twheel_tick_t s_wheel_armed_at; // tick s_wheel_task is deferred to
+
+#endif
+
 // *****************************************************************************
 // Private (static, forward) declarations
 
@@ -51,25 +64,122 @@
  */
 static void mu_timer_fn(mu_task_t *task, void *arg);
 
+#ifdef MU_CONFIG_TIMER_WHEEL
+
+/**
+ * @brief Convert a time to a wheel tick, rounding up or down.
+ */
+static mu_twheel_tick_t time_to_tick(mu_time_abs_t t, bool round_up);
+
+/**
+ * @brief Convert a wheel tick to the time at which it starts.
+ */
+static mu_time_abs_t tick_to_time(mu_twheel_tick_t tick);
+
+/**
+ * @brief Return the wheel tick at which a running timer should expire, taking
+ * its slack into account.
+ */
+static mu_twheel_tick_t expiry_tick(mu_timer_t *timer);
+
+/**
+ * @brief Return true if s_wheel_task is still deferred to s_wheel_armed_at.
+ *
+ * mu_sched_init() drops s_wheel_task without telling the wheel, so
+ * s_wheel_armed alone can't be trusted.
+ */
+static bool wheel_is_armed(void);
+
+/**
+ * @brief Make sure s_wheel_task is deferred until the wheel next needs service.
+ */
+static void arm_wheel(void);
+
+/**
+ * @brief Expire all timers that are due.  Called via s_wheel_task.
+ */
+static void wheel_task_fn(mu_task_t *task, void *arg);
+
+#endif
+
 // *****************************************************************************
 // Public code
 
+#ifdef MU_CONFIG_TIMER_WHEEL
+
+void mu_timer_wheel_init(void) {
+  s_wheel_origin = mu_sched_get_current_time();
+  mu_twheel_init(&s_wheel, 0);
+  mu_task_init(&s_wheel_task, wheel_task_fn, 0, NULL);
+  s_wheel_armed = false;
+}
+
+#endif
+
 void mu_timer_init(mu_timer_t *timer) {
   mu_task_init(&timer->task, mu_timer_fn, MU_TIMER_STATE_IDLE, NULL);
+  timer->state = MU_TIMER_STATE_IDLE;
+#ifdef MU_CONFIG_TIMER_WHEEL
+  mu_twheel_node_init(&timer->node);
+#endif
 }
 
 void mu_timer_start(mu_timer_t *timer,
                     mu_time_rel_t delay_tics,
                     bool periodic,
                     mu_task_t *on_completion) {
+  mu_timer_start_with_slack(timer, delay_tics, periodic, on_completion, 0);
+}
+
+#ifdef MU_CONFIG_TIMER_WHEEL
+
+void mu_timer_start_with_slack(mu_timer_t *timer,
+                               mu_time_rel_t delay_tics,
+                               bool periodic,
+                               mu_task_t *on_completion,
+                               mu_time_rel_t slack) {
+  mu_timer_stop(timer);
+  if (mu_twheel_count(&s_wheel) == 0 && !wheel_is_armed() &&
+      mu_sched_current_task() != &s_wheel_task) {
+    // Nothing depends on the wheel's origin, so (re-)start it from now.  This
+    // also sets up the wheel the first time a timer is started.  Not from an
+    // on_completion task, though: wheel_task_fn() is still expiring timers.
+    mu_timer_wheel_init();
+  }
+  mu_time_abs_t now = mu_sched_get_current_time();
+  timer->delay_tics = delay_tics;
+  timer->delay_until = mu_time_offset(now, timer->delay_tics);
+  timer->slack = slack;
+  timer->periodic = periodic;
+  timer->state = MU_TIMER_STATE_RUNNING;
+  timer->on_completion = on_completion;
+  mu_twheel_insert(&s_wheel, &timer->node, expiry_tick(timer));
+  arm_wheel();
+}
+
+void mu_timer_stop(mu_timer_t *timer) {
+  if (timer->state == MU_TIMER_STATE_RUNNING) {
+    mu_twheel_remove(&s_wheel, &timer->node);
+  }
+  timer->state = MU_TIMER_STATE_IDLE;
+}
+
+#else
+
+void mu_timer_start_with_slack(mu_timer_t *timer,
+                               mu_time_rel_t delay_tics,
+                               bool periodic,
+                               mu_task_t *on_completion,
+                               mu_time_rel_t slack) {
   mu_timer_stop(timer);
   mu_time_abs_t now = mu_sched_get_clock_source()(); // function pointers, whoo!
   timer->delay_tics = delay_tics;
   timer->delay_until = mu_time_offset(now, timer->delay_tics);
+  timer->slack = slack;
   timer->periodic = periodic;
   timer->state = MU_TIMER_STATE_RUNNING;
   timer->on_completion = on_completion;
-  mu_sched_defer_until(&timer->task, timer->delay_until);
+  mu_sched_defer_until_slack(&timer->task, timer->delay_until, timer->slack);
 }
 
 void mu_timer_stop(mu_timer_t *timer) {
@@ -79,6 +189,8 @@ void mu_timer_stop(mu_timer_t *timer) {
   timer->state = MU_TIMER_STATE_IDLE;
 }
 
+#endif
+
 bool mu_timer_is_running(mu_timer_t *timer) {
   return timer->state == MU_TIMER_STATE_RUNNING;
 }
@@ -105,7 +217,7 @@ static void mu_timer_fn(mu_task_t *task, void *arg) {
     if (self->periodic) {
       // Schedule next wakeup (and prevent time slippage...)
       self->delay_until = mu_time_offset(self->delay_until, self->delay_tics);
-      mu_sched_defer_until(&self->task, self->delay_until);
+      mu_sched_defer_until_slack(&self->task, self->delay_until, self->slack);
     } else {
       // Stop timer.
       self->state = MU_TIMER_STATE_IDLE;
@@ -121,6 +233,105 @@ static void mu_timer_fn(mu_task_t *task, void *arg) {
   } // switch
 }
 
+#ifdef MU_CONFIG_TIMER_WHEEL
+
+static mu_twheel_tick_t time_to_tick(mu_time_abs_t t, bool round_up) {
+  mu_time_rel_t dt = mu_time_difference(t, s_wheel_origin);
+  if (dt <= 0) {
+    return 0;
+  } else if (round_up) {
+    return (dt + MU_CONFIG_TIMER_WHEEL_RESOLUTION - 1) /
+           MU_CONFIG_TIMER_WHEEL_RESOLUTION;
+  } else {
+    return dt / MU_CONFIG_TIMER_WHEEL_RESOLUTION;
+  }
+}
+
+static mu_time_abs_t tick_to_time(mu_twheel_tick_t tick) {
+  return mu_time_offset(s_wheel_origin,
+                        (mu_time_rel_t)(tick * MU_CONFIG_TIMER_WHEEL_RESOLUTION));
+}
+
+static mu_twheel_tick_t expiry_tick(mu_timer_t *timer) {
+  // Round up so the timer never fires before delay_until.
+  mu_twheel_tick_t first = time_to_tick(timer->delay_until, true);
+  if (timer->slack <= 0) {
+    return first;
+  }
+  mu_twheel_tick_t last = time_to_tick(
+      mu_time_offset(timer->delay_until, timer->slack), false);
+  if ((int64_t)(last - first) <= 0) {
+    return first;
+  }
+  // Share the next wheel service if it falls in the window, else take the
+  // tick in the window with the most trailing zero bits, as mu_sched does.
+  if (wheel_is_armed() && (int64_t)(s_wheel_armed_at - first) >= 0 &&
+      (int64_t)(last - s_wheel_armed_at) >= 0) {
+    return s_wheel_armed_at;
+  }
+  int bit = 63 - __builtin_clzll((first - 1) ^ last);
+  return last & ~(((mu_twheel_tick_t)1 << bit) - 1);
+}
+
+static bool wheel_is_armed(void) {
+  if (s_wheel_armed && !mu_sched_is_deferred(&s_wheel_task)) {
+    s_wheel_armed = false;
+  }
+  return s_wheel_armed;
+}
+
+static void arm_wheel(void) {
+  mu_twheel_tick_t tick;
+
+  if (!mu_twheel_next_tick(&s_wheel, &tick)) {
+    // Wheel is empty.  If s_wheel_task is still deferred, it will find
+    // nothing to do, which is cheaper than removing it.
+    return;
+  }
+  if (wheel_is_armed()) {
+    if ((int64_t)(tick - s_wheel_armed_at) >= 0) {
+      // s_wheel_task will run soon enough.
+      return;
+    }
+    mu_sched_remove_deferred_task(&s_wheel_task);
+  }
+  mu_sched_defer_until(&s_wheel_task, tick_to_time(tick));
+  s_wheel_armed = true;
+  s_wheel_armed_at = tick;
+}
+
+static void wheel_task_fn(mu_task_t *task, void *arg) {
+  mu_twheel_node_t *node;
+  (void)task; // unused
+  (void)arg;  // unused
+
+  s_wheel_armed = false;
+  mu_twheel_tick_t now = time_to_tick(mu_sched_get_current_time(), false);
+
+  while ((node = mu_twheel_expire(&s_wheel, now)) != NULL) {
+    mu_timer_t *timer = MU_TASK_CTX(node, mu_timer_t, node);
+    if (timer->periodic) {
+      // Schedule next expiration (and prevent time slippage...).  A timer
+      // that has fallen behind catches up one tick at a time rather than
+      // being expired again in this loop.
+      timer->delay_until = mu_time_offset(timer->delay_until, timer->delay_tics);
+      mu_twheel_tick_t tick = expiry_tick(timer);
+      if ((int64_t)(tick - now) <= 0) {
+        tick = now + 1;
+      }
+      mu_twheel_insert(&s_wheel, &timer->node, tick);
+    } else {
+      // Stop timer.
+      timer->state = MU_TIMER_STATE_IDLE;
+    }
+    // Invoke on-completion task.
+    mu_task_call(timer->on_completion, NULL);
+  }
+  arm_wheel();
+}
+
+#endif
+
 // *****************************************************************************
 // Standalone tests
 
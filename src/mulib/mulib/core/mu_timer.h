@@ -34,8 +34,12 @@
 // *****************************************************************************
 // Includes
 
+#include "mu_config.h"
 #include "mu_task.h"
 #include "mu_time.h"
+#ifdef MU_CONFIG_TIMER_WHEEL
+#include "mu_twheel.h"
+#endif
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -50,6 +54,13 @@ extern "C" {
 // *****************************************************************************
 // Public types and definitions
 
+#ifdef MU_CONFIG_TIMER_WHEEL
+#ifndef MU_CONFIG_TIMER_WHEEL_RESOLUTION
+// Duration of one wheel tick, in mu_time units.  Defaults to one millisecond.
+#define MU_CONFIG_TIMER_WHEEL_RESOLUTION (MU_TIME_TICKS_PER_SECOND / 1000)
+#endif
+#endif
+
 typedef enum {
   MU_TIMER_STATE_IDLE,
   MU_TIMER_STATE_RUNNING,
@@ -62,12 +73,31 @@ typedef struct {
   mu_task_t *on_completion; // task to run upon completion.
   mu_time_rel_t delay_tics;
   mu_time_abs_t delay_until;
+  mu_time_rel_t slack;      // see mu_timer_start_with_slack()
   bool periodic;
+#ifdef MU_CONFIG_TIMER_WHEEL
+  mu_twheel_node_t node;    // links the timer into the timing wheel
+#endif
 } mu_timer_t;
 
 // *****************************************************************************
 // Public declarations
 
+#ifdef MU_CONFIG_TIMER_WHEEL
+/**
+ * @brief Initialize the timing wheel that drives all timers.
+ *
+ * With MU_CONFIG_TIMER_WHEEL defined, running timers are kept in a single
+ * hierarchical timing wheel rather than in the scheduler's deferred queue, so
+ * that start, stop and expiry are O(1).  One internal task is deferred until
+ * the next time the wheel needs attention.
+ *
+ * Calling this is optional: the wheel is initialized when a timer is started
+ * and no timer is running.  Call it to forget any timers that were running.
+ */
+void mu_timer_wheel_init(void);
+#endif
+
 /**
  * @brief Initialize the timer.
  */
@@ -89,6 +119,23 @@ void mu_timer_start(mu_timer_t *timer,
                     bool periodic,
                     mu_task_t *on_completion);
 
+/**
+ * @brief Start the timer, allowing each expiration to be up to slack tics late
+ * so that it can share a wakeup with other tasks.
+ *
+ * The timer expires at a time from delay_until to delay_until + slack chosen
+ * as by mu_sched_defer_until_slack() (or, with MU_CONFIG_TIMER_WHEEL, the
+ * equivalent wheel tick).  A periodic timer's period is still measured from
+ * the nominal expiration times, so slack doesn't accumulate.
+ *
+ * @param slack How late the timer may expire.  Zero is mu_timer_start().
+ */
+void mu_timer_start_with_slack(mu_timer_t *timer,
+                               mu_time_rel_t delay_tics,
+                               bool periodic,
+                               mu_task_t *on_completion,
+                               mu_time_rel_t slack);
+
 /**
  * @brief Stop the timer.
  *
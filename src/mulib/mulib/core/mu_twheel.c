@@ -0,0 +1,311 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. D. Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_twheel.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// *****************************************************************************
+// Private types and definitions
+
+#define SLOT_MASK (MU_TWHEEL_SLOTS - 1)
+
+// Slot index used for nodes that have expired but have not been fetched.
+#define PENDING_SLOT (MU_TWHEEL_LEVELS * MU_TWHEEL_SLOTS)
+
+// Number of ticks covered by one slot at the given level.
+#define LEVEL_SHIFT(level) ((level) * MU_TWHEEL_SLOT_BITS)
+
+// Largest distance into the future that the wheel can represent directly.
+#define MAX_DELTA                                                              \
+  (((mu_twheel_tick_t)1 << LEVEL_SHIFT(MU_TWHEEL_LEVELS)) - 1)
+
+// *****************************************************************************
+// Private (static) storage
+
+// *****************************************************************************
+// Private (forward) declarations
+
+static void list_init(mu_twheel_link_t *head);
+static bool list_is_empty(mu_twheel_link_t *head);
+static void list_append(mu_twheel_link_t *head, mu_twheel_link_t *link);
+static void list_unlink(mu_twheel_link_t *link);
+
+/**
+ * @brief Return true if tick a comes strictly after tick b.
+ */
+static bool tick_follows(mu_twheel_tick_t a, mu_twheel_tick_t b);
+
+/**
+ * @brief Rotate a 64 bit word right by n bits.
+ */
+static uint64_t rotate_right(uint64_t word, unsigned int n);
+
+/**
+ * @brief File the node in the slot that matches its expiration.
+ */
+static void file_node(mu_twheel_t *wheel, mu_twheel_node_t *node);
+
+/**
+ * @brief Re-file every node in slots[level][index] relative to wheel->now.
+ */
+static void cascade(mu_twheel_t *wheel, int level, unsigned int index);
+
+/**
+ * @brief Process tick wheel->now: cascade as needed, then move the expired
+ * nodes to the pending list.
+ */
+static void process_tick(mu_twheel_t *wheel);
+
+// *****************************************************************************
+// Public code
+
+mu_twheel_t *mu_twheel_init(mu_twheel_t *wheel, mu_twheel_tick_t now) {
+  for (int level = 0; level < MU_TWHEEL_LEVELS; level++) {
+    for (int slot = 0; slot < MU_TWHEEL_SLOTS; slot++) {
+      list_init(&wheel->slots[level][slot]);
+    }
+    wheel->occupied[level] = 0;
+  }
+  list_init(&wheel->pending);
+  wheel->now = now;
+  wheel->count = 0;
+  return wheel;
+}
+
+mu_twheel_node_t *mu_twheel_node_init(mu_twheel_node_t *node) {
+  node->link.next = NULL;
+  node->link.prev = NULL;
+  node->expires = 0;
+  node->slot = 0;
+  return node;
+}
+
+bool mu_twheel_node_is_linked(mu_twheel_node_t *node) {
+  return node->link.next != NULL;
+}
+
+mu_twheel_tick_t mu_twheel_node_expires(mu_twheel_node_t *node) {
+  return node->expires;
+}
+
+size_t mu_twheel_count(mu_twheel_t *wheel) { return wheel->count; }
+
+void mu_twheel_insert(mu_twheel_t *wheel, mu_twheel_node_t *node,
+                      mu_twheel_tick_t expires) {
+  node->expires = expires;
+  file_node(wheel, node);
+  wheel->count += 1;
+}
+
+void mu_twheel_remove(mu_twheel_t *wheel, mu_twheel_node_t *node) {
+  if (!mu_twheel_node_is_linked(node)) {
+    return;
+  }
+  list_unlink(&node->link);
+  if (node->slot != PENDING_SLOT) {
+    int level = node->slot / MU_TWHEEL_SLOTS;
+    unsigned int index = node->slot & SLOT_MASK;
+    if (list_is_empty(&wheel->slots[level][index])) {
+      wheel->occupied[level] &= ~((uint64_t)1 << index);
+    }
+  }
+  wheel->count -= 1;
+}
+
+bool mu_twheel_next_tick(mu_twheel_t *wheel, mu_twheel_tick_t *tick) {
+  bool found = false;
+  mu_twheel_tick_t best = 0;
+
+  if (!list_is_empty(&wheel->pending)) {
+    // Already expired: due as of the last processed tick.
+    *tick = wheel->now - 1;
+    return true;
+  }
+
+  for (int level = 0; level < MU_TWHEEL_LEVELS; level++) {
+    uint64_t occupied = wheel->occupied[level];
+    if (occupied == 0) {
+      continue;
+    }
+    int shift = LEVEL_SHIFT(level);
+    mu_twheel_tick_t block = wheel->now >> shift;
+    unsigned int current = block & SLOT_MASK;
+    // bit k of rotated is set if the slot k positions past current is in use.
+    uint64_t rotated = rotate_right(occupied, current);
+    mu_twheel_tick_t candidate;
+
+    if (level == 0) {
+      // Level 0 slots expire one tick apart, starting with the current slot.
+      candidate = wheel->now + __builtin_ctzll(rotated);
+    } else {
+      // Higher level slots are cascaded when the wheel reaches the start of
+      // the slot's block.  The current slot has already been cascaded unless
+      // the wheel sits exactly at the start of its block.
+      bool at_boundary =
+          (wheel->now & (((mu_twheel_tick_t)1 << shift) - 1)) == 0;
+      if (!at_boundary) {
+        rotated &= ~(uint64_t)1;
+      }
+      unsigned int k = rotated ? __builtin_ctzll(rotated) : MU_TWHEEL_SLOTS;
+      candidate = (block + k) << shift;
+    }
+    if (!found || tick_follows(best, candidate)) {
+      best = candidate;
+      found = true;
+    }
+  }
+
+  if (found) {
+    *tick = best;
+  }
+  return found;
+}
+
+mu_twheel_node_t *mu_twheel_expire(mu_twheel_t *wheel, mu_twheel_tick_t now) {
+  mu_twheel_tick_t tick;
+
+  while (list_is_empty(&wheel->pending)) {
+    if (!mu_twheel_next_tick(wheel, &tick) || tick_follows(tick, now)) {
+      // Nothing left to do up to and including now.
+      if (!tick_follows(wheel->now, now)) {
+        wheel->now = now + 1;
+      }
+      return NULL;
+    }
+    // Skip directly to the next tick that needs servicing.
+    wheel->now = tick;
+    process_tick(wheel);
+  }
+
+  mu_twheel_node_t *node = (mu_twheel_node_t *)wheel->pending.next;
+  list_unlink(&node->link);
+  wheel->count -= 1;
+  return node;
+}
+
+// *****************************************************************************
+// Private (static) code
+
+static void list_init(mu_twheel_link_t *head) {
+  head->next = head;
+  head->prev = head;
+}
+
+static bool list_is_empty(mu_twheel_link_t *head) { return head->next == head; }
+
+static void list_append(mu_twheel_link_t *head, mu_twheel_link_t *link) {
+  link->prev = head->prev;
+  link->next = head;
+  head->prev->next = link;
+  head->prev = link;
+}
+
+static void list_unlink(mu_twheel_link_t *link) {
+  link->prev->next = link->next;
+  link->next->prev = link->prev;
+  link->next = NULL;
+  link->prev = NULL;
+}
+
+static bool tick_follows(mu_twheel_tick_t a, mu_twheel_tick_t b) {
+  return (int64_t)(a - b) > 0;
+}
+
+static uint64_t rotate_right(uint64_t word, unsigned int n) {
+  return n == 0 ? word : (word >> n) | (word << (64 - n));
+}
+
+static void file_node(mu_twheel_t *wheel, mu_twheel_node_t *node) {
+  mu_twheel_tick_t expires = node->expires;
+  int level;
+
+  if (tick_follows(wheel->now, expires)) {
+    // Already past due: hand it out on the next call to mu_twheel_expire().
+    node->slot = PENDING_SLOT;
+    list_append(&wheel->pending, &node->link);
+    return;
+  } else if (expires - wheel->now > MAX_DELTA) {
+    // Too far out to represent: park it as far out as possible.  It will be
+    // re-filed with its true expiration when it is cascaded.
+    expires = wheel->now + MAX_DELTA;
+  }
+
+  mu_twheel_tick_t delta = expires - wheel->now;
+  for (level = 0; level < MU_TWHEEL_LEVELS - 1; level++) {
+    if (delta < ((mu_twheel_tick_t)1 << LEVEL_SHIFT(level + 1))) {
+      break;
+    }
+  }
+  unsigned int index = (expires >> LEVEL_SHIFT(level)) & SLOT_MASK;
+  node->slot = level * MU_TWHEEL_SLOTS + index;
+  list_append(&wheel->slots[level][index], &node->link);
+  wheel->occupied[level] |= (uint64_t)1 << index;
+}
+
+static void cascade(mu_twheel_t *wheel, int level, unsigned int index) {
+  mu_twheel_link_t *head = &wheel->slots[level][index];
+  mu_twheel_link_t *link = head->next;
+
+  // Detach the whole list first: re-filed nodes never land back in this slot,
+  // but the list must be empty before any of them are appended elsewhere.
+  list_init(head);
+  wheel->occupied[level] &= ~((uint64_t)1 << index);
+
+  while (link != head) {
+    mu_twheel_link_t *next = link->next;
+    file_node(wheel, (mu_twheel_node_t *)link);
+    link = next;
+  }
+}
+
+static void process_tick(mu_twheel_t *wheel) {
+  mu_twheel_tick_t now = wheel->now;
+
+  // At the start of each block, pull the next slot of the level above down
+  // into the levels below, starting from the lowest level.
+  for (int level = 1; level < MU_TWHEEL_LEVELS; level++) {
+    if ((now & (((mu_twheel_tick_t)1 << LEVEL_SHIFT(level)) - 1)) != 0) {
+      break;
+    }
+    cascade(wheel, level, (now >> LEVEL_SHIFT(level)) & SLOT_MASK);
+  }
+
+  // Everything in the current level 0 slot has now expired.
+  unsigned int index = now & SLOT_MASK;
+  mu_twheel_link_t *head = &wheel->slots[0][index];
+  while (!list_is_empty(head)) {
+    mu_twheel_link_t *link = head->next;
+    list_unlink(link);
+    ((mu_twheel_node_t *)link)->slot = PENDING_SLOT;
+    list_append(&wheel->pending, link);
+  }
+  wheel->occupied[0] &= ~((uint64_t)1 << index);
+  wheel->now = now + 1;
+}
@@ -0,0 +1,174 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. D. Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file: mu_twheel.h
+ *
+ * @brief A hierarchical timing wheel of intrusive nodes.
+ *
+ * A twheel keeps MU_TWHEEL_LEVELS levels of MU_TWHEEL_SLOTS slots.  Level 0
+ * has one slot per tick, level 1 one slot per 64 ticks, and so on.  A node is
+ * filed in the level that matches how far in the future it expires and is
+ * moved ("cascaded") to a lower level as its expiration approaches.  Insert and
+ * remove are O(1), and each node is cascaded at most MU_TWHEEL_LEVELS-1 times.
+ * A per-level occupancy bitmap lets the wheel skip over empty slots, so idle
+ * stretches of time cost nothing.
+ *
+ * Times are measured in abstract ticks; it is up to the user to map ticks onto
+ * mu_time values.  Nodes that expire more than 2^24 ticks in the future are
+ * parked in the top level and re-filed as time advances.
+ */
+
+#ifndef _MU_TWHEEL_H_
+#define _MU_TWHEEL_H_
+
+// *****************************************************************************
+// Includes
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// *****************************************************************************
+// C++ Compatibility
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// Public types and definitions
+
+#define MU_TWHEEL_LEVELS 4
+#define MU_TWHEEL_SLOT_BITS 6
+#define MU_TWHEEL_SLOTS (1 << MU_TWHEEL_SLOT_BITS) // one bit per slot in a uint64
+
+typedef uint64_t mu_twheel_tick_t;
+
+// Doubly linked list pointers, used both in nodes and in slot heads.
+typedef struct _mu_twheel_link {
+  struct _mu_twheel_link *next;
+  struct _mu_twheel_link *prev;
+} mu_twheel_link_t;
+
+// A node is embedded in the user's structure.  Use MU_TASK_CTX() (or an
+// equivalent offsetof() trick) to get from the node to its container.
+typedef struct {
+  mu_twheel_link_t link;    // must be first.  next == NULL when not in a wheel
+  mu_twheel_tick_t expires; // tick at which the node expires
+  uint16_t slot;            // index into the slot table (or pending list)
+} mu_twheel_node_t;
+
+typedef struct {
+  mu_twheel_link_t slots[MU_TWHEEL_LEVELS][MU_TWHEEL_SLOTS];
+  uint64_t occupied[MU_TWHEEL_LEVELS]; // bit n set if slots[level][n] in use
+  mu_twheel_link_t pending;            // expired nodes not yet fetched
+  mu_twheel_tick_t now;                // next tick to be processed
+  size_t count;                        // number of nodes in the wheel
+} mu_twheel_t;
+
+// *****************************************************************************
+// Public declarations
+
+/**
+ * @brief Initialize a wheel, discarding any nodes it may have held.
+ *
+ * @param wheel The wheel to initialize.
+ * @param now The first tick to be processed.
+ * @return wheel
+ */
+mu_twheel_t *mu_twheel_init(mu_twheel_t *wheel, mu_twheel_tick_t now);
+
+/**
+ * @brief Initialize a node so it is recognized as not being in a wheel.
+ */
+mu_twheel_node_t *mu_twheel_node_init(mu_twheel_node_t *node);
+
+/**
+ * @brief Return true if the node is currently in a wheel.
+ */
+bool mu_twheel_node_is_linked(mu_twheel_node_t *node);
+
+/**
+ * @brief Return the tick at which the node expires.
+ */
+mu_twheel_tick_t mu_twheel_node_expires(mu_twheel_node_t *node);
+
+/**
+ * @brief Return the number of nodes in the wheel.
+ */
+size_t mu_twheel_count(mu_twheel_t *wheel);
+
+/**
+ * @brief Add a node to the wheel.  O(1).
+ *
+ * A node whose expiration tick has already been processed expires on the next
+ * call to mu_twheel_expire().  Nodes that expire on the same tick are fetched
+ * in the order in which they were inserted.
+ *
+ * Note: the node must not already be in a wheel.
+ */
+void mu_twheel_insert(mu_twheel_t *wheel, mu_twheel_node_t *node,
+                      mu_twheel_tick_t expires);
+
+/**
+ * @brief Remove a node from the wheel.  O(1).
+ *
+ * Note: if the node is not in a wheel, this has no effect.
+ */
+void mu_twheel_remove(mu_twheel_t *wheel, mu_twheel_node_t *node);
+
+/**
+ * @brief Find the next tick at which the wheel needs servicing.
+ *
+ * This is the earliest tick at which a node expires or must be cascaded to a
+ * lower level.  Calling mu_twheel_expire() before then does no work.
+ *
+ * @param wheel The wheel.
+ * @param tick Receives the tick if the wheel is non-empty.
+ * @return false if the wheel is empty, true otherwise.
+ */
+bool mu_twheel_next_tick(mu_twheel_t *wheel, mu_twheel_tick_t *tick);
+
+/**
+ * @brief Advance the wheel to now and fetch the next expired node.
+ *
+ * Call repeatedly until it returns NULL to process every node that expires at
+ * or before now.  The returned node has been removed from the wheel and may be
+ * re-inserted immediately.
+ *
+ * @param wheel The wheel.
+ * @param now The current tick.
+ * @return An expired node, or NULL if there are none.
+ */
+mu_twheel_node_t *mu_twheel_expire(mu_twheel_t *wheel, mu_twheel_tick_t now);
+
+// *****************************************************************************
+// End of file
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* #ifndef _MU_TWHEEL_H_ */
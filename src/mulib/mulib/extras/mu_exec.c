@@ -0,0 +1,530 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_exec.h"
+
+#include "mu_sched.h"
+#include "mu_task.h"
+#include "mu_time.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// *****************************************************************************
+// Private types and definitions
+
+// Tasks carry the lock that workers take before calling them.
+#ifndef MU_CONFIG_SCHED_EXEC
+#error "mu_exec requires MU_CONFIG_SCHED_EXEC"
+#endif
+
+// Upper bound on how long an idle worker sleeps before re-checking its
+// deferred queue.  Deferred tasks queued by other threads and clock sources
+// that don't track wall time are picked up within this interval.
+#define MAX_IDLE_NS 1000000
+
+// *****************************************************************************
+// Private (static) storage
+
+static mu_exec_t *volatile s_exec;
+
+// The worker running on this thread, NULL for non-worker threads.
+static _Thread_local mu_exec_worker_t *s_worker;
+
+// *****************************************************************************
+// Private (forward) declarations
+
+static void *worker_thread(void *arg);
+
+/**
+ * @brief Find the next task for the worker to run, or NULL if there is none.
+ */
+static mu_task_t *next_task(mu_exec_worker_t *worker);
+
+/**
+ * @brief Run a task while holding its lock.  Return false if another worker is
+ * already running the task.
+ */
+static bool run_task(mu_exec_worker_t *worker, mu_task_t *task);
+
+/**
+ * @brief Wait until there is (probably) work to do or a deferred task is due.
+ */
+static void idle_wait(mu_exec_worker_t *worker);
+
+/**
+ * @brief Wake one idle worker, if there are any.
+ */
+static void wake_worker(mu_exec_t *exec);
+
+// asap queue: a bounded FIFO.  Only the owning worker puts at the bottom; any
+// worker may take from the top.  top and bottom increase monotonically, so a
+// take that loses a race (or reads a slot that has since been reused) fails
+// its compare-and-swap on top and retries.
+static bool asap_put(mu_exec_worker_t *worker, mu_task_t *task);
+static mu_task_t *asap_take(mu_exec_worker_t *worker);
+static bool asap_is_empty(mu_exec_worker_t *worker);
+
+static mu_task_err_t inject_put(mu_exec_t *exec, mu_task_t *task);
+static mu_task_t *inject_take(mu_exec_t *exec);
+
+// deferred queue: a binary min-heap, called with deferred_lock held.
+static bool deferred_precedes(mu_exec_deferred_t *a, mu_exec_deferred_t *b);
+static void deferred_sift_up(mu_exec_worker_t *worker, size_t i);
+static void deferred_sift_down(mu_exec_worker_t *worker, size_t i);
+static void deferred_remove_at(mu_exec_worker_t *worker, size_t i);
+static mu_task_t *deferred_take_runnable(mu_exec_worker_t *worker,
+                                         mu_time_abs_t now);
+
+// *****************************************************************************
+// Public code
+
+mu_exec_worker_t *mu_exec_worker_init(mu_exec_worker_t *worker,
+                                      mu_task_t **asap_store,
+                                      size_t asap_capacity,
+                                      mu_exec_deferred_t *deferred_store,
+                                      size_t deferred_capacity) {
+    if ((asap_capacity == 0) || (asap_capacity & (asap_capacity - 1)) != 0) {
+        return NULL;
+    }
+    worker->top = 0;
+    worker->bottom = 0;
+    worker->asap_store = asap_store;
+    worker->asap_mask = asap_capacity - 1;
+    pthread_mutex_init(&worker->deferred_lock, NULL);
+    worker->deferred_store = deferred_store;
+    worker->deferred_capacity = deferred_capacity;
+    worker->deferred_count = 0;
+    worker->deferred_seq = 0;
+    worker->exec = NULL;
+    worker->curr_task = NULL;
+    worker->run_count = 0;
+    worker->steal_count = 0;
+    return worker;
+}
+
+mu_exec_t *mu_exec_init(mu_exec_t *exec, mu_exec_worker_t *workers,
+                        size_t n_workers, mu_task_t **inject_store,
+                        size_t inject_capacity) {
+    exec->workers = workers;
+    exec->n_workers = n_workers;
+    for (size_t i = 0; i < n_workers; i++) {
+        workers[i].exec = exec;
+    }
+    pthread_mutex_init(&exec->lock, NULL);
+    pthread_cond_init(&exec->work_available, NULL);
+    exec->inject_store = inject_store;
+    exec->inject_capacity = inject_capacity;
+    exec->inject_count = 0;
+    exec->inject_index = 0;
+    exec->next_worker = 0;
+    exec->n_sleeping = 0;
+    exec->stopping = false;
+    __atomic_store_n(&s_exec, exec, __ATOMIC_RELEASE);
+    return exec;
+}
+
+bool mu_exec_start(mu_exec_t *exec) {
+    for (size_t i = 0; i < exec->n_workers; i++) {
+        mu_exec_worker_t *worker = &exec->workers[i];
+        if (pthread_create(&worker->thread, NULL, worker_thread, worker) != 0) {
+            // Unwind the workers that did start.
+            exec->n_workers = i;
+            mu_exec_stop(exec);
+            return false;
+        }
+    }
+    return true;
+}
+
+void mu_exec_stop(mu_exec_t *exec) {
+    pthread_mutex_lock(&exec->lock);
+    __atomic_store_n(&exec->stopping, true, __ATOMIC_SEQ_CST);
+    pthread_cond_broadcast(&exec->work_available);
+    pthread_mutex_unlock(&exec->lock);
+
+    for (size_t i = 0; i < exec->n_workers; i++) {
+        pthread_join(exec->workers[i].thread, NULL);
+    }
+    __atomic_compare_exchange_n(&s_exec, &exec, NULL, false, __ATOMIC_SEQ_CST,
+                                __ATOMIC_SEQ_CST);
+}
+
+mu_exec_t *mu_exec_active(void) {
+    return __atomic_load_n(&s_exec, __ATOMIC_ACQUIRE);
+}
+
+mu_exec_worker_t *mu_exec_current_worker(void) { return s_worker; }
+
+mu_task_t *mu_exec_current_task(void) {
+    return s_worker ? s_worker->curr_task : NULL;
+}
+
+mu_task_err_t mu_exec_asap(mu_task_t *task) {
+    mu_exec_t *exec = mu_exec_active();
+    mu_exec_worker_t *worker = s_worker;
+
+    if (worker != NULL && worker->exec == exec) {
+        if (!asap_put(worker, task)) {
+            return MU_TASK_ERR_SCHED_FULL;
+        }
+        wake_worker(exec);
+        return MU_TASK_ERR_NONE;
+    } else {
+        return inject_put(exec, task);
+    }
+}
+
+mu_task_err_t mu_exec_defer_until(mu_task_t *task, mu_time_abs_t at) {
+    mu_exec_t *exec = mu_exec_active();
+    mu_exec_worker_t *worker = s_worker;
+    mu_task_err_t err = MU_TASK_ERR_NONE;
+
+    if (worker == NULL || worker->exec != exec) {
+        size_t i = __atomic_fetch_add(&exec->next_worker, 1, __ATOMIC_RELAXED);
+        worker = &exec->workers[i % exec->n_workers];
+    }
+
+    pthread_mutex_lock(&worker->deferred_lock);
+    if (worker->deferred_count == worker->deferred_capacity) {
+        err = MU_TASK_ERR_SCHED_FULL;
+    } else {
+        size_t i = worker->deferred_count;
+        __atomic_store_n(&worker->deferred_count, i + 1, __ATOMIC_RELAXED);
+        mu_exec_deferred_t *deferred = &worker->deferred_store[i];
+        deferred->at = at;
+        deferred->task = task;
+        deferred->seq = worker->deferred_seq++;
+        deferred_sift_up(worker, i);
+    }
+    pthread_mutex_unlock(&worker->deferred_lock);
+    return err;
+}
+
+mu_task_err_t mu_exec_remove_deferred_task(mu_task_t *task) {
+    mu_exec_t *exec = mu_exec_active();
+    mu_task_err_t err = MU_TASK_ERR_NOT_FOUND;
+
+    // A task that yields may be run by a different worker than the one that
+    // deferred it, so check every worker.
+    for (size_t w = 0; w < exec->n_workers; w++) {
+        mu_exec_worker_t *worker = &exec->workers[w];
+        pthread_mutex_lock(&worker->deferred_lock);
+        size_t i = 0;
+        while (i < worker->deferred_count) {
+            if (worker->deferred_store[i].task == task) {
+                deferred_remove_at(worker, i);
+                err = MU_TASK_ERR_NONE;
+            } else {
+                i += 1;
+            }
+        }
+        pthread_mutex_unlock(&worker->deferred_lock);
+    }
+    return err;
+}
+
+uint64_t mu_exec_worker_run_count(mu_exec_worker_t *worker) {
+    return __atomic_load_n(&worker->run_count, __ATOMIC_RELAXED);
+}
+
+uint64_t mu_exec_worker_steal_count(mu_exec_worker_t *worker) {
+    return __atomic_load_n(&worker->steal_count, __ATOMIC_RELAXED);
+}
+
+// *****************************************************************************
+// Private (static) code
+
+static void *worker_thread(void *arg) {
+    mu_exec_worker_t *worker = (mu_exec_worker_t *)arg;
+    mu_exec_t *exec = worker->exec;
+
+    s_worker = worker;
+    while (!__atomic_load_n(&exec->stopping, __ATOMIC_ACQUIRE)) {
+        mu_task_t *task = next_task(worker);
+        if (task == NULL) {
+            idle_wait(worker);
+        } else if (!run_task(worker, task)) {
+            // Another worker is running this task.  Requeue it behind any
+            // other work; if there is no room, wait for the other worker.
+            if (!asap_put(worker, task)) {
+                while (!run_task(worker, task)) {
+                    sched_yield();
+                }
+            }
+        }
+    }
+    s_worker = NULL;
+    return NULL;
+}
+
+static mu_task_t *next_task(mu_exec_worker_t *worker) {
+    mu_exec_t *exec = worker->exec;
+    mu_task_t *task;
+
+    // Deferred tasks whose time has arrived come first, as in mu_sched_step().
+    if ((task = deferred_take_runnable(worker, mu_sched_get_current_time()))) {
+        return task;
+    }
+    if ((task = asap_take(worker))) {
+        return task;
+    }
+    if ((task = inject_take(exec))) {
+        return task;
+    }
+    // Steal, starting with the worker after this one so that thieves spread
+    // out over their victims.
+    size_t self = worker - exec->workers;
+    for (size_t i = 1; i < exec->n_workers; i++) {
+        mu_exec_worker_t *victim = &exec->workers[(self + i) % exec->n_workers];
+        if ((task = asap_take(victim))) {
+            __atomic_fetch_add(&worker->steal_count, 1, __ATOMIC_RELAXED);
+            return task;
+        }
+    }
+    return NULL;
+}
+
+static bool run_task(mu_exec_worker_t *worker, mu_task_t *task) {
+    if (__atomic_exchange_n(&task->exec_lock, 1, __ATOMIC_ACQUIRE) != 0) {
+        return false;
+    }
+    worker->curr_task = task;
+    mu_task_call(task, NULL);
+    worker->curr_task = NULL;
+    __atomic_store_n(&task->exec_lock, 0, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&worker->run_count, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+static void idle_wait(mu_exec_worker_t *worker) {
+    mu_exec_t *exec = worker->exec;
+    long wait_ns = MAX_IDLE_NS;
+
+    pthread_mutex_lock(&worker->deferred_lock);
+    if (worker->deferred_count > 0) {
+        mu_time_rel_t dt = mu_time_difference(worker->deferred_store[0].at,
+                                              mu_sched_get_current_time());
+        if (dt <= 0) {
+            wait_ns = 0;
+        } else if (dt < MU_TIME_TICKS_PER_SECOND / 1000) {
+            wait_ns = (long)(dt * 1000000000LL / MU_TIME_TICKS_PER_SECOND);
+        }
+    }
+    pthread_mutex_unlock(&worker->deferred_lock);
+    if (wait_ns <= 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&exec->lock);
+    // Announce the intent to sleep before the final check for work: a thread
+    // that queues work after this point is guaranteed to see n_sleeping > 0
+    // and signal (see wake_worker()).
+    __atomic_fetch_add(&exec->n_sleeping, 1, __ATOMIC_SEQ_CST);
+    bool has_work = exec->inject_count > 0 ||
+                    __atomic_load_n(&exec->stopping, __ATOMIC_SEQ_CST);
+    for (size_t i = 0; !has_work && i < exec->n_workers; i++) {
+        has_work = !asap_is_empty(&exec->workers[i]);
+    }
+    if (!has_work) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += wait_ns;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&exec->work_available, &exec->lock, &deadline);
+    }
+    __atomic_fetch_sub(&exec->n_sleeping, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&exec->lock);
+}
+
+static void wake_worker(mu_exec_t *exec) {
+    if (__atomic_load_n(&exec->n_sleeping, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&exec->lock);
+        pthread_cond_signal(&exec->work_available);
+        pthread_mutex_unlock(&exec->lock);
+    }
+}
+
+static bool asap_put(mu_exec_worker_t *worker, mu_task_t *task) {
+    uint64_t bottom = __atomic_load_n(&worker->bottom, __ATOMIC_RELAXED);
+    uint64_t top = __atomic_load_n(&worker->top, __ATOMIC_ACQUIRE);
+
+    if (bottom - top > worker->asap_mask) {
+        return false;
+    }
+    __atomic_store_n(&worker->asap_store[bottom & worker->asap_mask], task,
+                     __ATOMIC_RELAXED);
+    // seq_cst pairs with the n_sleeping handshake in idle_wait().
+    __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_SEQ_CST);
+    return true;
+}
+
+static mu_task_t *asap_take(mu_exec_worker_t *worker) {
+    uint64_t top = __atomic_load_n(&worker->top, __ATOMIC_ACQUIRE);
+
+    while (true) {
+        uint64_t bottom = __atomic_load_n(&worker->bottom, __ATOMIC_ACQUIRE);
+        if (top >= bottom) {
+            return NULL;
+        }
+        mu_task_t *task = __atomic_load_n(
+            &worker->asap_store[top & worker->asap_mask], __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&worker->top, &top, top + 1, true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return task;
+        }
+        // Lost the race: top has been reloaded, try again.
+    }
+}
+
+static bool asap_is_empty(mu_exec_worker_t *worker) {
+    return __atomic_load_n(&worker->top, __ATOMIC_SEQ_CST) >=
+           __atomic_load_n(&worker->bottom, __ATOMIC_SEQ_CST);
+}
+
+static mu_task_err_t inject_put(mu_exec_t *exec, mu_task_t *task) {
+    mu_task_err_t err = MU_TASK_ERR_NONE;
+
+    pthread_mutex_lock(&exec->lock);
+    if (exec->inject_count == exec->inject_capacity) {
+        err = MU_TASK_ERR_SCHED_FULL;
+    } else {
+        size_t i = (exec->inject_index + exec->inject_count) %
+                   exec->inject_capacity;
+        exec->inject_store[i] = task;
+        __atomic_store_n(&exec->inject_count, exec->inject_count + 1,
+                         __ATOMIC_RELAXED);
+        if (exec->n_sleeping > 0) {
+            pthread_cond_signal(&exec->work_available);
+        }
+    }
+    pthread_mutex_unlock(&exec->lock);
+    return err;
+}
+
+static mu_task_t *inject_take(mu_exec_t *exec) {
+    mu_task_t *task = NULL;
+
+    // Cheap unlocked check first: the injection queue is usually empty.  The
+    // count is only modified with the lock held.
+    if (__atomic_load_n(&exec->inject_count, __ATOMIC_RELAXED) == 0) {
+        return NULL;
+    }
+    pthread_mutex_lock(&exec->lock);
+    if (exec->inject_count > 0) {
+        task = exec->inject_store[exec->inject_index];
+        exec->inject_index = (exec->inject_index + 1) % exec->inject_capacity;
+        __atomic_store_n(&exec->inject_count, exec->inject_count - 1,
+                         __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&exec->lock);
+    return task;
+}
+
+static bool deferred_precedes(mu_exec_deferred_t *a, mu_exec_deferred_t *b) {
+    if (mu_time_precedes(a->at, b->at)) {
+        return true;
+    } else if (mu_time_equals(a->at, b->at)) {
+        return (int32_t)(a->seq - b->seq) < 0;
+    } else {
+        return false;
+    }
+}
+
+static void deferred_sift_up(mu_exec_worker_t *worker, size_t i) {
+    mu_exec_deferred_t *store = worker->deferred_store;
+    mu_exec_deferred_t item = store[i];
+
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!deferred_precedes(&item, &store[parent])) {
+            break;
+        }
+        store[i] = store[parent];
+        i = parent;
+    }
+    store[i] = item;
+}
+
+static void deferred_sift_down(mu_exec_worker_t *worker, size_t i) {
+    mu_exec_deferred_t *store = worker->deferred_store;
+    size_t count = worker->deferred_count;
+    mu_exec_deferred_t item = store[i];
+
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= count) {
+            break;
+        }
+        if ((child + 1 < count) &&
+            deferred_precedes(&store[child + 1], &store[child])) {
+            child += 1;
+        }
+        if (!deferred_precedes(&store[child], &item)) {
+            break;
+        }
+        store[i] = store[child];
+        i = child;
+    }
+    store[i] = item;
+}
+
+static void deferred_remove_at(mu_exec_worker_t *worker, size_t i) {
+    size_t last = worker->deferred_count - 1;
+
+    __atomic_store_n(&worker->deferred_count, last, __ATOMIC_RELAXED);
+    if (i != last) {
+        worker->deferred_store[i] = worker->deferred_store[last];
+        deferred_sift_down(worker, i);
+        deferred_sift_up(worker, i);
+    }
+}
+
+static mu_task_t *deferred_take_runnable(mu_exec_worker_t *worker,
+                                         mu_time_abs_t now) {
+    mu_task_t *task = NULL;
+
+    // Cheap unlocked check first.  A stale zero only delays a task that was
+    // deferred by another thread until the next pass.
+    if (__atomic_load_n(&worker->deferred_count, __ATOMIC_RELAXED) == 0) {
+        return NULL;
+    }
+    pthread_mutex_lock(&worker->deferred_lock);
+    if (worker->deferred_count > 0 &&
+        !mu_time_precedes(now, worker->deferred_store[0].at)) {
+        task = worker->deferred_store[0].task;
+        deferred_remove_at(worker, 0);
+    }
+    pthread_mutex_unlock(&worker->deferred_lock);
+    return task;
+}
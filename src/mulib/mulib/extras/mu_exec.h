@@ -0,0 +1,226 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file: mu_exec.h
+ *
+ * @brief A multi-threaded, work-stealing executor for mu_tasks (POSIX hosts).
+ *
+ * mu_exec runs mu_tasks on N worker threads.  Each worker owns a FIFO queue of
+ * "asap" tasks and a queue of deferred tasks.  A worker that runs out of work
+ * takes tasks scheduled from other threads, then steals from other workers.
+ *
+ * When mulib is compiled with MU_CONFIG_SCHED_EXEC, the mu_sched_xxx() (and so
+ * mu_task_xxx()) scheduling calls are routed to the executor while one is
+ * active, so existing task code runs unchanged:
+ * - called from a worker, mu_task_yield() and friends queue on that worker.
+ * - called from any other thread, tasks are handed to the workers through a
+ *   shared, locked queue.  This includes mu_sched_from_isr().
+ *
+ * A task is never run by two workers at the same time: each worker holds a
+ * per-task lock while it runs the task.  Tasks that are invoked directly
+ * through mu_task_call() run in the caller's thread and are not covered.
+ *
+ * Notes:
+ * - Tasks queued on one worker run in FIFO order.  There is no ordering among
+ *   tasks queued on different workers.
+ * - mu_timer's MU_CONFIG_TIMER_WHEEL engine is single-threaded and may not be
+ *   used with the executor.
+ * - Like the rest of mulib, mu_exec never mallocs: all queues are supplied by
+ *   the caller.
+ */
+
+#ifndef _MU_EXEC_H_
+#define _MU_EXEC_H_
+
+// *****************************************************************************
+// Includes
+
+#include "mu_task.h"
+#include "mu_time.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// *****************************************************************************
+// C++ Compatibility
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// Public types and definitions
+
+#ifndef MU_EXEC_CACHE_LINE_SIZE
+#define MU_EXEC_CACHE_LINE_SIZE 64
+#endif
+
+// A deferred task, as held in a worker's deferred queue.
+typedef struct {
+    mu_time_abs_t at;
+    mu_task_t *task;
+    uint32_t seq; // insertion order: breaks ties between equal 'at' values
+} mu_exec_deferred_t;
+
+struct _mu_exec; // forward declaration
+
+typedef struct {
+    // asap queue.  Only the owning worker puts; any worker may take.
+    _Alignas(MU_EXEC_CACHE_LINE_SIZE) volatile uint64_t top; // next to take
+    _Alignas(MU_EXEC_CACHE_LINE_SIZE) volatile uint64_t bottom; // next to put
+    mu_task_t **asap_store;
+    size_t asap_mask;
+    // deferred queue (a binary min-heap), guarded by deferred_lock
+    pthread_mutex_t deferred_lock;
+    mu_exec_deferred_t *deferred_store;
+    size_t deferred_capacity;
+    size_t deferred_count;
+    uint32_t deferred_seq;
+    // bookkeeping
+    struct _mu_exec *exec;
+    pthread_t thread;
+    mu_task_t *curr_task;  // task currently being run by this worker
+    uint64_t run_count;    // number of tasks run
+    uint64_t steal_count;  // number of tasks stolen from other workers
+} mu_exec_worker_t;
+
+typedef struct _mu_exec {
+    mu_exec_worker_t *workers;
+    size_t n_workers;
+    // tasks scheduled from outside the workers, guarded by lock
+    pthread_mutex_t lock;
+    pthread_cond_t work_available;
+    mu_task_t **inject_store;
+    size_t inject_capacity;
+    size_t inject_count;
+    size_t inject_index;
+    volatile size_t next_worker; // round-robin target for outside deferrals
+    volatile int n_sleeping;     // number of workers waiting for work
+    volatile bool stopping;
+} mu_exec_t;
+
+// *****************************************************************************
+// Public declarations
+
+/**
+ * @brief Initialize a worker with its queues.
+ *
+ * @param worker The worker to initialize.
+ * @param asap_store Storage for the worker's asap queue.
+ * @param asap_capacity Number of slots in asap_store.  Must be a power of two.
+ * @param deferred_store Storage for the worker's deferred queue.
+ * @param deferred_capacity Number of slots in deferred_store.
+ * @return worker, or NULL if asap_capacity is not a power of two.
+ */
+mu_exec_worker_t *mu_exec_worker_init(mu_exec_worker_t *worker,
+                                      mu_task_t **asap_store,
+                                      size_t asap_capacity,
+                                      mu_exec_deferred_t *deferred_store,
+                                      size_t deferred_capacity);
+
+/**
+ * @brief Initialize an executor and make it the active executor.
+ *
+ * From this point until mu_exec_stop(), mu_sched routes scheduling calls to
+ * this executor, so tasks may be queued before the workers are started.
+ *
+ * @param exec The executor to initialize.
+ * @param workers An array of previously initialized workers.
+ * @param n_workers The number of workers.
+ * @param inject_store Storage for tasks scheduled from non-worker threads.
+ * @param inject_capacity Number of slots in inject_store.
+ * @return exec
+ */
+mu_exec_t *mu_exec_init(mu_exec_t *exec, mu_exec_worker_t *workers,
+                        size_t n_workers, mu_task_t **inject_store,
+                        size_t inject_capacity);
+
+/**
+ * @brief Start one thread per worker.
+ *
+ * @return true on success, false if a thread could not be created.
+ */
+bool mu_exec_start(mu_exec_t *exec);
+
+/**
+ * @brief Stop and join the worker threads and deactivate the executor.
+ *
+ * Tasks already running are allowed to complete.  Tasks still queued are
+ * abandoned.
+ */
+void mu_exec_stop(mu_exec_t *exec);
+
+/**
+ * @brief Return the active executor, or NULL if there is none.
+ */
+mu_exec_t *mu_exec_active(void);
+
+/**
+ * @brief Return the calling thread's worker, or NULL if not a worker thread.
+ */
+mu_exec_worker_t *mu_exec_current_worker(void);
+
+/**
+ * @brief Return the task being run by the calling worker, or NULL.
+ */
+mu_task_t *mu_exec_current_task(void);
+
+/**
+ * @brief Schedule a task to run as soon as possible on the active executor.
+ *
+ * From a worker thread the task is queued on that worker, otherwise it is
+ * queued for whichever worker gets to it first.  Thread safe.
+ */
+mu_task_err_t mu_exec_asap(mu_task_t *task);
+
+/**
+ * @brief Schedule a task to run at the given time on the active executor.
+ *
+ * From a worker thread the task is queued on that worker, otherwise the
+ * workers take turns.  Thread safe.
+ */
+mu_task_err_t mu_exec_defer_until(mu_task_t *task, mu_time_abs_t at);
+
+/**
+ * @brief Remove a deferred task from every worker's deferred queue.
+ */
+mu_task_err_t mu_exec_remove_deferred_task(mu_task_t *task);
+
+/**
+ * @brief Return the number of tasks run by the worker.
+ */
+uint64_t mu_exec_worker_run_count(mu_exec_worker_t *worker);
+
+/**
+ * @brief Return the number of tasks the worker stole from other workers.
+ */
+uint64_t mu_exec_worker_steal_count(mu_exec_worker_t *worker);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* #ifndef _MU_EXEC_H_ */
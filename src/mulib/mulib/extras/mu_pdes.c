@@ -0,0 +1,485 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+// *****************************************************************************
+// Includes
+
+#include "mu_pdes.h"
+
+#include "mu_sched.h"
+#include "mu_task.h"
+#include "mu_time.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// *****************************************************************************
+// Private types and definitions
+
+#define STRINGIFY(x) STRINGIFY_(x)
+#define STRINGIFY_(x) #x
+
+// Each LP's scheduler records that it is running in a static variable, which
+// must be private to each thread.
+_Static_assert(sizeof(STRINGIFY(MU_CONFIG_SCHED_THREAD_LOCAL)) > 1,
+               "mu_pdes requires MU_CONFIG_SCHED_THREAD_LOCAL _Thread_local");
+
+// A reusable barrier.  Unlike pthread_barrier_t, the number of threads can be
+// reduced while threads are waiting.
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t n_threads; // arrivals that complete a phase
+    size_t n_waiting; // arrivals so far in this phase
+    uint64_t phase;
+} barrier_t;
+
+typedef struct {
+    mu_pdes_t *pdes;
+    size_t k;           // runs LPs k, k + n_threads, ...
+    barrier_t *barrier; // shared by all threads of the run
+    pthread_t thread;
+} worker_t;
+
+// *****************************************************************************
+// Private (static) storage
+
+static mu_pdes_t *s_pdes;
+
+// The LP running on this thread, NULL if none.
+static _Thread_local mu_pdes_lp_t *s_lp;
+
+// *****************************************************************************
+// Private (forward) declarations
+
+/**
+ * @brief The clock source of every LP's scheduler.
+ *
+ * Outside of a task, e.g. while a simulation is being set up, this is the
+ * simulation's time.
+ */
+static mu_time_abs_t lp_clock(void);
+
+/**
+ * @brief Call the receivers of the LP's messages that have arrived.
+ */
+static void inbox_task_fn(mu_task_t *task, void *arg);
+
+static void *worker_thread(void *arg);
+
+/**
+ * @brief Wait until n_threads threads have called barrier_wait().
+ */
+static void barrier_wait(barrier_t *barrier);
+
+/**
+ * @brief Run rounds until the run is complete.  Worker 0 plans each round and
+ * delivers its messages while the others wait.
+ */
+static void run_rounds(worker_t *worker);
+
+/**
+ * @brief Find the earliest pending event and set the window of the next
+ * round, or set stopping if there is nothing left to do before end.
+ *
+ * If from_now is true, the window starts no later than the current time, so
+ * that tasks queued while the LPs were stopped get to run.
+ */
+static void plan_round(mu_pdes_t *pdes, bool from_now);
+
+/**
+ * @brief Run the LP's tasks that are due before the end of the window.
+ */
+static void run_lp(mu_pdes_lp_t *lp);
+
+/**
+ * @brief Move the messages sent in this round to their receivers' inboxes.
+ *
+ * LPs and outboxes are visited in order, so the result does not depend on
+ * which threads ran the round.
+ */
+static void deliver(mu_pdes_t *pdes);
+
+static bool msg_precedes(const mu_pdes_msg_t *a, const mu_pdes_msg_t *b);
+
+static void inbox_sift_up(mu_pdes_lp_t *lp, size_t i);
+
+static void inbox_sift_down(mu_pdes_lp_t *lp, size_t i);
+
+// *****************************************************************************
+// Public code
+
+mu_pdes_lp_t *mu_pdes_lp_init(mu_pdes_lp_t *lp, mu_sched_t *sched,
+                              mu_pdes_msg_t *inbox_store,
+                              size_t inbox_capacity,
+                              mu_pdes_msg_t *outbox_store,
+                              size_t outbox_capacity) {
+    lp->sched = sched;
+    lp->now = 0;
+    mu_task_init(&lp->inbox_task, inbox_task_fn, 0, NULL);
+    lp->inbox = inbox_store;
+    lp->inbox_capacity = inbox_capacity;
+    lp->inbox_count = 0;
+    lp->outbox = outbox_store;
+    lp->outbox_capacity = outbox_capacity;
+    lp->outbox_count = 0;
+    lp->received = false;
+    lp->index = 0;
+    lp->seq = 0;
+    lp->run_count = 0;
+    lp->drop_count = 0;
+    lp->pdes = NULL;
+    mu_sched_inst_set_clock_source(sched, lp_clock);
+    return lp;
+}
+
+mu_pdes_t *mu_pdes_init(mu_pdes_t *pdes, mu_pdes_lp_t *lps, size_t n_lps,
+                        mu_time_rel_t lookahead, mu_time_abs_t start) {
+    if (lookahead <= 0) {
+        return NULL;
+    }
+    pdes->lps = lps;
+    pdes->n_lps = n_lps;
+    pdes->lookahead = lookahead;
+    pdes->now = start;
+    pdes->window_end = start;
+    pdes->end = start;
+    pdes->n_threads = 1;
+    pdes->stopping = false;
+    pdes->round_count = 0;
+    for (size_t i = 0; i < n_lps; i++) {
+        lps[i].now = start;
+        lps[i].index = (uint32_t)i;
+        lps[i].pdes = pdes;
+    }
+    s_pdes = pdes;
+    return pdes;
+}
+
+size_t mu_pdes_run_until(mu_pdes_t *pdes, mu_time_abs_t end,
+                         size_t n_threads) {
+    worker_t workers[MU_PDES_MAX_THREADS];
+    barrier_t barrier;
+    uint64_t count = 0;
+    size_t started = 1;
+
+    if (n_threads > MU_PDES_MAX_THREADS) {
+        n_threads = MU_PDES_MAX_THREADS;
+    }
+    if (n_threads > pdes->n_lps) {
+        n_threads = pdes->n_lps;
+    }
+    if (n_threads < 1) {
+        n_threads = 1;
+    }
+    for (size_t i = 0; i < pdes->n_lps; i++) {
+        count -= pdes->lps[i].run_count;
+    }
+
+    s_pdes = pdes;
+    pdes->end = end;
+    pdes->n_threads = n_threads;
+    pthread_mutex_init(&barrier.lock, NULL);
+    pthread_cond_init(&barrier.cond, NULL);
+    barrier.n_threads = n_threads;
+    barrier.n_waiting = 0;
+    barrier.phase = 0;
+    for (size_t k = 0; k < n_threads; k++) {
+        workers[k].pdes = pdes;
+        workers[k].k = k;
+        workers[k].barrier = &barrier;
+    }
+    for (; started < n_threads; started++) {
+        if (pthread_create(&workers[started].thread, NULL, worker_thread,
+                           &workers[started]) != 0) {
+            break;
+        }
+    }
+    if (started == n_threads) {
+        run_rounds(&workers[0]);
+    } else {
+        // Release the threads that did start from their first barrier.
+        pthread_mutex_lock(&barrier.lock);
+        barrier.n_threads = started;
+        pthread_mutex_unlock(&barrier.lock);
+        pdes->stopping = true;
+        barrier_wait(&barrier);
+    }
+    for (size_t k = 1; k < started; k++) {
+        pthread_join(workers[k].thread, NULL);
+    }
+    pthread_cond_destroy(&barrier.cond);
+    pthread_mutex_destroy(&barrier.lock);
+    if (started < n_threads) {
+        return 0;
+    }
+
+    pdes->now = end;
+    for (size_t i = 0; i < pdes->n_lps; i++) {
+        mu_pdes_lp_t *lp = &pdes->lps[i];
+        if (mu_time_follows(end, lp->now)) {
+            lp->now = end;
+        }
+        count += lp->run_count;
+    }
+    return (size_t)count;
+}
+
+mu_pdes_err_t mu_pdes_send(mu_pdes_lp_t *dst, mu_task_t *task,
+                           mu_time_rel_t latency, uintptr_t data) {
+    mu_pdes_lp_t *lp = s_lp;
+    if (lp == NULL) {
+        return MU_PDES_ERR_NOT_IN_LP;
+    }
+    if (latency < lp->pdes->lookahead) {
+        return MU_PDES_ERR_LATENCY;
+    }
+    if (lp->outbox_count == lp->outbox_capacity) {
+        return MU_PDES_ERR_FULL;
+    }
+    mu_pdes_msg_t *msg = &lp->outbox[lp->outbox_count++];
+    msg->at = mu_time_offset(lp->now, latency);
+    msg->src = lp->index;
+    msg->seq = lp->seq++;
+    msg->dst = dst;
+    msg->task = task;
+    msg->data = data;
+    return MU_PDES_ERR_NONE;
+}
+
+mu_pdes_lp_t *mu_pdes_current_lp(void) { return s_lp; }
+
+mu_time_abs_t mu_pdes_lp_now(mu_pdes_lp_t *lp) { return lp->now; }
+
+mu_sched_t *mu_pdes_lp_sched(mu_pdes_lp_t *lp) { return lp->sched; }
+
+uint64_t mu_pdes_lp_run_count(mu_pdes_lp_t *lp) { return lp->run_count; }
+
+uint64_t mu_pdes_lp_drop_count(mu_pdes_lp_t *lp) { return lp->drop_count; }
+
+uint64_t mu_pdes_round_count(mu_pdes_t *pdes) { return pdes->round_count; }
+
+// *****************************************************************************
+// Private (static) code
+
+static mu_time_abs_t lp_clock(void) {
+    mu_pdes_lp_t *lp = s_lp;
+    if (lp != NULL) {
+        return lp->now;
+    }
+    return s_pdes ? s_pdes->now : 0;
+}
+
+static void inbox_task_fn(mu_task_t *task, void *arg) {
+    (void)arg;
+    mu_pdes_lp_t *lp = MU_TASK_CTX(task, mu_pdes_lp_t, inbox_task);
+
+    // The inbox task itself is counted by the scheduler: count it as the
+    // first message.
+    lp->run_count -= 1;
+    while (lp->inbox_count > 0 &&
+           !mu_time_follows(lp->inbox[0].at, lp->now)) {
+        mu_pdes_msg_t msg = lp->inbox[0];
+        lp->inbox[0] = lp->inbox[--lp->inbox_count];
+        inbox_sift_down(lp, 0);
+        lp->run_count += 1;
+        mu_task_call(msg.task, &msg);
+    }
+    if (lp->inbox_count > 0) {
+        mu_sched_inst_defer_until(lp->sched, task, lp->inbox[0].at);
+    }
+}
+
+static void *worker_thread(void *arg) {
+    run_rounds((worker_t *)arg);
+    return NULL;
+}
+
+static void barrier_wait(barrier_t *barrier) {
+    pthread_mutex_lock(&barrier->lock);
+    uint64_t phase = barrier->phase;
+    if (++barrier->n_waiting >= barrier->n_threads) {
+        barrier->n_waiting = 0;
+        barrier->phase += 1;
+        pthread_cond_broadcast(&barrier->cond);
+    } else {
+        while (barrier->phase == phase) {
+            pthread_cond_wait(&barrier->cond, &barrier->lock);
+        }
+    }
+    pthread_mutex_unlock(&barrier->lock);
+}
+
+static void run_rounds(worker_t *worker) {
+    mu_pdes_t *pdes = worker->pdes;
+    bool first = true;
+
+    while (true) {
+        if (worker->k == 0) {
+            plan_round(pdes, first);
+        }
+        first = false;
+        barrier_wait(worker->barrier);
+        if (pdes->stopping) {
+            break;
+        }
+        for (size_t i = worker->k; i < pdes->n_lps; i += pdes->n_threads) {
+            run_lp(&pdes->lps[i]);
+        }
+        barrier_wait(worker->barrier);
+        if (worker->k == 0) {
+            deliver(pdes);
+            pdes->round_count += 1;
+        }
+    }
+}
+
+static void plan_round(mu_pdes_t *pdes, bool from_now) {
+    bool found = from_now;
+    mu_time_abs_t t_min = pdes->now;
+
+    for (size_t i = 0; i < pdes->n_lps; i++) {
+        mu_pdes_lp_t *lp = &pdes->lps[i];
+        mu_time_abs_t at;
+        if (mu_sched_inst_next_deadline(lp->sched, &at)) {
+            if (mu_time_precedes(at, lp->now)) {
+                at = lp->now; // overdue: runs as soon as the LP runs
+            }
+            if (!found || mu_time_precedes(at, t_min)) {
+                t_min = at;
+                found = true;
+            }
+        }
+    }
+    if (!found || mu_time_follows(t_min, pdes->end)) {
+        pdes->stopping = true;
+        return;
+    }
+    // Any message sent from now on is sent at t_min or later, so it cannot
+    // arrive before t_min + lookahead.
+    if (mu_time_follows(t_min, pdes->now)) {
+        pdes->now = t_min;
+    }
+    pdes->window_end = mu_time_offset(t_min, pdes->lookahead);
+    pdes->stopping = false;
+}
+
+static void run_lp(mu_pdes_lp_t *lp) {
+    mu_pdes_t *pdes = lp->pdes;
+    mu_time_abs_t at;
+
+    s_lp = lp;
+    while (true) {
+        int n = mu_sched_inst_drain(lp->sched);
+        if (n > 0) {
+            lp->run_count += n;
+        } else if (mu_sched_inst_next_deadline(lp->sched, &at) &&
+                   mu_time_precedes(at, pdes->window_end) &&
+                   !mu_time_follows(at, pdes->end)) {
+            // Nothing is runnable now: skip ahead to the next deadline.
+            if (mu_time_follows(at, lp->now)) {
+                lp->now = at;
+            }
+        } else {
+            break;
+        }
+    }
+    s_lp = NULL;
+}
+
+static void deliver(mu_pdes_t *pdes) {
+    for (size_t i = 0; i < pdes->n_lps; i++) {
+        mu_pdes_lp_t *src = &pdes->lps[i];
+        for (size_t j = 0; j < src->outbox_count; j++) {
+            mu_pdes_msg_t *msg = &src->outbox[j];
+            mu_pdes_lp_t *dst = msg->dst;
+            if (dst->inbox_count == dst->inbox_capacity) {
+                dst->drop_count += 1;
+                continue;
+            }
+            dst->inbox[dst->inbox_count] = *msg;
+            inbox_sift_up(dst, dst->inbox_count++);
+            dst->received = true;
+        }
+        src->outbox_count = 0;
+    }
+    for (size_t i = 0; i < pdes->n_lps; i++) {
+        mu_pdes_lp_t *lp = &pdes->lps[i];
+        if (lp->received) {
+            lp->received = false;
+            mu_sched_inst_remove_deferred_task(lp->sched, &lp->inbox_task);
+            mu_sched_inst_defer_until(lp->sched, &lp->inbox_task,
+                                      lp->inbox[0].at);
+        }
+    }
+}
+
+static bool msg_precedes(const mu_pdes_msg_t *a, const mu_pdes_msg_t *b) {
+    if (a->at != b->at) {
+        return mu_time_precedes(a->at, b->at);
+    }
+    if (a->src != b->src) {
+        return a->src < b->src;
+    }
+    return a->seq < b->seq;
+}
+
+static void inbox_sift_up(mu_pdes_lp_t *lp, size_t i) {
+    mu_pdes_msg_t msg = lp->inbox[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!msg_precedes(&msg, &lp->inbox[parent])) {
+            break;
+        }
+        lp->inbox[i] = lp->inbox[parent];
+        i = parent;
+    }
+    lp->inbox[i] = msg;
+}
+
+static void inbox_sift_down(mu_pdes_lp_t *lp, size_t i) {
+    size_t n = lp->inbox_count;
+    if (n == 0) {
+        return;
+    }
+    mu_pdes_msg_t msg = lp->inbox[i];
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= n) {
+            break;
+        }
+        if (child + 1 < n &&
+            msg_precedes(&lp->inbox[child + 1], &lp->inbox[child])) {
+            child += 1;
+        }
+        if (!msg_precedes(&lp->inbox[child], &msg)) {
+            break;
+        }
+        lp->inbox[i] = lp->inbox[child];
+        i = child;
+    }
+    lp->inbox[i] = msg;
+}
@@ -0,0 +1,241 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file: mu_pdes.h
+ *
+ * @brief Parallel discrete-event simulation: run groups of mu_tasks in virtual
+ * time on several threads (POSIX hosts).
+ *
+ * mu_sim runs a whole simulation on one scheduler and so on one core.  mu_pdes
+ * splits it into logical processes (LPs), e.g. one per simulated device or
+ * building.  Each LP has its own scheduler and its own virtual clock, and LPs
+ * interact only by sending each other messages with mu_pdes_send().  The LPs
+ * are divided among worker threads.
+ *
+ * Synchronization is conservative: no LP ever runs a task out of time order.
+ * Every message takes at least the lookahead time to arrive, so the LPs run in
+ * rounds.  Each round finds T, the earliest pending event of any LP, and lets
+ * every LP run all its tasks due before T + lookahead in parallel, since no
+ * message sent in the round can arrive before then.  Between rounds, messages
+ * are delivered.  For a network simulation, the lookahead is the minimum
+ * latency of any link between LPs: the larger it is, the more work each round
+ * does.
+ *
+ *    mu_pdes_init(&pdes, lps, N_LPS, MIN_LINK_LATENCY, 0);
+ *    my_campus_init();   // schedules tasks on each LP's scheduler
+ *    mu_pdes_run_until(&pdes, ONE_DAY, 8);
+ *
+ * Results are deterministic and do not depend on the number of threads:
+ * messages that reach an LP at the same time are handled in the order of
+ * their senders' indices, then in the order they were sent.
+ *
+ * Notes:
+ * - mulib must be compiled with MU_CONFIG_SCHED_THREAD_LOCAL as _Thread_local.
+ * - Tasks of one LP must not touch the state of another LP: send a message.
+ *   Shared read-only data is fine.
+ * - Within a task, mu_sched_xxx() calls (and so mu_task_yield() and friends)
+ *   use the LP's scheduler and clock.
+ * - mu_timer's MU_CONFIG_TIMER_WHEEL engine serves only one scheduler and may
+ *   not be used by LP tasks.
+ * - Only one mu_pdes may run at a time.
+ * - Like the rest of mulib, mu_pdes never mallocs: all storage is supplied by
+ *   the caller.
+ */
+
+#ifndef _MU_PDES_H_
+#define _MU_PDES_H_
+
+// *****************************************************************************
+// Includes
+
+#include "mu_sched.h"
+#include "mu_task.h"
+#include "mu_time.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// *****************************************************************************
+// C++ Compatibility
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// Public types and definitions
+
+// The most worker threads mu_pdes_run_until() will use.
+#ifndef MU_PDES_MAX_THREADS
+#define MU_PDES_MAX_THREADS 64
+#endif
+
+typedef enum {
+    MU_PDES_ERR_NONE,
+    MU_PDES_ERR_FULL,      // the sending LP's outbox is full
+    MU_PDES_ERR_LATENCY,   // latency is less than the lookahead
+    MU_PDES_ERR_NOT_IN_LP, // not called from a task run by mu_pdes
+} mu_pdes_err_t;
+
+struct _mu_pdes;    // forward declaration
+struct _mu_pdes_lp; // forward declaration
+
+// A message between LPs.  The receiving task is called with a pointer to the
+// message as its arg; the message is valid only for the duration of the call.
+typedef struct {
+    mu_time_abs_t at;  // arrival time
+    uint32_t src;      // index of the sending LP
+    uint32_t seq;      // sent by src before this one: orders src's messages
+    struct _mu_pdes_lp *dst; // the receiving LP
+    mu_task_t *task;   // the task to call in dst
+    uintptr_t data;    // user-supplied data
+} mu_pdes_msg_t;
+
+// A logical process.  Treat as opaque.
+typedef struct _mu_pdes_lp {
+    mu_sched_t *sched;       // the LP's scheduler
+    mu_time_abs_t now;       // the LP's virtual time
+    mu_task_t inbox_task;    // calls the receivers of messages as they arrive
+    mu_pdes_msg_t *inbox;    // messages received: a min-heap by (at, src, seq)
+    size_t inbox_capacity;
+    size_t inbox_count;
+    mu_pdes_msg_t *outbox;   // messages sent in the current round
+    size_t outbox_capacity;
+    size_t outbox_count;
+    bool received;           // true if messages were delivered this round
+    uint32_t index;          // position in the mu_pdes's array of LPs
+    uint32_t seq;            // number of messages sent
+    uint64_t run_count;      // number of tasks (including messages) run
+    uint64_t drop_count;     // messages lost to a full inbox
+    struct _mu_pdes *pdes;
+} mu_pdes_lp_t;
+
+typedef struct _mu_pdes {
+    mu_pdes_lp_t *lps;
+    size_t n_lps;
+    mu_time_rel_t lookahead;  // the least latency of any message
+    mu_time_abs_t now;        // no LP has an event before this time
+    mu_time_abs_t window_end; // LPs run tasks due before this time...
+    mu_time_abs_t end;        // ...and not after this one
+    size_t n_threads;         // threads used by the current run
+    bool stopping;            // set when the current run is complete
+    uint64_t round_count;     // number of rounds run
+} mu_pdes_t;
+
+// *****************************************************************************
+// Public declarations
+
+/**
+ * @brief Initialize an LP.
+ *
+ * @param lp The LP to initialize.
+ * @param sched A previously initialized scheduler for the LP's tasks.  Its
+ * clock source is replaced by the LP's virtual clock.
+ * @param inbox_store Storage for messages waiting to be received.
+ * @param inbox_capacity Number of messages in inbox_store.
+ * @param outbox_store Storage for messages sent by the LP in one round.
+ * @param outbox_capacity Number of messages in outbox_store.
+ * @return lp
+ */
+mu_pdes_lp_t *mu_pdes_lp_init(mu_pdes_lp_t *lp, mu_sched_t *sched,
+                              mu_pdes_msg_t *inbox_store,
+                              size_t inbox_capacity,
+                              mu_pdes_msg_t *outbox_store,
+                              size_t outbox_capacity);
+
+/**
+ * @brief Initialize a simulation and set every LP's virtual time to start.
+ *
+ * Tasks may then be scheduled on each LP's scheduler with the
+ * mu_sched_inst_xxx() functions.
+ *
+ * @param pdes The simulation to initialize.
+ * @param lps An array of previously initialized LPs.
+ * @param n_lps The number of LPs.
+ * @param lookahead The least latency of any message.  Must be positive.
+ * @param start The starting virtual time.
+ * @return pdes, or NULL if lookahead is not positive.
+ */
+mu_pdes_t *mu_pdes_init(mu_pdes_t *pdes, mu_pdes_lp_t *lps, size_t n_lps,
+                        mu_time_rel_t lookahead, mu_time_abs_t start);
+
+/**
+ * @brief Run the LPs on n_threads threads (including the calling thread) until
+ * virtual time reaches end.
+ *
+ * Tasks due at end are run.  Every LP's virtual time is left at end.
+ *
+ * @return The number of tasks run, counting each message received as a task,
+ * or 0 if a thread could not be created.
+ */
+size_t mu_pdes_run_until(mu_pdes_t *pdes, mu_time_abs_t end,
+                         size_t n_threads);
+
+/**
+ * @brief Send a message from the calling task's LP to dst.
+ *
+ * The message arrives at the current virtual time plus latency, when task is
+ * called in dst with the message as its arg.
+ */
+mu_pdes_err_t mu_pdes_send(mu_pdes_lp_t *dst, mu_task_t *task,
+                           mu_time_rel_t latency, uintptr_t data);
+
+/**
+ * @brief Return the LP running the calling task, or NULL if none.
+ */
+mu_pdes_lp_t *mu_pdes_current_lp(void);
+
+/**
+ * @brief Return the LP's virtual time.
+ */
+mu_time_abs_t mu_pdes_lp_now(mu_pdes_lp_t *lp);
+
+/**
+ * @brief Return the LP's scheduler.
+ */
+mu_sched_t *mu_pdes_lp_sched(mu_pdes_lp_t *lp);
+
+/**
+ * @brief Return the number of tasks the LP has run, counting each message
+ * received as a task.
+ */
+uint64_t mu_pdes_lp_run_count(mu_pdes_lp_t *lp);
+
+/**
+ * @brief Return the number of messages to the LP lost to a full inbox.
+ */
+uint64_t mu_pdes_lp_drop_count(mu_pdes_lp_t *lp);
+
+/**
+ * @brief Return the number of rounds run since mu_pdes_init().
+ */
+uint64_t mu_pdes_round_count(mu_pdes_t *pdes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* #ifndef _MU_PDES_H_ */
@@ -0,0 +1,219 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+// *****************************************************************************
+// Includes
+
+#include "mu_poll.h"
+
+#include "mu_sched.h"
+#include "mu_task.h"
+#include "mu_time.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+// *****************************************************************************
+// Private types and definitions
+
+typedef struct {
+    int fd;          // -1 if the slot is free
+    mu_task_t *task; // scheduled when fd is readable
+} poll_fd_t;
+
+typedef struct {
+    int epoll_fd;
+    int timer_fd;
+    int wake_fd;
+    poll_fd_t fds[MU_CONFIG_POLL_MAX_FDS];
+    mu_task_t idle_task;
+} mu_poll_t;
+
+// epoll_event.data.ptr tags for the timerfd and eventfd.
+#define TIMER_TAG ((void *)&s_poll.timer_fd)
+#define WAKE_TAG ((void *)&s_poll.wake_fd)
+
+// *****************************************************************************
+// Private (static) storage
+
+static mu_poll_t s_poll = {.epoll_fd = -1, .timer_fd = -1, .wake_fd = -1};
+
+// *****************************************************************************
+// Private (forward) declarations
+
+static void idle_task_fn(mu_task_t *task, void *arg);
+
+/**
+ * @brief Watch fd for input, tagging its events with ptr.
+ */
+static bool watch(int fd, void *ptr);
+
+/**
+ * @brief Read and discard the 8 byte counter of a timerfd or eventfd.
+ */
+static void drain_counter(int fd);
+
+static struct timespec rel_to_timespec(mu_time_rel_t dt);
+
+// *****************************************************************************
+// Public code
+
+bool mu_poll_init(void) {
+    for (int i = 0; i < MU_CONFIG_POLL_MAX_FDS; i++) {
+        s_poll.fds[i].fd = -1;
+        s_poll.fds[i].task = NULL;
+    }
+    mu_task_init(&s_poll.idle_task, idle_task_fn, 0, NULL);
+
+    s_poll.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    s_poll.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    s_poll.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (s_poll.epoll_fd < 0 || s_poll.timer_fd < 0 || s_poll.wake_fd < 0 ||
+        !watch(s_poll.timer_fd, TIMER_TAG) || !watch(s_poll.wake_fd, WAKE_TAG)) {
+        mu_poll_deinit();
+        return false;
+    }
+    mu_sched_set_wakeup_fn(mu_poll_wake);
+    return true;
+}
+
+void mu_poll_deinit(void) {
+    mu_sched_set_wakeup_fn(NULL);
+    if (s_poll.epoll_fd >= 0) {
+        close(s_poll.epoll_fd);
+        s_poll.epoll_fd = -1;
+    }
+    if (s_poll.timer_fd >= 0) {
+        close(s_poll.timer_fd);
+        s_poll.timer_fd = -1;
+    }
+    if (s_poll.wake_fd >= 0) {
+        close(s_poll.wake_fd);
+        s_poll.wake_fd = -1;
+    }
+}
+
+bool mu_poll_add_fd(int fd, mu_task_t *task) {
+    for (int i = 0; i < MU_CONFIG_POLL_MAX_FDS; i++) {
+        poll_fd_t *entry = &s_poll.fds[i];
+        if (entry->fd < 0) {
+            if (!watch(fd, entry)) {
+                return false;
+            }
+            entry->fd = fd;
+            entry->task = task;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool mu_poll_remove_fd(int fd) {
+    for (int i = 0; i < MU_CONFIG_POLL_MAX_FDS; i++) {
+        poll_fd_t *entry = &s_poll.fds[i];
+        if (entry->fd == fd) {
+            epoll_ctl(s_poll.epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+            entry->fd = -1;
+            entry->task = NULL;
+            return true;
+        }
+    }
+    return false;
+}
+
+void mu_poll_wait(void) {
+    struct itimerspec its = {0}; // all zeros disarms the timer
+    struct epoll_event events[MU_CONFIG_POLL_MAX_FDS + 2];
+    mu_time_abs_t at;
+
+    if (mu_sched_next_deadline(&at)) {
+        mu_time_rel_t dt = mu_time_difference(at, mu_sched_get_current_time());
+        if (dt <= 0) {
+            // Already due: nothing to wait for.
+            return;
+        }
+        its.it_value = rel_to_timespec(dt);
+    }
+    timerfd_settime(s_poll.timer_fd, 0, &its, NULL);
+
+    int n = epoll_wait(s_poll.epoll_fd, events,
+                       sizeof(events) / sizeof(events[0]), -1);
+    for (int i = 0; i < n; i++) {
+        void *ptr = events[i].data.ptr;
+        if (ptr == TIMER_TAG) {
+            drain_counter(s_poll.timer_fd);
+        } else if (ptr == WAKE_TAG) {
+            drain_counter(s_poll.wake_fd);
+        } else {
+            mu_sched_asap(((poll_fd_t *)ptr)->task);
+        }
+    }
+}
+
+void mu_poll_wake(void) {
+    uint64_t one = 1;
+    // Only fails if the counter would overflow, i.e. a wakeup is pending.
+    ssize_t n = write(s_poll.wake_fd, &one, sizeof(one));
+    (void)n;
+}
+
+mu_task_t *mu_poll_idle_task(void) { return &s_poll.idle_task; }
+
+// *****************************************************************************
+// Private (static) code
+
+static void idle_task_fn(mu_task_t *task, void *arg) {
+    (void)task;
+    (void)arg;
+    mu_poll_wait();
+}
+
+static bool watch(int fd, void *ptr) {
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = ptr};
+    return epoll_ctl(s_poll.epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+static void drain_counter(int fd) {
+    uint64_t count;
+    // Fails with EAGAIN if already drained, which is fine.
+    ssize_t n = read(fd, &count, sizeof(count));
+    (void)n;
+}
+
+static struct timespec rel_to_timespec(mu_time_rel_t dt) {
+    struct timespec ts;
+    ts.tv_sec = dt / MU_TIME_TICKS_PER_SECOND;
+    ts.tv_nsec = (long)((dt % MU_TIME_TICKS_PER_SECOND) * 1000000000LL /
+                        MU_TIME_TICKS_PER_SECOND);
+    if (ts.tv_sec == 0 && ts.tv_nsec == 0) {
+        ts.tv_nsec = 1; // a zero it_value would disarm the timer
+    }
+    return ts;
+}
@@ -0,0 +1,143 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file: mu_poll.h
+ *
+ * @brief Tickless, blocking idle for mu_sched on Linux hosts.
+ *
+ * mu_poll lets a host program sleep whenever mu_sched has nothing to run.  It
+ * blocks in epoll_wait() until one of the following happens:
+ * - the next deferred task is due (tracked with a timerfd),
+ * - a registered file descriptor becomes readable, or
+ * - another thread calls mu_sched_from_isr() (signalled through an eventfd).
+ *
+ * When a registered file descriptor becomes readable, its task is scheduled
+ * with mu_sched_asap().  The descriptor is level triggered, so the task must
+ * read from it (or remove it) or it will be scheduled again.
+ *
+ * Use it either as the scheduler's idle task:
+ *
+ *    mu_sched_init();
+ *    mu_poll_init();
+ *    mu_sched_set_idle_task(mu_poll_idle_task());
+ *    while (true) {
+ *        mu_sched_step();
+ *    }
+ *
+ * ...or with batches:
+ *
+ *    while (true) {
+ *        if (mu_sched_drain() == 0) {
+ *            mu_poll_wait();
+ *        }
+ *    }
+ *
+ * Note: deadlines are converted to a relative sleep, so the scheduler's clock
+ * source must track wall-clock time.  A clock source that measures CPU time,
+ * such as clock(), does not advance while the process sleeps.
+ */
+
+#ifndef _MU_POLL_H_
+#define _MU_POLL_H_
+
+// *****************************************************************************
+// Includes
+
+#include "mu_config.h"
+#include "mu_task.h"
+#include <stdbool.h>
+
+// *****************************************************************************
+// C++ Compatibility
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// Public types and definitions
+
+#ifndef MU_CONFIG_POLL_MAX_FDS
+#define MU_CONFIG_POLL_MAX_FDS 8
+#endif
+
+// *****************************************************************************
+// Public declarations
+
+/**
+ * @brief Create the epoll, timerfd and eventfd descriptors and install the
+ * mu_sched wakeup function.
+ *
+ * Call after mu_sched_init().
+ *
+ * @return true on success, false if a descriptor could not be created.
+ */
+bool mu_poll_init(void);
+
+/**
+ * @brief Uninstall the wakeup function and close the descriptors created by
+ * mu_poll_init().  Registered descriptors are not closed.
+ */
+void mu_poll_deinit(void);
+
+/**
+ * @brief Schedule task whenever fd is readable.
+ *
+ * @return false if fd could not be added or the table is full.
+ */
+bool mu_poll_add_fd(int fd, mu_task_t *task);
+
+/**
+ * @brief Stop watching fd.
+ *
+ * @return false if fd was not being watched.
+ */
+bool mu_poll_remove_fd(int fd);
+
+/**
+ * @brief Block until a deferred task is due, a watched descriptor is readable
+ * or mu_sched_from_isr() is called.
+ *
+ * Returns immediately if the next deferred task is already due.  Tasks for
+ * readable descriptors are scheduled before this returns.
+ */
+void mu_poll_wait(void);
+
+/**
+ * @brief Wake up a thread that is blocked in mu_poll_wait().  Thread safe.
+ */
+void mu_poll_wake(void);
+
+/**
+ * @brief Return a task that calls mu_poll_wait(), for use as the idle task.
+ */
+mu_task_t *mu_poll_idle_task(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* #ifndef _MU_POLL_H_ */
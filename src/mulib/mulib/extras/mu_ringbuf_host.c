@@ -0,0 +1,162 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// *****************************************************************************
+// Includes
+
+#define _GNU_SOURCE // for memfd_create()
+
+#include "mu_ringbuf_host.h"
+
+#include "mu_ringbuf.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// *****************************************************************************
+// Private types and definitions
+
+// *****************************************************************************
+// Private (static) storage
+
+// *****************************************************************************
+// Private (forward) declarations
+
+/**
+ * @brief Map the pages of a new capacity byte memfd at base and again at
+ * base + capacity.  Return base, or NULL on failure.
+ */
+static uint8_t *map_mirrored(uint32_t capacity);
+
+/**
+ * @brief Fill iov with the non-empty spans and return how many there are.
+ */
+static int spans_to_iov(mu_ringbuf_span_t spans[2], struct iovec iov[2]);
+
+// *****************************************************************************
+// Public code
+
+bool mu_ringbuf_host_init(mu_ringbuf_t *rb, uint32_t capacity) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    uint8_t *store;
+
+    if ((page_size <= 0) || (capacity % (uint32_t)page_size != 0)) {
+        return false;
+    }
+    if (mu_ringbuf_init_mirrored(rb, NULL, capacity) != MU_RINGBUF_ERR_NONE) {
+        return false;
+    }
+    if ((store = map_mirrored(capacity)) == NULL) {
+        return false;
+    }
+    rb->store = store;
+    return true;
+}
+
+void mu_ringbuf_host_deinit(mu_ringbuf_t *rb) {
+    if (rb->store != NULL) {
+        munmap(rb->store, 2 * (size_t)mu_ringbuf_capacity(rb));
+        rb->store = NULL;
+    }
+}
+
+ssize_t mu_ringbuf_host_read_fd(mu_ringbuf_t *rb, int fd) {
+    mu_ringbuf_span_t spans[2];
+    struct iovec iov[2];
+    ssize_t n;
+
+    if (mu_ringbuf_reserve_write(rb, spans) == 0) {
+        return 0;
+    }
+    n = readv(fd, iov, spans_to_iov(spans, iov));
+    if (n > 0) {
+        mu_ringbuf_commit_write(rb, (uint32_t)n);
+    }
+    return n;
+}
+
+ssize_t mu_ringbuf_host_write_fd(mu_ringbuf_t *rb, int fd) {
+    mu_ringbuf_span_t spans[2];
+    struct iovec iov[2];
+    ssize_t n;
+
+    if (mu_ringbuf_peek_read(rb, spans) == 0) {
+        return 0;
+    }
+    n = writev(fd, iov, spans_to_iov(spans, iov));
+    if (n > 0) {
+        mu_ringbuf_consume(rb, (uint32_t)n);
+    }
+    return n;
+}
+
+// *****************************************************************************
+// Private (static) code
+
+static uint8_t *map_mirrored(uint32_t capacity) {
+    size_t size = (size_t)capacity;
+    uint8_t *base;
+    int fd;
+
+    if ((fd = memfd_create("mu_ringbuf", MFD_CLOEXEC)) < 0) {
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)size) < 0) {
+        close(fd);
+        return NULL;
+    }
+    // Reserve twice the address space, then map the memfd over both halves.
+    base = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    if ((mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd,
+              0) == MAP_FAILED) ||
+        (mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+              fd, 0) == MAP_FAILED)) {
+        munmap(base, 2 * size);
+        close(fd);
+        return NULL;
+    }
+    close(fd); // the mappings keep the pages alive
+    return base;
+}
+
+static int spans_to_iov(mu_ringbuf_span_t spans[2], struct iovec iov[2]) {
+    int n = 0;
+
+    for (int i = 0; i < 2; i++) {
+        if (spans[i].len > 0) {
+            iov[n].iov_base = spans[i].data;
+            iov[n].iov_len = spans[i].len;
+            n++;
+        }
+    }
+    return n;
+}
@@ -0,0 +1,110 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file: mu_ringbuf_host.h
+ *
+ * @brief Linux host support for mu_ringbuf: mirrored stores and scatter /
+ * gather I/O.
+ *
+ * mu_ringbuf_host_init() maps the ring's store twice, back to back, over the
+ * same pages of a memfd.  Byte store[i + capacity] is then byte store[i], so
+ * every span the ring hands out is contiguous and can be passed as is to code
+ * that parses or formats in place.
+ *
+ * mu_ringbuf_host_read_fd() and mu_ringbuf_host_write_fd() move bytes between
+ * a file descriptor and a ring (mirrored or not) with a single readv() or
+ * writev() on the ring's spans, so received data lands directly in the ring
+ * rather than in a buffer that is then copied into it:
+ *
+ *    static void reader_task_fn(mu_task_t *task, void *arg) {
+ *        mu_ringbuf_span_t spans[2];
+ *        mu_ringbuf_host_read_fd(&s_rx, s_sock);
+ *        uint32_t n = mu_ringbuf_peek_read(&s_rx, spans);
+ *        mu_ringbuf_consume(&s_rx, parse(spans[0].data, n));
+ *    }
+ */
+
+#ifndef _MU_RINGBUF_HOST_H_
+#define _MU_RINGBUF_HOST_H_
+
+// *****************************************************************************
+// Includes
+
+#include "mu_ringbuf.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// *****************************************************************************
+// C++ Compatibility
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// Public types and definitions
+
+// *****************************************************************************
+// Public declarations
+
+/**
+ * @brief Allocate a mirrored store of capacity bytes and initialize rb with it.
+ * capacity must be a power of two and a multiple of the page size.
+ *
+ * @return true on success, false if capacity is unsuitable or the store could
+ * not be mapped.
+ */
+bool mu_ringbuf_host_init(mu_ringbuf_t *rb, uint32_t capacity);
+
+/**
+ * @brief Unmap the store allocated by mu_ringbuf_host_init().
+ */
+void mu_ringbuf_host_deinit(mu_ringbuf_t *rb);
+
+/**
+ * @brief Read as many bytes from fd as the ring has room for and commit them.
+ * May only be called by the producer.
+ *
+ * @return The number of bytes read, 0 if the ring is full or at end of file,
+ * or -1 with errno set if the read failed (e.g. EAGAIN).
+ */
+ssize_t mu_ringbuf_host_read_fd(mu_ringbuf_t *rb, int fd);
+
+/**
+ * @brief Write as many bytes from the ring to fd as fd accepts and consume
+ * them.  May only be called by the consumer.
+ *
+ * @return The number of bytes written, 0 if the ring is empty, or -1 with
+ * errno set if the write failed.
+ */
+ssize_t mu_ringbuf_host_write_fd(mu_ringbuf_t *rb, int fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* #ifndef _MU_RINGBUF_HOST_H_ */
@@ -0,0 +1,145 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_sim.h"
+
+#include "mu_sched.h"
+#include "mu_time.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// *****************************************************************************
+// Private types and definitions
+
+typedef struct {
+    mu_time_abs_t now;       // current virtual time
+    uint32_t speed;          // virtual seconds per wall second, 0 = unlimited
+    mu_time_abs_t virt_base; // virtual time at wall_base
+    double wall_base;        // wall clock (ns) at which pacing started
+    bool stopping;           // set by mu_sim_stop()
+} mu_sim_t;
+
+// *****************************************************************************
+// Private (static) storage
+
+static mu_sim_t s_sim;
+
+// *****************************************************************************
+// Private (forward) declarations
+
+/**
+ * @brief Restart pacing from the current virtual and wall-clock times.
+ */
+static void rebase(void);
+
+/**
+ * @brief If pacing, sleep until the wall clock catches up with virtual time at.
+ */
+static void pace(mu_time_abs_t at);
+
+static double wall_ns(void);
+
+// *****************************************************************************
+// Public code
+
+void mu_sim_init(mu_time_abs_t start) {
+    s_sim.now = start;
+    s_sim.speed = MU_SIM_SPEED_UNLIMITED;
+    s_sim.stopping = false;
+    rebase();
+    mu_sched_set_clock_source(mu_sim_now);
+}
+
+mu_time_abs_t mu_sim_now(void) { return s_sim.now; }
+
+void mu_sim_set_speed(uint32_t speed) {
+    s_sim.speed = speed;
+    rebase();
+}
+
+void mu_sim_advance_to(mu_time_abs_t at) {
+    if (mu_time_follows(at, s_sim.now)) {
+        pace(at);
+        s_sim.now = at;
+    }
+}
+
+size_t mu_sim_run_until(mu_time_abs_t end) {
+    size_t count = 0;
+    mu_time_abs_t at;
+
+    s_sim.stopping = false;
+    rebase();
+    while (!s_sim.stopping) {
+        int n = mu_sched_drain();
+        if (n > 0) {
+            // Tasks ran, and may have queued more work at the current time.
+            count += n;
+        } else if (mu_sched_next_deadline(&at) &&
+                   !mu_time_follows(at, end)) {
+            // Nothing is runnable now: skip ahead to the next deadline.
+            mu_sim_advance_to(at);
+        } else {
+            mu_sim_advance_to(end);
+            break;
+        }
+    }
+    return count;
+}
+
+void mu_sim_stop(void) { s_sim.stopping = true; }
+
+// *****************************************************************************
+// Private (static) code
+
+static void rebase(void) {
+    s_sim.virt_base = s_sim.now;
+    s_sim.wall_base = wall_ns();
+}
+
+static void pace(mu_time_abs_t at) {
+    if (s_sim.speed == MU_SIM_SPEED_UNLIMITED) {
+        return;
+    }
+    double dt_ns = (double)mu_time_difference(at, s_sim.virt_base) * 1e9 /
+                   MU_TIME_TICKS_PER_SECOND;
+    double target_ns = s_sim.wall_base + dt_ns / s_sim.speed;
+    struct timespec ts;
+    ts.tv_sec = (time_t)(target_ns / 1e9);
+    ts.tv_nsec = (long)(target_ns - ts.tv_sec * 1e9);
+    // Returns early only if interrupted by a signal, which merely speeds up
+    // the simulation a little.
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static double wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
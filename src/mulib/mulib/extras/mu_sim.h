@@ -0,0 +1,128 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file: mu_sim.h
+ *
+ * @brief Virtual time for mu_sched: run discrete-event simulations faster than
+ * real time (POSIX hosts).
+ *
+ * mu_sim installs itself as the scheduler's clock source.  Virtual time stands
+ * still while tasks run.  When no irq or asap task is pending and no deferred
+ * task is due, mu_sim_run_until() jumps virtual time straight to the next
+ * deferred deadline.  Hours of simulated polling and timeouts therefore cost
+ * only the time it takes to run the tasks themselves:
+ *
+ *    mu_sched_init();
+ *    mu_sim_init(0);
+ *    my_app_init();    // schedules tasks with mu_sched / mu_timer as usual
+ *    mu_sim_run_until(mu_time_offset(0, ONE_YEAR));
+ *
+ * By default virtual time advances as fast as the tasks allow.  Use
+ * mu_sim_set_speed() to pace it against the wall clock instead, e.g. to watch
+ * a simulation at 60x real time.
+ *
+ * Notes:
+ * - The idle task is never run: an idle scheduler simply advances time.
+ * - mu_sim is single threaded and may not be used with mu_exec.
+ */
+
+#ifndef _MU_SIM_H_
+#define _MU_SIM_H_
+
+// *****************************************************************************
+// Includes
+
+#include "mu_time.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// *****************************************************************************
+// C++ Compatibility
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// Public types and definitions
+
+// mu_sim_set_speed() value for running as fast as possible.
+#define MU_SIM_SPEED_UNLIMITED 0
+
+// *****************************************************************************
+// Public declarations
+
+/**
+ * @brief Set virtual time to start and install mu_sim_now() as the
+ * scheduler's clock source.
+ *
+ * Call after mu_sched_init().  Resets the speed to MU_SIM_SPEED_UNLIMITED.
+ */
+void mu_sim_init(mu_time_abs_t start);
+
+/**
+ * @brief Return the current virtual time.
+ */
+mu_time_abs_t mu_sim_now(void);
+
+/**
+ * @brief Set how fast virtual time may advance relative to the wall clock.
+ *
+ * @param speed Virtual seconds per wall-clock second, or
+ * MU_SIM_SPEED_UNLIMITED to advance virtual time without waiting.
+ */
+void mu_sim_set_speed(uint32_t speed);
+
+/**
+ * @brief Move virtual time forward to at, without running any tasks.
+ *
+ * Has no effect if at does not follow the current virtual time.
+ */
+void mu_sim_advance_to(mu_time_abs_t at);
+
+/**
+ * @brief Run tasks, advancing virtual time from deadline to deadline, until
+ * virtual time reaches end or mu_sim_stop() is called.
+ *
+ * Tasks due at end are run.  Unless stopped early, virtual time is left at end.
+ *
+ * @return The number of tasks run.
+ */
+size_t mu_sim_run_until(mu_time_abs_t end);
+
+/**
+ * @brief Make mu_sim_run_until() return once the current batch of tasks
+ * completes.
+ *
+ * Call from within a task.
+ */
+void mu_sim_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* #ifndef _MU_SIM_H_ */
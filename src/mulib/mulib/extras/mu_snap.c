@@ -0,0 +1,631 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+// *****************************************************************************
+// Includes
+
+#include "mu_snap.h"
+
+#include "mu_sched.h"
+#include "mu_task.h"
+#include "mu_time.h"
+#include "mu_timer.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// *****************************************************************************
+// Private types and definitions
+
+// File layout: a header, then the task states, the timers, the queued tasks
+// and the regions.  Every section starts on an 8 byte boundary.
+
+#define SNAP_MAGIC "mu_snap"
+#define SNAP_VERSION 2
+#define SNAP_BYTE_ORDER 0x01020304
+#define NO_TASK UINT32_MAX
+
+#ifdef MU_CONFIG_SCHED_EDF
+#define SNAP_EDF 1
+#else
+#define SNAP_EDF 0
+#endif
+
+// Settings that must agree between the saving and the restoring program.
+#define SNAP_CONFIG                                                            \
+    ((uint32_t)sizeof(mu_time_abs_t) |                                         \
+     (uint32_t)MU_CONFIG_SCHED_ASAP_PRIORITIES << 8 | SNAP_EDF << 16)
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t config;
+    uint32_t n_states;  // n_tasks + n_timers
+    uint32_t n_timers;
+    uint32_t n_entries; // queued tasks
+    uint32_t n_regions;
+    uint32_t reserved;
+    uint64_t saved_at;
+    uint64_t size;      // of the whole file
+} header_t;
+
+typedef struct {
+    uint64_t delay_tics;
+    uint64_t delay_until;
+    uint64_t slack;
+    uint32_t state;
+    uint32_t on_completion; // index in the tables, or NO_TASK
+    uint32_t periodic;
+    uint32_t reserved;
+} timer_rec_t;
+
+typedef struct {
+    uint64_t at;    // deferred: when due.  Deadline: the deadline
+    uint32_t task;  // index in the tables
+    uint32_t order; // see mu_sched_entry_t
+    uint8_t queue;  // a mu_sched_queue_t
+    uint8_t prio;
+    uint8_t has_deadline;
+    uint8_t reserved[5];
+} entry_rec_t;
+
+typedef struct {
+    uint32_t key;
+    uint32_t reserved;
+    uint64_t size; // followed by size bytes, padded to a multiple of 8
+} region_rec_t;
+
+// State of a mu_snap_save() visit of the scheduler.
+typedef struct {
+    mu_snap_t *snap;
+    entry_rec_t *entries; // NULL while counting
+    size_t n_entries;
+    bool unknown;         // a queued task is not in the tables
+} saver_t;
+
+// *****************************************************************************
+// Private (forward) declarations
+
+static size_t pad8(size_t n);
+
+static int compare_index(const void *a, const void *b);
+
+static int compare_entries(const void *a, const void *b);
+
+/**
+ * @brief Return the position of task in the tables, or NO_TASK.
+ */
+static uint32_t find_task(mu_snap_t *snap, mu_task_t *task);
+
+/**
+ * @brief Return the task at the given position in the tables.
+ */
+static mu_task_t *task_at(mu_snap_t *snap, uint32_t index);
+
+/**
+ * @brief mu_sched_visit_fn: count or record a queued task.
+ */
+static bool save_entry(const mu_sched_entry_t *entry, void *arg);
+
+/**
+ * @brief Return the size of the file for the given number of queued tasks.
+ */
+static size_t file_size(mu_snap_t *snap, size_t n_entries);
+
+/**
+ * @brief Write the snapshot into the mapped file at base.
+ */
+static void fill(mu_snap_t *snap, uint8_t *base, size_t size,
+                 size_t n_entries);
+
+/**
+ * @brief Check that the mapped file matches the tables.
+ */
+static mu_snap_err_t validate(mu_snap_t *snap, const uint8_t *base,
+                              size_t size);
+
+/**
+ * @brief Restore from the validated, mapped file, moving times by delta.
+ */
+static mu_snap_err_t apply(mu_snap_t *snap, const uint8_t *base,
+                           mu_time_rel_t delta);
+
+/**
+ * @brief Queue the deferred tasks entries[0 .. n-1], which are in run order.
+ */
+static mu_snap_err_t restore_deferred(mu_snap_t *snap,
+                                      const entry_rec_t *entries, size_t n,
+                                      mu_time_rel_t delta);
+
+static mu_task_err_t defer_entry(mu_snap_t *snap, const entry_rec_t *entry,
+                                 mu_time_rel_t delta);
+
+// *****************************************************************************
+// Public code
+
+mu_snap_t *mu_snap_init(mu_snap_t *snap, mu_sched_t *sched, mu_task_t **tasks,
+                        size_t n_tasks, mu_timer_t **timers, size_t n_timers,
+                        mu_snap_index_t *index_store) {
+    size_t n = n_tasks + n_timers;
+
+    snap->sched = sched;
+    snap->tasks = tasks;
+    snap->n_tasks = n_tasks;
+    snap->timers = timers;
+    snap->n_timers = n_timers;
+    snap->regions = NULL;
+    snap->n_regions = 0;
+    snap->index = index_store;
+    for (size_t i = 0; i < n; i++) {
+        index_store[i].task = task_at(snap, (uint32_t)i);
+        index_store[i].index = (uint32_t)i;
+    }
+    qsort(index_store, n, sizeof(mu_snap_index_t), compare_index);
+    for (size_t i = 1; i < n; i++) {
+        if (index_store[i].task == index_store[i - 1].task) {
+            return NULL;
+        }
+    }
+    return snap;
+}
+
+void mu_snap_set_regions(mu_snap_t *snap, mu_snap_region_t *regions,
+                         size_t n_regions) {
+    snap->regions = regions;
+    snap->n_regions = n_regions;
+}
+
+mu_snap_err_t mu_snap_save(mu_snap_t *snap, const char *path) {
+    saver_t saver = {.snap = snap};
+    char tmp_path[PATH_MAX];
+
+#ifdef MU_CONFIG_TIMER_WHEEL
+    // Running timers live in the wheel, which has no way to list them.
+    for (size_t i = 0; i < snap->n_timers; i++) {
+        if (mu_timer_is_running(snap->timers[i])) {
+            return MU_SNAP_ERR_UNSUPPORTED;
+        }
+    }
+#endif
+    for (size_t i = 0; i < snap->n_timers; i++) {
+        mu_task_t *on_completion = snap->timers[i]->on_completion;
+        if (on_completion && find_task(snap, on_completion) == NO_TASK) {
+            return MU_SNAP_ERR_UNKNOWN_TASK;
+        }
+    }
+    // Count the queued tasks to size the file.
+    mu_sched_inst_visit(snap->sched, save_entry, &saver);
+    if (saver.unknown) {
+        return MU_SNAP_ERR_UNKNOWN_TASK;
+    }
+    size_t n_entries = saver.n_entries;
+    size_t size = file_size(snap, n_entries);
+
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >=
+        (int)sizeof(tmp_path)) {
+        return MU_SNAP_ERR_IO;
+    }
+    int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return MU_SNAP_ERR_IO;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        unlink(tmp_path);
+        return MU_SNAP_ERR_IO;
+    }
+    uint8_t *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        unlink(tmp_path);
+        return MU_SNAP_ERR_IO;
+    }
+    fill(snap, base, size, n_entries);
+    bool ok = msync(base, size, MS_SYNC) == 0;
+    munmap(base, size);
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return MU_SNAP_ERR_IO;
+    }
+    return MU_SNAP_ERR_NONE;
+}
+
+mu_snap_err_t mu_snap_restore(mu_snap_t *snap, const char *path, bool rebase,
+                              mu_time_abs_t *saved_at) {
+    struct stat st;
+    mu_snap_err_t err;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return MU_SNAP_ERR_IO;
+    }
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return MU_SNAP_ERR_IO;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size < sizeof(header_t)) {
+        close(fd);
+        return MU_SNAP_ERR_FORMAT;
+    }
+    const uint8_t *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping stays valid
+    if (base == MAP_FAILED) {
+        return MU_SNAP_ERR_IO;
+    }
+
+    err = validate(snap, base, size);
+    if (err == MU_SNAP_ERR_NONE &&
+        mu_sched_inst_peek_next_task(snap->sched) != NULL) {
+        err = MU_SNAP_ERR_BUSY;
+    }
+    if (err == MU_SNAP_ERR_NONE) {
+        const header_t *header = (const header_t *)base;
+        mu_time_rel_t delta = 0;
+        if (rebase) {
+            delta = mu_time_difference(
+                mu_sched_inst_get_current_time(snap->sched),
+                (mu_time_abs_t)header->saved_at);
+        }
+        if (saved_at) {
+            *saved_at = (mu_time_abs_t)header->saved_at;
+        }
+        err = apply(snap, base, delta);
+    }
+    munmap((void *)base, size);
+    return err;
+}
+
+// *****************************************************************************
+// Private (static) code
+
+static size_t pad8(size_t n) { return (n + 7) & ~(size_t)7; }
+
+static int compare_index(const void *a, const void *b) {
+    uintptr_t ta = (uintptr_t)((const mu_snap_index_t *)a)->task;
+    uintptr_t tb = (uintptr_t)((const mu_snap_index_t *)b)->task;
+    return ta < tb ? -1 : ta > tb;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const entry_rec_t *ea = a;
+    const entry_rec_t *eb = b;
+    mu_time_abs_t at_a = (mu_time_abs_t)ea->at;
+    mu_time_abs_t at_b = (mu_time_abs_t)eb->at;
+    if (at_a != at_b) {
+        return mu_time_precedes(at_a, at_b) ? -1 : 1;
+    }
+    // signed difference tolerates wrapping of the sequence number
+    int32_t d = (int32_t)(ea->order - eb->order);
+    return d < 0 ? -1 : d > 0;
+}
+
+static uint32_t find_task(mu_snap_t *snap, mu_task_t *task) {
+    mu_snap_index_t key = {.task = task};
+    mu_snap_index_t *found =
+        bsearch(&key, snap->index, snap->n_tasks + snap->n_timers,
+                sizeof(mu_snap_index_t), compare_index);
+    return found ? found->index : NO_TASK;
+}
+
+static mu_task_t *task_at(mu_snap_t *snap, uint32_t index) {
+    if (index < snap->n_tasks) {
+        return snap->tasks[index];
+    }
+    return &snap->timers[index - snap->n_tasks]->task;
+}
+
+static bool save_entry(const mu_sched_entry_t *entry, void *arg) {
+    saver_t *saver = arg;
+    uint32_t index = find_task(saver->snap, entry->task);
+    if (index == NO_TASK) {
+        saver->unknown = true;
+        return false;
+    }
+    if (saver->entries) {
+        entry_rec_t *rec = &saver->entries[saver->n_entries];
+        memset(rec, 0, sizeof(*rec));
+        rec->at = (uint64_t)entry->at;
+        rec->task = index;
+        rec->order = entry->order;
+        rec->queue = (uint8_t)entry->queue;
+        rec->prio = (uint8_t)entry->prio;
+        rec->has_deadline = entry->has_deadline;
+    }
+    saver->n_entries += 1;
+    return true;
+}
+
+static size_t file_size(mu_snap_t *snap, size_t n_entries) {
+    size_t size = sizeof(header_t);
+    size += pad8((snap->n_tasks + snap->n_timers) * sizeof(uint32_t));
+    size += snap->n_timers * sizeof(timer_rec_t);
+    size += n_entries * sizeof(entry_rec_t);
+    for (size_t i = 0; i < snap->n_regions; i++) {
+        size += sizeof(region_rec_t) + pad8(snap->regions[i].size);
+    }
+    return size;
+}
+
+static void fill(mu_snap_t *snap, uint8_t *base, size_t size,
+                 size_t n_entries) {
+    size_t n_states = snap->n_tasks + snap->n_timers;
+    header_t *header = (header_t *)base;
+    uint8_t *p = base + sizeof(header_t);
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, SNAP_MAGIC, sizeof(SNAP_MAGIC));
+    header->version = SNAP_VERSION;
+    header->byte_order = SNAP_BYTE_ORDER;
+    header->config = SNAP_CONFIG;
+    header->n_states = (uint32_t)n_states;
+    header->n_timers = (uint32_t)snap->n_timers;
+    header->n_entries = (uint32_t)n_entries;
+    header->n_regions = (uint32_t)snap->n_regions;
+    header->saved_at = (uint64_t)mu_sched_inst_get_current_time(snap->sched);
+    header->size = size;
+
+    uint32_t *states = (uint32_t *)p;
+    for (size_t i = 0; i < n_states; i++) {
+        states[i] = (uint32_t)mu_task_get_state(task_at(snap, (uint32_t)i));
+    }
+    p += pad8(n_states * sizeof(uint32_t));
+
+    timer_rec_t *timer_recs = (timer_rec_t *)p;
+    for (size_t i = 0; i < snap->n_timers; i++) {
+        mu_timer_t *timer = snap->timers[i];
+        timer_rec_t *rec = &timer_recs[i];
+        memset(rec, 0, sizeof(*rec));
+        rec->delay_tics = (uint64_t)timer->delay_tics;
+        rec->delay_until = (uint64_t)timer->delay_until;
+        rec->slack = (uint64_t)timer->slack;
+        rec->state = (uint32_t)timer->state;
+        rec->on_completion = timer->on_completion
+                                 ? find_task(snap, timer->on_completion)
+                                 : NO_TASK;
+        rec->periodic = timer->periodic;
+    }
+    p += snap->n_timers * sizeof(timer_rec_t);
+
+    // Record the queued tasks, then put the deferred and deadline tasks,
+    // which are visited in heap order, in the order they will run.
+    saver_t saver = {.snap = snap, .entries = (entry_rec_t *)p};
+    mu_sched_inst_visit(snap->sched, save_entry, &saver);
+    size_t first = 0;
+    while (first < n_entries) {
+        entry_rec_t *rec = &saver.entries[first];
+        size_t last = first + 1;
+        while (last < n_entries && saver.entries[last].queue == rec->queue &&
+               saver.entries[last].has_deadline == rec->has_deadline &&
+               saver.entries[last].prio == rec->prio) {
+            last += 1;
+        }
+        if (rec->queue == MU_SCHED_QUEUE_DEFERRED || rec->has_deadline) {
+            qsort(rec, last - first, sizeof(entry_rec_t), compare_entries);
+        }
+        first = last;
+    }
+    p += n_entries * sizeof(entry_rec_t);
+
+    for (size_t i = 0; i < snap->n_regions; i++) {
+        mu_snap_region_t *region = &snap->regions[i];
+        region_rec_t *rec = (region_rec_t *)p;
+        rec->key = region->key;
+        rec->reserved = 0;
+        rec->size = region->size;
+        p += sizeof(region_rec_t);
+        memcpy(p, region->data, region->size);
+        memset(p + region->size, 0, pad8(region->size) - region->size);
+        p += pad8(region->size);
+    }
+}
+
+static mu_snap_err_t validate(mu_snap_t *snap, const uint8_t *base,
+                              size_t size) {
+    const header_t *header = (const header_t *)base;
+
+    if (memcmp(header->magic, SNAP_MAGIC, sizeof(SNAP_MAGIC)) != 0 ||
+        header->version != SNAP_VERSION || header->size != size) {
+        return MU_SNAP_ERR_FORMAT;
+    }
+    if (header->byte_order != SNAP_BYTE_ORDER ||
+        header->config != SNAP_CONFIG ||
+        header->n_states != snap->n_tasks + snap->n_timers ||
+        header->n_timers != snap->n_timers ||
+        header->n_regions != snap->n_regions) {
+        return MU_SNAP_ERR_MISMATCH;
+    }
+
+    // The fixed size sections must fit before the regions are examined.
+    size_t offset = sizeof(header_t) +
+                    pad8(header->n_states * sizeof(uint32_t)) +
+                    header->n_timers * sizeof(timer_rec_t);
+    if (header->n_entries > (size - offset) / sizeof(entry_rec_t)) {
+        return MU_SNAP_ERR_FORMAT;
+    }
+    const timer_rec_t *timer_recs =
+        (const timer_rec_t *)(base + offset -
+                              header->n_timers * sizeof(timer_rec_t));
+    for (size_t i = 0; i < header->n_timers; i++) {
+        uint32_t on_completion = timer_recs[i].on_completion;
+        if (on_completion != NO_TASK && on_completion >= header->n_states) {
+            return MU_SNAP_ERR_FORMAT;
+        }
+    }
+    const entry_rec_t *entries = (const entry_rec_t *)(base + offset);
+    for (size_t i = 0; i < header->n_entries; i++) {
+        if (entries[i].task >= header->n_states ||
+            entries[i].queue >= MU_SCHED_QUEUE_COUNT ||
+            entries[i].prio >= MU_CONFIG_SCHED_ASAP_PRIORITIES) {
+            return MU_SNAP_ERR_FORMAT;
+        }
+    }
+    offset += header->n_entries * sizeof(entry_rec_t);
+
+    for (size_t i = 0; i < snap->n_regions; i++) {
+        if (size - offset < sizeof(region_rec_t)) {
+            return MU_SNAP_ERR_FORMAT;
+        }
+        const region_rec_t *rec = (const region_rec_t *)(base + offset);
+        if (rec->key != snap->regions[i].key ||
+            rec->size != snap->regions[i].size) {
+            return MU_SNAP_ERR_MISMATCH;
+        }
+        offset += sizeof(region_rec_t);
+        if (size - offset < pad8(rec->size)) {
+            return MU_SNAP_ERR_FORMAT;
+        }
+        offset += pad8(rec->size);
+    }
+    return offset == size ? MU_SNAP_ERR_NONE : MU_SNAP_ERR_FORMAT;
+}
+
+static mu_snap_err_t apply(mu_snap_t *snap, const uint8_t *base,
+                           mu_time_rel_t delta) {
+    const header_t *header = (const header_t *)base;
+    const uint8_t *p = base + sizeof(header_t);
+    mu_sched_t *sched = snap->sched;
+
+    // Set states directly: the task state hooks are not for replays.
+    const uint32_t *states = (const uint32_t *)p;
+    for (size_t i = 0; i < header->n_states; i++) {
+        task_at(snap, (uint32_t)i)->state = states[i];
+    }
+    p += pad8(header->n_states * sizeof(uint32_t));
+
+    const timer_rec_t *timer_recs = (const timer_rec_t *)p;
+    for (size_t i = 0; i < snap->n_timers; i++) {
+        mu_timer_t *timer = snap->timers[i];
+        const timer_rec_t *rec = &timer_recs[i];
+        timer->delay_tics = (mu_time_rel_t)rec->delay_tics;
+        timer->delay_until = (mu_time_abs_t)rec->delay_until;
+        timer->slack = (mu_time_rel_t)rec->slack;
+        timer->state = (mu_timer_state_t)rec->state;
+        timer->on_completion = rec->on_completion == NO_TASK
+                                   ? NULL
+                                   : task_at(snap, rec->on_completion);
+        timer->periodic = rec->periodic != 0;
+        if (timer->state == MU_TIMER_STATE_RUNNING) {
+            timer->delay_until = mu_time_offset(timer->delay_until, delta);
+        }
+    }
+    p += snap->n_timers * sizeof(timer_rec_t);
+
+    const entry_rec_t *entries = (const entry_rec_t *)p;
+    size_t n_entries = header->n_entries;
+    p += n_entries * sizeof(entry_rec_t);
+
+    for (size_t i = 0; i < snap->n_regions; i++) {
+        const region_rec_t *rec = (const region_rec_t *)p;
+        p += sizeof(region_rec_t);
+        memcpy(snap->regions[i].data, p, snap->regions[i].size);
+        p += pad8(rec->size);
+    }
+
+    size_t first = 0;
+    while (first < n_entries) {
+        const entry_rec_t *rec = &entries[first];
+        mu_task_t *task = task_at(snap, rec->task);
+        mu_task_err_t err = MU_TASK_ERR_NONE;
+
+        if (rec->queue == MU_SCHED_QUEUE_DEFERRED) {
+            size_t last = first + 1;
+            while (last < n_entries &&
+                   entries[last].queue == MU_SCHED_QUEUE_DEFERRED) {
+                last += 1;
+            }
+            mu_snap_err_t snap_err =
+                restore_deferred(snap, rec, last - first, delta);
+            if (snap_err != MU_SNAP_ERR_NONE) {
+                return snap_err;
+            }
+            first = last;
+            continue;
+        } else if (rec->queue == MU_SCHED_QUEUE_IRQ) {
+            err = mu_sched_inst_from_isr(sched, task);
+        } else if (rec->has_deadline) {
+#ifdef MU_CONFIG_SCHED_EDF
+            err = mu_sched_inst_asap_deadline(
+                sched, task, mu_time_offset((mu_time_abs_t)rec->at, delta));
+#endif
+        } else {
+            err = mu_sched_inst_asap_prio(sched, task, rec->prio);
+        }
+        if (err != MU_TASK_ERR_NONE) {
+            return MU_SNAP_ERR_SCHED_FULL;
+        }
+        first += 1;
+    }
+    return MU_SNAP_ERR_NONE;
+}
+
+static mu_snap_err_t restore_deferred(mu_snap_t *snap,
+                                      const entry_rec_t *entries, size_t n,
+                                      mu_time_rel_t delta) {
+#ifdef MU_CONFIG_SCHED_DEFERRED_HEAP
+    // In run order, each task lands at the bottom of the heap and stays there.
+    for (size_t i = 0; i < n; i++) {
+        if (defer_entry(snap, &entries[i], delta) != MU_TASK_ERR_NONE) {
+            return MU_SNAP_ERR_SCHED_FULL;
+        }
+    }
+#else
+    // The sorted array keeps the next task to run last, so queue the latest
+    // tasks first: each then lands at the end without a search.  Tasks due at
+    // the same time are queued in run order, since a task deferred to the
+    // same time as another runs after it.
+    size_t last = n;
+    while (last > 0) {
+        size_t first = last - 1;
+        while (first > 0 && entries[first - 1].at == entries[last - 1].at) {
+            first -= 1;
+        }
+        for (size_t i = first; i < last; i++) {
+            if (defer_entry(snap, &entries[i], delta) != MU_TASK_ERR_NONE) {
+                return MU_SNAP_ERR_SCHED_FULL;
+            }
+        }
+        last = first;
+    }
+#endif
+    return MU_SNAP_ERR_NONE;
+}
+
+static mu_task_err_t defer_entry(mu_snap_t *snap, const entry_rec_t *entry,
+                                 mu_time_rel_t delta) {
+    mu_time_abs_t at = mu_time_offset((mu_time_abs_t)entry->at, delta);
+    return mu_sched_inst_defer_until(snap->sched, task_at(snap, entry->task),
+                                     at);
+}
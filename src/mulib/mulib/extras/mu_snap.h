@@ -0,0 +1,183 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file: mu_snap.h
+ *
+ * @brief Save the state of a scheduler and its tasks to a file, and restore it
+ * in a later run of the program (POSIX hosts).
+ *
+ * A snapshot holds:
+ * - the state of every task in a table of tasks,
+ * - the tasks waiting in the scheduler's queues, and when they are due,
+ * - the settings and deadlines of a table of mu_timers,
+ * - any number of application "regions": plain data such as device models.
+ *
+ * Tasks are recorded by their position in the task table rather than by
+ * address, so a restarted program can restore a snapshot as long as it builds
+ * the same tables (with the same task functions) before restoring it:
+ *
+ *    my_app_init();   // initializes tasks and timers, but schedules nothing
+ *    mu_snap_init(&snap, sched, tasks, N_TASKS, timers, N_TIMERS, index);
+ *    mu_snap_set_regions(&snap, regions, N_REGIONS);
+ *    if (mu_snap_restore(&snap, "app.snap", true, NULL) != MU_SNAP_ERR_NONE) {
+ *        my_app_start();   // schedules the initial tasks
+ *    }
+ *
+ * Both saving and restoring map the file into memory, so there are no
+ * per-record read() or write() calls: restoring costs little more than
+ * re-queueing the tasks.  Saving writes a temporary file and renames it, so a
+ * crash while saving leaves the previous snapshot intact.
+ *
+ * Notes:
+ * - The file is in the host's byte order and mulib configuration.  Restoring
+ *   a snapshot made by a differently configured program fails with
+ *   MU_SNAP_ERR_MISMATCH.
+ * - Regions are copied byte for byte, so they must not hold pointers.
+ * - Task fields other than the state, e.g. user_info, are not saved.
+ * - With MU_CONFIG_TIMER_WHEEL, running timers cannot be saved.
+ * - Like the rest of mulib, mu_snap never mallocs: all storage is supplied by
+ *   the caller.
+ */
+
+#ifndef _MU_SNAP_H_
+#define _MU_SNAP_H_
+
+// *****************************************************************************
+// Includes
+
+#include "mu_sched.h"
+#include "mu_task.h"
+#include "mu_time.h"
+#include "mu_timer.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// *****************************************************************************
+// C++ Compatibility
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// Public types and definitions
+
+typedef enum {
+    MU_SNAP_ERR_NONE,
+    MU_SNAP_ERR_IO,           // a file operation failed: see errno
+    MU_SNAP_ERR_FORMAT,       // the file is not a valid snapshot
+    MU_SNAP_ERR_MISMATCH,     // the snapshot doesn't match the tables
+    MU_SNAP_ERR_UNKNOWN_TASK, // a queued task is not in the task table
+    MU_SNAP_ERR_BUSY,         // the scheduler already has tasks queued
+    MU_SNAP_ERR_SCHED_FULL,   // the scheduler couldn't queue a task
+    MU_SNAP_ERR_UNSUPPORTED,  // e.g. a running timer in a timing wheel
+} mu_snap_err_t;
+
+// Application data to be saved with a snapshot.
+typedef struct {
+    uint32_t key; // identifies the region in the file
+    void *data;
+    size_t size;
+} mu_snap_region_t;
+
+// Maps a task's address to its position in the tables.  Treat as opaque.
+typedef struct {
+    mu_task_t *task;
+    uint32_t index;
+} mu_snap_index_t;
+
+typedef struct {
+    mu_sched_t *sched;
+    mu_task_t **tasks;
+    size_t n_tasks;
+    mu_timer_t **timers;
+    size_t n_timers;
+    mu_snap_region_t *regions;
+    size_t n_regions;
+    mu_snap_index_t *index; // n_tasks + n_timers entries, sorted by task
+} mu_snap_t;
+
+// *****************************************************************************
+// Public declarations
+
+/**
+ * @brief Initialize a snapshot context for a scheduler and its tasks.
+ *
+ * @param snap The context to initialize.
+ * @param sched The scheduler whose queues are saved and restored.
+ * @param tasks Every task that may be queued in sched, other than the tasks of
+ * the timers.  The order must be the same when saving and restoring.
+ * @param n_tasks The number of tasks.
+ * @param timers Timers whose state is saved and restored.  May be NULL.
+ * @param n_timers The number of timers.
+ * @param index_store Storage for n_tasks + n_timers entries, used to look up
+ * tasks by address.
+ * @return snap, or NULL if a task appears in the tables more than once.
+ */
+mu_snap_t *mu_snap_init(mu_snap_t *snap, mu_sched_t *sched, mu_task_t **tasks,
+                        size_t n_tasks, mu_timer_t **timers, size_t n_timers,
+                        mu_snap_index_t *index_store);
+
+/**
+ * @brief Set the application regions saved with the snapshot.
+ *
+ * Restoring requires the same keys and sizes, in the same order.
+ */
+void mu_snap_set_regions(mu_snap_t *snap, mu_snap_region_t *regions,
+                         size_t n_regions);
+
+/**
+ * @brief Save a snapshot to the file at path, replacing any previous one.
+ *
+ * Call from outside any task, e.g. between calls to mu_sched_drain().  The
+ * scheduler is not changed.
+ */
+mu_snap_err_t mu_snap_save(mu_snap_t *snap, const char *path);
+
+/**
+ * @brief Restore the snapshot in the file at path.
+ *
+ * The scheduler must have no tasks queued, e.g. having just been initialized.
+ * Task states, timers and regions are restored, then the saved tasks are
+ * queued in their saved order.  If the restore fails part way through, e.g.
+ * with MU_SNAP_ERR_SCHED_FULL, the scheduler is left partially restored.
+ *
+ * @param rebase If true, deferred times, deadlines and timers are moved by the
+ * time between saving and now (by the scheduler's clock), so that each is due
+ * as far in the future as it was when saved.  If false, they are restored
+ * as saved, e.g. to continue a simulation in virtual time.
+ * @param saved_at If not NULL, receives the scheduler's time when the snapshot
+ * was saved.
+ */
+mu_snap_err_t mu_snap_restore(mu_snap_t *snap, const char *path, bool rebase,
+                              mu_time_abs_t *saved_at);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* #ifndef _MU_SNAP_H_ */
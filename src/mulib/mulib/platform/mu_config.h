@@ -58,6 +58,11 @@ extern "C" {
 #define MU_FLOAT float
 #endif
 
+// Optional: Define the POSIX clock that mu_time_now() reads, in nanoseconds.
+// CLOCK_MONOTONIC_RAW is not slewed by NTP, so short intervals are measured
+// exactly.  Leave commented to accept the default of CLOCK_MONOTONIC.
+// #define MU_CONFIG_TIME_CLOCK_ID CLOCK_MONOTONIC_RAW
+
 // Optional: Define the number of deferred events that may be scheduled.
 // Leave commented to accept the default.
 // #define MU_CONFIG_SCHED_MAX_DEFERRED_TASKS 20
@@ -66,10 +71,129 @@ extern "C" {
 // Leave commented to accept the default.
 // #define MU_CONFIG_SCHED_MAX_IRQ_TASKS 8 // must be a power of two!
 
+// Optional: Define the cache line size that separates the producer's and the
+// consumer's fields of a mu_spsc_t, or 0 to pack them (single core targets).
+// Leave commented to accept the default of 64.
+// #define MU_CONFIG_SPSC_CACHE_LINE 64
+
 // Optional: Define the number of immediate events that may be scheduled.
 // Leave commented to accept the default.
 // #define MU_CONFIG_SCHED_MAX_ASAP_TASKS 20
 
+// Optional: Define the number of priority levels for "asap" tasks, from 1 to
+// 32.  Each level gets its own queue of MU_CONFIG_SCHED_MAX_ASAP_TASKS.  Leave
+// commented to accept the default of a single level.
+// #define MU_CONFIG_SCHED_ASAP_PRIORITIES 4
+
+// Optional: Define the priority used by mu_sched_asap() and mu_task_yield().
+// Leave commented to accept the default of the middle level.
+// #define MU_CONFIG_SCHED_ASAP_DEFAULT_PRIORITY 1
+
+// Optional: Define the storage class used to record which scheduler instance
+// is running a task.  Define as _Thread_local if scheduler instances run on
+// more than one thread.  Leave commented for single threaded use.
+// #define MU_CONFIG_SCHED_THREAD_LOCAL _Thread_local
+
+// Optional: un-comment this to keep deferred tasks in a binary min-heap rather
+// than a sorted array.  Insertion and removal become O(log n) instead of O(n),
+// which pays off when many deferred tasks are in flight.  Each task then holds
+// its position in the heap, so removing a task that is deferred once is
+// O(log n) too.  As with the array, deferring a task again adds another entry.
+// #define MU_CONFIG_SCHED_DEFERRED_HEAP
+
+// Optional: un-comment this to read the clock at most once per batch run by
+// mu_sched_drain() or mu_sched_run_for(): every task in the batch then sees
+// the same mu_sched_get_current_time().  See mu_sched_get_current_time().
+// #define MU_CONFIG_SCHED_CACHED_NOW
+
+// Optional: un-comment this to let individual tasks opt in to deduplicated
+// asap and irq scheduling: scheduling a task that is already queued becomes a
+// no-op until it runs.  See mu_sched_set_dedup().
+// #define MU_CONFIG_SCHED_DEDUP
+
+// Optional: un-comment this to add an earliest-deadline-first queue for tasks
+// that must run by a given time.  It runs ahead of the asap priority levels,
+// and deadline misses are counted.  See mu_sched_asap_deadline().
+// #define MU_CONFIG_SCHED_EDF
+
+// Optional: Define the number of tasks that may wait in the deadline queue.
+// Leave commented to accept the default.
+// #define MU_CONFIG_SCHED_MAX_EDF_TASKS 16
+
+// Optional: un-comment this to make mu_sched_step() serve the irq, deferred
+// and asap queues in weighted round robin turns rather than in strict order,
+// so that a flood of interrupts or expired timers can't starve asap tasks.
+// See mu_sched_set_fair_weights().
+// #define MU_CONFIG_SCHED_FAIR
+
+// Optional: Define the default number of tasks each class may run in its turn.
+// Leave commented to accept the defaults.
+// #define MU_CONFIG_SCHED_FAIR_IRQ_WEIGHT 4
+// #define MU_CONFIG_SCHED_FAIR_DEFERRED_WEIGHT 2
+// #define MU_CONFIG_SCHED_FAIR_ASAP_WEIGHT 1
+
+// Optional: un-comment this to give each scheduled task a 16-bit ID from a
+// task registry, so that the scheduler's queues hold IDs rather than pointers
+// and deferred times in 48 bits.  This shrinks queue storage, but the registry
+// costs a pointer per ID, and a task can be deferred at most MU_SCHED_AT_RANGE
+// (2^46) ticks ahead.  See mu_task_get_id().
+// #define MU_CONFIG_TASK_IDS
+
+// Optional: Define the number of tasks the task registry can hold, up to
+// 65535.  Leave commented to accept the default.
+// #define MU_CONFIG_TASK_MAX_IDS 32
+
+// Optional: un-comment this to account for the time a scheduler spends running
+// tasks versus idling, and to report utilization over rolling windows.  See
+// mu_sched_get_load().
+// #define MU_CONFIG_SCHED_LOAD
+
+// Optional: Define the number of utilization windows each scheduler keeps.
+// Leave commented to accept the default.
+// #define MU_CONFIG_SCHED_LOAD_WINDOWS 3
+
+// Optional: un-comment this (host builds) to let a scheduler's asap and deferred
+// queues grow from a caller-supplied allocator instead of returning
+// MU_TASK_ERR_SCHED_FULL.  See mu_sched_inst_set_allocator().
+// #define MU_CONFIG_SCHED_GROWABLE
+
+// Optional: un-comment this to gather scheduler statistics: how late deferred
+// tasks run, how long tasks wait in each queue, queue high-water marks and
+// MU_TASK_ERR_SCHED_FULL counts.  See mu_sched_get_stats().
+// #define MU_CONFIG_SCHED_STATS
+
+// Optional: Define the number of log2 buckets in each statistics histogram.
+// Leave commented to accept the default.
+// #define MU_CONFIG_SCHED_STATS_BUCKETS 24
+
+// Optional: un-comment this to run mu_timers from a hierarchical timing wheel
+// rather than from the scheduler's deferred queue.  Start, stop and expiry
+// become O(1), at the cost of rounding expirations up to a whole wheel tick.
+// #define MU_CONFIG_TIMER_WHEEL
+
+// Optional: Define the duration of one timing wheel tick in mu_time units.
+// Leave commented to accept the default of one millisecond.
+// #define MU_CONFIG_TIMER_WHEEL_RESOLUTION (MU_TIME_TICKS_PER_SECOND / 1000)
+
+// Optional: un-comment this to time every mu_task_call(), per task and
+// optionally per task state, and to report calls that exceed a run time
+// budget.  See mu_task_set_watchdog().
+// #define MU_CONFIG_TASK_WATCHDOG
+
+// Optional: un-comment this (hosts with C11 atomics) to let any number of
+// threads schedule tasks through a lock-free queue.  See
+// mu_sched_from_thread().
+// #define MU_CONFIG_SCHED_FROM_THREAD
+
+// Optional: un-comment this (POSIX hosts only) to let mu_sched hand tasks to a
+// multi-threaded mu_exec executor while one is active.  See extras/mu_exec.h.
+// #define MU_CONFIG_SCHED_EXEC
+
+// Optional: Define the number of file descriptors that mu_poll can watch
+// (Linux hosts only, see extras/mu_poll.h).  Leave commented to accept the
+// default.
+// #define MU_CONFIG_POLL_MAX_FDS 8
+
 // *****************************************************************************
 // Public declarations
 
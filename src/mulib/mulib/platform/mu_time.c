@@ -27,26 +27,85 @@
 
 #include "mu_config.h"
 #include "mu_time.h"
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <time.h>
 
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
 // *****************************************************************************
 // Private types and definitions
 
+// The clock the cycle counter is calibrated against, or read in its stead.
+#ifdef CLOCK_MONOTONIC_RAW
+#define CYCLES_CLOCK_ID CLOCK_MONOTONIC_RAW
+#else
+#define CYCLES_CLOCK_ID CLOCK_MONOTONIC
+#endif
+
+// How long to count cycles for when calibrating.
+#define CALIBRATION_NS 5000000
+
 // *****************************************************************************
 // Private (static) storage
 
+// True if the cycle counter is the TSC, false if it is CYCLES_CLOCK_ID.
+static bool s_use_tsc;
+
+// Nanoseconds per cycle, in 32.32 fixed point.
+static uint64_t s_ns_per_cycle;
+
+// Cycles per second, for mu_time_cycles_per_second().
+static uint64_t s_cycles_per_second;
+
+// Runs calibrate_cycles() exactly once.  Threads that arrive while it runs
+// wait for it, and then see all three of the values above.
+static pthread_once_t s_calibrate_once = PTHREAD_ONCE_INIT;
+
+// Set once s_calibrate_once has run, so that later reads of the cycle counter
+// skip it.
+static atomic_bool s_calibrated;
+
 // *****************************************************************************
 // Private (forward) declarations
 
+/**
+ * @brief Read CYCLES_CLOCK_ID in nanoseconds.
+ */
+static uint64_t clock_ns(void);
+
+/**
+ * @brief Return true if this CPU has a TSC that runs at a constant rate.
+ */
+static bool has_invariant_tsc(void);
+
+/**
+ * @brief Measure the rate of the cycle counter.
+ */
+static void calibrate_cycles(void);
+
+/**
+ * @brief Calibrate the cycle counter unless that is already done.  Thread
+ * safe, and once calibrated, a single acquire load.
+ */
+static void ensure_calibrated(void);
+
 // *****************************************************************************
 // Public code
 
-void mu_time_init(void) {}
+void mu_time_init(void) { ensure_calibrated(); }
 
-mu_time_abs_t mu_time_now(void) { return clock(); }
+mu_time_abs_t mu_time_now(void) {
+  struct timespec ts;
+  clock_gettime(MU_CONFIG_TIME_CLOCK_ID, &ts);
+  return (mu_time_abs_t)ts.tv_sec * MU_TIME_TICKS_PER_SECOND +
+         (mu_time_abs_t)ts.tv_nsec;
+}
 
 mu_time_abs_t mu_time_offset(mu_time_abs_t t, mu_time_rel_t dt) {
   return t + dt;
@@ -68,21 +127,73 @@ bool mu_time_follows(mu_time_abs_t t1, mu_time_abs_t t2) {
 
 int mu_time_rel_to_ms(mu_time_rel_t dt) {
   // TODO: reinstate integer rounding fn
-  return (dt * (mu_time_rel_t)1000) / MU_TIME_TICKS_PER_SECOND;
+  // Divide rather than multiply first: dt * 1000 overflows after 107 days.
+  return dt / (MU_TIME_TICKS_PER_SECOND / 1000);
 }
 
 mu_time_rel_t mu_time_ms_to_rel(int ms) {
   // TODO: reinstate integer rounding fn
-  return ms * MU_TIME_TICKS_PER_SECOND / (mu_time_rel_t)1000;
+  return (mu_time_rel_t)ms * (MU_TIME_TICKS_PER_SECOND / 1000);
+}
+
+mu_time_cycles_t mu_time_cycles(void) {
+  ensure_calibrated();
+#if defined(__x86_64__)
+  if (s_use_tsc) {
+    return __builtin_ia32_rdtsc();
+  }
+#endif
+  return clock_ns();
+}
+
+mu_time_cycles_t mu_time_cycles_ordered(void) {
+  ensure_calibrated();
+#if defined(__x86_64__)
+  if (s_use_tsc) {
+    unsigned int aux;
+    return __builtin_ia32_rdtscp(&aux);
+  }
+#endif
+  return clock_ns();
+}
+
+uint64_t mu_time_cycles_per_second(void) {
+  ensure_calibrated();
+  return s_cycles_per_second;
+}
+
+uint64_t mu_time_cycles_to_ns(mu_time_cycles_t cycles) {
+  ensure_calibrated();
+#if defined(__x86_64__)
+  if (s_use_tsc) {
+    return (uint64_t)(((unsigned __int128)cycles * s_ns_per_cycle) >> 32);
+  }
+#endif
+  return cycles;
+}
+
+mu_time_cycles_t mu_time_ns_to_cycles(uint64_t ns) {
+  ensure_calibrated();
+#if defined(__x86_64__)
+  if (s_use_tsc) {
+    return (mu_time_cycles_t)(((unsigned __int128)ns << 32) / s_ns_per_cycle);
+  }
+#endif
+  return ns;
+}
+
+mu_time_rel_t mu_time_cycles_to_rel(mu_time_cycles_t cycles) {
+  // One tick is one nanosecond.
+  return (mu_time_rel_t)mu_time_cycles_to_ns(cycles);
 }
 
 #ifdef MU_CONFIG_HAS_FLOAT
 
-mu_time_seconds_t mu_time_rel_to_s(mu_time_rel_t dt) {
-  return dt / (mu_time_seconds_t)MU_TIME_TICKS_PER_SECOND;
+MU_FLOAT mu_time_rel_to_s(mu_time_rel_t dt) {
+  return dt / (MU_FLOAT)MU_TIME_TICKS_PER_SECOND;
 }
 
-mu_time_seconds_t mu_time_s_to_rel(MU_FLOAT s) {
+mu_time_rel_t mu_time_s_to_rel(MU_FLOAT s) {
   return s * MU_TIME_TICKS_PER_SECOND;
 }
 
@@ -90,3 +201,54 @@ mu_time_seconds_t mu_time_s_to_rel(MU_FLOAT s) {
 
 // *****************************************************************************
 // Private (static) code
+
+static uint64_t clock_ns(void) {
+  struct timespec ts;
+  clock_gettime(CYCLES_CLOCK_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static bool has_invariant_tsc(void) {
+#if defined(__x86_64__)
+  unsigned int eax, ebx, ecx, edx;
+  // CPUID leaf 0x80000007, EDX bit 8: the TSC rate is constant across
+  // frequency changes and sleep states.
+  if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+    return (edx & (1u << 8)) != 0;
+  }
+#endif
+  return false;
+}
+
+static void calibrate_cycles(void) {
+#if defined(__x86_64__)
+  if (has_invariant_tsc()) {
+    // Count cycles across a few milliseconds of the reference clock, reading
+    // the TSC right after the clock at both ends.
+    unsigned int aux;
+    uint64_t ns0 = clock_ns();
+    uint64_t c0 = __builtin_ia32_rdtscp(&aux);
+    uint64_t ns1;
+    do {
+      ns1 = clock_ns();
+    } while (ns1 - ns0 < CALIBRATION_NS);
+    uint64_t cycles = __builtin_ia32_rdtscp(&aux) - c0;
+    uint64_t ns = ns1 - ns0;
+    s_cycles_per_second =
+        (uint64_t)((unsigned __int128)cycles * 1000000000 / ns);
+    s_use_tsc = true;
+    s_ns_per_cycle = (ns << 32) / cycles;
+    return;
+  }
+#endif
+  s_cycles_per_second = 1000000000;
+  s_use_tsc = false;
+  s_ns_per_cycle = (uint64_t)1 << 32;
+}
+
+static void ensure_calibrated(void) {
+  if (!atomic_load_explicit(&s_calibrated, memory_order_acquire)) {
+    pthread_once(&s_calibrate_once, calibrate_cycles);
+    atomic_store_explicit(&s_calibrated, true, memory_order_release);
+  }
+}
@@ -0,0 +1,154 @@
+/**
+ * @file bench_mu_exec.c
+ *
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/**
+ * @brief Measure how mu_exec throughput scales with the number of workers.
+ *
+ * Each of N_TASKS tasks stands in for an emulated thermostat: it does a little
+ * work, then yields, N_STEPS times.  This is a POSIX host program.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_exec.h"
+#include "mu_sched.h"
+#include "mu_task.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#define MAX_WORKERS 8
+#define N_TASKS 4096
+#define N_STEPS 200
+#define WORK_LOOPS 2000
+#define ASAP_CAPACITY 8192 // per worker, must be a power of two
+
+typedef struct {
+    mu_task_t task;
+    uint32_t acc;
+} thermostat_t;
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static mu_exec_t s_exec;
+static mu_exec_worker_t s_workers[MAX_WORKERS];
+static mu_task_t *s_asap_stores[MAX_WORKERS][ASAP_CAPACITY];
+static mu_exec_deferred_t s_deferred_stores[MAX_WORKERS][1];
+static mu_task_t *s_inject_store[N_TASKS];
+static thermostat_t s_thermostats[N_TASKS];
+static int s_done;
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static void thermostat_fn(mu_task_t *task, void *arg);
+static double wall_ns(void);
+static void bench_workers(size_t n_workers);
+
+// *****************************************************************************
+// Public code
+
+int main(void) {
+    mu_sched_init();
+    printf("\nbench_mu_exec: %d tasks x %d steps", N_TASKS, N_STEPS);
+    printf("\n%8s %12s %10s %10s", "workers", "ns/step", "speedup", "steals");
+    for (size_t n = 1; n <= MAX_WORKERS; n *= 2) {
+        bench_workers(n);
+    }
+    printf("\n");
+    return 0;
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+static void thermostat_fn(mu_task_t *task, void *arg) {
+    (void)arg;
+    thermostat_t *thermostat = MU_TASK_CTX(task, thermostat_t, task);
+
+    // Stand-in for the work of one control loop iteration.
+    uint32_t acc = thermostat->acc;
+    for (int i = 0; i < WORK_LOOPS; i++) {
+        acc = acc * 1664525 + 1013904223;
+    }
+    thermostat->acc = acc;
+
+    mu_task_state_t state = mu_task_get_state(task) + 1;
+    if (state < N_STEPS) {
+        mu_task_yield(task, state);
+    } else {
+        __atomic_fetch_add(&s_done, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static double wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench_workers(size_t n_workers) {
+    static double s_base_ns;
+
+    for (size_t i = 0; i < n_workers; i++) {
+        mu_exec_worker_init(&s_workers[i], s_asap_stores[i], ASAP_CAPACITY,
+                            s_deferred_stores[i], 1);
+    }
+    mu_exec_init(&s_exec, s_workers, n_workers, s_inject_store, N_TASKS);
+    s_done = 0;
+    for (size_t i = 0; i < N_TASKS; i++) {
+        s_thermostats[i].acc = i;
+        mu_task_init(&s_thermostats[i].task, thermostat_fn, 0, NULL);
+        mu_task_yield(&s_thermostats[i].task, 0);
+    }
+
+    double t0 = wall_ns();
+    mu_exec_start(&s_exec);
+    struct timespec ts = {.tv_sec = 0, .tv_nsec = 100000};
+    while (__atomic_load_n(&s_done, __ATOMIC_RELAXED) < N_TASKS) {
+        nanosleep(&ts, NULL);
+    }
+    double t1 = wall_ns();
+    mu_exec_stop(&s_exec);
+
+    uint64_t steals = 0;
+    for (size_t i = 0; i < n_workers; i++) {
+        steals += mu_exec_worker_steal_count(&s_workers[i]);
+    }
+    double ns = t1 - t0;
+    if (n_workers == 1) {
+        s_base_ns = ns;
+    }
+    printf("\n%8zu %12.1f %10.2f %10llu", n_workers,
+           ns / ((double)N_TASKS * N_STEPS), s_base_ns / ns,
+           (unsigned long long)steals);
+}
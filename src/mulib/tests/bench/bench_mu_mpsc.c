@@ -0,0 +1,165 @@
+/**
+ * @file bench_mu_mpsc.c
+ *
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/**
+ * @brief Measure mu_mpsc throughput with several producer threads.
+ *
+ * Each producer pushes its own items, numbered in order, and the consumer
+ * checks that each producer's items arrive in order.  Also measures what an
+ * empty queue costs the consumer.  Run it on a host with more cores than
+ * producers: on fewer, the threads only take turns.
+ * This is a POSIX host program.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_mpsc.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#define MAX_PRODUCERS 4
+#define N_ITEMS 1000000 // per producer
+#define N_EMPTY_POPS 10000000
+
+typedef struct {
+    mu_mpsc_node_t node;
+    uint32_t producer;
+    uint32_t seq;
+} item_t;
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static mu_mpsc_t s_mpsc;
+static item_t *s_items; // MAX_PRODUCERS * N_ITEMS
+static unsigned long s_errors;
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static double wall_ns(void);
+static void *producer_fn(void *arg);
+static void bench_producers(int n_producers);
+static void bench_empty(void);
+
+// *****************************************************************************
+// Public code
+
+int main(void) {
+    s_items = malloc(sizeof(item_t) * MAX_PRODUCERS * N_ITEMS);
+    if (s_items == NULL) {
+        return 1;
+    }
+    printf("\nbench_mu_mpsc (%d items per producer)", N_ITEMS);
+    printf("\n%10s %14s", "producers", "Mitems/s");
+    for (int n = 1; n <= MAX_PRODUCERS; n *= 2) {
+        bench_producers(n);
+    }
+    bench_empty();
+    printf("\n");
+    free(s_items);
+    return s_errors != 0;
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+static double wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void *producer_fn(void *arg) {
+    item_t *items = arg;
+    for (uint32_t i = 0; i < N_ITEMS; i++) {
+        mu_mpsc_push(&s_mpsc, &items[i].node);
+    }
+    return NULL;
+}
+
+static void bench_producers(int n_producers) {
+    pthread_t producers[MAX_PRODUCERS];
+    uint32_t next_seq[MAX_PRODUCERS] = {0};
+    unsigned long errors = 0;
+    long remaining = (long)n_producers * N_ITEMS;
+
+    mu_mpsc_init(&s_mpsc);
+    for (int p = 0; p < n_producers; p++) {
+        for (uint32_t i = 0; i < N_ITEMS; i++) {
+            s_items[p * N_ITEMS + i].producer = p;
+            s_items[p * N_ITEMS + i].seq = i;
+        }
+    }
+
+    double t0 = wall_ns();
+    for (int p = 0; p < n_producers; p++) {
+        pthread_create(&producers[p], NULL, producer_fn, &s_items[p * N_ITEMS]);
+    }
+    while (remaining > 0) {
+        mu_mpsc_node_t *node = mu_mpsc_pop(&s_mpsc);
+        if (node == NULL) {
+            sched_yield(); // let the producers run
+            continue;
+        }
+        item_t *item = MU_MPSC_CONTAINER_OF(node, item_t, node);
+        errors += item->seq != next_seq[item->producer];
+        next_seq[item->producer] = item->seq + 1;
+        remaining -= 1;
+    }
+    double ns = wall_ns() - t0;
+    for (int p = 0; p < n_producers; p++) {
+        pthread_join(producers[p], NULL);
+    }
+
+    printf("\n%10d %14.1f", n_producers, n_producers * N_ITEMS * 1e3 / ns);
+    if (errors != 0) {
+        printf("  error: %lu items out of order", errors);
+    }
+    s_errors += errors;
+}
+
+static void bench_empty(void) {
+    unsigned long found = 0;
+
+    mu_mpsc_init(&s_mpsc);
+    double t0 = wall_ns();
+    for (int i = 0; i < N_EMPTY_POPS; i++) {
+        found += mu_mpsc_pop(&s_mpsc) != NULL;
+    }
+    printf("\n%-24s %.2f ns", "pop from an empty queue",
+           (wall_ns() - t0) / N_EMPTY_POPS);
+    s_errors += found;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file bench_mu_pdes.c
+ *
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/**
+ * @brief Measure how a mu_pdes simulation scales with the number of threads.
+ *
+ * Each of N_LPS logical processes stands in for a building full of
+ * thermostats: once a (virtual) second it does a little work and reports to a
+ * neighbouring building over a link with LINK_LATENCY.  The results of every
+ * run are checked against the single threaded run.  This is a POSIX host
+ * program.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_pdes.h"
+#include "mu_sched.h"
+#include "mu_task.h"
+#include "mu_time.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#define MAX_THREADS 8
+#define N_LPS 256
+#define WORK_LOOPS 20000
+#define ONE_SECOND ((mu_time_rel_t)MU_TIME_TICKS_PER_SECOND)
+#define SIM_TIME (600 * ONE_SECOND)
+#define SAMPLE_INTERVAL ONE_SECOND
+#define LINK_LATENCY (ONE_SECOND / 4)
+
+#define LP_DEFERRED_TASKS 4
+#define LP_INBOX 16
+#define LP_OUTBOX 4
+
+typedef struct {
+    mu_sched_t sched;
+    mu_sched_slot_t irq_store[2];
+    mu_sched_slot_t asap_store[2 * MU_CONFIG_SCHED_ASAP_PRIORITIES];
+    mu_sched_deferred_t deferred_store[LP_DEFERRED_TASKS];
+    mu_pdes_msg_t inbox_store[LP_INBOX];
+    mu_pdes_msg_t outbox_store[LP_OUTBOX];
+    mu_task_t sample_task;
+    mu_task_t receive_task;
+    uint32_t acc;
+} building_t;
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static mu_pdes_t s_pdes;
+static mu_pdes_lp_t s_lps[N_LPS];
+static building_t s_buildings[N_LPS];
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static void sample_task_fn(mu_task_t *task, void *arg);
+static void receive_task_fn(mu_task_t *task, void *arg);
+static double wall_ns(void);
+static void bench_threads(size_t n_threads);
+
+// *****************************************************************************
+// Public code
+
+int main(void) {
+    mu_sched_init();
+    printf("\nbench_mu_pdes: %d LPs, %d virtual seconds", N_LPS,
+           (int)(SIM_TIME / ONE_SECOND));
+    printf("\n%8s %12s %10s %10s %10s", "threads", "ns/task", "speedup",
+           "rounds", "same");
+    for (size_t n = 1; n <= MAX_THREADS; n *= 2) {
+        bench_threads(n);
+    }
+    printf("\n");
+    return 0;
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+static void sample_task_fn(mu_task_t *task, void *arg) {
+    (void)arg;
+    building_t *building = MU_TASK_CTX(task, building_t, sample_task);
+    size_t i = building - s_buildings;
+
+    // Stand-in for the work of one control loop iteration.
+    uint32_t acc = building->acc;
+    for (int j = 0; j < WORK_LOOPS; j++) {
+        acc = acc * 1664525 + 1013904223;
+    }
+    building->acc = acc;
+
+    size_t peer = (i + 1 + acc % 7) % N_LPS;
+    mu_pdes_send(&s_lps[peer], &s_buildings[peer].receive_task,
+                 LINK_LATENCY + acc % LINK_LATENCY, acc);
+    mu_sched_defer_for(task, SAMPLE_INTERVAL);
+}
+
+static void receive_task_fn(mu_task_t *task, void *arg) {
+    building_t *building = MU_TASK_CTX(task, building_t, receive_task);
+    const mu_pdes_msg_t *msg = arg;
+    building->acc ^= (uint32_t)msg->data + msg->src;
+}
+
+static double wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench_threads(size_t n_threads) {
+    static double s_base_ns;
+    static uint32_t s_base_acc[N_LPS];
+
+    for (size_t i = 0; i < N_LPS; i++) {
+        building_t *building = &s_buildings[i];
+        mu_sched_inst_init(&building->sched, building->irq_store, 2,
+                           building->asap_store, 2, building->deferred_store,
+                           LP_DEFERRED_TASKS);
+        mu_pdes_lp_init(&s_lps[i], &building->sched, building->inbox_store,
+                        LP_INBOX, building->outbox_store, LP_OUTBOX);
+        mu_task_init(&building->sample_task, sample_task_fn, 0, NULL);
+        mu_task_init(&building->receive_task, receive_task_fn, 0, NULL);
+        building->acc = (uint32_t)i;
+    }
+    mu_pdes_init(&s_pdes, s_lps, N_LPS, LINK_LATENCY, 0);
+    for (size_t i = 0; i < N_LPS; i++) {
+        // stagger the buildings across the sample interval
+        mu_sched_inst_defer_until(&s_buildings[i].sched,
+                                  &s_buildings[i].sample_task,
+                                  i * SAMPLE_INTERVAL / N_LPS);
+    }
+
+    double t0 = wall_ns();
+    size_t n_tasks = mu_pdes_run_until(&s_pdes, SIM_TIME, n_threads);
+    double t1 = wall_ns();
+
+    int same = 1;
+    for (size_t i = 0; i < N_LPS; i++) {
+        if (n_threads == 1) {
+            s_base_acc[i] = s_buildings[i].acc;
+        } else if (s_buildings[i].acc != s_base_acc[i]) {
+            same = 0;
+        }
+    }
+    double ns = t1 - t0;
+    if (n_threads == 1) {
+        s_base_ns = ns;
+    }
+    printf("\n%8zu %12.1f %10.2f %10llu %10s", n_threads, ns / n_tasks,
+           s_base_ns / ns, (unsigned long long)mu_pdes_round_count(&s_pdes),
+           same ? "yes" : "NO");
+}
@@ -0,0 +1,202 @@
+/**
+ * @file bench_mu_spsc.c
+ *
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+/**
+ * @brief Measure how fast null terminated msgs can be taken from a byte ring.
+ *
+ * Each round writes a chunk of msgs into the ring and then splits them into a
+ * caller's buffer, as a receiver of null terminated msgs would.  Compares
+ * taking one byte at a time (like SERCOM3_USART_Read(&ch, 1) calls) with
+ * scanning and copying the spans from mu_ringbuf_peek_read(), on an ordinary
+ * store and on a mirrored one from mu_ringbuf_host_init().  The splitter
+ * checks that every msg arrives intact.
+ * This is a POSIX host program.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_ringbuf.h"
+#include "mu_ringbuf_host.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#define N_BYTES 200000000
+#define CAPACITY 4096 // must be a power of two and a multiple of the page size
+#define MSG_LEN 48    // including the null terminator
+#define CHUNK 1000    // bytes written per round, so msgs straddle the end
+
+typedef enum { MODE_BYTES, MODE_SPANS, MODE_MIRRORED, MODE_COUNT } bench_mode_t;
+
+static const char *s_mode_names[MODE_COUNT] = {
+    "byte at a time",
+    "spans",
+    "mirrored spans",
+};
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static mu_ringbuf_t s_ring;
+static uint8_t s_store[CAPACITY];
+static uint8_t s_stream[MSG_LEN * (CHUNK / MSG_LEN + 2)];
+static char s_msg[MSG_LEN];
+static size_t s_msg_len;
+static unsigned long s_errors;
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static double wall_ns(void);
+
+/**
+ * @brief Take bytes for the current msg from the ring, one at a time.  Return
+ * true when a msg is complete.
+ */
+static bool take_bytes(void);
+
+/**
+ * @brief Take bytes for the current msg from the ring, a span at a time.
+ * Return true when a msg is complete.
+ */
+static bool take_spans(void);
+
+static void check_msg(void);
+static void bench_mode(bench_mode_t mode);
+
+// *****************************************************************************
+// Public code
+
+int main(void) {
+    // A stream of identical msgs "abcd..."
+    for (size_t i = 0; i < sizeof(s_stream); i++) {
+        s_stream[i] = (i % MSG_LEN == MSG_LEN - 1) ? '\0' : 'a' + i % MSG_LEN;
+    }
+    printf("\nbench_mu_ringbuf (%d bytes, capacity %d, %d byte msgs)", N_BYTES,
+           CAPACITY, MSG_LEN);
+    printf("\n%-22s %14s", "take", "MB/s");
+    for (int mode = 0; mode < MODE_COUNT; mode++) {
+        bench_mode((bench_mode_t)mode);
+    }
+    printf("\n");
+    return s_errors != 0;
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+static double wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static bool take_bytes(void) {
+    uint8_t ch;
+
+    while (mu_ringbuf_read(&s_ring, &ch, 1) == 1) {
+        s_msg[s_msg_len++] = ch;
+        if ((ch == '\0') || (s_msg_len == sizeof(s_msg))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool take_spans(void) {
+    mu_ringbuf_span_t spans[2];
+
+    mu_ringbuf_peek_read(&s_ring, spans);
+    for (int i = 0; i < 2; i++) {
+        size_t n = sizeof(s_msg) - s_msg_len;
+        if (n > spans[i].len) {
+            n = spans[i].len;
+        }
+        uint8_t *nul = memchr(spans[i].data, '\0', n);
+        if (nul != NULL) {
+            n = nul - spans[i].data + 1;
+        }
+        memcpy(&s_msg[s_msg_len], spans[i].data, n);
+        mu_ringbuf_consume(&s_ring, n);
+        s_msg_len += n;
+        if ((nul != NULL) || (s_msg_len == sizeof(s_msg))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void check_msg(void) {
+    if ((s_msg_len != MSG_LEN) || (memcmp(s_msg, s_stream, MSG_LEN) != 0)) {
+        s_errors += 1;
+    }
+    s_msg_len = 0;
+}
+
+static void bench_mode(bench_mode_t mode) {
+    unsigned long msgs = 0;
+    size_t offset = 0; // position in s_stream, always at a msg boundary
+    double t0;
+
+    if (mode == MODE_MIRRORED) {
+        if (!mu_ringbuf_host_init(&s_ring, CAPACITY)) {
+            printf("\n%-22s %14s", s_mode_names[mode], "unavailable");
+            return;
+        }
+    } else {
+        mu_ringbuf_init(&s_ring, s_store, CAPACITY);
+    }
+    s_msg_len = 0;
+
+    t0 = wall_ns();
+    for (long total = 0; total < N_BYTES; total += CHUNK) {
+        if (mu_ringbuf_write(&s_ring, &s_stream[offset], CHUNK) != CHUNK) {
+            s_errors += 1;
+        }
+        offset = (offset + CHUNK) % MSG_LEN;
+        while ((mode == MODE_BYTES) ? take_bytes() : take_spans()) {
+            check_msg();
+            msgs += 1;
+        }
+    }
+    double dt = wall_ns() - t0;
+
+    if (mode == MODE_MIRRORED) {
+        mu_ringbuf_host_deinit(&s_ring);
+    }
+    if (msgs != N_BYTES / MSG_LEN) {
+        s_errors += 1;
+    }
+    printf("\n%-22s %14.1f", s_mode_names[mode], N_BYTES / dt * 1e3);
+}
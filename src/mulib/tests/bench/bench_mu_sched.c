@@ -0,0 +1,171 @@
+/**
+ * @file bench_mu_sched.c
+ *
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/**
+ * @brief Measure the cost of inserting and dispatching deferred tasks.
+ *
+ * Build as bench_mu_sched_array and bench_mu_sched_heap (see CMakeLists.txt)
+ * and compare the per-operation costs of the two deferred queue backends.
+ * Also compares running asap tasks one mu_sched_step() at a time against
+ * running them in batches with mu_sched_drain().
+ * This is a POSIX host program.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_sched.h"
+#include "mu_task.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#ifdef MU_CONFIG_SCHED_DEFERRED_HEAP
+#define BACKEND_NAME "heap"
+#else
+#define BACKEND_NAME "array"
+#endif
+
+#define N_YIELDING_TASKS 16
+#define N_YIELDS 1000000
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static mu_task_t s_tasks[MU_CONFIG_SCHED_MAX_DEFERRED_TASKS];
+static mu_time_abs_t s_time;
+static size_t s_call_count;
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static mu_time_abs_t get_bench_time(void);
+static void bench_task_fn(mu_task_t *task, void *arg);
+static double wall_ns(void);
+static void bench_deferred(size_t n);
+static void yielding_task_fn(mu_task_t *task, void *arg);
+static void bench_batching(void);
+
+// *****************************************************************************
+// Public code
+
+int main(void) {
+    printf("\nbench_mu_sched (%s backend)", BACKEND_NAME);
+    printf("\n%8s %14s %14s", "tasks", "insert ns/op", "dispatch ns/op");
+    for (size_t n = 256; n < MU_CONFIG_SCHED_MAX_DEFERRED_TASKS; n *= 4) {
+        bench_deferred(n);
+    }
+    bench_deferred(MU_CONFIG_SCHED_MAX_DEFERRED_TASKS);
+    bench_batching();
+    printf("\n");
+    return 0;
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+static mu_time_abs_t get_bench_time(void) { return s_time; }
+
+static void bench_task_fn(mu_task_t *task, void *arg) {
+    (void)task;
+    (void)arg;
+    s_call_count += 1;
+}
+
+static double wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench_deferred(size_t n) {
+    mu_sched_init();
+    mu_sched_set_clock_source(get_bench_time);
+    s_time = 0;
+    s_call_count = 0;
+    srand(1);
+
+    // Insert n tasks at pseudo-random times, with plenty of duplicates.
+    double t0 = wall_ns();
+    for (size_t i = 0; i < n; i++) {
+        mu_task_init(&s_tasks[i], bench_task_fn, 0, NULL);
+        mu_sched_defer_until(&s_tasks[i], 1 + rand() % (n * 4));
+    }
+    double t1 = wall_ns();
+
+    // Dispatch them all: every task is runnable.
+    s_time = n * 4 + 1;
+    for (size_t i = 0; i < n; i++) {
+        mu_sched_step();
+    }
+    double t2 = wall_ns();
+
+    if (s_call_count != n) {
+        printf("\nerror: dispatched %zu of %zu tasks", s_call_count, n);
+    }
+    printf("\n%8zu %14.1f %14.1f", n, (t1 - t0) / n, (t2 - t1) / n);
+}
+
+static void yielding_task_fn(mu_task_t *task, void *arg) {
+    (void)arg;
+    s_call_count += 1;
+    mu_sched_asap(task);
+}
+
+static void bench_batching(void) {
+    double ns[2];
+
+    // Busy asap tasks plus one deferred task that is an hour away, using the
+    // real clock: mu_sched_step() reads the clock on every call.
+    for (int use_drain = 0; use_drain < 2; use_drain++) {
+        mu_sched_init();
+        mu_task_init(&s_tasks[0], bench_task_fn, 0, NULL);
+        mu_sched_defer_for(&s_tasks[0], mu_time_ms_to_rel(3600 * 1000));
+        for (int i = 1; i <= N_YIELDING_TASKS; i++) {
+            mu_task_init(&s_tasks[i], yielding_task_fn, 0, NULL);
+            mu_sched_asap(&s_tasks[i]);
+        }
+        s_call_count = 0;
+        double t0 = wall_ns();
+        if (use_drain) {
+            while (s_call_count < N_YIELDS) {
+                mu_sched_drain();
+            }
+        } else {
+            while (s_call_count < N_YIELDS) {
+                mu_sched_step();
+            }
+        }
+        ns[use_drain] = (wall_ns() - t0) / s_call_count;
+    }
+    printf("\n%8s %14s %14s", "asap", "step ns/task", "drain ns/task");
+    printf("\n%8d %14.1f %14.1f", N_YIELDING_TASKS, ns[0], ns[1]);
+}
@@ -0,0 +1,188 @@
+/**
+ * @file bench_mu_timer.c
+ *
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+/**
+ * @brief Simulate a year of thermostat polling in virtual time.
+ *
+ * Each zone is polled once a minute.  A poll arms a response timeout, the
+ * "response" arrives a little later and cancels it, and a simple hysteresis
+ * controller decides whether to heat.  The room temperature drifts towards
+ * the outside temperature or the heater output between polls.  This is a
+ * POSIX host program.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_sched.h"
+#include "mu_sim.h"
+#include "mu_task.h"
+#include "mu_time.h"
+#include "mu_timer.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#define N_ZONES 16
+#define ONE_SECOND ((mu_time_rel_t)MU_TIME_TICKS_PER_SECOND)
+#define ONE_DAY (86400 * ONE_SECOND)
+#define N_DAYS 365
+#define POLL_INTERVAL (60 * ONE_SECOND)
+#define RESPONSE_TIMEOUT (5 * ONE_SECOND)
+#define RESPONSE_DELAY (ONE_SECOND / 5)
+
+// temperatures in millidegrees C
+#define SETPOINT 20000
+#define HYSTERESIS 500
+
+typedef struct {
+    mu_task_t poll_task;     // polls the zone once a minute
+    mu_task_t response_task; // the zone's (simulated) response
+    mu_task_t timeout_task;  // runs if the response is late
+    mu_timer_t timeout;
+    int32_t temperature;
+    bool heating;
+    uint32_t switch_count;   // number of times the heater switched on or off
+} zone_t;
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static zone_t s_zones[N_ZONES];
+static uint32_t s_timeout_count;
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static void poll_task_fn(mu_task_t *task, void *arg);
+static void response_task_fn(mu_task_t *task, void *arg);
+static void timeout_task_fn(mu_task_t *task, void *arg);
+static int32_t outside_temperature(mu_time_abs_t at);
+static double wall_ns(void);
+
+// *****************************************************************************
+// Public code
+
+int main(void) {
+    mu_sched_init();
+    mu_sim_init(0);
+#ifdef MU_CONFIG_TIMER_WHEEL
+    mu_timer_wheel_init();
+#endif
+
+    for (int i = 0; i < N_ZONES; i++) {
+        zone_t *zone = &s_zones[i];
+        mu_task_init(&zone->poll_task, poll_task_fn, 0, NULL);
+        mu_task_init(&zone->response_task, response_task_fn, 0, NULL);
+        mu_task_init(&zone->timeout_task, timeout_task_fn, 0, NULL);
+        mu_timer_init(&zone->timeout);
+        zone->temperature = SETPOINT;
+        zone->heating = false;
+        zone->switch_count = 0;
+        // stagger the zones across the polling interval
+        mu_sched_defer_for(&zone->poll_task, i * POLL_INTERVAL / N_ZONES);
+    }
+
+    double t0 = wall_ns();
+    size_t n_tasks = mu_sim_run_until(N_DAYS * ONE_DAY);
+    double t1 = wall_ns();
+
+    uint32_t switch_count = 0;
+    for (int i = 0; i < N_ZONES; i++) {
+        switch_count += s_zones[i].switch_count;
+    }
+    printf("\nbench_mu_sim (%d zones, %d days)", N_ZONES, N_DAYS);
+    printf("\n  tasks run:     %10zu", n_tasks);
+    printf("\n  heater cycles: %10u", switch_count);
+    printf("\n  timeouts:      %10u", s_timeout_count);
+    printf("\n  wall time:     %10.3f s", (t1 - t0) / 1e9);
+    printf("\n  speedup:       %10.0fx",
+           (double)N_DAYS * 86400 / ((t1 - t0) / 1e9));
+    printf("\n");
+    return 0;
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+static void poll_task_fn(mu_task_t *task, void *arg) {
+    (void)arg;
+    zone_t *zone = MU_TASK_CTX(task, zone_t, poll_task);
+    mu_timer_start(&zone->timeout, RESPONSE_TIMEOUT, false,
+                   &zone->timeout_task);
+    mu_sched_defer_for(&zone->response_task, RESPONSE_DELAY);
+    mu_sched_defer_for(task, POLL_INTERVAL);
+}
+
+static void response_task_fn(mu_task_t *task, void *arg) {
+    (void)arg;
+    zone_t *zone = MU_TASK_CTX(task, zone_t, response_task);
+    mu_timer_stop(&zone->timeout);
+
+    // Move a tenth of the way towards the outside temperature, plus heat.
+    int32_t outside = outside_temperature(mu_sched_get_current_time());
+    zone->temperature += (outside - zone->temperature) / 10;
+    if (zone->heating) {
+        zone->temperature += 1500;
+    }
+
+    bool heating = zone->heating;
+    if (zone->temperature < SETPOINT - HYSTERESIS) {
+        heating = true;
+    } else if (zone->temperature > SETPOINT + HYSTERESIS) {
+        heating = false;
+    }
+    if (heating != zone->heating) {
+        zone->heating = heating;
+        zone->switch_count += 1;
+    }
+}
+
+static void timeout_task_fn(mu_task_t *task, void *arg) {
+    (void)task;
+    (void)arg;
+    s_timeout_count += 1;
+}
+
+static int32_t outside_temperature(mu_time_abs_t at) {
+    // A crude triangle wave: 0C at midnight, 10C at noon.
+    mu_time_rel_t t = (mu_time_rel_t)(at % ONE_DAY);
+    mu_time_rel_t half = ONE_DAY / 2;
+    mu_time_rel_t from_midnight = t < half ? t : ONE_DAY - t;
+    return (int32_t)(from_midnight * 10000 / half);
+}
+
+static double wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file bench_mu_snap.c
+ *
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/**
+ * @brief Measure how long it takes to save and restore a snapshot of a large
+ * emulator.
+ *
+ * Each of N_DEVICES emulated thermostats has a poll task waiting in the
+ * deferred queue, a running response timer and a model.  The snapshot is
+ * saved, the program state is wiped as if the program had restarted, and the
+ * snapshot is restored.  This is a POSIX host program.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_sched.h"
+#include "mu_snap.h"
+#include "mu_task.h"
+#include "mu_time.h"
+#include "mu_timer.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#define N_DEVICES 100000
+#define ONE_SECOND ((mu_time_rel_t)MU_TIME_TICKS_PER_SECOND)
+#define POLL_INTERVAL (60 * ONE_SECOND)
+#define RESPONSE_TIMEOUT (5 * ONE_SECOND)
+
+typedef struct {
+    int32_t ambient;
+    int32_t setpoint;
+    uint8_t relay_w;
+    uint8_t relay_y;
+} model_t;
+
+typedef struct {
+    mu_task_t poll_task;
+    mu_task_t timeout_task;
+    mu_timer_t timeout;
+} device_t;
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static device_t s_devices[N_DEVICES];
+static model_t s_models[N_DEVICES];
+static mu_task_t *s_tasks[2 * N_DEVICES];
+static mu_timer_t *s_timers[N_DEVICES];
+static mu_snap_index_t s_index[3 * N_DEVICES];
+static mu_snap_region_t s_regions[] = {
+    {.key = 1, .data = s_models, .size = sizeof(s_models)},
+};
+static mu_snap_t s_snap;
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static void device_fn(mu_task_t *task, void *arg);
+static void init_devices(void);
+static double wall_ns(void);
+
+// *****************************************************************************
+// Public code
+
+int main(void) {
+    char path[] = "/tmp/bench_mu_snap_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return 1;
+    }
+    close(fd);
+
+    // Start the devices, staggered across the polling interval.
+    init_devices();
+    for (int i = 0; i < N_DEVICES; i++) {
+        device_t *device = &s_devices[i];
+        mu_sched_defer_for(&device->poll_task,
+                           (mu_time_rel_t)i * POLL_INTERVAL / N_DEVICES);
+        mu_timer_start(&device->timeout, RESPONSE_TIMEOUT + i, false,
+                       &device->timeout_task);
+        s_models[i].ambient = 20000 + i % 1000;
+        s_models[i].setpoint = 21000;
+    }
+
+    double t0 = wall_ns();
+    mu_snap_err_t save_err = mu_snap_save(&s_snap, path);
+    double t1 = wall_ns();
+
+    // Restart.
+    init_devices();
+    memset(s_models, 0, sizeof(s_models));
+    double t2 = wall_ns();
+    mu_snap_err_t restore_err = mu_snap_restore(&s_snap, path, true, NULL);
+    double t3 = wall_ns();
+    unlink(path);
+
+    printf("\nbench_mu_snap (%d devices)", N_DEVICES);
+    printf("\n  save:    %8.1f ms (err %d)", (t1 - t0) / 1e6, save_err);
+    printf("\n  restore: %8.1f ms (err %d)", (t3 - t2) / 1e6, restore_err);
+    printf("\n  models restored: %s",
+           s_models[N_DEVICES - 1].setpoint == 21000 ? "yes" : "NO");
+    printf("\n");
+    return 0;
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+static void device_fn(mu_task_t *task, void *arg) {
+    (void)task;
+    (void)arg;
+}
+
+static void init_devices(void) {
+    mu_sched_init();
+    for (int i = 0; i < N_DEVICES; i++) {
+        device_t *device = &s_devices[i];
+        mu_task_init(&device->poll_task, device_fn, 0, NULL);
+        mu_task_init(&device->timeout_task, device_fn, 0, NULL);
+        mu_timer_init(&device->timeout);
+        s_tasks[2 * i] = &device->poll_task;
+        s_tasks[2 * i + 1] = &device->timeout_task;
+        s_timers[i] = &device->timeout;
+    }
+    mu_snap_init(&s_snap, mu_sched_default_instance(), s_tasks, 2 * N_DEVICES,
+                 s_timers, N_DEVICES, s_index);
+    mu_snap_set_regions(&s_snap, s_regions, 1);
+}
+
+static double wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
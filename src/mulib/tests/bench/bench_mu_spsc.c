@@ -0,0 +1,215 @@
+/**
+ * @file bench_mu_spsc.c
+ *
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/**
+ * @brief Measure mu_spsc throughput between a producer and a consumer thread.
+ *
+ * Compares the previous mu_spsc (volatile 16-bit indices, reproduced below)
+ * with the current one, item by item and with mu_spsc_put_n()/get_n().  The
+ * consumer checks that every item arrives in order.  Run it on a host with at
+ * least two cores: on one core the threads only take turns.
+ * This is a POSIX host program.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_spsc.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#define N_ITEMS 20000000
+#define CAPACITY 4096 // must be a power of two
+#define BATCH 64
+
+typedef enum { MODE_LEGACY, MODE_SINGLE, MODE_BULK, MODE_COUNT } bench_mode_t;
+
+static const char *s_mode_names[MODE_COUNT] = {
+    "previous mu_spsc",
+    "mu_spsc_put/get",
+    "mu_spsc_put_n/get_n",
+};
+
+// The previous implementation, for comparison.
+typedef struct {
+    uint16_t mask;
+    volatile uint16_t head;
+    volatile uint16_t tail;
+    mu_spsc_item_t *store;
+} legacy_spsc_t;
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static mu_spsc_t s_spsc;
+static legacy_spsc_t s_legacy;
+static mu_spsc_item_t s_store[CAPACITY];
+static bench_mode_t s_mode;
+static uintptr_t s_errors;
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static double wall_ns(void);
+static bool legacy_put(legacy_spsc_t *q, mu_spsc_item_t item);
+static bool legacy_get(legacy_spsc_t *q, mu_spsc_item_t *item);
+static void *producer_fn(void *arg);
+static void *consumer_fn(void *arg);
+static void bench_mode(bench_mode_t mode);
+
+// *****************************************************************************
+// Public code
+
+int main(void) {
+    printf("\nbench_mu_spsc (%d items, capacity %d, batch %d)", N_ITEMS,
+           CAPACITY, BATCH);
+    printf("\n%-22s %14s", "queue", "Mitems/s");
+    for (int mode = 0; mode < MODE_COUNT; mode++) {
+        bench_mode((bench_mode_t)mode);
+    }
+    printf("\n");
+    return s_errors != 0;
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+static double wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static bool legacy_put(legacy_spsc_t *q, mu_spsc_item_t item) {
+    uint16_t next_tail = (q->tail + 1) & q->mask;
+    if (next_tail == q->head) {
+        return false;
+    }
+    q->store[q->tail] = item;
+    q->tail = next_tail;
+    return true;
+}
+
+static bool legacy_get(legacy_spsc_t *q, mu_spsc_item_t *item) {
+    if (q->head == q->tail) {
+        return false;
+    }
+    *item = q->store[q->head];
+    q->head = (q->head + 1) & q->mask;
+    return true;
+}
+
+static void *producer_fn(void *arg) {
+    (void)arg;
+    uintptr_t next = 1; // items are 1 .. N_ITEMS, never NULL
+
+    while (next <= N_ITEMS) {
+        bool progress;
+        if (s_mode == MODE_LEGACY) {
+            progress = legacy_put(&s_legacy, (mu_spsc_item_t)next);
+            next += progress;
+        } else if (s_mode == MODE_SINGLE) {
+            progress = mu_spsc_put(&s_spsc, (mu_spsc_item_t)next) ==
+                       MU_SPSC_ERR_NONE;
+            next += progress;
+        } else {
+            mu_spsc_item_t items[BATCH];
+            uint32_t n = BATCH;
+            if (n > N_ITEMS + 1 - next) {
+                n = (uint32_t)(N_ITEMS + 1 - next);
+            }
+            for (uint32_t i = 0; i < n; i++) {
+                items[i] = (mu_spsc_item_t)(next + i);
+            }
+            // Items that don't fit are offered again next time round.
+            n = mu_spsc_put_n(&s_spsc, items, n);
+            next += n;
+            progress = n > 0;
+        }
+        if (!progress) {
+            sched_yield(); // full: let the consumer catch up
+        }
+    }
+    return NULL;
+}
+
+static void *consumer_fn(void *arg) {
+    (void)arg;
+    uintptr_t expected = 1;
+
+    while (expected <= N_ITEMS) {
+        mu_spsc_item_t items[BATCH];
+        uint32_t n;
+        if (s_mode == MODE_LEGACY) {
+            n = legacy_get(&s_legacy, &items[0]);
+        } else if (s_mode == MODE_SINGLE) {
+            n = mu_spsc_get(&s_spsc, &items[0]) == MU_SPSC_ERR_NONE;
+        } else {
+            n = mu_spsc_get_n(&s_spsc, items, BATCH);
+        }
+        if (n == 0) {
+            sched_yield(); // empty: let the producer get ahead
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            s_errors += (uintptr_t)items[i] != expected;
+            expected += 1;
+        }
+    }
+    return NULL;
+}
+
+static void bench_mode(bench_mode_t mode) {
+    pthread_t producer;
+    pthread_t consumer;
+
+    s_mode = mode;
+    s_legacy.mask = CAPACITY - 1;
+    s_legacy.head = 0;
+    s_legacy.tail = 0;
+    s_legacy.store = s_store;
+    mu_spsc_init(&s_spsc, s_store, CAPACITY);
+
+    uintptr_t errors = s_errors;
+    double t0 = wall_ns();
+    pthread_create(&consumer, NULL, consumer_fn, NULL);
+    pthread_create(&producer, NULL, producer_fn, NULL);
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+    double ns = wall_ns() - t0;
+
+    printf("\n%-22s %14.1f", s_mode_names[mode], N_ITEMS * 1e3 / ns);
+    if (s_errors != errors) {
+        printf("  error: %lu items out of order",
+               (unsigned long)(s_errors - errors));
+    }
+}
@@ -0,0 +1,161 @@
+/**
+ * @file bench_mu_time.c
+ *
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/**
+ * @brief Measure the cost of reading the time.
+ *
+ * Compares clock(), which mu_time_now() used to call, against the POSIX
+ * monotonic clocks, mu_time_now() itself and the cycle counter, and then
+ * measures mu_sched_get_current_time() from within a task.  Build as
+ * bench_mu_time and bench_mu_time_cached (see CMakeLists.txt) to compare the
+ * latter with and without MU_CONFIG_SCHED_CACHED_NOW.
+ * This is a POSIX host program.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_sched.h"
+#include "mu_task.h"
+#include "mu_time.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#ifdef MU_CONFIG_SCHED_CACHED_NOW
+#define NOW_NAME "cached"
+#else
+#define NOW_NAME "uncached"
+#endif
+
+#define N_CALLS 10000000
+#define N_TASKS 1000
+#define N_READS_PER_TASK 100
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static mu_task_t s_tasks[N_TASKS];
+static uint64_t s_sink; // keeps the reads from being optimized away
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static double wall_ns(void);
+static uint64_t read_clock(void);
+static uint64_t read_monotonic(void);
+static uint64_t read_monotonic_raw(void);
+static uint64_t read_mu_time(void);
+static uint64_t read_cycles(void);
+static uint64_t read_cycles_ordered(void);
+static void bench_source(const char *name, uint64_t (*fn)(void));
+static void reading_task_fn(mu_task_t *task, void *arg);
+static void bench_sched_time(void);
+
+// *****************************************************************************
+// Public code
+
+int main(void) {
+    mu_time_init();
+    printf("\nbench_mu_time (%s scheduler time, %.3f cycles/ns)", NOW_NAME,
+           mu_time_cycles_per_second() / 1e9);
+    printf("\n%-28s %10s", "source", "ns/call");
+    bench_source("clock()", read_clock);
+    bench_source("CLOCK_MONOTONIC", read_monotonic);
+    bench_source("CLOCK_MONOTONIC_RAW", read_monotonic_raw);
+    bench_source("mu_time_now()", read_mu_time);
+    bench_source("mu_time_cycles()", read_cycles);
+    bench_source("mu_time_cycles_ordered()", read_cycles_ordered);
+    bench_sched_time();
+    printf("\n");
+    return s_sink == 0; // never true, but uses s_sink
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+static double wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint64_t read_clock(void) { return (uint64_t)clock(); }
+
+static uint64_t read_monotonic(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t read_monotonic_raw(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t read_mu_time(void) { return mu_time_now(); }
+
+static uint64_t read_cycles(void) { return mu_time_cycles(); }
+
+static uint64_t read_cycles_ordered(void) { return mu_time_cycles_ordered(); }
+
+static void bench_source(const char *name, uint64_t (*fn)(void)) {
+    double t0 = wall_ns();
+    for (int i = 0; i < N_CALLS; i++) {
+        s_sink += fn();
+    }
+    printf("\n%-28s %10.1f", name, (wall_ns() - t0) / N_CALLS);
+}
+
+static void reading_task_fn(mu_task_t *task, void *arg) {
+    (void)arg;
+    for (int i = 0; i < N_READS_PER_TASK; i++) {
+        s_sink += mu_sched_get_current_time();
+    }
+    mu_sched_asap(task);
+}
+
+static void bench_sched_time(void) {
+    // Each task reads the scheduler's time repeatedly, so the cost of the
+    // reads dominates the cost of running the tasks.
+    mu_sched_init();
+    for (int i = 0; i < N_TASKS; i++) {
+        mu_task_init(&s_tasks[i], reading_task_fn, 0, NULL);
+        mu_sched_asap(&s_tasks[i]);
+    }
+    int batches = N_CALLS / (N_TASKS * N_READS_PER_TASK);
+    double t0 = wall_ns();
+    for (int i = 0; i < batches; i++) {
+        mu_sched_drain();
+    }
+    printf("\n%-28s %10.1f", "mu_sched_get_current_time()",
+           (wall_ns() - t0) / N_CALLS);
+}
@@ -0,0 +1,139 @@
+/**
+ * @file bench_mu_timer.c
+ *
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/**
+ * @brief Measure the cost of starting, restarting and expiring many timers.
+ *
+ * Build as bench_mu_timer_sched and bench_mu_timer_wheel (see CMakeLists.txt)
+ * to compare timers run from the scheduler's deferred queue against timers run
+ * from the timing wheel.  This is a POSIX host program.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_sched.h"
+#include "mu_task.h"
+#include "mu_timer.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#ifdef MU_CONFIG_TIMER_WHEEL
+#define ENGINE_NAME "timing wheel"
+#else
+#define ENGINE_NAME "deferred queue"
+#endif
+
+#define N_TIMERS 100000
+#define N_RESTARTS 50000
+#define MAX_DELAY 1000000
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static mu_timer_t s_timers[N_TIMERS];
+static mu_task_t s_on_completion;
+static mu_time_abs_t s_time;
+static size_t s_call_count;
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static mu_time_abs_t get_bench_time(void);
+static void on_completion_fn(mu_task_t *task, void *arg);
+static double wall_ns(void);
+
+// *****************************************************************************
+// Public code
+
+int main(void) {
+    mu_sched_init();
+    mu_sched_set_clock_source(get_bench_time);
+    s_time = 0;
+#ifdef MU_CONFIG_TIMER_WHEEL
+    mu_timer_wheel_init();
+#endif
+    mu_task_init(&s_on_completion, on_completion_fn, 0, NULL);
+    srand(1);
+
+    double t0 = wall_ns();
+    for (size_t i = 0; i < N_TIMERS; i++) {
+        mu_timer_init(&s_timers[i]);
+        mu_timer_start(&s_timers[i], 1 + rand() % MAX_DELAY, false,
+                       &s_on_completion);
+    }
+    double t1 = wall_ns();
+
+    // Re-arm running timers, as a timeout is re-armed on each message.
+    for (size_t i = 0; i < N_RESTARTS; i++) {
+        mu_timer_start(&s_timers[rand() % N_TIMERS], 1 + rand() % MAX_DELAY,
+                       false, &s_on_completion);
+    }
+    double t2 = wall_ns();
+
+    // Advance time in coarse steps until every timer has fired.
+    while (s_call_count < N_TIMERS && s_time <= MAX_DELAY) {
+        s_time += 1000;
+        for (int i = 0; i < 2000; i++) {
+            mu_sched_step();
+        }
+    }
+    double t3 = wall_ns();
+
+    printf("\nbench_mu_timer (%s, %d timers)", ENGINE_NAME, N_TIMERS);
+    printf("\n  start:   %10.1f ns/op", (t1 - t0) / N_TIMERS);
+    printf("\n  restart: %10.1f ns/op (%.0f restarts/s)",
+           (t2 - t1) / N_RESTARTS, N_RESTARTS * 1e9 / (t2 - t1));
+    printf("\n  expire:  %10.1f ns/op", (t3 - t2) / N_TIMERS);
+    if (s_call_count != N_TIMERS) {
+        printf("\nerror: %zu of %d timers fired", s_call_count, N_TIMERS);
+    }
+    printf("\n");
+    return 0;
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+static mu_time_abs_t get_bench_time(void) { return s_time; }
+
+static void on_completion_fn(mu_task_t *task, void *arg) {
+    (void)task;
+    (void)arg;
+    s_call_count += 1;
+}
+
+static double wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
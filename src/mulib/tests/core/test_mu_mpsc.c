@@ -0,0 +1,127 @@
+/**
+ * @file test_mu_mpsc.c
+ *
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_mpsc.h"
+#include "test_support.h"
+#include <stdio.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+typedef struct {
+    int value;
+    mu_mpsc_node_t node;
+} item_t;
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static int pop_value(mu_mpsc_t *q);
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static mu_mpsc_t s_mpsc;
+static item_t s_items[3];
+
+// *****************************************************************************
+// Public code
+
+void test_mu_mpsc(void) {
+    printf("\nStarting test_mu_mpsc...");
+
+    for (int i = 0; i < 3; i++) {
+        s_items[i].value = i + 1;
+    }
+
+    // void mu_mpsc_init(mu_mpsc_t *q);
+    mu_mpsc_init(&s_mpsc);
+    MU_ASSERT(mu_mpsc_is_empty(&s_mpsc));
+    MU_ASSERT(mu_mpsc_pop(&s_mpsc) == NULL);
+    MU_ASSERT(mu_mpsc_peek(&s_mpsc) == NULL);
+
+    // void mu_mpsc_push(mu_mpsc_t *q, mu_mpsc_node_t *node);
+    // mu_mpsc_node_t *mu_mpsc_pop(mu_mpsc_t *q);
+    // FIFO order is preserved, including for the last node in the queue
+    mu_mpsc_push(&s_mpsc, &s_items[0].node);
+    MU_ASSERT(!mu_mpsc_is_empty(&s_mpsc));
+    mu_mpsc_push(&s_mpsc, &s_items[1].node);
+    mu_mpsc_push(&s_mpsc, &s_items[2].node);
+    MU_ASSERT(pop_value(&s_mpsc) == 1);
+    MU_ASSERT(pop_value(&s_mpsc) == 2);
+    MU_ASSERT(pop_value(&s_mpsc) == 3);
+    MU_ASSERT(pop_value(&s_mpsc) == 0);
+    MU_ASSERT(mu_mpsc_is_empty(&s_mpsc));
+
+    // popped nodes may be pushed again, and pushes interleave with pops
+    mu_mpsc_push(&s_mpsc, &s_items[2].node);
+    MU_ASSERT(pop_value(&s_mpsc) == 3);
+    mu_mpsc_push(&s_mpsc, &s_items[0].node);
+    mu_mpsc_push(&s_mpsc, &s_items[2].node);
+    MU_ASSERT(pop_value(&s_mpsc) == 1);
+    mu_mpsc_push(&s_mpsc, &s_items[1].node);
+    MU_ASSERT(pop_value(&s_mpsc) == 3);
+    MU_ASSERT(pop_value(&s_mpsc) == 2);
+    MU_ASSERT(pop_value(&s_mpsc) == 0);
+
+    // mu_mpsc_node_t *mu_mpsc_peek(mu_mpsc_t *q);
+    // mu_mpsc_node_t *mu_mpsc_next(mu_mpsc_t *q, mu_mpsc_node_t *node);
+    // walking the queue skips the stub node, wherever it is in the list
+    mu_mpsc_push(&s_mpsc, &s_items[0].node);
+    mu_mpsc_push(&s_mpsc, &s_items[1].node);
+    mu_mpsc_push(&s_mpsc, &s_items[2].node);
+    {
+        int expected = 1;
+        for (mu_mpsc_node_t *node = mu_mpsc_peek(&s_mpsc); node != NULL;
+             node = mu_mpsc_next(&s_mpsc, node)) {
+            MU_ASSERT(MU_MPSC_CONTAINER_OF(node, item_t, node)->value ==
+                      expected);
+            expected += 1;
+        }
+        MU_ASSERT(expected == 4);
+    }
+    MU_ASSERT(pop_value(&s_mpsc) == 1);
+    MU_ASSERT(pop_value(&s_mpsc) == 2);
+    MU_ASSERT(pop_value(&s_mpsc) == 3);
+
+    printf("\n   Completed test_mu_mpsc.");
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+// Return the value of the item popped from q, or 0 if q is empty.
+static int pop_value(mu_mpsc_t *q) {
+    mu_mpsc_node_t *node = mu_mpsc_pop(q);
+    if (node == NULL) {
+        return 0;
+    }
+    return MU_MPSC_CONTAINER_OF(node, item_t, node)->value;
+}
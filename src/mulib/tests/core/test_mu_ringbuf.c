@@ -0,0 +1,153 @@
+/**
+ * @file test_mu_spsc.c
+ *
+ * MIT License
+ *
+ * Copyright (c) 2022 - 2023 R. Dunbar Poor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+// *****************************************************************************
+// Includes
+
+#include "mu_ringbuf.h"
+#include "test_support.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#define RINGBUF_SIZE 8
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static uint8_t s_store[RINGBUF_SIZE];
+
+// *****************************************************************************
+// Local (private, static) storage
+
+// *****************************************************************************
+// Public code
+
+void test_mu_ringbuf(void) {
+    printf("\nStarting test_mu_ringbuf...");
+
+    mu_ringbuf_t rb;
+    mu_ringbuf_span_t spans[2];
+    uint8_t buf[RINGBUF_SIZE + 2];
+
+    // size must be a power of two and greater than one
+    MU_ASSERT(mu_ringbuf_init(&rb, s_store, 1) == MU_RINGBUF_ERR_SIZE);
+    MU_ASSERT(mu_ringbuf_init(&rb, s_store, 6) == MU_RINGBUF_ERR_SIZE);
+    MU_ASSERT(mu_ringbuf_init(&rb, s_store, RINGBUF_SIZE) ==
+              MU_RINGBUF_ERR_NONE);
+
+    // every byte of the store is usable
+    MU_ASSERT(mu_ringbuf_capacity(&rb) == RINGBUF_SIZE);
+    MU_ASSERT(mu_ringbuf_is_empty(&rb));
+
+    // an empty ring offers the whole store as one span
+    MU_ASSERT(mu_ringbuf_reserve_write(&rb, spans) == RINGBUF_SIZE);
+    MU_ASSERT(spans[0].data == s_store);
+    MU_ASSERT(spans[0].len == RINGBUF_SIZE);
+    MU_ASSERT(spans[1].len == 0);
+    MU_ASSERT(mu_ringbuf_peek_read(&rb, spans) == 0);
+
+    // fill in place, then commit part of the reservation
+    MU_ASSERT(mu_ringbuf_reserve_write(&rb, spans) == RINGBUF_SIZE);
+    memcpy(spans[0].data, "abcdef", 6);
+    MU_ASSERT(mu_ringbuf_commit_write(&rb, 6) == 6);
+    MU_ASSERT(mu_ringbuf_count(&rb) == 6);
+
+    // peek doesn't remove bytes; consume does
+    MU_ASSERT(mu_ringbuf_peek_read(&rb, spans) == 6);
+    MU_ASSERT(spans[0].data == s_store);
+    MU_ASSERT(spans[0].len == 6);
+    MU_ASSERT(spans[1].len == 0);
+    MU_ASSERT(memcmp(spans[0].data, "abcdef", 6) == 0);
+    MU_ASSERT(mu_ringbuf_peek_read(&rb, spans) == 6);
+    MU_ASSERT(mu_ringbuf_consume(&rb, 4) == 4);
+    MU_ASSERT(mu_ringbuf_count(&rb) == 2);
+
+    // free space now wraps: 2 bytes at the end, 4 at the start
+    MU_ASSERT(mu_ringbuf_reserve_write(&rb, spans) == 6);
+    MU_ASSERT(spans[0].data == &s_store[6]);
+    MU_ASSERT(spans[0].len == 2);
+    MU_ASSERT(spans[1].data == s_store);
+    MU_ASSERT(spans[1].len == 4);
+    memcpy(spans[0].data, "gh", 2);
+    memcpy(spans[1].data, "ij", 2);
+    MU_ASSERT(mu_ringbuf_commit_write(&rb, 4) == 4);
+
+    // ...and so does the data
+    MU_ASSERT(mu_ringbuf_peek_read(&rb, spans) == 6);
+    MU_ASSERT(spans[0].data == &s_store[4]);
+    MU_ASSERT(spans[0].len == 4);
+    MU_ASSERT(memcmp(spans[0].data, "efgh", 4) == 0);
+    MU_ASSERT(spans[1].data == s_store);
+    MU_ASSERT(spans[1].len == 2);
+    MU_ASSERT(memcmp(spans[1].data, "ij", 2) == 0);
+
+    // commit and consume are clipped to what is available
+    MU_ASSERT(mu_ringbuf_reserve_write(&rb, spans) == 2);
+    MU_ASSERT(mu_ringbuf_commit_write(&rb, 5) == 2);
+    MU_ASSERT(mu_ringbuf_count(&rb) == RINGBUF_SIZE);
+    MU_ASSERT(mu_ringbuf_reserve_write(&rb, spans) == 0);
+    MU_ASSERT(spans[0].len == 0);
+    MU_ASSERT(spans[1].len == 0);
+    MU_ASSERT(mu_ringbuf_peek_read(&rb, spans) == RINGBUF_SIZE);
+    MU_ASSERT(mu_ringbuf_consume(&rb, RINGBUF_SIZE + 1) == RINGBUF_SIZE);
+    MU_ASSERT(mu_ringbuf_is_empty(&rb));
+
+    // copying write and read wrap across the end of the store
+    MU_ASSERT(mu_ringbuf_write(&rb, "0123456789", 10) == RINGBUF_SIZE);
+    MU_ASSERT(mu_ringbuf_read(&rb, buf, 3) == 3);
+    MU_ASSERT(memcmp(buf, "012", 3) == 0);
+    MU_ASSERT(mu_ringbuf_write(&rb, "89", 2) == 2);
+    MU_ASSERT(mu_ringbuf_read(&rb, buf, sizeof(buf)) == 7);
+    MU_ASSERT(memcmp(buf, "3456789", 7) == 0);
+    MU_ASSERT(mu_ringbuf_read(&rb, buf, sizeof(buf)) == 0);
+
+    // reset empties the ring
+    MU_ASSERT(mu_ringbuf_write(&rb, "xy", 2) == 2);
+    MU_ASSERT(mu_ringbuf_reset(&rb) == MU_RINGBUF_ERR_NONE);
+    MU_ASSERT(mu_ringbuf_is_empty(&rb));
+    MU_ASSERT(mu_ringbuf_reserve_write(&rb, spans) == RINGBUF_SIZE);
+
+    // a mirrored ring hands out one span even where the store wraps.  The
+    // spans aren't touched here, only described.
+    MU_ASSERT(mu_ringbuf_init_mirrored(&rb, s_store, RINGBUF_SIZE) ==
+              MU_RINGBUF_ERR_NONE);
+    MU_ASSERT(mu_ringbuf_reserve_write(&rb, spans) == RINGBUF_SIZE);
+    MU_ASSERT(mu_ringbuf_commit_write(&rb, 6) == 6);
+    MU_ASSERT(mu_ringbuf_peek_read(&rb, spans) == 6);
+    MU_ASSERT(mu_ringbuf_consume(&rb, 5) == 5);
+    MU_ASSERT(mu_ringbuf_reserve_write(&rb, spans) == 7);
+    MU_ASSERT(spans[0].data == &s_store[6]);
+    MU_ASSERT(spans[0].len == 7);
+    MU_ASSERT(spans[1].len == 0);
+
+    printf("\n   Completed test_mu_ringbuf.");
+}
@@ -31,11 +31,45 @@
 #include "mu_sched.h"
 #include "test_support.h"
 #include <stdio.h>
+#include <stdlib.h>
 
 
 // *****************************************************************************
 // Local (private) types and definitions
 
+#define N_ORDERED_TASKS 8
+
+// Scheduler statistics and load accounting read the clock whenever a task is
+// queued or run, so clock read counts are only checked without them.
+#if defined(MU_CONFIG_SCHED_STATS) || defined(MU_CONFIG_SCHED_LOAD)
+#define ASSERT_CLOCK_READS(n)
+#else
+#define ASSERT_CLOCK_READS(n) MU_ASSERT(s_clock_reads == (n))
+#endif
+
+// How long s_slow_task takes to run.
+#define SLOW_TASK_TICKS 30
+
+// Storage for a small scheduler instance.
+#define DEVICE_IRQ_TASKS 4
+#define DEVICE_ASAP_TASKS 4
+#define DEVICE_DEFERRED_TASKS 4
+
+typedef struct {
+    mu_sched_t sched;
+    mu_sched_slot_t irq_store[DEVICE_IRQ_TASKS];
+    mu_sched_slot_t asap_store[MU_CONFIG_SCHED_ASAP_PRIORITIES *
+                               DEVICE_ASAP_TASKS];
+    mu_sched_deferred_t deferred_store[DEVICE_DEFERRED_TASKS];
+    mu_time_abs_t time;
+} device_t;
+
+// A task that records the order in which it was called.
+typedef struct {
+    mu_task_t task;
+    int id;
+} ordered_obj_t;
+
 // *****************************************************************************
 // Local (private, static) storage
 
@@ -47,6 +81,28 @@ static mu_task_t *s_task1;
 static mu_task_t *s_task2;
 static mu_time_abs_t s_time;
 static mu_task_t s_basic_task;
+static ordered_obj_t s_ordered_objs[N_ORDERED_TASKS];
+static int s_call_order[N_ORDERED_TASKS];
+static int s_call_order_count;
+static int s_clock_reads;
+static mu_task_t s_yielding_task;
+static int s_yield_count;
+static device_t s_devices[2];
+static mu_sched_t *s_seen_instance; // set by instance_task_fn
+static mu_task_t s_flood_task;
+static int s_flood_count;
+#ifdef MU_CONFIG_SCHED_LOAD
+static mu_task_t s_slow_task; // takes SLOW_TASK_TICKS to run
+#endif
+#ifdef MU_CONFIG_SCHED_CACHED_NOW
+static mu_task_t s_clock_tasks[3]; // record the time, then advance the clock
+static mu_time_abs_t s_seen_times[3];
+static int s_seen_count;
+#endif
+#ifdef MU_CONFIG_SCHED_GROWABLE
+static int s_live_blocks;  // blocks handed out by grow_alloc()
+static bool s_alloc_fails; // makes grow_alloc() fail
+#endif
 
 // *****************************************************************************
 // Local (private, static) forward declarations
@@ -55,6 +111,23 @@ static void setup(void);
 static mu_time_abs_t get_test_time(void);
 static void set_test_time(mu_time_abs_t time);
 static void basic_task_fn(mu_task_t *task, void *arg);
+static void ordered_task_fn(mu_task_t *task, void *arg);
+static void yielding_task_fn(mu_task_t *task, void *arg);
+static void instance_task_fn(mu_task_t *task, void *arg);
+static void flood_task_fn(mu_task_t *task, void *arg);
+static mu_sched_t *device_init(device_t *device, mu_clock_fn clock_fn);
+static mu_time_abs_t device0_time(void);
+static mu_time_abs_t device1_time(void);
+#ifdef MU_CONFIG_SCHED_LOAD
+static void slow_task_fn(mu_task_t *task, void *arg);
+#endif
+#ifdef MU_CONFIG_SCHED_CACHED_NOW
+static void clock_task_fn(mu_task_t *task, void *arg);
+#endif
+#ifdef MU_CONFIG_SCHED_GROWABLE
+static void *grow_alloc(size_t size, void *arg);
+static void grow_free(void *ptr, void *arg);
+#endif
 
 // *****************************************************************************
 // Public code
@@ -176,6 +249,37 @@ void test_mu_sched(void) {
     MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
     MU_ASSERT(counting_obj_get_call_count(&s_obj2) == 1);
 
+    // mu_task_err_t mu_sched_defer_until_slack(mu_task_t *task,
+    //                                          mu_time_abs_t at,
+    //                                          mu_time_rel_t slack);
+    setup();
+    {
+        mu_time_abs_t at;
+        // alone, a task goes to the time in its window with the most
+        // trailing zero bits: 8 in [5, 15]
+        MU_ASSERT(mu_sched_defer_until_slack(s_task1, 5, 10) ==
+                  MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_next_deadline(&at) == true);
+        MU_ASSERT(at == 8);
+        // a task whose window holds the next wakeup shares it
+        MU_ASSERT(mu_sched_defer_for_slack(s_task2, 6, 4) == MU_TASK_ERR_NONE);
+        // ...otherwise it doesn't: 10 in [9, 11]
+        MU_ASSERT(mu_sched_defer_until_slack(&s_ordered_objs[0].task, 9, 2) ==
+                  MU_TASK_ERR_NONE);
+        // no slack, no coalescing
+        MU_ASSERT(mu_sched_defer_until_slack(&s_ordered_objs[1].task, 5, 0) ==
+                  MU_TASK_ERR_NONE);
+        set_test_time(7);
+        MU_ASSERT(mu_sched_drain() == 1);
+        MU_ASSERT(s_call_order[0] == 1);
+        set_test_time(8);
+        MU_ASSERT(mu_sched_drain() == 2);
+        MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+        MU_ASSERT(counting_obj_get_call_count(&s_obj2) == 1);
+        MU_ASSERT(mu_sched_next_deadline(&at) == true);
+        MU_ASSERT(at == 10);
+    }
+
     // mu_task_err_t mu_sched_remove_deferred_task(mu_task_t *task);
     setup();
     MU_ASSERT(mu_sched_defer_until(s_task1, 10) == MU_TASK_ERR_NONE);
@@ -201,13 +305,747 @@ void test_mu_sched(void) {
     MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 0);
     MU_ASSERT(counting_obj_get_call_count(&s_obj2) == 1);
 
-    // mu_task_t *mu_sched_get_current_task(void);
+    // deferred tasks run in time order, equal times run in FIFO order
+    setup();
+    {
+        // id:               0  1  2  3  4  5  6  7
+        mu_time_abs_t at[] = {7, 3, 5, 3, 9, 1, 5, 3};
+        int expected[] = {5, 1, 3, 7, 2, 6, 0, 4};
+        for (int i = 0; i < N_ORDERED_TASKS; i++) {
+            MU_ASSERT(mu_sched_defer_until(&s_ordered_objs[i].task, at[i]) ==
+                      MU_TASK_ERR_NONE);
+        }
+        // removing a task doesn't disturb the order of the others
+        MU_ASSERT(mu_sched_defer_until(s_task1, 4) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_remove_deferred_task(s_task1) == MU_TASK_ERR_NONE);
+        set_test_time(10);
+        for (int i = 0; i < N_ORDERED_TASKS; i++) {
+            mu_sched_step();
+        }
+        MU_ASSERT(s_call_order_count == N_ORDERED_TASKS);
+        for (int i = 0; i < N_ORDERED_TASKS; i++) {
+            MU_ASSERT(s_call_order[i] == expected[i]);
+        }
+        MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 0);
+        MU_ASSERT(counting_obj_get_call_count(&s_idle_obj) == 0);
+    }
+
+    // deferring a deferred task adds another entry, so to reschedule a task,
+    // remove it first
+    setup();
+    {
+        // id:               0  1  2  3  4  5  6  7
+        mu_time_abs_t at[] = {7, 3, 5, 3, 9, 1, 5, 3};
+        for (int i = 0; i < N_ORDERED_TASKS; i++) {
+            MU_ASSERT(mu_sched_defer_until(&s_ordered_objs[i].task, at[i]) ==
+                      MU_TASK_ERR_NONE);
+        }
+        // move 4 to the front, 5 to the back and 1 behind the other 3s
+        int move[] = {4, 5, 1};
+        mu_time_abs_t move_to[] = {0, 8, 3};
+        for (int i = 0; i < 3; i++) {
+            mu_task_t *task = &s_ordered_objs[move[i]].task;
+            MU_ASSERT(mu_sched_remove_deferred_task(task) == MU_TASK_ERR_NONE);
+            MU_ASSERT(mu_sched_defer_until(task, move_to[i]) ==
+                      MU_TASK_ERR_NONE);
+        }
+        // a task deferred twice runs twice...
+        MU_ASSERT(mu_sched_defer_until(s_task2, 4) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_defer_until(s_task2, 6) == MU_TASK_ERR_NONE);
+        // ...unless it is removed, which removes both entries
+        MU_ASSERT(mu_sched_defer_until(s_task1, 4) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_defer_until(s_task1, 2) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_remove_deferred_task(s_task1) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_remove_deferred_task(s_task1) ==
+                  MU_TASK_ERR_NOT_FOUND);
+        int expected[] = {4, 3, 7, 1, 2, 6, 0, 5};
+        set_test_time(10);
+        for (int i = 0; i < N_ORDERED_TASKS + 3; i++) {
+            mu_sched_step();
+        }
+        MU_ASSERT(s_call_order_count == N_ORDERED_TASKS);
+        for (int i = 0; i < N_ORDERED_TASKS; i++) {
+            MU_ASSERT(s_call_order[i] == expected[i]);
+        }
+        MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 0);
+        MU_ASSERT(counting_obj_get_call_count(&s_obj2) == 2);
+        MU_ASSERT(counting_obj_get_call_count(&s_idle_obj) == 1);
+    }
+    // the remaining entry of a task that has run once can still be removed
+    setup();
+    MU_ASSERT(mu_sched_defer_until(s_task1, 5) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_defer_until(s_task1, 15) == MU_TASK_ERR_NONE);
+    set_test_time(10);
+    MU_ASSERT(mu_sched_drain() == 1);
+    MU_ASSERT(mu_sched_is_deferred(s_task1) == true);
+    MU_ASSERT(mu_sched_remove_deferred_task(s_task1) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_is_deferred(s_task1) == false);
+    set_test_time(20);
+    MU_ASSERT(mu_sched_drain() == 0);
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+    // a task left deferred across mu_sched_reset() can be deferred again
+    MU_ASSERT(mu_sched_defer_until(s_task1, 20) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_defer_until(s_task2, 21) == MU_TASK_ERR_NONE);
+    mu_sched_reset();
+    MU_ASSERT(mu_sched_is_deferred(s_task1) == false);
+    MU_ASSERT(mu_sched_remove_deferred_task(s_task1) == MU_TASK_ERR_NOT_FOUND);
+    MU_ASSERT(mu_sched_defer_until(s_task2, 25) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_defer_until(s_task1, 25) == MU_TASK_ERR_NONE);
+    set_test_time(25);
+    MU_ASSERT(mu_sched_drain() == 2);
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 2);
+    MU_ASSERT(counting_obj_get_call_count(&s_obj2) == 1);
+
+    // a deferral of more than 2^31 ticks (about 2 s) waits for its time
+    setup();
+    MU_ASSERT(mu_sched_defer_for(s_task1, 3 * MU_TIME_TICKS_PER_SECOND) ==
+              MU_TASK_ERR_NONE);
+    mu_sched_step();
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 0);
+    MU_ASSERT(counting_obj_get_call_count(&s_idle_obj) == 1);
+    set_test_time(3 * MU_TIME_TICKS_PER_SECOND - 1);
+    mu_sched_step();
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 0);
+    set_test_time(3 * MU_TIME_TICKS_PER_SECOND);
+    mu_sched_step();
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+
+#ifdef MU_CONFIG_TASK_IDS
+    // a deferred time must lie within MU_SCHED_AT_RANGE of the current time
+    setup();
+    set_test_time(1000);
+    MU_ASSERT(mu_sched_defer_until(s_task1, 1000 + MU_SCHED_AT_RANGE) ==
+              MU_TASK_ERR_SCHED_RANGE);
+    MU_ASSERT(mu_sched_defer_until(s_task1, 1000 - MU_SCHED_AT_RANGE) ==
+              MU_TASK_ERR_SCHED_RANGE);
+#ifdef MU_CONFIG_SCHED_STATS
+    // ...and a time out of range isn't counted as a full queue
+    {
+        const mu_sched_stats_t *stats = mu_sched_get_stats();
+        MU_ASSERT(stats->queues[MU_SCHED_QUEUE_DEFERRED].sched_full == 0);
+    }
+#endif
+    MU_ASSERT(mu_sched_defer_until(s_task1, 1000 + MU_SCHED_AT_RANGE - 1) ==
+              MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_defer_until(s_task2, 2000) == MU_TASK_ERR_NONE);
+    {
+        mu_time_abs_t at;
+        MU_ASSERT(mu_sched_next_deadline(&at) == true);
+        MU_ASSERT(at == 2000);
+    }
+    set_test_time(2000);
+    MU_ASSERT(mu_sched_drain() == 1);
+    MU_ASSERT(counting_obj_get_call_count(&s_obj2) == 1);
+    set_test_time(1000 + MU_SCHED_AT_RANGE - 2);
+    MU_ASSERT(mu_sched_drain() == 0);
+    set_test_time(1000 + MU_SCHED_AT_RANGE - 1);
+    MU_ASSERT(mu_sched_drain() == 1);
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+#endif
+
+    // deferred times keep their order across a 32 bit boundary
+    setup();
+    {
+        const mu_time_abs_t base = 0x1FFFFFF00;
+        MU_ASSERT(mu_sched_defer_until(s_task2, base + 0x200) ==
+                  MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_defer_until(s_task1, base + 0x80) ==
+                  MU_TASK_ERR_NONE);
+        mu_time_abs_t at;
+        MU_ASSERT(mu_sched_next_deadline(&at) == true);
+        MU_ASSERT(at == base + 0x80);
+        set_test_time(base + 0x100);
+        MU_ASSERT(mu_sched_drain() == 1);
+        MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+        MU_ASSERT(mu_sched_next_deadline(&at) == true);
+        MU_ASSERT(at == base + 0x200);
+        set_test_time(base + 0x200);
+        MU_ASSERT(mu_sched_drain() == 1);
+        MU_ASSERT(counting_obj_get_call_count(&s_obj2) == 1);
+    }
+
+    // asap tasks run in priority order, equal priorities run in FIFO order
+    setup();
+    {
+        // id:                   0  1  2  3  4  5  6  7
+        mu_sched_prio_t prio[] = {3, 1, 0, 2, 1, 9, 0, 2};
+        int expected[N_ORDERED_TASKS];
+        int n_expected = 0;
+        for (mu_sched_prio_t p = 0; p <= MU_SCHED_PRIO_LOWEST; p++) {
+            for (int i = 0; i < N_ORDERED_TASKS; i++) {
+                mu_sched_prio_t clamped = prio[i] > MU_SCHED_PRIO_LOWEST
+                                              ? MU_SCHED_PRIO_LOWEST
+                                              : prio[i];
+                if (clamped == p) {
+                    expected[n_expected++] = i;
+                }
+            }
+        }
+        for (int i = 0; i < N_ORDERED_TASKS; i++) {
+            MU_ASSERT(mu_sched_asap_prio(&s_ordered_objs[i].task, prio[i]) ==
+                      MU_TASK_ERR_NONE);
+        }
+        MU_ASSERT(mu_sched_peek_next_task() ==
+                  &s_ordered_objs[expected[0]].task);
+        for (int i = 0; i < N_ORDERED_TASKS; i++) {
+            mu_sched_step();
+        }
+        MU_ASSERT(s_call_order_count == N_ORDERED_TASKS);
+        for (int i = 0; i < N_ORDERED_TASKS; i++) {
+            MU_ASSERT(s_call_order[i] == expected[i]);
+        }
+        MU_ASSERT(mu_sched_peek_next_task() == NULL);
+        MU_ASSERT(counting_obj_get_call_count(&s_idle_obj) == 0);
+        // all queues are drained: the idle task runs
+        mu_sched_step();
+        MU_ASSERT(counting_obj_get_call_count(&s_idle_obj) == 1);
+    }
+
+    // mu_sched_step() doesn't read the clock when nothing is deferred
+    setup();
+    MU_ASSERT(mu_sched_asap(s_task1) == MU_TASK_ERR_NONE);
+    s_clock_reads = 0;
+    mu_sched_step();
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+    ASSERT_CLOCK_READS(0);
+
+    // int mu_sched_drain(void);
+    // a batch runs irq, then due deferred, then asap tasks, reading the clock
+    // once.
+    setup();
+    {
+        // id:               0  1  2  3  4  5  6  7
+        mu_time_abs_t at[] = {0, 0, 0, 5, 3, 0, 0, 0};
+        int expected[] = {2, 4, 3, 0, 1, 6};
+        MU_ASSERT(mu_sched_asap(&s_ordered_objs[0].task) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_asap(&s_ordered_objs[1].task) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_from_isr(&s_ordered_objs[2].task) ==
+                  MU_TASK_ERR_NONE);
+        for (int i = 3; i < 5; i++) {
+            MU_ASSERT(mu_sched_defer_until(&s_ordered_objs[i].task, at[i]) ==
+                      MU_TASK_ERR_NONE);
+        }
+        MU_ASSERT(mu_sched_defer_until(&s_ordered_objs[5].task, 20) ==
+                  MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_asap(&s_ordered_objs[6].task) == MU_TASK_ERR_NONE);
+        set_test_time(10);
+        s_clock_reads = 0;
+        MU_ASSERT(mu_sched_drain() == 6);
+        ASSERT_CLOCK_READS(1);
+        MU_ASSERT(s_call_order_count == 6);
+        for (int i = 0; i < 6; i++) {
+            MU_ASSERT(s_call_order[i] == expected[i]);
+        }
+        // nothing left to run until time 20: the idle task is not run
+        MU_ASSERT(mu_sched_drain() == 0);
+        MU_ASSERT(counting_obj_get_call_count(&s_idle_obj) == 0);
+        set_test_time(20);
+        MU_ASSERT(mu_sched_drain() == 1);
+        MU_ASSERT(s_call_order[6] == 5);
+        // with nothing deferred, draining doesn't read the clock
+        s_clock_reads = 0;
+        MU_ASSERT(mu_sched_drain() == 0);
+        ASSERT_CLOCK_READS(0);
+    }
+
+    // a task that re-schedules itself runs once per batch
+    setup();
+    MU_ASSERT(mu_sched_asap(&s_yielding_task) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_drain() == 1);
+    MU_ASSERT(s_yield_count == 1);
+    MU_ASSERT(mu_sched_drain() == 1);
+    MU_ASSERT(s_yield_count == 2);
+
+    // int mu_sched_run_for(mu_time_rel_t budget);
+    // s_yielding_task advances the clock by one per call: a budget of 5 runs
+    // five batches, each reading the clock once.
+    setup();
+    MU_ASSERT(mu_sched_asap(&s_yielding_task) == MU_TASK_ERR_NONE);
+    s_clock_reads = 0;
+    MU_ASSERT(mu_sched_run_for(5) == 5);
+    MU_ASSERT(s_yield_count == 5);
+    ASSERT_CLOCK_READS(6);
+    // returns early when there is nothing left to run
+    setup();
+    MU_ASSERT(mu_sched_run_for(5) == 0);
+
+#ifdef MU_CONFIG_SCHED_FROM_THREAD
+    // Tasks scheduled from other threads run in order, after the irq tasks
+    // and before the asap tasks, and are queued at most once.
+    setup();
+    {
+        int expected[] = {2, 0, 1, 3};
+        MU_ASSERT(mu_sched_asap(&s_ordered_objs[3].task) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_from_thread(&s_ordered_objs[0].task) ==
+                  MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_from_thread(&s_ordered_objs[1].task) ==
+                  MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_from_thread(&s_ordered_objs[0].task) ==
+                  MU_TASK_ERR_NONE); // already queued: a no-op
+        MU_ASSERT(mu_sched_from_isr(&s_ordered_objs[2].task) ==
+                  MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_drain() == 4);
+        MU_ASSERT(s_call_order_count == 4);
+        for (int i = 0; i < 4; i++) {
+            MU_ASSERT(s_call_order[i] == expected[i]);
+        }
+        // once taken from the queue, a task may be scheduled again
+        MU_ASSERT(mu_sched_from_thread(&s_ordered_objs[0].task) ==
+                  MU_TASK_ERR_NONE);
+        mu_sched_step();
+        MU_ASSERT(s_call_order_count == 5 && s_call_order[4] == 0);
+        mu_sched_step(); // nothing queued: the idle task runs
+        MU_ASSERT(counting_obj_get_call_count(&s_idle_obj) == 1);
+    }
+#endif
+
+#ifdef MU_CONFIG_SCHED_CACHED_NOW
+    // Every task in a batch sees the time at which the batch read the clock,
+    // even though each one advances it.
+    setup();
+    s_seen_count = 0;
+    for (int i = 0; i < 3; i++) {
+        mu_task_init(&s_clock_tasks[i], clock_task_fn, 0, NULL);
+        MU_ASSERT(mu_sched_asap(&s_clock_tasks[i]) == MU_TASK_ERR_NONE);
+    }
+    set_test_time(10);
+    s_clock_reads = 0;
+    MU_ASSERT(mu_sched_drain() == 3);
+    ASSERT_CLOCK_READS(1);
+    for (int i = 0; i < 3; i++) {
+        MU_ASSERT(s_seen_times[i] == 10);
+    }
+    // outside of a batch, the clock is read afresh
+    MU_ASSERT(mu_sched_get_current_time() == 13);
+    // mu_sched_step() is not a batch: each step reads the clock
+    s_seen_count = 0;
+    MU_ASSERT(mu_sched_asap(&s_clock_tasks[0]) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_asap(&s_clock_tasks[1]) == MU_TASK_ERR_NONE);
+    mu_sched_step();
+    mu_sched_step();
+    MU_ASSERT(s_seen_times[0] == 13 && s_seen_times[1] == 14);
+#endif
+
+#ifdef MU_CONFIG_SCHED_STATS
+    // lateness, queue wait times, high-water marks and SCHED_FULL counts
+    setup();
+    {
+        const mu_sched_stats_t *stats = mu_sched_get_stats();
+        const mu_sched_queue_stats_t *deferred =
+            &stats->queues[MU_SCHED_QUEUE_DEFERRED];
+        const mu_sched_queue_stats_t *asap = &stats->queues[MU_SCHED_QUEUE_ASAP];
+        const mu_sched_queue_stats_t *irq = &stats->queues[MU_SCHED_QUEUE_IRQ];
+        mu_sched_hist_t task_lateness;
+
+        MU_ASSERT(deferred->capacity == MU_CONFIG_SCHED_MAX_DEFERRED_TASKS);
+        MU_ASSERT(asap->capacity == MU_CONFIG_SCHED_MAX_ASAP_TASKS);
+        MU_ASSERT(stats->lateness.count == 0);
+
+        mu_sched_hist_reset(&task_lateness);
+        mu_sched_set_lateness_hist(s_task1, &task_lateness);
+        // queued at 0, due at 3 and 4, run at 10: late by 7 and 6 ticks.
+        MU_ASSERT(mu_sched_defer_until(s_task1, 3) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_defer_until(s_task2, 4) == MU_TASK_ERR_NONE);
+        MU_ASSERT(deferred->high_water == 2);
+        set_test_time(10);
+        mu_sched_step();
+        mu_sched_step();
+        MU_ASSERT(stats->lateness.count == 2);
+        MU_ASSERT(stats->lateness.max == 7);
+        MU_ASSERT(stats->lateness.buckets[3] == 2); // 4..7
+        MU_ASSERT(task_lateness.count == 1);
+        MU_ASSERT(task_lateness.buckets[3] == 1);
+        MU_ASSERT(deferred->wait.count == 2);
+        MU_ASSERT(deferred->wait.max == 10);
+
+        // queued at 10, run at 11: waited 1 tick.  run at 12: waited 2.
+        MU_ASSERT(mu_sched_asap(s_task1) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_from_isr(s_task2) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_from_isr(s_task2) == MU_TASK_ERR_NONE);
+        set_test_time(11);
+        mu_sched_step(); // irq
+        mu_sched_step(); // irq
+        mu_sched_step(); // asap
+        MU_ASSERT(irq->high_water == 2);
+        MU_ASSERT(irq->wait.count == 2);
+        MU_ASSERT(irq->wait.buckets[1] == 2);
+        MU_ASSERT(asap->high_water == 1);
+        MU_ASSERT(asap->wait.count == 1);
+        MU_ASSERT(asap->wait.max == 1);
+
+        // fill the deferred queue and count the overflow
+        for (int i = 0; i < MU_CONFIG_SCHED_MAX_DEFERRED_TASKS; i++) {
+            MU_ASSERT(mu_sched_defer_until(s_task1, 100) == MU_TASK_ERR_NONE);
+        }
+        MU_ASSERT(mu_sched_defer_until(s_task1, 100) ==
+                  MU_TASK_ERR_SCHED_FULL);
+        MU_ASSERT(deferred->sched_full == 1);
+        MU_ASSERT(deferred->high_water == MU_CONFIG_SCHED_MAX_DEFERRED_TASKS);
+
+        mu_sched_reset_stats();
+        MU_ASSERT(deferred->sched_full == 0);
+        MU_ASSERT(deferred->high_water == 0);
+        MU_ASSERT(stats->lateness.count == 0);
+        MU_ASSERT(deferred->capacity == MU_CONFIG_SCHED_MAX_DEFERRED_TASKS);
+        mu_sched_set_lateness_hist(s_task1, NULL);
+    }
+#endif
+
+#ifdef MU_CONFIG_SCHED_DEDUP
+    // a dedup task is queued at most once until it runs
+    setup();
+    mu_sched_set_dedup(s_task1, true);
+    MU_ASSERT(mu_sched_asap(s_task1) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_asap(s_task1) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_from_isr(s_task1) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_asap_prio(s_task1, MU_SCHED_PRIO_HIGHEST) ==
+              MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_asap(s_task2) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_asap(s_task2) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_drain() == 3);
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+    MU_ASSERT(counting_obj_get_call_count(&s_obj2) == 2);
+    // ...and may be queued again once it has run, from the irq queue too
+    MU_ASSERT(mu_sched_from_isr(s_task1) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_asap(s_task1) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_drain() == 1);
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 2);
+    // the mark is cleared before the task runs, so a task can yield
+    mu_sched_set_dedup(&s_yielding_task, true);
+    MU_ASSERT(mu_sched_asap(&s_yielding_task) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_drain() == 1);
+    MU_ASSERT(mu_sched_drain() == 1);
+    MU_ASSERT(s_yield_count == 2);
+    // a mark left by a task dropped by mu_sched_init() doesn't block it
+    MU_ASSERT(mu_sched_asap(s_task1) == MU_TASK_ERR_NONE);
+    mu_sched_init();
+    MU_ASSERT(mu_sched_asap(s_task1) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_drain() == 1);
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 3);
+    // a full queue doesn't leave the task marked
+    for (int i = 0; i < MU_CONFIG_SCHED_MAX_ASAP_TASKS; i++) {
+        MU_ASSERT(mu_sched_asap(s_task2) == MU_TASK_ERR_NONE);
+    }
+    MU_ASSERT(mu_sched_asap(s_task1) == MU_TASK_ERR_SCHED_FULL);
+    MU_ASSERT(mu_sched_drain() == MU_CONFIG_SCHED_MAX_ASAP_TASKS);
+    MU_ASSERT(mu_sched_asap(s_task1) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_drain() == 1);
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 4);
+    mu_sched_set_dedup(s_task1, false);
+#endif
+
+#ifdef MU_CONFIG_SCHED_EDF
+    // deadline tasks run earliest deadline first, ahead of any asap task
+    setup();
+    {
+        const mu_time_abs_t deadlines[N_ORDERED_TASKS] = {70, 20, 50, 20,
+                                                           90, 10, 50, 30};
+        const int expected[N_ORDERED_TASKS] = {5, 1, 3, 7, 2, 6, 0, 4};
+        MU_ASSERT(mu_sched_asap_prio(s_task1, MU_SCHED_PRIO_HIGHEST) ==
+                  MU_TASK_ERR_NONE);
+        for (int i = 0; i < N_ORDERED_TASKS; i++) {
+            MU_ASSERT(mu_sched_asap_deadline(&s_ordered_objs[i].task,
+                                             deadlines[i]) ==
+                      MU_TASK_ERR_NONE);
+        }
+        MU_ASSERT(mu_sched_peek_next_task() == &s_ordered_objs[5].task);
+        set_test_time(40);
+        MU_ASSERT(mu_sched_drain() == N_ORDERED_TASKS + 1);
+        MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+        for (int i = 0; i < N_ORDERED_TASKS; i++) {
+            MU_ASSERT(s_call_order[i] == expected[i]);
+        }
+        // tasks 5, 1, 3 and 7 ran after their deadlines
+        MU_ASSERT(mu_sched_get_deadline_misses() == 4);
+        MU_ASSERT(mu_sched_get_task_deadline_misses(&s_ordered_objs[5].task) ==
+                  1);
+        MU_ASSERT(mu_sched_get_task_deadline_misses(&s_ordered_objs[2].task) ==
+                  0);
+
+        // a deadline task runs after a due deferred task, one per step
+        MU_ASSERT(mu_task_yield_deadline(s_task2, 0, 45) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_defer_until(s_task1, 40) == MU_TASK_ERR_NONE);
+        mu_sched_step();
+        MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 2);
+        MU_ASSERT(counting_obj_get_call_count(&s_obj2) == 0);
+        mu_sched_step();
+        MU_ASSERT(counting_obj_get_call_count(&s_obj2) == 1);
+        MU_ASSERT(mu_sched_get_task_deadline_misses(s_task2) == 0);
+        MU_ASSERT(mu_sched_get_deadline_misses() == 4);
+
+        // the deadline queue has a fixed capacity
+        for (int i = 0; i < MU_CONFIG_SCHED_MAX_EDF_TASKS; i++) {
+            MU_ASSERT(mu_sched_asap_deadline(s_task2, 100) == MU_TASK_ERR_NONE);
+        }
+        MU_ASSERT(mu_sched_asap_deadline(s_task1, 100) ==
+                  MU_TASK_ERR_SCHED_FULL);
+#ifdef MU_CONFIG_SCHED_STATS
+        // deadline tasks are counted with the asap queue
+        const mu_sched_queue_stats_t *asap =
+            &mu_sched_get_stats()->queues[MU_SCHED_QUEUE_ASAP];
+        MU_ASSERT(asap->sched_full == 1);
+        MU_ASSERT(asap->high_water == MU_CONFIG_SCHED_MAX_EDF_TASKS);
+#endif
+        MU_ASSERT(mu_sched_drain() == MU_CONFIG_SCHED_MAX_EDF_TASKS);
+        MU_ASSERT(mu_sched_get_deadline_misses() == 4);
+#ifdef MU_CONFIG_SCHED_DEDUP
+        // a dedup task already queued isn't refused when the queue is full...
+        mu_sched_set_dedup(s_task1, true);
+        MU_ASSERT(mu_sched_asap_deadline(s_task1, 100) == MU_TASK_ERR_NONE);
+        for (int i = 1; i < MU_CONFIG_SCHED_MAX_EDF_TASKS; i++) {
+            MU_ASSERT(mu_sched_asap_deadline(s_task2, 100) == MU_TASK_ERR_NONE);
+        }
+        MU_ASSERT(mu_sched_asap_deadline(s_task1, 100) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_drain() == MU_CONFIG_SCHED_MAX_EDF_TASKS);
+        // ...and a refused one isn't left marked
+        for (int i = 0; i < MU_CONFIG_SCHED_MAX_EDF_TASKS; i++) {
+            MU_ASSERT(mu_sched_asap_deadline(s_task2, 100) == MU_TASK_ERR_NONE);
+        }
+        MU_ASSERT(mu_sched_asap_deadline(s_task1, 100) ==
+                  MU_TASK_ERR_SCHED_FULL);
+        MU_ASSERT(mu_sched_drain() == MU_CONFIG_SCHED_MAX_EDF_TASKS);
+        MU_ASSERT(mu_sched_asap_deadline(s_task1, 100) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_drain() == 1);
+        mu_sched_set_dedup(s_task1, false);
+#endif
+    }
+#endif
+
+#ifdef MU_CONFIG_SCHED_FAIR
+    // an irq flood can't starve asap tasks
+    setup();
+    MU_ASSERT(mu_sched_from_isr(&s_flood_task) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_asap(s_task1) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_asap(s_task2) == MU_TASK_ERR_NONE);
+    for (int i = 0; i < MU_CONFIG_SCHED_FAIR_IRQ_WEIGHT + 1; i++) {
+        mu_sched_step();
+    }
+    MU_ASSERT(s_flood_count == MU_CONFIG_SCHED_FAIR_IRQ_WEIGHT);
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+    MU_ASSERT(counting_obj_get_call_count(&s_obj2) == 0);
+    for (int i = 0; i < MU_CONFIG_SCHED_FAIR_IRQ_WEIGHT + 1; i++) {
+        mu_sched_step();
+    }
+    MU_ASSERT(counting_obj_get_call_count(&s_obj2) == 1);
+#ifdef MU_CONFIG_SCHED_STATS
+    MU_ASSERT(mu_sched_get_stats()->queues[MU_SCHED_QUEUE_ASAP].wait.max ==
+              2 * MU_CONFIG_SCHED_FAIR_IRQ_WEIGHT);
+#endif
+
+    // weights set the ratio of irq to asap dispatches; deferred tasks that
+    // are due get their turn too
+    mu_sched_set_fair_weights(2, 0, 1);
+    MU_ASSERT(mu_sched_defer_until(s_task1, 0) == MU_TASK_ERR_NONE);
+    for (int i = 0; i < 3; i++) {
+        MU_ASSERT(mu_sched_asap(s_task2) == MU_TASK_ERR_NONE);
+    }
+    s_flood_count = 0;
+    for (int i = 0; i < 9; i++) {
+        mu_sched_step();
+    }
+    MU_ASSERT(s_flood_count == 6);
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 2);
+    MU_ASSERT(counting_obj_get_call_count(&s_obj2) == 3);
+    MU_ASSERT(counting_obj_get_call_count(&s_idle_obj) == 0);
+    mu_sched_init(); // stop the flood
+#endif
+
+    // Scheduler instances are independent of each other and of the default.
+    setup();
+    {
+        mu_sched_t *d0 = device_init(&s_devices[0], device0_time);
+        mu_sched_t *d1 = device_init(&s_devices[1], device1_time);
+        mu_task_t instance_task;
+        mu_task_init(&instance_task, instance_task_fn, 0, NULL);
+        MU_ASSERT(d0 == &s_devices[0].sched);
+        MU_ASSERT(mu_sched_current_instance() == mu_sched_default_instance());
+
+        // irq capacity must be a power of two
+        mu_sched_t bad;
+        MU_ASSERT(mu_sched_inst_init(&bad, s_devices[0].irq_store, 3,
+                                     s_devices[0].asap_store,
+                                     DEVICE_ASAP_TASKS,
+                                     s_devices[0].deferred_store,
+                                     DEVICE_DEFERRED_TASKS) == NULL);
+
+        // tasks see their own scheduler and clock
+        MU_ASSERT(mu_sched_inst_asap(d1, &instance_task) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_peek_next_task() == NULL);
+        MU_ASSERT(mu_sched_inst_peek_next_task(d1) == &instance_task);
+        s_devices[1].time = 42;
+        mu_sched_inst_step(d1);
+        MU_ASSERT(s_seen_instance == d1);
+        MU_ASSERT(mu_sched_current_instance() == mu_sched_default_instance());
+
+        // a task's mu_sched_asap() and mu_sched_defer_for() go to the
+        // scheduler that is running it
+        MU_ASSERT(mu_sched_inst_asap(d0, &s_yielding_task) ==
+                  MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_inst_drain(d0) == 1);
+        MU_ASSERT(mu_sched_inst_drain(d0) == 1);
+        MU_ASSERT(s_yield_count == 2);
+        MU_ASSERT(mu_sched_inst_drain(d1) == 0);
+        mu_sched_step();
+        MU_ASSERT(s_yield_count == 2);
+        MU_ASSERT(counting_obj_get_call_count(&s_idle_obj) == 1);
+
+        // deferred queues, capacities and clocks are per scheduler
+        for (int i = 0; i < DEVICE_DEFERRED_TASKS; i++) {
+            MU_ASSERT(mu_sched_inst_defer_until(d1, &s_ordered_objs[i].task,
+                                                50 + DEVICE_DEFERRED_TASKS -
+                                                    i) == MU_TASK_ERR_NONE);
+        }
+        MU_ASSERT(mu_sched_inst_defer_until(d1, s_task1, 50) ==
+                  MU_TASK_ERR_SCHED_FULL);
+        MU_ASSERT(mu_sched_defer_until(s_task1, 50) == MU_TASK_ERR_NONE);
+        mu_time_abs_t at;
+        MU_ASSERT(mu_sched_inst_next_deadline(d1, &at) == true);
+        MU_ASSERT(at == 51);
+        MU_ASSERT(mu_sched_inst_next_deadline(d0, &at) == false);
+        set_test_time(100);
+        MU_ASSERT(mu_sched_inst_drain(d1) == 0); // d1's clock is still at 42
+        s_devices[1].time = 100;
+        MU_ASSERT(mu_sched_inst_drain(d1) == DEVICE_DEFERRED_TASKS);
+        MU_ASSERT(s_call_order_count == DEVICE_DEFERRED_TASKS);
+        MU_ASSERT(s_call_order[0] == DEVICE_DEFERRED_TASKS - 1);
+        MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 0);
+        MU_ASSERT(mu_sched_drain() == 1);
+        MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+
+        // mu_sched_inst_from_isr() queues on the given scheduler
+        d0 = device_init(&s_devices[0], device0_time); // drop s_yielding_task
+        MU_ASSERT(mu_sched_inst_from_isr(d0, s_task2) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_drain() == 0);
+        MU_ASSERT(mu_sched_inst_drain(d0) == 1);
+        MU_ASSERT(counting_obj_get_call_count(&s_obj2) == 1);
+    }
+
+#ifdef MU_CONFIG_SCHED_LOAD
+    // Time in tasks is busy; time in the idle task or between steps is idle.
+    setup();
+    {
+        const mu_sched_load_t *load;
+        mu_task_init(&s_slow_task, slow_task_fn, 0, NULL);
+        mu_sched_reset_load();
+        mu_sched_set_load_window(0, 100);
+
+        MU_ASSERT(mu_sched_asap(&s_slow_task) == MU_TASK_ERR_NONE);
+        mu_sched_step(); // busy from 0 to 30
+        set_test_time(50);
+        mu_sched_step(); // runs the idle task
+        MU_ASSERT(counting_obj_get_call_count(&s_idle_obj) == 1);
+        MU_ASSERT(mu_sched_asap(&s_slow_task) == MU_TASK_ERR_NONE);
+        mu_sched_step(); // busy from 50 to 80
+        set_test_time(100);
+        load = mu_sched_get_load();
+        MU_ASSERT(load->busy == 2 * SLOW_TASK_TICKS);
+        MU_ASSERT(load->idle == 100 - 2 * SLOW_TASK_TICKS);
+        MU_ASSERT(load->tasks_run == 2);
+        MU_ASSERT(load->idle_steps == 1);
+        MU_ASSERT(load->windows[0].utilization ==
+                  MU_SCHED_LOAD_FULL * 2 * SLOW_TASK_TICKS / 100);
+        MU_ASSERT(load->windows[1].utilization == 0); // not in use
+
+        // mu_sched_drain() is accounted for too; the window rolls over when
+        // the task that ends it finishes
+        for (int i = 0; i < 3; i++) {
+            MU_ASSERT(mu_sched_asap(&s_slow_task) == MU_TASK_ERR_NONE);
+        }
+        set_test_time(110);
+        MU_ASSERT(mu_sched_drain() == 3); // busy from 110 to 200
+        load = mu_sched_get_load();
+        MU_ASSERT(load->busy == 5 * SLOW_TASK_TICKS);
+        MU_ASSERT(load->tasks_run == 5);
+        MU_ASSERT(load->windows[0].utilization ==
+                  MU_SCHED_LOAD_FULL * 3 * SLOW_TASK_TICKS / 100);
+
+        mu_sched_reset_load();
+        load = mu_sched_get_load();
+        MU_ASSERT(load->busy == 0 && load->idle == 0);
+        MU_ASSERT(load->windows[0].utilization == 0);
+        MU_ASSERT(load->windows[0].length == 100);
+    }
+#endif
+
+#ifdef MU_CONFIG_SCHED_GROWABLE
+    // Growable queues take storage from the allocator when they fill up, and
+    // keep their tasks in order.
+    setup();
+    {
+        mu_sched_t *d0 = device_init(&s_devices[0], device0_time);
+        mu_sched_allocator_t allocator = {grow_alloc, grow_free, NULL};
+        s_live_blocks = 0;
+        s_alloc_fails = false;
+        mu_sched_inst_set_allocator(d0, &allocator, 0, 6);
+
+        // the asap queues double, even while wrapped around their storage
+        for (int i = 0; i < DEVICE_ASAP_TASKS; i++) {
+            MU_ASSERT(mu_sched_inst_asap(d0, &s_ordered_objs[i].task) ==
+                      MU_TASK_ERR_NONE);
+        }
+        mu_sched_inst_step(d0);
+        for (int i = DEVICE_ASAP_TASKS; i < N_ORDERED_TASKS; i++) {
+            MU_ASSERT(mu_sched_inst_asap(d0, &s_ordered_objs[i].task) ==
+                      MU_TASK_ERR_NONE);
+        }
+        MU_ASSERT(mu_sched_inst_get_capacity(d0, MU_SCHED_QUEUE_ASAP) ==
+                  2 * DEVICE_ASAP_TASKS);
+        MU_ASSERT(s_live_blocks == 1);
+        MU_ASSERT(mu_sched_inst_drain(d0) == N_ORDERED_TASKS - 1);
+        for (int i = 0; i < N_ORDERED_TASKS; i++) {
+            MU_ASSERT(s_call_order[i] == i);
+        }
+
+        // the deferred queue grows up to its maximum
+        s_call_order_count = 0;
+        for (int i = 0; i < 6; i++) {
+            MU_ASSERT(mu_sched_inst_defer_until(d0, &s_ordered_objs[i].task,
+                                                10 - i) == MU_TASK_ERR_NONE);
+        }
+        MU_ASSERT(mu_sched_inst_defer_until(d0, &s_ordered_objs[6].task, 1) ==
+                  MU_TASK_ERR_SCHED_FULL);
+        MU_ASSERT(mu_sched_inst_get_capacity(d0, MU_SCHED_QUEUE_DEFERRED) ==
+                  6);
+        MU_ASSERT(mu_sched_inst_get_capacity(d0, MU_SCHED_QUEUE_IRQ) ==
+                  DEVICE_IRQ_TASKS - 1);
+        MU_ASSERT(s_live_blocks == 2);
+
+        // shrinking returns the storage that is no longer needed
+        mu_sched_inst_shrink(d0);
+        MU_ASSERT(mu_sched_inst_get_capacity(d0, MU_SCHED_QUEUE_ASAP) ==
+                  DEVICE_ASAP_TASKS);
+        MU_ASSERT(mu_sched_inst_get_capacity(d0, MU_SCHED_QUEUE_DEFERRED) ==
+                  6);
+        MU_ASSERT(s_live_blocks == 1);
+        s_devices[0].time = 10;
+        MU_ASSERT(mu_sched_inst_drain(d0) == 6);
+        MU_ASSERT(s_call_order[0] == 5);
+        MU_ASSERT(s_call_order[5] == 0);
+        mu_sched_inst_shrink(d0);
+        MU_ASSERT(mu_sched_inst_get_capacity(d0, MU_SCHED_QUEUE_DEFERRED) ==
+                  DEVICE_DEFERRED_TASKS);
+        MU_ASSERT(s_live_blocks == 0);
+
+        // a full queue stays full if the allocator has nothing to give
+        s_alloc_fails = true;
+        for (int i = 0; i < DEVICE_DEFERRED_TASKS; i++) {
+            MU_ASSERT(mu_sched_inst_defer_until(d0, &s_ordered_objs[i].task,
+                                                20) == MU_TASK_ERR_NONE);
+        }
+        MU_ASSERT(mu_sched_inst_defer_until(
+                      d0, &s_ordered_objs[DEVICE_DEFERRED_TASKS].task, 20) ==
+                  MU_TASK_ERR_SCHED_FULL);
+        MU_ASSERT(s_live_blocks == 0);
+    }
+#endif
+
+    // mu_task_t *mu_sched_current_task(void);
     mu_sched_asap(&s_basic_task);
-    // verify that mu_sched_get_current_task() == &s_basic_task
+    // verify that mu_sched_current_task() == &s_basic_task
     // see body of basic_task_fn
     mu_sched_step();
-    // check that mu_sched_get_current_task() is null outside of a step() call
-    MU_ASSERT(mu_sched_get_current_task() == NULL);
+    // check that mu_sched_current_task() is null outside of a step() call
+    MU_ASSERT(mu_sched_current_task() == NULL);
 
     printf("\n   Completed test_mu_sched.");
 }
@@ -223,10 +1061,20 @@ static void setup(void) {
     mu_sched_set_idle_task(s_idle_task);
     mu_sched_set_clock_source(get_test_time);
     set_test_time(0);
-    mu_task_init(&s_basic_task, basic_task_fn, (mu_task_state_t)9);
+    mu_task_init(&s_basic_task, basic_task_fn, (mu_task_state_t)9, NULL);
+    for (int i = 0; i < N_ORDERED_TASKS; i++) {
+        s_ordered_objs[i].id = i;
+        mu_task_init(&s_ordered_objs[i].task, ordered_task_fn, 0, NULL);
+    }
+    s_call_order_count = 0;
+    mu_task_init(&s_yielding_task, yielding_task_fn, 0, NULL);
+    s_yield_count = 0;
+    mu_task_init(&s_flood_task, flood_task_fn, 0, NULL);
+    s_flood_count = 0;
 }
 
 static mu_time_abs_t get_test_time(void) {
+    s_clock_reads += 1;
     return s_time;
 }
 
@@ -236,5 +1084,89 @@ static void set_test_time(mu_time_abs_t time) {
 
 static void basic_task_fn(mu_task_t *task, void *arg) {
     (void)arg;
-    MU_ASSERT(mu_sched_get_current_task() == task);
+    MU_ASSERT(mu_sched_current_task() == task);
+}
+
+static void ordered_task_fn(mu_task_t *task, void *arg) {
+    ordered_obj_t *self = MU_TASK_CTX(task, ordered_obj_t, task);
+    (void)arg;
+    if (s_call_order_count < N_ORDERED_TASKS) {
+        s_call_order[s_call_order_count++] = self->id;
+    }
+}
+
+static void yielding_task_fn(mu_task_t *task, void *arg) {
+    (void)arg;
+    s_yield_count += 1;
+    s_time += 1;
+    mu_sched_asap(task);
+}
+
+static void instance_task_fn(mu_task_t *task, void *arg) {
+    (void)arg;
+    s_seen_instance = mu_sched_current_instance();
+    MU_ASSERT(mu_sched_current_task() == task);
+    MU_ASSERT(mu_sched_get_current_time() == 42);
 }
+
+static void flood_task_fn(mu_task_t *task, void *arg) {
+    // stands in for an interrupt that fires again as soon as it is serviced
+    (void)arg;
+    s_flood_count += 1;
+    s_time += 1;
+    mu_sched_from_isr(task);
+}
+
+static mu_sched_t *device_init(device_t *device, mu_clock_fn clock_fn) {
+    mu_sched_t *sched = mu_sched_inst_init(
+        &device->sched, device->irq_store, DEVICE_IRQ_TASKS,
+        device->asap_store, DEVICE_ASAP_TASKS, device->deferred_store,
+        DEVICE_DEFERRED_TASKS);
+    device->time = 0;
+    mu_sched_inst_set_clock_source(sched, clock_fn);
+    return sched;
+}
+
+static mu_time_abs_t device0_time(void) { return s_devices[0].time; }
+
+static mu_time_abs_t device1_time(void) { return s_devices[1].time; }
+
+#ifdef MU_CONFIG_SCHED_LOAD
+
+static void slow_task_fn(mu_task_t *task, void *arg) {
+    (void)task;
+    (void)arg;
+    s_time += SLOW_TASK_TICKS;
+}
+
+#endif
+
+#ifdef MU_CONFIG_SCHED_CACHED_NOW
+
+static void clock_task_fn(mu_task_t *task, void *arg) {
+    (void)task;
+    (void)arg;
+    s_seen_times[s_seen_count++] = mu_sched_get_current_time();
+    s_time += 1;
+}
+
+#endif
+
+#ifdef MU_CONFIG_SCHED_GROWABLE
+
+static void *grow_alloc(size_t size, void *arg) {
+    (void)arg;
+    if (s_alloc_fails) {
+        return NULL;
+    }
+    s_live_blocks += 1;
+    return malloc(size);
+}
+
+static void grow_free(void *ptr, void *arg) {
+    (void)arg;
+    s_live_blocks -= 1;
+    free(ptr);
+}
+
+#endif
@@ -37,10 +37,14 @@
 
 #define SPSC_SIZE 4
 
+// Larger than the old 16-bit indices allowed.
+#define BIG_SPSC_SIZE 131072
+
 // *****************************************************************************
 // Local (private, static) forward declarations
 
 static void *s_store[SPSC_SIZE];
+static void *s_big_store[BIG_SPSC_SIZE];
 
 // *****************************************************************************
 // Local (private, static) storage
@@ -57,7 +61,7 @@ void test_mu_spsc(void) {
     MU_ASSERT(mu_spsc_init(&spsc, s_store, 3) == MU_SPSC_ERR_SIZE);
     MU_ASSERT(mu_spsc_init(&spsc, s_store, SPSC_SIZE) == MU_SPSC_ERR_NONE);
 
-    // uint16_t mu_spsc_capacity(mu_spsc_t *q);
+    // uint32_t mu_spsc_capacity(mu_spsc_t *q);
     MU_ASSERT(mu_spsc_capacity(&spsc) == SPSC_SIZE-1);
 
     int item1 = 1;
@@ -82,6 +86,48 @@ void test_mu_spsc(void) {
     MU_ASSERT(element == &item3);
     MU_ASSERT(mu_spsc_get(&spsc, &element) == MU_SPSC_ERR_EMPTY);
 
+    // uint32_t mu_spsc_count(mu_spsc_t *q);
+    MU_ASSERT(mu_spsc_count(&spsc) == 0);
+    MU_ASSERT(mu_spsc_put(&spsc, &item1) == MU_SPSC_ERR_NONE);
+    MU_ASSERT(mu_spsc_count(&spsc) == 1);
+    MU_ASSERT(mu_spsc_get(&spsc, &element) == MU_SPSC_ERR_NONE);
+
+    // uint32_t mu_spsc_put_n(mu_spsc_t *q, const mu_spsc_item_t *items,
+    //                        uint32_t n);
+    // uint32_t mu_spsc_get_n(mu_spsc_t *q, mu_spsc_item_t *items, uint32_t n);
+    // Indices are now part way round the store, so these wrap.  Bulk calls
+    // stop short when the queue fills or empties.
+    {
+        void *items[4] = {&item1, &item2, &item3, &item4};
+        void *got[4] = {NULL, NULL, NULL, NULL};
+        MU_ASSERT(mu_spsc_put_n(&spsc, items, 4) == 3);
+        MU_ASSERT(mu_spsc_put_n(&spsc, items, 1) == 0);
+        MU_ASSERT(mu_spsc_count(&spsc) == 3);
+        MU_ASSERT(mu_spsc_get_n(&spsc, got, 2) == 2);
+        MU_ASSERT(got[0] == &item1 && got[1] == &item2);
+        MU_ASSERT(mu_spsc_put_n(&spsc, &items[3], 1) == 1);
+        MU_ASSERT(mu_spsc_get_n(&spsc, got, 4) == 2);
+        MU_ASSERT(got[0] == &item3 && got[1] == &item4);
+        MU_ASSERT(mu_spsc_get_n(&spsc, got, 4) == 0);
+        // single and bulk calls interleave
+        MU_ASSERT(mu_spsc_put(&spsc, &item1) == MU_SPSC_ERR_NONE);
+        MU_ASSERT(mu_spsc_put_n(&spsc, &items[1], 2) == 2);
+        MU_ASSERT(mu_spsc_get(&spsc, &element) == MU_SPSC_ERR_NONE);
+        MU_ASSERT(element == &item1);
+        MU_ASSERT(mu_spsc_get_n(&spsc, got, 4) == 2);
+        MU_ASSERT(got[0] == &item2 && got[1] == &item3);
+    }
+
+    // capacity is no longer limited to 16 bits
+    MU_ASSERT(mu_spsc_init(&spsc, s_big_store, BIG_SPSC_SIZE) ==
+              MU_SPSC_ERR_NONE);
+    MU_ASSERT(mu_spsc_capacity(&spsc) == BIG_SPSC_SIZE - 1);
+    for (uint32_t i = 0; i < BIG_SPSC_SIZE - 1; i++) {
+        MU_ASSERT(mu_spsc_put(&spsc, &item1) == MU_SPSC_ERR_NONE);
+    }
+    MU_ASSERT(mu_spsc_put(&spsc, &item1) == MU_SPSC_ERR_FULL);
+    MU_ASSERT(mu_spsc_count(&spsc) == BIG_SPSC_SIZE - 1);
+
     printf("\n   Completed test_mu_spsc.");
 }
 
@@ -70,12 +70,29 @@ static void task_transfer_hook(mu_task_t *prev_task, mu_task_t *next_task);
 static void task_state_change_hook(mu_task_t *task, mu_task_state_t prev_state,
                                    mu_task_state_t next_state);
 
+#ifdef MU_CONFIG_TASK_WATCHDOG
+static void slow_fn(mu_task_t *task, void *arg);
+
+static mu_time_abs_t get_watchdog_time(void);
+
+static void overrun_hook(mu_task_t *task, mu_task_state_t state,
+                         mu_time_rel_t elapsed);
+#endif
+
 // *****************************************************************************
 // Local (private, static) storage
 
 int s_transfer_hook_count;
 int s_state_change_hook_count;
 
+#ifdef MU_CONFIG_TASK_WATCHDOG
+static mu_time_abs_t s_watchdog_time;
+static mu_time_rel_t s_run_time; // how long slow_fn takes
+static int s_overrun_count;
+static mu_task_state_t s_overrun_state;
+static mu_time_rel_t s_overrun_elapsed;
+#endif
+
 // *****************************************************************************
 // Public code
 
@@ -91,9 +108,10 @@ void test_mu_task(void) {
     MU_ASSERT(MU_TASK_CTX(&ctx2.task, test_ctx_t, task) == &ctx2);
 
     // mu_task_t *mu_task_init(mu_task_t *task, mu_task_fn fn,
-    //                         mu_task_state_t initial_state);
-    MU_ASSERT(mu_task_init(&ctx1.task, test_fn, 1) == &ctx1.task);
-    MU_ASSERT(mu_task_init(&ctx2.task, test_fn, 2) == &ctx2.task);
+    //                         mu_task_state_t initial_state,
+    //                         void *user_info);
+    MU_ASSERT(mu_task_init(&ctx1.task, test_fn, 1, NULL) == &ctx1.task);
+    MU_ASSERT(mu_task_init(&ctx2.task, test_fn, 2, NULL) == &ctx2.task);
 
     // void mu_task_call(mu_task_t *task, void *arg);
     ctx1.call_count = 0;
@@ -165,8 +183,8 @@ void test_mu_task(void) {
     // TODO: test this feature, probably with fff
 
     // with mu_task_state_change_hook
-    mu_task_set_state_change_hook(task_state_change_hook);
-    mu_task_init(&ctx1.task, test_fn, 1);
+    mu_task_install_set_state_hook(task_state_change_hook);
+    mu_task_init(&ctx1.task, test_fn, 1, NULL);
     s_state_change_hook_count = 0;
     // should get called when state changes
     mu_task_set_state(&ctx1.task, 2);
@@ -174,6 +192,103 @@ void test_mu_task(void) {
     // should not called when state stays the same
     mu_task_set_state(&ctx1.task, 2);
     MU_ASSERT(s_state_change_hook_count == 1);
+    mu_task_install_set_state_hook(NULL);
+
+#ifdef MU_CONFIG_TASK_IDS
+    // the registry gives each task a compact ID that stays with it
+    mu_task_init(&ctx1.task, test_fn, 0, NULL);
+    mu_task_init(&ctx2.task, test_fn, 0, NULL);
+    mu_task_id_t id1 = mu_task_get_id(&ctx1.task);
+    mu_task_id_t id2 = mu_task_get_id(&ctx2.task);
+    MU_ASSERT(id1 != MU_TASK_ID_NONE);
+    MU_ASSERT(id2 != MU_TASK_ID_NONE);
+    MU_ASSERT(id1 != id2);
+    MU_ASSERT(mu_task_get_id(&ctx1.task) == id1);
+    MU_ASSERT(mu_task_from_id(id1) == &ctx1.task);
+    MU_ASSERT(mu_task_from_id(MU_TASK_ID_NONE) == NULL);
+    // re-initializing a task doesn't use up another ID
+    mu_task_init(&ctx1.task, test_fn, 0, NULL);
+    MU_ASSERT(mu_task_get_id(&ctx1.task) == id1);
+    mu_task_unregister(&ctx1.task);
+    MU_ASSERT(mu_task_from_id(id1) == NULL);
+
+    // a task that can't be registered can't be scheduled
+    static mu_task_t s_extra[MU_CONFIG_TASK_MAX_IDS];
+    size_t n_extra = 0;
+    while (true) {
+        mu_task_init(&s_extra[n_extra], test_fn, 0, NULL);
+        if (mu_task_get_id(&s_extra[n_extra]) == MU_TASK_ID_NONE) {
+            break;
+        }
+        n_extra += 1;
+    }
+    MU_ASSERT(n_extra < MU_CONFIG_TASK_MAX_IDS); // ctx2 holds an ID
+    mu_sched_init();
+    MU_ASSERT(mu_sched_asap(&s_extra[n_extra]) == MU_TASK_ERR_SCHED_FULL);
+    MU_ASSERT(mu_sched_from_isr(&s_extra[n_extra]) == MU_TASK_ERR_SCHED_FULL);
+    MU_ASSERT(mu_sched_defer_for(&s_extra[n_extra], 1) ==
+              MU_TASK_ERR_SCHED_FULL);
+    for (size_t i = 0; i < n_extra; i++) {
+        mu_task_unregister(&s_extra[i]);
+    }
+    mu_task_unregister(&ctx2.task);
+    MU_ASSERT(mu_sched_asap(&s_extra[n_extra]) == MU_TASK_ERR_NONE);
+    mu_task_unregister(&s_extra[n_extra]);
+    mu_sched_init();
+#endif
+
+#ifdef MU_CONFIG_TASK_WATCHDOG
+    // the watchdog times each call, by task and by state, and reports calls
+    // that take longer than the budget
+    mu_task_timing_t state_timing[3];
+    mu_task_init(&ctx1.task, slow_fn, 0, NULL);
+    mu_task_set_state_timing(&ctx1.task, state_timing, 3);
+    mu_task_set_watchdog_clock(get_watchdog_time);
+    mu_task_set_watchdog(10, overrun_hook);
+    s_overrun_count = 0;
+    s_run_time = 5;
+    mu_task_call(&ctx1.task, NULL);
+    s_run_time = 10;
+    mu_task_call(&ctx1.task, NULL);
+    MU_ASSERT(s_overrun_count == 0);
+    s_run_time = 25;
+    mu_task_set_state(&ctx1.task, 1);
+    mu_task_call(&ctx1.task, NULL);
+    MU_ASSERT(s_overrun_count == 1);
+    MU_ASSERT(s_overrun_state == 1);
+    MU_ASSERT(s_overrun_elapsed == 25);
+    // states beyond the state timing table count for the task only
+    s_run_time = 40;
+    mu_task_set_state(&ctx1.task, 7);
+    mu_task_call(&ctx1.task, NULL);
+    MU_ASSERT(s_overrun_count == 2);
+    MU_ASSERT(s_overrun_state == 7);
+
+    const mu_task_timing_t *timing = mu_task_get_timing(&ctx1.task);
+    MU_ASSERT(timing->calls == 4);
+    MU_ASSERT(timing->overruns == 2);
+    MU_ASSERT(timing->max == 40);
+    MU_ASSERT(timing->total == 80);
+    MU_ASSERT(state_timing[0].calls == 2);
+    MU_ASSERT(state_timing[0].overruns == 0);
+    MU_ASSERT(state_timing[0].max == 10);
+    MU_ASSERT(state_timing[1].calls == 1);
+    MU_ASSERT(state_timing[1].overruns == 1);
+    MU_ASSERT(state_timing[1].total == 25);
+    MU_ASSERT(state_timing[2].calls == 0);
+
+    // a budget of zero times calls but never reports them
+    mu_task_set_watchdog(0, overrun_hook);
+    mu_task_call(&ctx1.task, NULL);
+    MU_ASSERT(s_overrun_count == 2);
+    MU_ASSERT(timing->calls == 5);
+    MU_ASSERT(timing->overruns == 2);
+
+    mu_task_reset_timing(&ctx1.task);
+    MU_ASSERT(timing->calls == 0);
+    MU_ASSERT(state_timing[1].calls == 0);
+    mu_task_set_watchdog_clock(NULL);
+#endif
 
     printf("\n   Completed test_mu_task.");
 }
@@ -195,3 +310,25 @@ static void task_state_change_hook(mu_task_t *task, mu_task_state_t prev_state,
                                    mu_task_state_t next_state) {
     s_state_change_hook_count += 1;
 }
+
+#ifdef MU_CONFIG_TASK_WATCHDOG
+
+static void slow_fn(mu_task_t *task, void *arg) {
+    (void)task;
+    (void)arg;
+    s_watchdog_time += s_run_time;
+}
+
+static mu_time_abs_t get_watchdog_time(void) {
+    return s_watchdog_time;
+}
+
+static void overrun_hook(mu_task_t *task, mu_task_state_t state,
+                         mu_time_rel_t elapsed) {
+    (void)task;
+    s_overrun_count += 1;
+    s_overrun_state = state;
+    s_overrun_elapsed = elapsed;
+}
+
+#endif
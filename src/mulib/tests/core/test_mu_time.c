@@ -108,6 +108,27 @@ void test_mu_time(void) {
     // mu_time_rel_t mu_time_ms_to_rel(int ms);
     // assumed...
 
+    // mu_time_cycles_t mu_time_cycles(void);
+    // The cycle counter never runs backwards and, once converted, keeps pace
+    // with mu_time_now() (within generous bounds for a loaded host).
+    MU_ASSERT(mu_time_cycles_per_second() > 0);
+    mu_time_cycles_t c0 = mu_time_cycles();
+    mu_time_abs_t t0 = mu_time_now();
+    mu_time_abs_t t1;
+    do {
+        t1 = mu_time_now();
+    } while (mu_time_difference(t1, t0) < mu_time_ms_to_rel(2));
+    mu_time_cycles_t c1 = mu_time_cycles_ordered();
+    MU_ASSERT(c1 >= c0);
+    mu_time_rel_t measured = mu_time_cycles_to_rel(c1 - c0);
+    MU_ASSERT(measured >= mu_time_ms_to_rel(1));
+    MU_ASSERT(measured < mu_time_ms_to_rel(1000));
+
+    // uint64_t mu_time_cycles_to_ns(mu_time_cycles_t cycles);
+    // mu_time_cycles_t mu_time_ns_to_cycles(uint64_t ns);
+    uint64_t ns = mu_time_cycles_to_ns(mu_time_ns_to_cycles(1000000));
+    MU_ASSERT(ns > 999000 && ns < 1001000);
+
     printf("\n   Completed test_mu_time.");
 }
 
@@ -92,6 +92,7 @@ void test_mu_timer(void) {
     set_test_time(10);
     mu_sched_step();
     MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 2);
+    mu_timer_stop(&timer);
 
     // void mu_timer_stop(mu_timer_t *timer);
     // bool mu_timer_is_running(mu_timer_t *timer);
@@ -112,6 +113,97 @@ void test_mu_timer(void) {
     mu_sched_step();
     MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 0);
 
+    // periodic timers don't drift when serviced late
+    setup();
+    mu_timer_init(&timer);
+
+    mu_timer_start(&timer, 5, true, s_task1);
+    set_test_time(7);
+    mu_sched_step();
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+    set_test_time(9);
+    mu_sched_step();
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+    set_test_time(10);
+    mu_sched_step();
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 2);
+    mu_timer_stop(&timer);
+
+    // restarting a running timer cancels the original expiration
+    setup();
+    mu_timer_init(&timer);
+
+    mu_timer_start(&timer, 5, false, s_task1);
+    set_test_time(3);
+    mu_timer_start(&timer, 5, false, s_task1);
+    set_test_time(5);
+    mu_sched_step();
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 0);
+    set_test_time(8);
+    mu_sched_step();
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+    MU_ASSERT(mu_timer_is_stopped(&timer) == true);
+
+    // timers still expire after the scheduler is re-initialized
+    setup();
+    mu_timer_init(&timer);
+
+    mu_timer_start(&timer, 5, false, s_task1);
+    mu_sched_init();
+    mu_sched_set_clock_source(get_test_time);
+    mu_timer_start(&timer, 5, false, s_task1);
+    set_test_time(5);
+    mu_sched_step();
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+
+    // timers longer than 2^31 ticks (about 2 s) expire on time
+    setup();
+    mu_timer_init(&timer);
+
+    mu_timer_start(&timer, 3 * MU_TIME_TICKS_PER_SECOND, false, s_task1);
+    mu_sched_step();
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 0);
+    set_test_time(3 * MU_TIME_TICKS_PER_SECOND - 1);
+    mu_sched_step();
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 0);
+    set_test_time(3 * MU_TIME_TICKS_PER_SECOND);
+    mu_sched_drain();
+    MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+
+    // void mu_timer_start_with_slack(mu_timer_t *timer,
+    //                                uint32_t delay_tics,
+    //                                bool periodic,
+    //                                mu_task_t *on_completion,
+    //                                mu_time_rel_t slack);
+    // timers whose windows overlap expire together
+    setup();
+    mu_timer_init(&timer);
+    {
+        mu_timer_t timer2;
+        counting_obj_t obj2;
+        mu_task_t *task2 = counting_obj_task(counting_obj_init(&obj2));
+        mu_timer_init(&timer2);
+
+        mu_timer_start_with_slack(&timer, 5, true, s_task1, 10); // [5, 15]
+        mu_timer_start_with_slack(&timer2, 6, false, task2, 4);  // [6, 10]
+        set_test_time(7);
+        mu_sched_step();
+        MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 0);
+        MU_ASSERT(counting_obj_get_call_count(&obj2) == 0);
+        set_test_time(8);
+        mu_sched_drain();
+        MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+        MU_ASSERT(counting_obj_get_call_count(&obj2) == 1);
+        // the period runs from the nominal expiration: [10, 20] gives 16
+        set_test_time(15);
+        mu_sched_drain();
+        MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 1);
+        set_test_time(16);
+        mu_sched_drain();
+        MU_ASSERT(counting_obj_get_call_count(&s_obj1) == 2);
+        mu_timer_stop(&timer);
+    }
+
     printf("\n   Completed test_mu_timer.");
 }
 
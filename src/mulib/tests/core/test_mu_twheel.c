@@ -0,0 +1,145 @@
+/**
+ * @file test_mu_twheel.c
+ *
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_twheel.h"
+#include "test_support.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#define N_NODES 6
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static mu_twheel_t s_wheel;
+static mu_twheel_node_t s_nodes[N_NODES];
+
+// *****************************************************************************
+// Public code
+
+void test_mu_twheel(void) {
+    printf("\nStarting test_mu_twheel...");
+
+    mu_twheel_tick_t tick;
+
+    // mu_twheel_t *mu_twheel_init(mu_twheel_t *wheel, mu_twheel_tick_t now);
+    MU_ASSERT(mu_twheel_init(&s_wheel, 0) == &s_wheel);
+    MU_ASSERT(mu_twheel_count(&s_wheel) == 0);
+    MU_ASSERT(mu_twheel_next_tick(&s_wheel, &tick) == false);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 1000) == NULL);
+
+    // mu_twheel_node_t *mu_twheel_node_init(mu_twheel_node_t *node);
+    // bool mu_twheel_node_is_linked(mu_twheel_node_t *node);
+    for (int i = 0; i < N_NODES; i++) {
+        MU_ASSERT(mu_twheel_node_init(&s_nodes[i]) == &s_nodes[i]);
+        MU_ASSERT(mu_twheel_node_is_linked(&s_nodes[i]) == false);
+    }
+
+    // nodes expire in time order, equal ticks in insertion order, and across
+    // all levels of the wheel.
+    mu_twheel_init(&s_wheel, 0);
+    mu_twheel_insert(&s_wheel, &s_nodes[0], 5000000);  // level 3
+    mu_twheel_insert(&s_wheel, &s_nodes[1], 70);       // level 1
+    mu_twheel_insert(&s_wheel, &s_nodes[2], 3);        // level 0
+    mu_twheel_insert(&s_wheel, &s_nodes[3], 70);       // level 1
+    mu_twheel_insert(&s_wheel, &s_nodes[4], 10000);    // level 2
+    mu_twheel_insert(&s_wheel, &s_nodes[5], 40000000); // beyond the wheel
+    MU_ASSERT(mu_twheel_count(&s_wheel) == N_NODES);
+    MU_ASSERT(mu_twheel_node_is_linked(&s_nodes[0]) == true);
+    MU_ASSERT(mu_twheel_node_expires(&s_nodes[0]) == 5000000);
+
+    MU_ASSERT(mu_twheel_next_tick(&s_wheel, &tick) == true);
+    MU_ASSERT(tick == 3);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 2) == NULL);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 3) == &s_nodes[2]);
+    MU_ASSERT(mu_twheel_node_is_linked(&s_nodes[2]) == false);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 3) == NULL);
+    // the level 1 slot is cascaded at the start of its block
+    MU_ASSERT(mu_twheel_next_tick(&s_wheel, &tick) == true);
+    MU_ASSERT(tick == 64);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 69) == NULL);
+    MU_ASSERT(mu_twheel_next_tick(&s_wheel, &tick) == true);
+    MU_ASSERT(tick == 70);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 100) == &s_nodes[1]);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 100) == &s_nodes[3]);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 100) == NULL);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 9999) == NULL);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 10000) == &s_nodes[4]);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 4999999) == NULL);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 5000000) == &s_nodes[0]);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 39999999) == NULL);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 40000000) == &s_nodes[5]);
+    MU_ASSERT(mu_twheel_count(&s_wheel) == 0);
+    MU_ASSERT(mu_twheel_next_tick(&s_wheel, &tick) == false);
+
+    // a large step expires everything that is due, in order
+    mu_twheel_init(&s_wheel, 100);
+    mu_twheel_insert(&s_wheel, &s_nodes[0], 300);
+    mu_twheel_insert(&s_wheel, &s_nodes[1], 200);
+    mu_twheel_insert(&s_wheel, &s_nodes[2], 90); // already past due
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 1000) == &s_nodes[2]);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 1000) == &s_nodes[1]);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 1000) == &s_nodes[0]);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 1000) == NULL);
+
+    // void mu_twheel_remove(mu_twheel_t *wheel, mu_twheel_node_t *node);
+    mu_twheel_init(&s_wheel, 0);
+    mu_twheel_insert(&s_wheel, &s_nodes[0], 10);
+    mu_twheel_insert(&s_wheel, &s_nodes[1], 10);
+    mu_twheel_insert(&s_wheel, &s_nodes[2], 500);
+    mu_twheel_remove(&s_wheel, &s_nodes[0]);
+    mu_twheel_remove(&s_wheel, &s_nodes[0]); // no effect
+    mu_twheel_remove(&s_wheel, &s_nodes[2]);
+    MU_ASSERT(mu_twheel_count(&s_wheel) == 1);
+    MU_ASSERT(mu_twheel_next_tick(&s_wheel, &tick) == true);
+    MU_ASSERT(tick == 10);
+    mu_twheel_remove(&s_wheel, &s_nodes[1]);
+    MU_ASSERT(mu_twheel_next_tick(&s_wheel, &tick) == false);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 1000) == NULL);
+
+    // removed nodes may be re-inserted, including after expiring
+    mu_twheel_insert(&s_wheel, &s_nodes[0], 1005);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 1005) == &s_nodes[0]);
+    mu_twheel_insert(&s_wheel, &s_nodes[0], 1010);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 1009) == NULL);
+    MU_ASSERT(mu_twheel_expire(&s_wheel, 1010) == &s_nodes[0]);
+
+    printf("\n   Completed test_mu_twheel.");
+}
+
+// *****************************************************************************
+// Local (private, static) code
@@ -0,0 +1,234 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_exec.h"
+#include "mu_sched.h"
+#include "mu_task.h"
+#include "mu_time.h"
+#include "test_support.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#define N_WORKERS 4
+#define N_TASKS 512
+#define N_STEPS 20
+#define ASAP_CAPACITY 4096 // per worker, must be a power of two
+#define DEFERRED_CAPACITY N_TASKS
+#define INJECT_CAPACITY N_TASKS
+
+// A task that runs N_STEPS times, alternately yielding and deferring.
+typedef struct {
+    mu_task_t task;
+    int in_run; // number of workers currently running this task
+} stepper_t;
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static mu_exec_t s_exec;
+static mu_exec_worker_t s_workers[N_WORKERS];
+static mu_task_t *s_asap_stores[N_WORKERS][ASAP_CAPACITY];
+static mu_exec_deferred_t s_deferred_stores[N_WORKERS][DEFERRED_CAPACITY];
+static mu_task_t *s_inject_store[INJECT_CAPACITY];
+
+static stepper_t s_steppers[N_TASKS];
+static int s_steppers_done;
+static int s_overlaps;
+static int s_wrong_current;
+
+// Every stepper run schedules s_hot.  s_hot_count is updated without atomics:
+// it will be short if two workers ever run s_hot at the same time.
+static mu_task_t s_hot;
+static int s_hot_scheduled;
+static int s_hot_count;
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static mu_time_abs_t monotonic_clock(void);
+static void stepper_fn(mu_task_t *task, void *arg);
+static void hot_fn(mu_task_t *task, void *arg);
+static bool wait_for(int *value, int expected);
+
+// *****************************************************************************
+// Public code
+
+void test_mu_exec(void) {
+    printf("\nStarting test_mu_exec...");
+
+    mu_sched_init();
+    mu_sched_set_clock_source(monotonic_clock);
+
+    for (int i = 0; i < N_WORKERS; i++) {
+        MU_ASSERT(mu_exec_worker_init(&s_workers[i], s_asap_stores[i],
+                                      ASAP_CAPACITY, s_deferred_stores[i],
+                                      DEFERRED_CAPACITY) == &s_workers[i]);
+    }
+    // asap capacity must be a power of two
+    mu_exec_worker_t bad_worker;
+    MU_ASSERT(mu_exec_worker_init(&bad_worker, s_asap_stores[0], 100,
+                                  s_deferred_stores[0], 1) == NULL);
+
+    MU_ASSERT(mu_exec_active() == NULL);
+    MU_ASSERT(mu_exec_init(&s_exec, s_workers, N_WORKERS, s_inject_store,
+                           INJECT_CAPACITY) == &s_exec);
+    MU_ASSERT(mu_exec_active() == &s_exec);
+    MU_ASSERT(mu_exec_current_worker() == NULL);
+
+    s_steppers_done = 0;
+    s_overlaps = 0;
+    s_wrong_current = 0;
+    s_hot_scheduled = 0;
+    s_hot_count = 0;
+    mu_task_init(&s_hot, hot_fn, 0, NULL);
+
+    // A slack deferral goes to a worker, so it isn't aligned with a task in
+    // the default scheduler.  It takes the round time in its window instead.
+    {
+        mu_sched_t *sched = mu_sched_default_instance();
+        mu_task_t task;
+        mu_task_init(&task, hot_fn, 0, NULL);
+        MU_ASSERT(mu_sched_inst_defer_until(sched, &s_hot, 1000) ==
+                  MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_defer_until_slack(&task, 900, 200) ==
+                  MU_TASK_ERR_NONE);
+        mu_time_abs_t at = 0;
+        for (int i = 0; i < N_WORKERS; i++) {
+            if (s_workers[i].deferred_count == 1) {
+                at = s_workers[i].deferred_store[0].at;
+            }
+        }
+        MU_ASSERT(at == 1024);
+        MU_ASSERT(mu_exec_remove_deferred_task(&task) == MU_TASK_ERR_NONE);
+        MU_ASSERT(mu_sched_inst_remove_deferred_task(sched, &s_hot) ==
+                  MU_TASK_ERR_NONE);
+    }
+
+    // Tasks scheduled before the workers start wait in the injection queue.
+    for (int i = 0; i < N_TASKS; i++) {
+        stepper_t *stepper = &s_steppers[i];
+        stepper->in_run = 0;
+        mu_task_init(&stepper->task, stepper_fn, 0, NULL);
+        MU_ASSERT(mu_task_yield(&stepper->task, 0) == MU_TASK_ERR_NONE);
+    }
+
+    MU_ASSERT(mu_exec_start(&s_exec) == true);
+    MU_ASSERT(wait_for(&s_steppers_done, N_TASKS));
+    MU_ASSERT(wait_for(&s_hot_count,
+                       __atomic_load_n(&s_hot_scheduled, __ATOMIC_SEQ_CST)));
+    mu_exec_stop(&s_exec);
+    MU_ASSERT(mu_exec_active() == NULL);
+
+    MU_ASSERT(s_overlaps == 0);
+    MU_ASSERT(s_wrong_current == 0);
+    MU_ASSERT(s_hot_scheduled == N_TASKS * N_STEPS);
+    MU_ASSERT(s_hot_count == s_hot_scheduled);
+    for (int i = 0; i < N_TASKS; i++) {
+        MU_ASSERT(mu_task_get_state(&s_steppers[i].task) == N_STEPS);
+    }
+
+    uint64_t run_count = 0;
+    for (int i = 0; i < N_WORKERS; i++) {
+        run_count += mu_exec_worker_run_count(&s_workers[i]);
+    }
+    MU_ASSERT(run_count == (uint64_t)N_TASKS * N_STEPS + s_hot_count);
+
+    // With the executor stopped, scheduling reverts to mu_sched.
+    counting_obj_t counting_obj;
+    counting_obj_init(&counting_obj);
+    MU_ASSERT(mu_sched_asap(counting_obj_task(&counting_obj)) ==
+              MU_TASK_ERR_NONE);
+    mu_sched_step();
+    MU_ASSERT(counting_obj_get_call_count(&counting_obj) == 1);
+
+    printf("\n...test_mu_exec complete\n");
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+static mu_time_abs_t monotonic_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (mu_time_abs_t)ts.tv_sec * MU_TIME_TICKS_PER_SECOND +
+           (mu_time_abs_t)ts.tv_nsec / (1000000000 / MU_TIME_TICKS_PER_SECOND);
+}
+
+static void stepper_fn(mu_task_t *task, void *arg) {
+    (void)arg;
+    stepper_t *stepper = MU_TASK_CTX(task, stepper_t, task);
+
+    if (__atomic_fetch_add(&stepper->in_run, 1, __ATOMIC_SEQ_CST) != 0) {
+        __atomic_fetch_add(&s_overlaps, 1, __ATOMIC_SEQ_CST);
+    }
+    if (mu_task_current_task() != task) {
+        __atomic_fetch_add(&s_wrong_current, 1, __ATOMIC_SEQ_CST);
+    }
+
+    if (mu_sched_asap(&s_hot) == MU_TASK_ERR_NONE) {
+        __atomic_fetch_add(&s_hot_scheduled, 1, __ATOMIC_SEQ_CST);
+    }
+
+    mu_task_state_t state = mu_task_get_state(task) + 1;
+    if (state == N_STEPS) {
+        mu_task_set_state(task, state);
+        __atomic_fetch_add(&s_steppers_done, 1, __ATOMIC_SEQ_CST);
+    } else if (state % 4 == 0) {
+        mu_task_defer_for(task, state, mu_time_ms_to_rel(1));
+    } else {
+        mu_task_yield(task, state);
+    }
+    // The task may already be queued elsewhere: keep in_run up to date until
+    // the very end to catch a second worker picking it up early.
+    __atomic_fetch_sub(&stepper->in_run, 1, __ATOMIC_SEQ_CST);
+}
+
+static void hot_fn(mu_task_t *task, void *arg) {
+    (void)task;
+    (void)arg;
+    int count = __atomic_load_n(&s_hot_count, __ATOMIC_RELAXED);
+    for (volatile int i = 0; i < 100; i++) {
+        // widen the window for a lost update
+    }
+    __atomic_store_n(&s_hot_count, count + 1, __ATOMIC_RELAXED);
+}
+
+static bool wait_for(int *value, int expected) {
+    struct timespec ts = {.tv_sec = 0, .tv_nsec = 1000000};
+    for (int i = 0; i < 10000; i++) {
+        if (__atomic_load_n(value, __ATOMIC_SEQ_CST) == expected) {
+            return true;
+        }
+        nanosleep(&ts, NULL);
+    }
+    return false;
+}
@@ -0,0 +1,230 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+// *****************************************************************************
+// Includes
+
+#include "mu_pdes.h"
+#include "mu_sched.h"
+#include "mu_task.h"
+#include "mu_time.h"
+#include "test_support.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#define N_DEVICES 12
+#define ONE_SECOND ((mu_time_rel_t)MU_TIME_TICKS_PER_SECOND)
+#define ONE_HOUR (3600 * ONE_SECOND)
+#define LOOKAHEAD (ONE_SECOND / 10)
+#define SAMPLE_INTERVAL ONE_SECOND
+
+#define DEVICE_IRQ_TASKS 2
+#define DEVICE_ASAP_TASKS 4
+#define DEVICE_DEFERRED_TASKS 8
+#define DEVICE_INBOX 32
+#define DEVICE_OUTBOX 8
+
+// A simulated thermostat: samples once a second and reports to two peers.
+typedef struct {
+    mu_pdes_lp_t lp;
+    mu_sched_t sched;
+    mu_sched_slot_t irq_store[DEVICE_IRQ_TASKS];
+    mu_sched_slot_t asap_store[DEVICE_ASAP_TASKS *
+                               MU_CONFIG_SCHED_ASAP_PRIORITIES];
+    mu_sched_deferred_t deferred_store[DEVICE_DEFERRED_TASKS];
+    mu_pdes_msg_t inbox_store[DEVICE_INBOX];
+    mu_pdes_msg_t outbox_store[DEVICE_OUTBOX];
+    mu_task_t start_task;   // runs once, asap
+    mu_task_t sample_task;  // runs every SAMPLE_INTERVAL
+    mu_task_t receive_task; // receives reports from peers
+    uint32_t rng;
+    uint64_t checksum;      // summarizes every report, in order of receipt
+    uint32_t received;
+    mu_time_abs_t last_received_at;
+    bool in_order;          // false if a report arrived early or out of order
+    bool short_latency_refused;
+} device_t;
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static device_t s_devices[N_DEVICES];
+static mu_pdes_lp_t s_lps[N_DEVICES];
+static mu_pdes_t s_pdes;
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static void setup(void);
+static device_t *device_of(mu_pdes_lp_t *lp);
+static void start_task_fn(mu_task_t *task, void *arg);
+static void sample_task_fn(mu_task_t *task, void *arg);
+static void receive_task_fn(mu_task_t *task, void *arg);
+
+// *****************************************************************************
+// Public code
+
+void test_mu_pdes(void) {
+    printf("\nStarting test_mu_pdes...");
+    uint64_t checksums[N_DEVICES];
+    size_t counts[2];
+
+    // The lookahead must be positive.
+    MU_ASSERT(mu_pdes_init(&s_pdes, s_lps, N_DEVICES, 0, 0) == NULL);
+
+    // Messages may be sent only from LP tasks.
+    setup();
+    MU_ASSERT(mu_pdes_current_lp() == NULL);
+    MU_ASSERT(mu_pdes_send(&s_lps[1], &s_devices[1].receive_task, LOOKAHEAD,
+                           0) == MU_PDES_ERR_NOT_IN_LP);
+
+    // Reference run on one thread.
+    size_t count = mu_pdes_run_until(&s_pdes, 1000 + ONE_HOUR, 1);
+    MU_ASSERT(count > 0);
+    for (int i = 0; i < N_DEVICES; i++) {
+        device_t *device = &s_devices[i];
+        MU_ASSERT(device->in_order);
+        MU_ASSERT(device->short_latency_refused);
+        MU_ASSERT(device->received > 3000); // two reports a second
+        MU_ASSERT(mu_pdes_lp_drop_count(&s_lps[i]) == 0);
+        MU_ASSERT(mu_pdes_lp_now(&s_lps[i]) == 1000 + ONE_HOUR);
+        checksums[i] = device->checksum;
+    }
+    // The asap start tasks ran at the start time.
+    MU_ASSERT(mu_pdes_round_count(&s_pdes) > 0);
+
+    // The same run gives the same results on any number of threads...
+    for (size_t n_threads = 2; n_threads <= 5; n_threads++) {
+        setup();
+        MU_ASSERT(mu_pdes_run_until(&s_pdes, 1000 + ONE_HOUR, n_threads) ==
+                  count);
+        for (int i = 0; i < N_DEVICES; i++) {
+            MU_ASSERT(s_devices[i].in_order);
+            MU_ASSERT(s_devices[i].checksum == checksums[i]);
+        }
+    }
+
+    // ...and when run in installments.
+    setup();
+    counts[0] = mu_pdes_run_until(&s_pdes, 1000 + ONE_HOUR / 3, 4);
+    MU_ASSERT(mu_pdes_lp_now(&s_lps[0]) == 1000 + ONE_HOUR / 3);
+    counts[1] = mu_pdes_run_until(&s_pdes, 1000 + ONE_HOUR, 3);
+    MU_ASSERT(counts[0] + counts[1] == count);
+    for (int i = 0; i < N_DEVICES; i++) {
+        MU_ASSERT(s_devices[i].checksum == checksums[i]);
+    }
+
+    // More threads than LPs are not an error.
+    setup();
+    MU_ASSERT(mu_pdes_run_until(&s_pdes, 1000 + ONE_HOUR, 100) == count);
+
+    mu_sched_init();
+    printf("\n...test_mu_pdes complete\n");
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+static void setup(void) {
+    for (int i = 0; i < N_DEVICES; i++) {
+        device_t *device = &s_devices[i];
+        mu_sched_t *sched = mu_sched_inst_init(
+            &device->sched, device->irq_store, DEVICE_IRQ_TASKS,
+            device->asap_store, DEVICE_ASAP_TASKS, device->deferred_store,
+            DEVICE_DEFERRED_TASKS);
+        mu_pdes_lp_init(&s_lps[i], sched, device->inbox_store, DEVICE_INBOX,
+                        device->outbox_store, DEVICE_OUTBOX);
+        mu_task_init(&device->start_task, start_task_fn, 0, device);
+        mu_task_init(&device->sample_task, sample_task_fn, 0, device);
+        mu_task_init(&device->receive_task, receive_task_fn, 0, device);
+        device->rng = 12345u + 1000u * (uint32_t)i;
+        device->checksum = 0;
+        device->received = 0;
+        device->last_received_at = 0;
+        device->in_order = true;
+        device->short_latency_refused = false;
+    }
+    MU_ASSERT(mu_pdes_init(&s_pdes, s_lps, N_DEVICES, LOOKAHEAD, 1000) ==
+              &s_pdes);
+    for (int i = 0; i < N_DEVICES; i++) {
+        mu_sched_t *sched = mu_pdes_lp_sched(&s_lps[i]);
+        MU_ASSERT(mu_sched_inst_get_current_time(sched) == 1000);
+        MU_ASSERT(mu_sched_inst_asap(sched, &s_devices[i].start_task) ==
+                  MU_TASK_ERR_NONE);
+    }
+}
+
+static device_t *device_of(mu_pdes_lp_t *lp) {
+    return &s_devices[lp - s_lps];
+}
+
+static void start_task_fn(mu_task_t *task, void *arg) {
+    (void)arg;
+    device_t *device = mu_task_get_user_info(task);
+    mu_pdes_lp_t *lp = mu_pdes_current_lp();
+    MU_ASSERT(device_of(lp) == device);
+    MU_ASSERT(mu_sched_get_current_time() == 1000);
+    device->short_latency_refused =
+        mu_pdes_send(lp, &device->receive_task, LOOKAHEAD - 1, 0) ==
+        MU_PDES_ERR_LATENCY;
+    // Every device samples at the same times, so reports arrive in ties.
+    mu_sched_defer_for(&device->sample_task, SAMPLE_INTERVAL);
+}
+
+static void sample_task_fn(mu_task_t *task, void *arg) {
+    (void)arg;
+    device_t *device = mu_task_get_user_info(task);
+    int i = device - s_devices;
+    device_t *peer1 = &s_devices[(i + 1) % N_DEVICES];
+    device_t *peer2 = &s_devices[(i + 5) % N_DEVICES];
+
+    device->rng = device->rng * 1103515245u + 12345u;
+    uint32_t reading = device->rng >> 16;
+    MU_ASSERT(mu_pdes_send(&s_lps[peer1 - s_devices], &peer1->receive_task,
+                           LOOKAHEAD + (reading % 4) * LOOKAHEAD / 2,
+                           reading) == MU_PDES_ERR_NONE);
+    MU_ASSERT(mu_pdes_send(&s_lps[peer2 - s_devices], &peer2->receive_task,
+                           LOOKAHEAD, reading) == MU_PDES_ERR_NONE);
+    mu_sched_defer_for(task, SAMPLE_INTERVAL);
+}
+
+static void receive_task_fn(mu_task_t *task, void *arg) {
+    device_t *device = mu_task_get_user_info(task);
+    const mu_pdes_msg_t *msg = arg;
+    mu_time_abs_t now = mu_sched_get_current_time();
+
+    if (now != msg->at || mu_time_precedes(now, device->last_received_at) ||
+        mu_pdes_current_lp() != &s_lps[device - s_devices]) {
+        device->in_order = false;
+    }
+    device->last_received_at = now;
+    device->received += 1;
+    device->checksum = device->checksum * 1099511628211u ^
+                       ((uint64_t)msg->at * 31 + msg->src * 7 + msg->data);
+}
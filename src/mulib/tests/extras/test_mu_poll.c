@@ -0,0 +1,195 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+// *****************************************************************************
+// Includes
+
+#include "mu_poll.h"
+#include "mu_sched.h"
+#include "mu_task.h"
+#include "mu_time.h"
+#include "test_support.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#define DELAY_MS 20
+#define MAX_STEPS 100
+
+// Bound on the cross-thread wakeup latency.  Typical latency is tens to a
+// hundred microseconds, mostly the host waking the sleeping thread; the bound
+// leaves room for sanitizers and loaded machines.
+#define MAX_WAKEUP_US 1000
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static counting_obj_t s_counting_obj;
+static mu_task_t s_reader_task;
+static int s_pipe[2];
+static char s_read_char;
+static double s_kick_ns; // wall time at which the other thread kicked us
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static mu_time_abs_t monotonic_clock(void);
+static double wall_ns(void);
+static double cpu_ns(void);
+static void reader_task_fn(mu_task_t *task, void *arg);
+static void *isr_thread(void *arg);
+static void *writer_thread(void *arg);
+static void sleep_ms(int ms);
+
+/**
+ * @brief Step the scheduler until the counting object has been called
+ * (at most MAX_STEPS times) and return the number of steps taken.
+ */
+static int step_until_called(int call_count);
+
+// *****************************************************************************
+// Public code
+
+void test_mu_poll(void) {
+    printf("\nStarting test_mu_poll...");
+    mu_task_t *task = counting_obj_task(counting_obj_init(&s_counting_obj));
+    pthread_t thread;
+    double t0, cpu0;
+    int steps;
+
+    mu_sched_init();
+    mu_sched_set_clock_source(monotonic_clock);
+    MU_ASSERT(mu_poll_init() == true);
+    mu_sched_set_idle_task(mu_poll_idle_task());
+
+    // Sleep until a deferred task is due, without spinning.
+    MU_ASSERT(mu_sched_defer_for(task, mu_time_ms_to_rel(DELAY_MS)) ==
+              MU_TASK_ERR_NONE);
+    t0 = wall_ns();
+    cpu0 = cpu_ns();
+    steps = step_until_called(1);
+    MU_ASSERT(counting_obj_get_call_count(&s_counting_obj) == 1);
+    MU_ASSERT(wall_ns() - t0 >= DELAY_MS * 1e6);
+    MU_ASSERT(steps < 10);
+    MU_ASSERT(cpu_ns() - cpu0 < DELAY_MS * 1e6 / 4);
+
+    // Nothing deferred: mu_sched_from_isr() from another thread wakes us.
+    pthread_create(&thread, NULL, isr_thread, task);
+    steps = step_until_called(2);
+    double latency_ns = wall_ns() - s_kick_ns;
+    pthread_join(thread, NULL);
+    MU_ASSERT(counting_obj_get_call_count(&s_counting_obj) == 2);
+    MU_ASSERT(steps < 10);
+    MU_ASSERT(latency_ns < MAX_WAKEUP_US * 1e3);
+    printf("\n   wakeup latency: %.1f us", latency_ns / 1000);
+
+    // A readable descriptor schedules its task.
+    MU_ASSERT(pipe(s_pipe) == 0);
+    mu_task_init(&s_reader_task, reader_task_fn, 0, NULL);
+    MU_ASSERT(mu_poll_add_fd(s_pipe[0], &s_reader_task) == true);
+    s_read_char = 0;
+    pthread_create(&thread, NULL, writer_thread, NULL);
+    for (int i = 0; i < MAX_STEPS && s_read_char == 0; i++) {
+        mu_sched_step();
+    }
+    pthread_join(thread, NULL);
+    MU_ASSERT(s_read_char == 'x');
+    MU_ASSERT(mu_poll_remove_fd(s_pipe[0]) == true);
+    MU_ASSERT(mu_poll_remove_fd(s_pipe[0]) == false);
+    close(s_pipe[0]);
+    close(s_pipe[1]);
+
+    // A task that is already due doesn't block.
+    MU_ASSERT(mu_sched_defer_for(task, 0) == MU_TASK_ERR_NONE);
+    mu_poll_wait();
+    mu_sched_step();
+    MU_ASSERT(counting_obj_get_call_count(&s_counting_obj) == 3);
+
+    mu_poll_deinit();
+    mu_sched_init();
+    printf("\n...test_mu_poll complete\n");
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+static mu_time_abs_t monotonic_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (mu_time_abs_t)ts.tv_sec * MU_TIME_TICKS_PER_SECOND +
+           (mu_time_abs_t)ts.tv_nsec / (1000000000 / MU_TIME_TICKS_PER_SECOND);
+}
+
+static double wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void reader_task_fn(mu_task_t *task, void *arg) {
+    (void)task;
+    (void)arg;
+    MU_ASSERT(read(s_pipe[0], &s_read_char, 1) == 1);
+}
+
+static void *isr_thread(void *arg) {
+    sleep_ms(DELAY_MS / 2);
+    s_kick_ns = wall_ns();
+    mu_sched_from_isr((mu_task_t *)arg);
+    return NULL;
+}
+
+static void *writer_thread(void *arg) {
+    (void)arg;
+    sleep_ms(DELAY_MS / 2);
+    MU_ASSERT(write(s_pipe[1], "x", 1) == 1);
+    return NULL;
+}
+
+static void sleep_ms(int ms) {
+    struct timespec ts = {.tv_sec = 0, .tv_nsec = ms * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+static int step_until_called(int call_count) {
+    int steps = 0;
+    while (steps < MAX_STEPS &&
+           counting_obj_get_call_count(&s_counting_obj) < call_count) {
+        mu_sched_step();
+        steps += 1;
+    }
+    return steps;
+}
@@ -0,0 +1,121 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+// *****************************************************************************
+// Includes
+
+#include "mu_ringbuf.h"
+#include "mu_ringbuf_host.h"
+#include "test_support.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#define MSG_LEN 100
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static uint8_t s_msg[MSG_LEN];
+
+// *****************************************************************************
+// Public code
+
+void test_mu_ringbuf_host(void) {
+    printf("\nStarting test_mu_ringbuf_host...");
+    uint32_t capacity = (uint32_t)sysconf(_SC_PAGESIZE);
+    mu_ringbuf_t rb;
+    mu_ringbuf_span_t spans[2];
+    uint8_t buf[MSG_LEN];
+    int fds[2];
+
+    for (int i = 0; i < MSG_LEN; i++) {
+        s_msg[i] = (uint8_t)i;
+    }
+
+    // The capacity must be a whole number of pages.
+    MU_ASSERT(mu_ringbuf_host_init(&rb, capacity / 2) == false);
+    MU_ASSERT(mu_ringbuf_host_init(&rb, capacity) == true);
+    MU_ASSERT(mu_ringbuf_capacity(&rb) == capacity);
+
+    // The second mapping aliases the first.
+    rb.store[1] = 'a';
+    MU_ASSERT(rb.store[capacity + 1] == 'a');
+    rb.store[capacity + 2] = 'b';
+    MU_ASSERT(rb.store[2] == 'b');
+
+    // Move the indices to just short of the end of the store.
+    mu_ringbuf_reserve_write(&rb, spans);
+    mu_ringbuf_commit_write(&rb, capacity - MSG_LEN / 2);
+    mu_ringbuf_peek_read(&rb, spans);
+    mu_ringbuf_consume(&rb, capacity - MSG_LEN / 2);
+
+    // Free space and data that wrap are still one contiguous span.
+    MU_ASSERT(mu_ringbuf_reserve_write(&rb, spans) == capacity);
+    MU_ASSERT(spans[0].len == capacity);
+    MU_ASSERT(spans[1].len == 0);
+    memcpy(spans[0].data, s_msg, MSG_LEN);
+    MU_ASSERT(mu_ringbuf_commit_write(&rb, MSG_LEN) == MSG_LEN);
+    MU_ASSERT(mu_ringbuf_peek_read(&rb, spans) == MSG_LEN);
+    MU_ASSERT(spans[0].len == MSG_LEN);
+    MU_ASSERT(spans[1].len == 0);
+    MU_ASSERT(memcmp(spans[0].data, s_msg, MSG_LEN) == 0);
+    // ...and the bytes past the end landed at the start of the store.
+    MU_ASSERT(memcmp(rb.store, &s_msg[MSG_LEN / 2], MSG_LEN / 2) == 0);
+
+    // Drain the ring into a pipe and read it back in.
+    MU_ASSERT(pipe(fds) == 0);
+    MU_ASSERT(mu_ringbuf_host_write_fd(&rb, fds[1]) == MSG_LEN);
+    MU_ASSERT(mu_ringbuf_is_empty(&rb));
+    MU_ASSERT(mu_ringbuf_host_write_fd(&rb, fds[1]) == 0);
+    MU_ASSERT(mu_ringbuf_host_read_fd(&rb, fds[0]) == MSG_LEN);
+    MU_ASSERT(mu_ringbuf_read(&rb, buf, sizeof(buf)) == MSG_LEN);
+    MU_ASSERT(memcmp(buf, s_msg, MSG_LEN) == 0);
+    mu_ringbuf_host_deinit(&rb);
+
+    // The same I/O works on an ordinary ring, where it wraps in two spans.
+    static uint8_t store[128];
+    MU_ASSERT(mu_ringbuf_init(&rb, store, sizeof(store)) == MU_RINGBUF_ERR_NONE);
+    MU_ASSERT(mu_ringbuf_write(&rb, store, 64) == 64);
+    MU_ASSERT(mu_ringbuf_read(&rb, buf, 64) == 64);
+    MU_ASSERT(write(fds[1], s_msg, MSG_LEN) == MSG_LEN);
+    MU_ASSERT(mu_ringbuf_host_read_fd(&rb, fds[0]) == MSG_LEN);
+    MU_ASSERT(mu_ringbuf_peek_read(&rb, spans) == MSG_LEN);
+    MU_ASSERT(spans[0].len == 64);
+    MU_ASSERT(spans[1].len == MSG_LEN - 64);
+    MU_ASSERT(mu_ringbuf_host_write_fd(&rb, fds[1]) == MSG_LEN);
+    MU_ASSERT(read(fds[0], buf, sizeof(buf)) == MSG_LEN);
+    MU_ASSERT(memcmp(buf, s_msg, MSG_LEN) == 0);
+
+    close(fds[0]);
+    close(fds[1]);
+    printf("\n...test_mu_ringbuf_host complete\n");
+}
@@ -0,0 +1,130 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_sched.h"
+#include "mu_task.h"
+#include "test_support.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#define N_EVENTS 200000
+
+// A task standing in for a UART rx handler: an "interrupt" counts an event
+// and schedules the task, which consumes every event counted so far.
+typedef struct {
+    mu_task_t task;
+    volatile uint32_t pending_events; // updated atomically
+    uint32_t handled_events;
+    uint32_t sched_full;              // MU_TASK_ERR_SCHED_FULL count
+} rx_obj_t;
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static volatile bool s_storm_done;
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+/**
+ * @brief Raise N_EVENTS "interrupts" on rx, on another thread, while the
+ * scheduler drains.  Return the number of scheduling errors.
+ */
+static uint32_t run_storm(rx_obj_t *rx, bool dedup);
+
+static void rx_task_fn(mu_task_t *task, void *arg);
+static void *storm_thread(void *arg);
+
+// *****************************************************************************
+// Public code
+
+void test_mu_sched_dedup(void) {
+    printf("\nStarting test_mu_sched_dedup...");
+    rx_obj_t plain, dedup;
+
+    // Without deduplication, events outrun the irq queue.  With it, the task
+    // is queued at most once, so the queue can't overflow.  No events are
+    // lost either way: the task consumes every event counted before it runs.
+    uint32_t plain_full = run_storm(&plain, false);
+    uint32_t dedup_full = run_storm(&dedup, true);
+    MU_ASSERT(plain.handled_events == N_EVENTS);
+    MU_ASSERT(dedup.handled_events == N_EVENTS);
+    MU_ASSERT(dedup_full == 0);
+    printf("\n   %d events: %u queue-full errors without dedup, %u with dedup",
+           N_EVENTS, plain_full, dedup_full);
+
+    mu_sched_init();
+    printf("\n...test_mu_sched_dedup complete\n");
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+static uint32_t run_storm(rx_obj_t *rx, bool dedup) {
+    pthread_t thread;
+
+    mu_sched_init();
+    mu_task_init(&rx->task, rx_task_fn, 0, NULL);
+    mu_sched_set_dedup(&rx->task, dedup);
+    rx->pending_events = 0;
+    rx->handled_events = 0;
+    rx->sched_full = 0;
+
+    s_storm_done = false;
+    pthread_create(&thread, NULL, storm_thread, rx);
+    while (!__atomic_load_n(&s_storm_done, __ATOMIC_ACQUIRE)) {
+        mu_sched_drain();
+    }
+    pthread_join(thread, NULL);
+    while (mu_sched_drain() > 0) {
+    }
+    return rx->sched_full;
+}
+
+static void rx_task_fn(mu_task_t *task, void *arg) {
+    rx_obj_t *rx = MU_TASK_CTX(task, rx_obj_t, task);
+    (void)arg;
+    rx->handled_events +=
+        __atomic_exchange_n(&rx->pending_events, 0, __ATOMIC_ACQ_REL);
+}
+
+static void *storm_thread(void *arg) {
+    rx_obj_t *rx = (rx_obj_t *)arg;
+    for (int i = 0; i < N_EVENTS; i++) {
+        __atomic_add_fetch(&rx->pending_events, 1, __ATOMIC_ACQ_REL);
+        if (mu_sched_from_isr(&rx->task) == MU_TASK_ERR_SCHED_FULL) {
+            rx->sched_full += 1;
+        }
+    }
+    __atomic_store_n(&s_storm_done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
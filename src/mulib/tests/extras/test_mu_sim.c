@@ -0,0 +1,177 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "mu_sched.h"
+#include "mu_sim.h"
+#include "mu_task.h"
+#include "mu_time.h"
+#include "test_support.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#define ONE_SECOND ((mu_time_rel_t)MU_TIME_TICKS_PER_SECOND)
+#define ONE_DAY (86400 * ONE_SECOND)
+#define POLL_INTERVAL (60 * ONE_SECOND)
+#define N_YIELDS 5
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static mu_task_t s_poll_task;
+static int s_poll_count;
+static mu_time_abs_t s_last_poll_at;
+static int s_stop_after; // mu_sim_stop() on this poll, 0 to never stop
+
+static mu_task_t s_yield_task;
+static int s_yield_count;
+static bool s_time_moved; // true if virtual time changed between yields
+static mu_time_abs_t s_yield_at;
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static void poll_task_fn(mu_task_t *task, void *arg);
+static void yield_task_fn(mu_task_t *task, void *arg);
+static void setup(void);
+static double wall_ns(void);
+
+// *****************************************************************************
+// Public code
+
+void test_mu_sim(void) {
+    printf("\nStarting test_mu_sim...");
+    counting_obj_t far_obj;
+    mu_task_t *far_task = counting_obj_task(counting_obj_init(&far_obj));
+    double t0;
+
+    // A day of polling once a minute takes no time at all.
+    setup();
+    MU_ASSERT(mu_sched_get_current_time() == 1000);
+    MU_ASSERT(mu_sched_defer_for(&s_poll_task, POLL_INTERVAL) ==
+              MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_defer_for(far_task, 2 * ONE_DAY) == MU_TASK_ERR_NONE);
+    t0 = wall_ns();
+    MU_ASSERT(mu_sim_run_until(1000 + ONE_DAY) == 24 * 60);
+    MU_ASSERT(wall_ns() - t0 < 1e9);
+    MU_ASSERT(s_poll_count == 24 * 60);
+    MU_ASSERT(s_last_poll_at == 1000 + ONE_DAY); // tasks due at end are run
+    MU_ASSERT(mu_sim_now() == 1000 + ONE_DAY);
+    MU_ASSERT(counting_obj_get_call_count(&far_obj) == 0);
+
+    // Nothing left to do before end: time still advances to end.
+    mu_sched_remove_deferred_task(&s_poll_task);
+    MU_ASSERT(mu_sim_run_until(1000 + ONE_DAY + ONE_SECOND) == 0);
+    MU_ASSERT(mu_sim_now() == 1000 + ONE_DAY + ONE_SECOND);
+    MU_ASSERT(mu_sim_run_until(1000 + 2 * ONE_DAY) == 1);
+    MU_ASSERT(counting_obj_get_call_count(&far_obj) == 1);
+
+    // Time stands still while asap work is pending.
+    setup();
+    MU_ASSERT(mu_sched_defer_for(&s_poll_task, ONE_SECOND) ==
+              MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_asap(&s_yield_task) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sim_run_until(1000 + ONE_SECOND) == N_YIELDS + 1);
+    MU_ASSERT(s_yield_count == N_YIELDS);
+    MU_ASSERT(s_time_moved == false);
+    MU_ASSERT(s_poll_count == 1);
+
+    // mu_sim_stop() ends the run early, leaving time where it stopped.
+    setup();
+    s_stop_after = 10;
+    MU_ASSERT(mu_sched_defer_for(&s_poll_task, POLL_INTERVAL) ==
+              MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sim_run_until(1000 + ONE_DAY) == 10);
+    MU_ASSERT(mu_sim_now() == 1000 + 10 * POLL_INTERVAL);
+    s_stop_after = 0;
+    MU_ASSERT(mu_sim_run_until(1000 + 20 * POLL_INTERVAL) == 10);
+
+    // mu_sim_advance_to() never moves time backwards.
+    mu_sim_advance_to(1000);
+    MU_ASSERT(mu_sim_now() == 1000 + 20 * POLL_INTERVAL);
+
+    // Paced: 2 virtual seconds at 100x take at least 20 ms of wall time, even
+    // though the only task is due after 1 second.
+    setup();
+    mu_sim_set_speed(100);
+    MU_ASSERT(mu_sched_defer_for(&s_poll_task, ONE_SECOND) ==
+              MU_TASK_ERR_NONE);
+    t0 = wall_ns();
+    MU_ASSERT(mu_sim_run_until(1000 + 2 * ONE_SECOND) == 1);
+    MU_ASSERT(wall_ns() - t0 >= 19e6);
+    MU_ASSERT(wall_ns() - t0 < 1e9);
+
+    mu_sched_init();
+    printf("\n...test_mu_sim complete\n");
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+static void poll_task_fn(mu_task_t *task, void *arg) {
+    (void)arg;
+    s_poll_count += 1;
+    s_last_poll_at = mu_sched_get_current_time();
+    if (s_poll_count == s_stop_after) {
+        mu_sim_stop();
+    }
+    mu_sched_defer_for(task, POLL_INTERVAL);
+}
+
+static void yield_task_fn(mu_task_t *task, void *arg) {
+    (void)arg;
+    mu_time_abs_t now = mu_sched_get_current_time();
+    if (s_yield_count > 0 && now != s_yield_at) {
+        s_time_moved = true;
+    }
+    s_yield_at = now;
+    s_yield_count += 1;
+    if (s_yield_count < N_YIELDS) {
+        mu_sched_asap(task);
+    }
+}
+
+static void setup(void) {
+    mu_sched_init();
+    mu_sim_init(1000);
+    mu_task_init(&s_poll_task, poll_task_fn, 0, NULL);
+    s_poll_count = 0;
+    s_last_poll_at = 0;
+    s_stop_after = 0;
+    mu_task_init(&s_yield_task, yield_task_fn, 0, NULL);
+    s_yield_count = 0;
+    s_time_moved = false;
+}
+
+static double wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
@@ -0,0 +1,237 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 R. Dunbar Poor <rdpoor@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+// *****************************************************************************
+// Includes
+
+#include "mu_sched.h"
+#include "mu_snap.h"
+#include "mu_task.h"
+#include "mu_time.h"
+#include "mu_timer.h"
+#include "test_support.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// *****************************************************************************
+// Local (private) types and definitions
+
+#define N_TASKS 4
+#define N_TIMERS 1
+#define MAX_RUNS 16
+
+// An application object saved as a region.
+typedef struct {
+    int setpoint;
+    char mode[6];
+} model_t;
+
+// *****************************************************************************
+// Local (private, static) storage
+
+static mu_time_abs_t s_now;
+static mu_task_t s_tasks[N_TASKS];
+static mu_task_t s_stray_task; // not in the task table
+static mu_task_t *s_task_table[N_TASKS];
+static mu_timer_t s_timer;
+static mu_timer_t *s_timer_table[N_TIMERS] = {&s_timer};
+static mu_snap_index_t s_index[N_TASKS + N_TIMERS];
+static model_t s_model;
+static mu_snap_region_t s_regions[] = {
+    {.key = 0x6d6f646c, .data = &s_model, .size = sizeof(s_model)},
+};
+static mu_snap_t s_snap;
+static char s_path[] = "/tmp/test_mu_snap_XXXXXX";
+
+// The order in which tasks ran, as indices into s_tasks.
+static int s_runs[MAX_RUNS];
+static mu_time_abs_t s_run_at[MAX_RUNS];
+static int s_run_count;
+
+// *****************************************************************************
+// Local (private, static) forward declarations
+
+static mu_time_abs_t fake_clock(void);
+static void task_fn(mu_task_t *task, void *arg);
+static void setup(void);
+static void run_until(mu_time_abs_t end);
+
+// *****************************************************************************
+// Public code
+
+void test_mu_snap(void) {
+    printf("\nStarting test_mu_snap...");
+    mu_time_abs_t saved_at;
+    int fd = mkstemp(s_path);
+    MU_ASSERT(fd >= 0);
+    close(fd);
+
+    // A task may appear in the tables only once.
+    setup();
+    s_task_table[1] = s_task_table[0];
+    MU_ASSERT(mu_snap_init(&s_snap, mu_sched_default_instance(), s_task_table,
+                           N_TASKS, s_timer_table, N_TIMERS, s_index) == NULL);
+
+    // Save a scheduler with tasks in every queue, a running timer and a model.
+    setup();
+    s_now = 1000;
+    mu_task_set_state(&s_tasks[0], 3);
+    mu_task_set_state(&s_tasks[2], 7);
+    s_model.setpoint = 21500;
+    strcpy(s_model.mode, "heat");
+    MU_ASSERT(mu_sched_defer_until(&s_tasks[0], 1100) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_defer_until(&s_tasks[1], 1100) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_defer_until(&s_tasks[2], 1050) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_asap(&s_tasks[3]) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_sched_from_isr(&s_tasks[1]) == MU_TASK_ERR_NONE);
+    mu_timer_start(&s_timer, 300, false, &s_tasks[2]);
+    MU_ASSERT(mu_snap_save(&s_snap, s_path) == MU_SNAP_ERR_NONE);
+
+    // The scheduler is unchanged by saving: run it for reference.
+    run_until(2000);
+    MU_ASSERT(s_run_count == 6);
+    int runs[MAX_RUNS];
+    mu_time_abs_t run_at[MAX_RUNS];
+    memcpy(runs, s_runs, sizeof(runs));
+    memcpy(run_at, s_run_at, sizeof(run_at));
+    MU_ASSERT(runs[0] == 1 && runs[1] == 3); // irq, then asap
+    MU_ASSERT(runs[2] == 2 && run_at[2] == 1050);
+    MU_ASSERT(runs[3] == 0 && runs[4] == 1 && run_at[4] == 1100);
+    MU_ASSERT(runs[5] == 2 && run_at[5] == 1300); // timer completion
+
+    // A fresh start restores everything, and runs the same way.
+    setup();
+    s_now = 5000; // not used: the snapshot keeps its times
+    MU_ASSERT(mu_snap_restore(&s_snap, s_path, false, &saved_at) ==
+              MU_SNAP_ERR_NONE);
+    MU_ASSERT(saved_at == 1000);
+    MU_ASSERT(mu_task_get_state(&s_tasks[0]) == 3);
+    MU_ASSERT(mu_task_get_state(&s_tasks[2]) == 7);
+    MU_ASSERT(s_model.setpoint == 21500);
+    MU_ASSERT(strcmp(s_model.mode, "heat") == 0);
+    MU_ASSERT(mu_timer_is_running(&s_timer));
+    MU_ASSERT(s_timer.on_completion == &s_tasks[2]);
+    s_now = saved_at;
+    run_until(2000);
+    MU_ASSERT(s_run_count == 6);
+    MU_ASSERT(memcmp(runs, s_runs, sizeof(runs)) == 0);
+    MU_ASSERT(memcmp(run_at, s_run_at, sizeof(run_at)) == 0);
+
+    // Rebased, each deferred task is due as far ahead as when it was saved.
+    setup();
+    s_now = 5000;
+    MU_ASSERT(mu_snap_restore(&s_snap, s_path, true, NULL) ==
+              MU_SNAP_ERR_NONE);
+    mu_time_abs_t at;
+    MU_ASSERT(mu_sched_next_deadline(&at) && at == 5050);
+    MU_ASSERT(s_timer.delay_until == 5300);
+
+    // A scheduler with tasks queued can't be restored into.
+    MU_ASSERT(mu_snap_restore(&s_snap, s_path, true, NULL) ==
+              MU_SNAP_ERR_BUSY);
+
+    // Tables that differ from the snapshot's are refused.
+    setup();
+    MU_ASSERT(mu_snap_init(&s_snap, mu_sched_default_instance(), s_task_table,
+                           N_TASKS - 1, s_timer_table, N_TIMERS,
+                           s_index) == &s_snap);
+    MU_ASSERT(mu_snap_restore(&s_snap, s_path, false, NULL) ==
+              MU_SNAP_ERR_MISMATCH);
+    setup();
+    s_regions[0].size -= 1;
+    MU_ASSERT(mu_snap_restore(&s_snap, s_path, false, NULL) ==
+              MU_SNAP_ERR_MISMATCH);
+    s_regions[0].size += 1;
+
+    // So are damaged files.
+    setup();
+    MU_ASSERT(truncate(s_path, 100) == 0);
+    MU_ASSERT(mu_snap_restore(&s_snap, s_path, false, NULL) ==
+              MU_SNAP_ERR_FORMAT);
+    MU_ASSERT(mu_sched_peek_next_task() == NULL);
+    unlink(s_path);
+    MU_ASSERT(mu_snap_restore(&s_snap, s_path, false, NULL) ==
+              MU_SNAP_ERR_IO);
+
+    // Every queued task must be in the tables.
+    setup();
+    MU_ASSERT(mu_sched_asap(&s_stray_task) == MU_TASK_ERR_NONE);
+    MU_ASSERT(mu_snap_save(&s_snap, s_path) == MU_SNAP_ERR_UNKNOWN_TASK);
+    MU_ASSERT(access(s_path, F_OK) != 0);
+
+    mu_sched_init();
+    printf("\n...test_mu_snap complete\n");
+}
+
+// *****************************************************************************
+// Local (private, static) code
+
+static mu_time_abs_t fake_clock(void) { return s_now; }
+
+static void task_fn(mu_task_t *task, void *arg) {
+    (void)arg;
+    if (s_run_count < MAX_RUNS) {
+        s_runs[s_run_count] = task - s_tasks;
+        s_run_at[s_run_count] = s_now;
+    }
+    s_run_count += 1;
+}
+
+static void setup(void) {
+    mu_sched_init();
+    mu_sched_set_clock_source(fake_clock);
+    s_now = 0;
+    for (int i = 0; i < N_TASKS; i++) {
+        mu_task_init(&s_tasks[i], task_fn, 0, NULL);
+        s_task_table[i] = &s_tasks[i];
+    }
+    mu_task_init(&s_stray_task, task_fn, 0, NULL);
+    mu_timer_init(&s_timer);
+    memset(&s_model, 0, sizeof(s_model));
+    memset(s_runs, 0, sizeof(s_runs));
+    memset(s_run_at, 0, sizeof(s_run_at));
+    s_run_count = 0;
+    MU_ASSERT(mu_snap_init(&s_snap, mu_sched_default_instance(), s_task_table,
+                           N_TASKS, s_timer_table, N_TIMERS,
+                           s_index) == &s_snap);
+    mu_snap_set_regions(&s_snap, s_regions, 1);
+}
+
+static void run_until(mu_time_abs_t end) {
+    mu_time_abs_t at;
+    while (true) {
+        if (mu_sched_drain() > 0) {
+            continue;
+        }
+        if (!mu_sched_next_deadline(&at) || mu_time_follows(at, end)) {
+            break;
+        }
+        s_now = at;
+    }
+}
@@ -0,0 +1,28 @@
+#include "test_support.h"
+
+#include <stdio.h>
+
+void test_mu_exec(void);
+void test_mu_pdes(void);
+void test_mu_poll(void);
+void test_mu_ringbuf_host(void);
+void test_mu_sim(void);
+void test_mu_snap(void);
+void test_mu_sched_dedup(void);
+
+void test_mulib_extras(void) {
+	printf("\nStarting test_mulib_extras...");
+	test_mu_exec();
+	test_mu_pdes();
+	test_mu_poll();
+	test_mu_ringbuf_host();
+	test_mu_sim();
+	test_mu_snap();
+	test_mu_sched_dedup();
+	printf("\nCompleted test_mulib_extras\n");
+}
+
+int main(void) {
+	test_mulib_extras();
+	return 0;
+}
@@ -0,0 +1,201 @@
+/**
+ * @file sched_report.c
+ *
+ * MIT License
+ *
+ * Copyright (c) 2023 PRO1 IAQ, INC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// *****************************************************************************
+// Includes
+
+#include "sched_report.h"
+
+#include "jems.h"
+#include "mulib/core/mu_sched.h"
+#include "mulib/core/mu_task.h"
+#include "mulib/platform/mu_time.h"
+#include "task_info.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(MU_CONFIG_SCHED_STATS) || defined(MU_CONFIG_SCHED_LOAD)
+
+// *****************************************************************************
+// Private types and definitions
+
+// root object, "queues" object, queue object, histogram object, buckets array
+#define MAX_JEMS_LEVELS 5
+
+typedef struct {
+    char *buf;
+    size_t buflen;
+    size_t written;
+} writer_state_t;
+
+// *****************************************************************************
+// Private (static) storage
+
+// *****************************************************************************
+// Private (static, forward) declarations
+
+static void jems_writer(char ch, uintptr_t arg);
+
+#ifdef MU_CONFIG_SCHED_STATS
+
+/**
+ * @brief Emit a histogram as the value of key.
+ */
+static void emit_hist(jems_t *jems, const char *key,
+                      const mu_sched_hist_t *hist);
+
+#endif
+
+// *****************************************************************************
+// Public code
+
+#ifdef MU_CONFIG_SCHED_STATS
+
+const char *sched_report_dump_json(char *buf, size_t buflen) {
+    // It's safe to allocate writer_state and jems_levels on the stack because
+    // we stay within dynamic scope of this function until JSON has been
+    // written. Use buflen-1 to always leave space for null termination.
+    writer_state_t writer_state = {
+        .buf = buf, .buflen = buflen - 1, .written = 0};
+    jems_level_t jems_levels[MAX_JEMS_LEVELS];
+    jems_t jems;
+    const mu_sched_stats_t *stats = mu_sched_get_stats();
+
+    jems_init(&jems, jems_levels, MAX_JEMS_LEVELS, jems_writer,
+              (uintptr_t)(&writer_state));
+    jems_object_open(&jems);
+    jems_key_integer(&jems, "ticks_per_second", MU_TIME_TICKS_PER_SECOND);
+    emit_hist(&jems, "lateness", &stats->lateness);
+    jems_key_object_open(&jems, "queues");
+    for (int queue = 0; queue < MU_SCHED_QUEUE_COUNT; queue++) {
+        const mu_sched_queue_stats_t *queue_stats = &stats->queues[queue];
+        jems_key_object_open(&jems, mu_sched_queue_name(queue));
+        jems_key_integer(&jems, "capacity", queue_stats->capacity);
+        jems_key_integer(&jems, "high_water", queue_stats->high_water);
+        jems_key_integer(&jems, "sched_full", queue_stats->sched_full);
+        emit_hist(&jems, "wait", &queue_stats->wait);
+        jems_object_close(&jems);
+    }
+    jems_object_close(&jems);
+    jems_object_close(&jems);
+    // null terminate the string in buf
+    buf[writer_state.written] = '\0';
+    return buf;
+}
+
+const char *sched_report_dump_task_json(mu_task_t *task, char *buf,
+                                        size_t buflen) {
+    writer_state_t writer_state = {
+        .buf = buf, .buflen = buflen - 1, .written = 0};
+    jems_level_t jems_levels[MAX_JEMS_LEVELS];
+    jems_t jems;
+
+    jems_init(&jems, jems_levels, MAX_JEMS_LEVELS, jems_writer,
+              (uintptr_t)(&writer_state));
+    jems_object_open(&jems);
+    jems_key_string(&jems, "task", task_info_task_name(task));
+    if (task->lateness == NULL) {
+        jems_key_null(&jems, "lateness");
+    } else {
+        emit_hist(&jems, "lateness", task->lateness);
+    }
+    jems_object_close(&jems);
+    buf[writer_state.written] = '\0';
+    return buf;
+}
+
+#endif // MU_CONFIG_SCHED_STATS
+
+#ifdef MU_CONFIG_SCHED_LOAD
+
+const char *sched_report_dump_load_json(char *buf, size_t buflen) {
+    writer_state_t writer_state = {
+        .buf = buf, .buflen = buflen - 1, .written = 0};
+    jems_level_t jems_levels[MAX_JEMS_LEVELS];
+    jems_t jems;
+    const mu_sched_load_t *load = mu_sched_get_load();
+
+    jems_init(&jems, jems_levels, MAX_JEMS_LEVELS, jems_writer,
+              (uintptr_t)(&writer_state));
+    jems_object_open(&jems);
+    jems_key_integer(&jems, "ticks_per_second", MU_TIME_TICKS_PER_SECOND);
+    jems_key_integer(&jems, "busy", (int64_t)load->busy);
+    jems_key_integer(&jems, "idle", (int64_t)load->idle);
+    jems_key_integer(&jems, "tasks_run", load->tasks_run);
+    jems_key_integer(&jems, "idle_steps", load->idle_steps);
+    jems_key_array_open(&jems, "utilization");
+    for (int n = 0; n < MU_CONFIG_SCHED_LOAD_WINDOWS; n++) {
+        const mu_sched_load_window_t *window = &load->windows[n];
+        if (window->length <= 0) {
+            continue;
+        }
+        jems_object_open(&jems);
+        jems_key_integer(&jems, "window", window->length);
+        jems_key_number(&jems, "percent",
+                        window->utilization * 100.0 / MU_SCHED_LOAD_FULL);
+        jems_object_close(&jems);
+    }
+    jems_array_close(&jems);
+    jems_object_close(&jems);
+    buf[writer_state.written] = '\0';
+    return buf;
+}
+
+#endif // MU_CONFIG_SCHED_LOAD
+
+// *****************************************************************************
+// Private (static) code
+
+static void jems_writer(char ch, uintptr_t arg) {
+    writer_state_t *writer_state = (writer_state_t *)arg;
+    if (writer_state->written < writer_state->buflen) {
+        writer_state->buf[writer_state->written++] = ch;
+    }
+}
+
+#ifdef MU_CONFIG_SCHED_STATS
+
+static void emit_hist(jems_t *jems, const char *key,
+                      const mu_sched_hist_t *hist) {
+    int n_buckets = MU_CONFIG_SCHED_STATS_BUCKETS;
+
+    while (n_buckets > 0 && hist->buckets[n_buckets - 1] == 0) {
+        n_buckets -= 1;
+    }
+    jems_key_object_open(jems, key);
+    jems_key_integer(jems, "count", hist->count);
+    jems_key_integer(jems, "max", hist->max);
+    jems_key_array_open(jems, "buckets");
+    for (int i = 0; i < n_buckets; i++) {
+        jems_integer(jems, hist->buckets[i]);
+    }
+    jems_array_close(jems);
+    jems_object_close(jems);
+}
+
+#endif
+
+#endif // MU_CONFIG_SCHED_STATS || MU_CONFIG_SCHED_LOAD
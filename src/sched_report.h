@@ -0,0 +1,100 @@
+/**
+ * @file sched_report.h
+ *
+ * MIT License
+ *
+ * Copyright (c) 2023 PRO1 IAQ, INC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @brief Dump mu_sched statistics and load as JSON.
+ *
+ * Statistics require mulib to be compiled with MU_CONFIG_SCHED_STATS, and load
+ * with MU_CONFIG_SCHED_LOAD.  Histograms are
+ * written as {"count":n, "max":m, "buckets":[...]}, where buckets[0] counts
+ * values of zero or less and buckets[b] counts values in [2^(b-1), 2^b) mu_time
+ * units.  Trailing empty buckets are omitted.
+ */
+
+#ifndef _SCHED_REPORT_H_
+#define _SCHED_REPORT_H_
+
+// *****************************************************************************
+// Includes
+
+#include "mulib/core/mu_sched.h"
+#include "mulib/core/mu_task.h"
+#include <stddef.h>
+
+// *****************************************************************************
+// C++ compatibility
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// Public types and definitions
+
+// *****************************************************************************
+// Public declarations
+
+#ifdef MU_CONFIG_SCHED_STATS
+
+/**
+ * @brief Write the scheduler statistics into buf as a JSON object.
+ *
+ * The output is truncated if buf is too small and is always null terminated.
+ * @return buf
+ */
+const char *sched_report_dump_json(char *buf, size_t buflen);
+
+/**
+ * @brief Write a task's name and lateness histogram into buf as a JSON object.
+ *
+ * See mu_sched_set_lateness_hist().  If no histogram is attached to the task,
+ * its lateness is written as null.
+ * @return buf
+ */
+const char *sched_report_dump_task_json(mu_task_t *task, char *buf,
+                                        size_t buflen);
+
+#endif // MU_CONFIG_SCHED_STATS
+
+#ifdef MU_CONFIG_SCHED_LOAD
+
+/**
+ * @brief Write the scheduler load into buf as a JSON object.
+ *
+ * Busy and idle times are in mu_time units, and each utilization window in use
+ * is written as {"window":length, "percent":p}.  See mu_sched_get_load().  The
+ * output is truncated if buf is too small and is always null terminated.
+ * @return buf
+ */
+const char *sched_report_dump_load_json(char *buf, size_t buflen);
+
+#endif // MU_CONFIG_SCHED_LOAD
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* #ifndef _SCHED_REPORT_H_ */
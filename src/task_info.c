@@ -65,6 +65,27 @@ static void task_call_hook(mu_task_t *task);
 static void state_change_hook(mu_task_t *task, mu_task_state_t from_state,
                               mu_task_state_t to_state);
 
+#ifdef MU_CONFIG_TASK_WATCHDOG
+
+/**
+ * @brief Called when a task call exceeds the watchdog budget.
+ */
+static void overrun_hook(mu_task_t *task, mu_task_state_t state,
+                         mu_time_rel_t elapsed);
+
+/**
+ * @brief Log one line of a watchdog report.
+ */
+static void report_timing(const char *task_name, const char *state_name,
+                          const mu_task_timing_t *timing);
+
+/**
+ * @brief Convert a duration to microseconds for logging.
+ */
+static long to_us(mu_time_rel_t dt);
+
+#endif
+
 // *****************************************************************************
 // Public code
 
@@ -113,6 +134,27 @@ void task_info(mu_task_t *task, mu_task_state_t terminal_state,
     mu_task_transfer(task, terminal_state, continuation);
 }
 
+#ifdef MU_CONFIG_TASK_WATCHDOG
+
+void task_info_watchdog_init(mu_time_rel_t budget) {
+    mu_task_set_watchdog(budget, overrun_hook);
+}
+
+void task_info_watchdog_report(mu_task_t *task) {
+    const char *task_name = task_info_task_name(task);
+
+    report_timing(task_name, "*", mu_task_get_timing(task));
+    for (size_t state = 0; state < task->n_state_timing; state++) {
+        const char *state_name = task_info_state_name(task, state);
+        if (state_name == NULL) {
+            state_name = "unknown_state";
+        }
+        report_timing(task_name, state_name, &task->state_timing[state]);
+    }
+}
+
+#endif
+
 // *****************************************************************************
 // Private (static) code
 
@@ -146,5 +188,41 @@ static void state_change_hook(mu_task_t *task, mu_task_state_t from_state,
     }
 }
 
+#ifdef MU_CONFIG_TASK_WATCHDOG
+
+static void overrun_hook(mu_task_t *task, mu_task_state_t state,
+                         mu_time_rel_t elapsed) {
+    // Called from mu_task_call() after the task returns: report only the names,
+    // which is all that's needed to find the offending code.
+    const char *state_name = task_info_state_name(task, state);
+    if (state_name == NULL) {
+        state_name = "unknown_state";
+    }
+    MU_LOG_WARN("watchdog: %s: %s ran %ld us", task_info_task_name(task),
+                state_name, to_us(elapsed));
+}
+
+static void report_timing(const char *task_name, const char *state_name,
+                          const mu_task_timing_t *timing) {
+    if (timing->calls == 0) {
+        return;
+    }
+    MU_LOG_INFO("watchdog: %s: %s calls=%lu overruns=%lu max=%ld us "
+                "mean=%ld us",
+                task_name, state_name, (unsigned long)timing->calls,
+                (unsigned long)timing->overruns, to_us(timing->max),
+                to_us(timing->total / timing->calls));
+}
+
+static long to_us(mu_time_rel_t dt) {
+    // With nanosecond ticks, multiplying first would overflow after hours.
+    if (MU_TIME_TICKS_PER_SECOND >= 1000000) {
+        return (long)(dt / (MU_TIME_TICKS_PER_SECOND / 1000000));
+    }
+    return (long)((dt * 1000000) / MU_TIME_TICKS_PER_SECOND);
+}
+
+#endif
+
 // *****************************************************************************
 // End of file
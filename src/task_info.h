@@ -85,6 +85,22 @@ const char *task_info_state_name(mu_task_t *task, mu_task_state_t state);
 void task_info_endgame(mu_task_t *from, mu_task_state_t terminal_state,
                        bool had_error, mu_task_t *continuation);
 
+#ifdef MU_CONFIG_TASK_WATCHDOG
+
+/**
+ * @brief Log a warning naming the task and state whenever a single task call
+ * runs longer than budget.  A budget of zero turns the warnings off.
+ */
+void task_info_watchdog_init(mu_time_rel_t budget);
+
+/**
+ * @brief Log the run time of a task's calls at MU_LOG_INFO level, and of each
+ * of its states by name if mu_task_set_state_timing() has been called.
+ */
+void task_info_watchdog_report(mu_task_t *task);
+
+#endif // MU_CONFIG_TASK_WATCHDOG
+
 // *****************************************************************************
 // End of file
 
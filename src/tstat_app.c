@@ -30,6 +30,7 @@
 
 #include "tstat_app.h"
 
+#include "mulib/core/mu_sched.h"
 #include "mulib/core/mu_task.h"
 #include "mulib/extras/mu_log.h"
 #include "task_info.h"
@@ -160,7 +161,9 @@ static void tstat_app_fn(mu_task_t *task, void *arg) {
     case TSTAT_APP_STATE_UPDATE_MODEL: {
         // update local copy of the model
         logic_update_model(&self->model);
-        mu_task_yield(task, TSTAT_APP_STATE_START_PUSH_MODEL);
+        // Pushing the model drives the relays: don't wait behind bulk work.
+        mu_task_yield_prio(task, TSTAT_APP_STATE_START_PUSH_MODEL,
+                           MU_SCHED_PRIO_HIGHEST);
     } break;
 
     case TSTAT_APP_STATE_START_PUSH_MODEL: {